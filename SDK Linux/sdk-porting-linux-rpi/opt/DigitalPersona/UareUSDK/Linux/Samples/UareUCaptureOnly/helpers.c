@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <time.h>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // error handling
@@ -40,7 +41,7 @@ void print_error(const char* szFunctionName, int nError){
 // capture
 
 DPFPDD_DEV g_hReader = NULL;
-int        g_bCancel = 0;
+volatile sig_atomic_t g_bCancel = 0;
 
 void signal_handler(int nSignal) {
 	if(SIGINT == nSignal){
@@ -50,6 +51,40 @@ void signal_handler(int nSignal) {
 	}
 }
 
+//the status is polled while the reader is busy, with the sleep in between doubled up to the maximum
+#define READY_POLL_MIN_MS 1
+#define READY_POLL_MAX_MS 16
+
+//waits until the reader is ready to capture; returns 0 if ready, EINTR if canceled, otherwise an error code;
+//the library notifies of no status change, so instead of spinning on dpfpdd_get_device_status() the thread sleeps
+//between the polls, and Ctrl-C cuts the sleep short
+static int wait_until_ready(DPFPDD_DEV hReader){
+	unsigned int nDelay = READY_POLL_MIN_MS;
+	while(!g_bCancel){
+		DPFPDD_DEV_STATUS ds;
+		ds.size = sizeof(DPFPDD_DEV_STATUS);
+		int result = dpfpdd_get_device_status(hReader, &ds);
+		if(DPFPDD_SUCCESS != result){
+			print_error("dpfpdd_get_device_status()", result);
+			return result;
+		}
+
+		if(DPFPDD_STATUS_FAILURE == ds.status){
+			print_error("Reader failure", DPFPDD_STATUS_FAILURE);
+			return DPFPDD_E_DEVICE_FAILURE;
+		}
+		if(DPFPDD_STATUS_READY == ds.status || DPFPDD_STATUS_NEED_CALIBRATION == ds.status) return 0;
+
+		//busy
+		struct timespec ts;
+		ts.tv_sec = 0;
+		ts.tv_nsec = (long)nDelay * 1000000;
+		nanosleep(&ts, NULL);
+		if(READY_POLL_MAX_MS > nDelay) nDelay <<= 1;
+	}
+	return EINTR;
+}
+
 int CaptureFinger(DPFPDD_DEV hReader, int bStream){
 	int result = 0;
 
@@ -127,26 +162,8 @@ int CaptureFinger(DPFPDD_DEV hReader, int bStream){
 	g_bCancel = 0;
 	while(!g_bCancel){
 		//wait until ready
-		int is_ready = 0;
-		while(!g_bCancel){
-			DPFPDD_DEV_STATUS ds;
-			ds.size = sizeof(DPFPDD_DEV_STATUS);
-			result = dpfpdd_get_device_status(hReader, &ds);
-			if(DPFPDD_SUCCESS != result){
-				print_error("dpfpdd_get_device_status()", result);
-				break;
-			}
-			
-			if(DPFPDD_STATUS_FAILURE == ds.status){
-				print_error("Reader failure", DPFPDD_STATUS_FAILURE);
-				break;
-			}
-			if(DPFPDD_STATUS_READY == ds.status || DPFPDD_STATUS_NEED_CALIBRATION == ds.status){
-				is_ready = 1;
-				break;
-			}
-		}
-		if(!is_ready) break;
+		result = wait_until_ready(hReader);
+		if(0 != result) break;
 
 		if(0 == bStream){
 			//capture fingerprint
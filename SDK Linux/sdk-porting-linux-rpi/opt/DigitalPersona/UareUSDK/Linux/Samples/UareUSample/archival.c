@@ -0,0 +1,41 @@
+/* 
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "archival.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "helpers.h"
+#include "archiver.h"
+
+#define ARCHIVAL_MEMORY_LIMIT (64 * 1024 * 1024) //images in flight
+#define ARCHIVAL_BITRATE      75                 //0.75 bpp
+
+static int read_line(const char* szPrompt, char* szBuffer, size_t nBufferSize){
+	printf("%s: ", szPrompt);
+	if(NULL == fgets(szBuffer, nBufferSize, stdin)) return 0;
+	szBuffer[strcspn(szBuffer, "\r\n")] = '\0';
+	return '\0' != szBuffer[0];
+}
+
+void Archival(){
+	char szInDir[PATH_MAX];
+	char szOutDir[PATH_MAX];
+
+	printf("Archival started\n\n");
+	printf("Uncompressed ISO 19794-4 images are compressed with WSQ and written under the same names.\n\n");
+	if(!read_line("Directory with the images", szInDir, sizeof(szInDir))) return;
+	if(!read_line("Directory for the compressed images", szOutDir, sizeof(szOutDir))) return;
+
+	archiver_stats_t stats;
+	int result = Archiver_Run(szInDir, szOutDir, 0, ARCHIVAL_MEMORY_LIMIT, ARCHIVAL_BITRATE, &stats);
+	if(0 == result){
+		printf("\nArchived: %u, skipped: %u, failed: %u.\n\n\n", stats.nArchivedCnt, stats.nSkippedCnt, stats.nFailedCnt);
+	}
+	else print_error("Archiver_Run()", result);
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "archiver.h"
+#include "compressor.h"
+
+#include <dpfj.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ARCHIVER_MAX_WORKERS 16
+
+typedef struct archiver_item_s {
+	struct archiver_item_s* pNext;
+	char                    szName[NAME_MAX + 1];
+	unsigned char*          pFid;
+	unsigned int            nFidSize;
+	unsigned char*          pData;      //compressed FID
+	unsigned int            nDataSize;
+	unsigned int            nReserved;  //bytes charged against the memory limit
+	int                     nResult;
+} archiver_item_t;
+
+typedef struct {
+	archiver_item_t* pHead;
+	archiver_item_t* pTail;
+	int              bClosed;       //no more items will be added
+	pthread_cond_t   cond;
+} archiver_queue_t;
+
+typedef struct {
+	const char*      szOutDir;
+	unsigned int     nBitrate;
+	pthread_mutex_t  mutex;
+	pthread_cond_t   condMemory;
+	unsigned int     nMemoryLimit;
+	unsigned int     nMemoryUsed;
+	archiver_queue_t queueEncode;
+	archiver_queue_t queueWrite;
+	unsigned int     nEncoderCnt;   //encoders still running, the write queue is closed by the last one
+	archiver_stats_t stats;
+} archiver_t;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// queues, must be called with the mutex locked
+
+static void queue_push(archiver_queue_t* pQueue, archiver_item_t* pItem){
+	pItem->pNext = NULL;
+	if(NULL != pQueue->pTail) pQueue->pTail->pNext = pItem;
+	else pQueue->pHead = pItem;
+	pQueue->pTail = pItem;
+	pthread_cond_signal(&pQueue->cond);
+}
+
+//waits for an item, returns NULL when the queue is closed and empty
+static archiver_item_t* queue_pop(archiver_t* pArchiver, archiver_queue_t* pQueue){
+	while(NULL == pQueue->pHead && !pQueue->bClosed) pthread_cond_wait(&pQueue->cond, &pArchiver->mutex);
+
+	archiver_item_t* pItem = pQueue->pHead;
+	if(NULL != pItem){
+		pQueue->pHead = pItem->pNext;
+		if(NULL == pQueue->pHead) pQueue->pTail = NULL;
+	}
+	return pItem;
+}
+
+static void queue_close(archiver_queue_t* pQueue){
+	pQueue->bClosed = 1;
+	pthread_cond_broadcast(&pQueue->cond);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// memory limit
+
+//waits until nSize bytes fit into the limit; a single item larger than the limit is let through
+//when nothing else is in flight, otherwise it would wait forever
+static void memory_reserve(archiver_t* pArchiver, unsigned int nSize){
+	pthread_mutex_lock(&pArchiver->mutex);
+	while(0 != pArchiver->nMemoryUsed && pArchiver->nMemoryUsed + nSize > pArchiver->nMemoryLimit){
+		pthread_cond_wait(&pArchiver->condMemory, &pArchiver->mutex);
+	}
+	pArchiver->nMemoryUsed += nSize;
+	pthread_mutex_unlock(&pArchiver->mutex);
+}
+
+static void memory_release(archiver_t* pArchiver, unsigned int nSize){
+	pthread_mutex_lock(&pArchiver->mutex);
+	pArchiver->nMemoryUsed -= nSize;
+	pthread_cond_broadcast(&pArchiver->condMemory);
+	pthread_mutex_unlock(&pArchiver->mutex);
+}
+
+static void count(archiver_t* pArchiver, unsigned int* pnCounter){
+	pthread_mutex_lock(&pArchiver->mutex);
+	(*pnCounter)++;
+	pthread_mutex_unlock(&pArchiver->mutex);
+}
+
+static void free_item(archiver_t* pArchiver, archiver_item_t* pItem){
+	memory_release(pArchiver, pItem->nReserved);
+	if(NULL != pItem->pFid) free(pItem->pFid);
+	if(NULL != pItem->pData) free(pItem->pData);
+	free(pItem);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// pipeline stages
+
+//checks the ISO 19794-4-2005 record header: format identifier, record length and compression
+static int check_fid(const unsigned char* pFid, unsigned int nFidSize){
+	if(DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH + DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH > nFidSize) return 0;
+	if(0 != memcmp(pFid, "FIR\0", 4)) return 0;
+
+	DPFJ_FID_RECORD_PARAMS params;
+	dpfj_get_fid_record_params(DPFJ_FID_ISO_19794_4_2005, pFid, &params);
+	if(params.record_length != nFidSize) return 0;
+
+	//0 - uncompressed, 1 - uncompressed bit packed, everything else is compressed already
+	return 0 == params.compression;
+}
+
+static int read_file(const char* szPath, unsigned char* pBuffer, unsigned int nSize){
+	FILE* pFile = fopen(szPath, "rb");
+	if(NULL == pFile) return errno;
+	int result = (nSize == fread(pBuffer, 1, nSize, pFile)) ? 0 : EIO;
+	fclose(pFile);
+	return result;
+}
+
+//written under a hidden temporary name and renamed, a file of the final name is always complete
+static int write_file(const char* szDir, const char* szName, const unsigned char* pBuffer, unsigned int nSize){
+	char szPath[PATH_MAX];
+	char szTempPath[PATH_MAX];
+	if(sizeof(szPath) <= (size_t)snprintf(szPath, sizeof(szPath), "%s/%s", szDir, szName)) return ENAMETOOLONG;
+	if(sizeof(szTempPath) <= (size_t)snprintf(szTempPath, sizeof(szTempPath), "%s/.%s.tmp", szDir, szName)) return ENAMETOOLONG;
+
+	FILE* pFile = fopen(szTempPath, "wb");
+	if(NULL == pFile) return errno;
+	int result = (nSize == fwrite(pBuffer, 1, nSize, pFile)) ? 0 : EIO;
+	if(0 != fclose(pFile) && 0 == result) result = errno;
+	if(0 == result && 0 != rename(szTempPath, szPath)) result = errno;
+	if(0 != result) unlink(szTempPath);
+	return result;
+}
+
+static void* encoder_thread(void* pContext){
+	archiver_t* pArchiver = (archiver_t*)pContext;
+
+	compressor_t* pCompressor = NULL;
+	int result = Compressor_Create(DPFJ_COMPRESSION_WSQ_NIST, &pCompressor);
+	if(0 == result) result = Compressor_SetBitrate(pCompressor, pArchiver->nBitrate, 0);
+
+	while(1){
+		pthread_mutex_lock(&pArchiver->mutex);
+		archiver_item_t* pItem = queue_pop(pArchiver, &pArchiver->queueEncode);
+		pthread_mutex_unlock(&pArchiver->mutex);
+		if(NULL == pItem) break;
+
+		//output buffer is the size of the input, WSQ is always a lot smaller than the raw image
+		pItem->nResult = result;
+		if(0 == pItem->nResult){
+			pItem->pData = (unsigned char*)malloc(pItem->nFidSize);
+			pItem->nDataSize = pItem->nFidSize;
+			if(NULL == pItem->pData) pItem->nResult = ENOMEM;
+		}
+		if(0 == pItem->nResult){
+			pItem->nResult = Compressor_CompressFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, pItem->pFid, pItem->nFidSize, pItem->pData, &pItem->nDataSize);
+		}
+		//tiny images can grow because of the WSQ tables, the extra memory is charged without waiting
+		if(DPFJ_E_MORE_DATA == pItem->nResult){
+			unsigned char* pData = (unsigned char*)realloc(pItem->pData, pItem->nDataSize);
+			if(NULL == pData) pItem->nResult = ENOMEM;
+			else{
+				pthread_mutex_lock(&pArchiver->mutex);
+				pArchiver->nMemoryUsed += pItem->nDataSize - pItem->nFidSize;
+				pthread_mutex_unlock(&pArchiver->mutex);
+				pItem->nReserved += pItem->nDataSize - pItem->nFidSize;
+				pItem->pData = pData;
+				pItem->nResult = Compressor_CompressFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, pItem->pFid, pItem->nFidSize, pItem->pData, &pItem->nDataSize);
+			}
+		}
+
+		//the raw image is not needed anymore, give its memory back to the reader
+		free(pItem->pFid);
+		pItem->pFid = NULL;
+		memory_release(pArchiver, pItem->nFidSize);
+		pItem->nReserved -= pItem->nFidSize;
+
+		pthread_mutex_lock(&pArchiver->mutex);
+		queue_push(&pArchiver->queueWrite, pItem);
+		pthread_mutex_unlock(&pArchiver->mutex);
+	}
+
+	Compressor_Destroy(pCompressor);
+
+	pthread_mutex_lock(&pArchiver->mutex);
+	pArchiver->nEncoderCnt--;
+	if(0 == pArchiver->nEncoderCnt) queue_close(&pArchiver->queueWrite);
+	pthread_mutex_unlock(&pArchiver->mutex);
+	return NULL;
+}
+
+static void* writer_thread(void* pContext){
+	archiver_t* pArchiver = (archiver_t*)pContext;
+
+	while(1){
+		pthread_mutex_lock(&pArchiver->mutex);
+		archiver_item_t* pItem = queue_pop(pArchiver, &pArchiver->queueWrite);
+		pthread_mutex_unlock(&pArchiver->mutex);
+		if(NULL == pItem) break;
+
+		if(0 == pItem->nResult) pItem->nResult = write_file(pArchiver->szOutDir, pItem->szName, pItem->pData, pItem->nDataSize);
+
+		if(0 == pItem->nResult) count(pArchiver, &pArchiver->stats.nArchivedCnt);
+		else count(pArchiver, &pArchiver->stats.nFailedCnt);
+		free_item(pArchiver, pItem);
+	}
+	return NULL;
+}
+
+//reads the directory on the calling thread and feeds the encoders
+static void read_dir(archiver_t* pArchiver, DIR* pDir, const char* szInDir){
+	struct dirent* pEntry = NULL;
+	while(NULL != (pEntry = readdir(pDir))){
+		//a truncated path or name would read or write another file, it fails as ENAMETOOLONG does in write_file()
+		char szPath[PATH_MAX];
+		if(sizeof(szPath) <= (size_t)snprintf(szPath, sizeof(szPath), "%s/%s", szInDir, pEntry->d_name)
+			|| NAME_MAX < strlen(pEntry->d_name)){
+			count(pArchiver, &pArchiver->stats.nFailedCnt);
+			continue;
+		}
+
+		struct stat st;
+		if(0 != stat(szPath, &st) || !S_ISREG(st.st_mode)) continue;
+		if(DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH > st.st_size || UINT_MAX / 2 < st.st_size){
+			count(pArchiver, &pArchiver->stats.nSkippedCnt);
+			continue;
+		}
+
+		//raw image and compressed image are charged against the limit before the file is read
+		unsigned int nFidSize = (unsigned int)st.st_size;
+		memory_reserve(pArchiver, 2 * nFidSize);
+
+		archiver_item_t* pItem = (archiver_item_t*)calloc(1, sizeof(archiver_item_t));
+		if(NULL != pItem) pItem->pFid = (unsigned char*)malloc(nFidSize);
+		if(NULL == pItem || NULL == pItem->pFid){
+			if(NULL != pItem) free(pItem);
+			memory_release(pArchiver, 2 * nFidSize);
+			count(pArchiver, &pArchiver->stats.nFailedCnt);
+			continue;
+		}
+		memcpy(pItem->szName, pEntry->d_name, strlen(pEntry->d_name) + 1);
+		pItem->nFidSize = nFidSize;
+		pItem->nReserved = 2 * nFidSize;
+
+		int result = read_file(szPath, pItem->pFid, nFidSize);
+		if(0 != result || !check_fid(pItem->pFid, nFidSize)){
+			if(0 != result) count(pArchiver, &pArchiver->stats.nFailedCnt);
+			else count(pArchiver, &pArchiver->stats.nSkippedCnt);
+			free_item(pArchiver, pItem);
+			continue;
+		}
+
+		pthread_mutex_lock(&pArchiver->mutex);
+		queue_push(&pArchiver->queueEncode, pItem);
+		pthread_mutex_unlock(&pArchiver->mutex);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// archiver
+
+int Archiver_Run(const char* szInDir, const char* szOutDir, unsigned int nWorkerCnt, unsigned int nMemoryLimit,
+	unsigned int nBitrate, archiver_stats_t* pStats){
+	if(NULL == szInDir || NULL == szOutDir || NULL == pStats || 0 == nMemoryLimit || 0 == nBitrate) return EINVAL;
+	memset(pStats, 0, sizeof(archiver_stats_t));
+
+	if(0 == nWorkerCnt){
+		long nCpuCnt = sysconf(_SC_NPROCESSORS_ONLN);
+		nWorkerCnt = (0 < nCpuCnt) ? (unsigned int)nCpuCnt : 1;
+	}
+	if(ARCHIVER_MAX_WORKERS < nWorkerCnt) nWorkerCnt = ARCHIVER_MAX_WORKERS;
+
+	//the archives would replace the images they are read from
+	struct stat stIn;
+	struct stat stOut;
+	if(0 != stat(szInDir, &stIn) || 0 != stat(szOutDir, &stOut)) return errno;
+	if(stIn.st_dev == stOut.st_dev && stIn.st_ino == stOut.st_ino) return EINVAL;
+
+	DIR* pDir = opendir(szInDir);
+	if(NULL == pDir) return errno;
+
+	archiver_t archiver;
+	memset(&archiver, 0, sizeof(archiver));
+	archiver.szOutDir = szOutDir;
+	archiver.nBitrate = nBitrate;
+	archiver.nMemoryLimit = nMemoryLimit;
+	pthread_mutex_init(&archiver.mutex, NULL);
+	pthread_cond_init(&archiver.condMemory, NULL);
+	pthread_cond_init(&archiver.queueEncode.cond, NULL);
+	pthread_cond_init(&archiver.queueWrite.cond, NULL);
+
+	//start writer and encoders
+	pthread_t threadWriter;
+	pthread_t vThreadEncoder[ARCHIVER_MAX_WORKERS];
+	int result = pthread_create(&threadWriter, NULL, writer_thread, &archiver);
+	int bWriter = (0 == result);
+	unsigned int i = 0;
+	for(i = 0; 0 == result && i < nWorkerCnt; i++){
+		archiver.nEncoderCnt++;
+		result = pthread_create(&vThreadEncoder[i], NULL, encoder_thread, &archiver);
+		if(0 != result) archiver.nEncoderCnt--;
+	}
+	unsigned int nStarted = archiver.nEncoderCnt;
+
+	//without encoders the writer is stopped right away, otherwise the last encoder stops it
+	if(0 == nStarted){
+		pthread_mutex_lock(&archiver.mutex);
+		queue_close(&archiver.queueWrite);
+		pthread_mutex_unlock(&archiver.mutex);
+	}
+	else read_dir(&archiver, pDir, szInDir);
+
+	pthread_mutex_lock(&archiver.mutex);
+	queue_close(&archiver.queueEncode);
+	pthread_mutex_unlock(&archiver.mutex);
+
+	for(i = 0; i < nStarted; i++) pthread_join(vThreadEncoder[i], NULL);
+	if(bWriter) pthread_join(threadWriter, NULL);
+	closedir(pDir);
+
+	*pStats = archiver.stats;
+	pthread_cond_destroy(&archiver.queueWrite.cond);
+	pthread_cond_destroy(&archiver.queueEncode.cond);
+	pthread_cond_destroy(&archiver.condMemory);
+	pthread_mutex_destroy(&archiver.mutex);
+
+	//failure to start the threads is reported only if nothing was archived
+	return (0 == nStarted) ? result : 0;
+}
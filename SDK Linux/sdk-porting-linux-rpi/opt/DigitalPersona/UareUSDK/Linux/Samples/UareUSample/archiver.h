@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+//WSQ archival of a directory of ISO 19794-4 FIDs: files are read, checked, compressed and written
+//by a pipeline of threads; a file is read only when its buffers fit into the memory limit, so
+//the reader waits for the encoders and the writer instead of piling up images
+typedef struct {
+	unsigned int nArchivedCnt; //files compressed and written
+	unsigned int nSkippedCnt;  //files which are not uncompressed ISO 19794-4 FIDs
+	unsigned int nFailedCnt;   //files which failed to be read, compressed or written
+} archiver_stats_t;
+
+//nWorkerCnt of 0 starts one encoder per online CPU, nMemoryLimit is in bytes; the output directory must exist and
+//differ from the input one, every file appears in it only when complete;
+//returns 0 on success, otherwise DPFJ error code or errno
+int Archiver_Run(const char* szInDir, const char* szOutDir, unsigned int nWorkerCnt, unsigned int nMemoryLimit,
+	unsigned int nBitrate, archiver_stats_t* pStats);
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "asynccapture.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+void AsyncCapture_Deadline(int nTimeoutMs, struct timespec* pDeadline){
+	clock_gettime(CLOCK_REALTIME, pDeadline);
+	pDeadline->tv_sec += nTimeoutMs / 1000;
+	pDeadline->tv_nsec += (long)(nTimeoutMs % 1000) * 1000000;
+	if(1000000000 <= pDeadline->tv_nsec){
+		pDeadline->tv_sec++;
+		pDeadline->tv_nsec -= 1000000000;
+	}
+}
+
+void AsyncCapture_SetEvent(int fdEvent){
+	uint64_t nValue = 1;
+	if(sizeof(nValue) != write(fdEvent, &nValue, sizeof(nValue))){}
+}
+
+void AsyncCapture_ResetEvent(int fdEvent){
+	uint64_t nValue = 0;
+	if(sizeof(nValue) != read(fdEvent, &nValue, sizeof(nValue))){}
+}
+
+int AsyncCapture_Cancel(pthread_mutex_t* pMutex, pthread_cond_t* pCond, DPFPDD_DEV hReader, const int* pbInFlight,
+	const struct timespec* pDeadline){
+	pthread_mutex_lock(pMutex);
+	int bInFlight = *pbInFlight;
+	pthread_mutex_unlock(pMutex);
+	if(bInFlight) dpfpdd_cancel(hReader);
+
+	int result = 0;
+	pthread_mutex_lock(pMutex);
+	while(*pbInFlight && 0 == result) result = pthread_cond_timedwait(pCond, pMutex, pDeadline);
+	pthread_mutex_unlock(pMutex);
+	return result;
+}
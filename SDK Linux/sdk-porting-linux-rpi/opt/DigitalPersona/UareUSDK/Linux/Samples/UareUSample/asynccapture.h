@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <time.h>
+
+#include <dpfpdd.h>
+
+//pieces shared by the modules over dpfpdd_capture_async(): the library calls back on a thread of its own, the results
+//are queued under a mutex and an eventfd tells the event loop of the application that the queue is not empty
+
+//absolute CLOCK_REALTIME time nTimeoutMs from now, for pthread_cond_timedwait()
+void AsyncCapture_Deadline(int nTimeoutMs, struct timespec* pDeadline);
+
+//make the eventfd readable when the queue becomes non-empty, drain it when the queue becomes empty
+void AsyncCapture_SetEvent(int fdEvent);
+void AsyncCapture_ResetEvent(int fdEvent);
+
+//cancels the capture on the reader if *pbInFlight is set and waits for the callback to clear it, signaled on pCond;
+//the library may call back from within dpfpdd_cancel(), so the mutex must not be held by the caller;
+//returns ETIMEDOUT if the capture is still in flight at the deadline, its callback may still come then
+int  AsyncCapture_Cancel(pthread_mutex_t* pMutex, pthread_cond_t* pCond, DPFPDD_DEV hReader, const int* pbInFlight,
+	const struct timespec* pDeadline);
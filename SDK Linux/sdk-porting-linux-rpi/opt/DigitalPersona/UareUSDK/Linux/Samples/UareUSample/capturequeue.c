@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "capturequeue.h"
+#include "asynccapture.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// completion ring, must be called with the mutex locked
+
+//the request goes back to the free list, its completion has all the caller needs
+static void post_completion(capture_queue_t* pQueue, capture_request_t* pRequest, const capture_cqe_t* pCqe){
+	pQueue->vCqe[(pQueue->nCqHead + pQueue->nCqCnt) % pQueue->nDepth] = *pCqe;
+	if(0 == pQueue->nCqCnt) AsyncCapture_SetEvent(pQueue->fdEvent);
+	pQueue->nCqCnt++;
+
+	pRequest->bInFlight = 0;
+	pRequest->pNext = pQueue->pFree;
+	pQueue->pFree = pRequest;
+	pQueue->nInFlightCnt--;
+	pthread_cond_broadcast(&pQueue->condComplete);
+}
+
+static unsigned int take_completions(capture_queue_t* pQueue, capture_cqe_t* vCqe, unsigned int nMaxCnt){
+	unsigned int nCnt = (pQueue->nCqCnt < nMaxCnt) ? pQueue->nCqCnt : nMaxCnt;
+	unsigned int i = 0;
+	for(i = 0; i < nCnt; i++) vCqe[i] = pQueue->vCqe[(pQueue->nCqHead + i) % pQueue->nDepth];
+	pQueue->nCqHead = (pQueue->nCqHead + nCnt) % pQueue->nDepth;
+	pQueue->nCqCnt -= nCnt;
+	if(0 != nCnt && 0 == pQueue->nCqCnt) AsyncCapture_ResetEvent(pQueue->fdEvent);
+	return nCnt;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// captures
+
+//called by the library on its own thread, does only the copy and the posting
+static void DPAPICALL capture_callback(void* pContext, unsigned int nReserved, unsigned int nDataSize, void* pData){
+	capture_request_t* pRequest = (capture_request_t*)pContext;
+	capture_queue_t* pQueue = pRequest->pQueue;
+	DPFPDD_CAPTURE_CALLBACK_DATA_0* pCallbackData = (DPFPDD_CAPTURE_CALLBACK_DATA_0*)pData;
+	(void)nReserved;
+
+	capture_cqe_t cqe;
+	memset(&cqe, 0, sizeof(cqe));
+	cqe.nUserData = pRequest->sqe.nUserData;
+	cqe.pImage = pRequest->sqe.pImage;
+	cqe.nResult = DPFPDD_E_FAILURE;
+	if(NULL != pCallbackData && sizeof(DPFPDD_CAPTURE_CALLBACK_DATA_0) <= nDataSize){
+		cqe.nResult = pCallbackData->error;
+		if(DPFPDD_SUCCESS == cqe.nResult){
+			cqe.result = pCallbackData->capture_result;
+			if(NULL != pCallbackData->image_data){
+				cqe.nImageSize = pCallbackData->image_size;
+				if(cqe.nImageSize > pRequest->sqe.nImageSize) cqe.nResult = DPFPDD_E_MORE_DATA;
+				else if(cqe.pImage != pCallbackData->image_data) memcpy(cqe.pImage, pCallbackData->image_data, cqe.nImageSize);
+			}
+		}
+	}
+
+	pthread_mutex_lock(&pQueue->mutex);
+	post_completion(pQueue, pRequest, &cqe);
+	pthread_mutex_unlock(&pQueue->mutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// capture queue
+
+int CaptureQueue_Create(const DPFPDD_CAPTURE_PARAM* pParam, unsigned int nDepth, capture_queue_t** ppQueue){
+	if(NULL == pParam || 0 == nDepth || NULL == ppQueue) return EINVAL;
+	*ppQueue = NULL;
+
+	capture_queue_t* pQueue = (capture_queue_t*)calloc(1, sizeof(capture_queue_t));
+	if(NULL != pQueue){
+		pQueue->vRequest = (capture_request_t*)calloc(nDepth, sizeof(capture_request_t));
+		pQueue->vCqe = (capture_cqe_t*)calloc(nDepth, sizeof(capture_cqe_t));
+	}
+	if(NULL == pQueue || NULL == pQueue->vRequest || NULL == pQueue->vCqe){
+		if(NULL != pQueue && NULL != pQueue->vRequest) free(pQueue->vRequest);
+		if(NULL != pQueue && NULL != pQueue->vCqe) free(pQueue->vCqe);
+		if(NULL != pQueue) free(pQueue);
+		return ENOMEM;
+	}
+	pQueue->fdEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(-1 == pQueue->fdEvent){
+		int result = errno;
+		free(pQueue->vCqe);
+		free(pQueue->vRequest);
+		free(pQueue);
+		return result;
+	}
+
+	pthread_mutex_init(&pQueue->mutex, NULL);
+	pthread_cond_init(&pQueue->condComplete, NULL);
+	pQueue->cparam = *pParam;
+	pQueue->cparam.size = sizeof(DPFPDD_CAPTURE_PARAM);
+	pQueue->nDepth = nDepth;
+	unsigned int i = 0;
+	for(i = nDepth; i > 0; i--){
+		pQueue->vRequest[i - 1].pQueue = pQueue;
+		pQueue->vRequest[i - 1].pNext = pQueue->pFree;
+		pQueue->pFree = &pQueue->vRequest[i - 1];
+	}
+
+	*ppQueue = pQueue;
+	return 0;
+}
+
+void CaptureQueue_Destroy(capture_queue_t* pQueue){
+	if(NULL == pQueue) return;
+
+	//nothing is submitted anymore, the readers of the requests in flight stay as they are; one deadline for all of them
+	struct timespec deadline;
+	AsyncCapture_Deadline(CAPTURE_QUEUE_STOP_TIMEOUT_MS, &deadline);
+	int result = 0;
+	unsigned int i = 0;
+	for(i = 0; i < pQueue->nDepth; i++){
+		capture_request_t* pRequest = &pQueue->vRequest[i];
+		if(0 != AsyncCapture_Cancel(&pQueue->mutex, &pQueue->condComplete, pRequest->sqe.hReader, &pRequest->bInFlight, &deadline)){
+			result = ETIMEDOUT;
+		}
+	}
+	//a request not called back in time is the context of its callback, which also posts into the ring and signals
+	//the descriptor: the queue is left allocated then, a late callback must not find it freed
+	if(0 != result) return;
+
+	close(pQueue->fdEvent);
+	pthread_cond_destroy(&pQueue->condComplete);
+	pthread_mutex_destroy(&pQueue->mutex);
+	free(pQueue->vCqe);
+	free(pQueue->vRequest);
+	free(pQueue);
+}
+
+int CaptureQueue_Submit(capture_queue_t* pQueue, const capture_sqe_t* vSqe, unsigned int nSqeCnt, unsigned int* pnSubmitted){
+	if(NULL == pQueue || (NULL == vSqe && 0 != nSqeCnt) || NULL == pnSubmitted) return EINVAL;
+	*pnSubmitted = 0;
+
+	unsigned int i = 0;
+	for(i = 0; i < nSqeCnt; i++){
+		//a request is taken only if its completion will fit into the ring
+		pthread_mutex_lock(&pQueue->mutex);
+		capture_request_t* pRequest = NULL;
+		if(pQueue->nInFlightCnt + pQueue->nCqCnt < pQueue->nDepth && NULL != pQueue->pFree){
+			pRequest = pQueue->pFree;
+			pQueue->pFree = pRequest->pNext;
+			pRequest->pNext = NULL;
+			pRequest->sqe = vSqe[i];
+			pRequest->bInFlight = 1;
+			pQueue->nInFlightCnt++;
+		}
+		pthread_mutex_unlock(&pQueue->mutex);
+		if(NULL == pRequest) break;
+
+		//the callback can come before dpfpdd_capture_async() returns
+		int result = dpfpdd_capture_async(pRequest->sqe.hReader, &pQueue->cparam, pRequest, capture_callback);
+		if(DPFPDD_SUCCESS != result){
+			capture_cqe_t cqe;
+			memset(&cqe, 0, sizeof(cqe));
+			cqe.nUserData = pRequest->sqe.nUserData;
+			cqe.nResult = result;
+			cqe.pImage = pRequest->sqe.pImage;
+			pthread_mutex_lock(&pQueue->mutex);
+			post_completion(pQueue, pRequest, &cqe);
+			pthread_mutex_unlock(&pQueue->mutex);
+		}
+		(*pnSubmitted)++;
+	}
+	return 0;
+}
+
+int CaptureQueue_Reap(capture_queue_t* pQueue, capture_cqe_t* vCqe, unsigned int nMaxCnt, unsigned int nMinCnt,
+	int nTimeoutMs, unsigned int* pnReaped){
+	if(NULL == pQueue || NULL == vCqe || 0 == nMaxCnt || NULL == pnReaped) return EINVAL;
+	*pnReaped = 0;
+	if(nMinCnt > nMaxCnt) nMinCnt = nMaxCnt;
+	if(0 == nMinCnt) nMinCnt = 1;
+
+	struct timespec deadline;
+	if(0 < nTimeoutMs) AsyncCapture_Deadline(nTimeoutMs, &deadline);
+
+	pthread_mutex_lock(&pQueue->mutex);
+	while(pQueue->nCqCnt < nMinCnt && 0 != nTimeoutMs){
+		if(0 > nTimeoutMs) pthread_cond_wait(&pQueue->condComplete, &pQueue->mutex);
+		else if(ETIMEDOUT == pthread_cond_timedwait(&pQueue->condComplete, &pQueue->mutex, &deadline)) break;
+	}
+	*pnReaped = take_completions(pQueue, vCqe, nMaxCnt);
+	pthread_mutex_unlock(&pQueue->mutex);
+
+	return (0 != *pnReaped) ? 0 : ETIMEDOUT;
+}
+
+int CaptureQueue_Cancel(capture_queue_t* pQueue, DPFPDD_DEV hReader){
+	if(NULL == pQueue || NULL == hReader) return EINVAL;
+	return dpfpdd_cancel(hReader);
+}
+
+int CaptureQueue_GetEventFd(capture_queue_t* pQueue){
+	return (NULL != pQueue) ? pQueue->fdEvent : -1;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include <dpfpdd.h>
+
+//how long CaptureQueue_Destroy() waits for the canceled captures to be called back
+#define CAPTURE_QUEUE_STOP_TIMEOUT_MS 2000
+
+//capture to start: the image goes into the buffer of the caller
+typedef struct {
+	DPFPDD_DEV         hReader;
+	unsigned char*     pImage;
+	unsigned int       nImageSize;  //size of the buffer
+	unsigned long long nUserData;   //returned in the completion as it is
+} capture_sqe_t;
+
+//capture completed; the buffer of the submission is the caller's again
+typedef struct {
+	unsigned long long    nUserData;
+	int                   nResult;     //0 or DPFPDD error code, DPFPDD_E_MORE_DATA if the image did not fit into the buffer
+	DPFPDD_CAPTURE_RESULT result;
+	unsigned char*        pImage;
+	unsigned int          nImageSize;  //size of the image, also when it did not fit
+} capture_cqe_t;
+
+struct capture_queue;
+
+typedef struct capture_request {
+	struct capture_request* pNext;    //in the free list
+	struct capture_queue*   pQueue;
+	capture_sqe_t           sqe;
+	int                     bInFlight;
+} capture_request_t;
+
+//submission and completion queue over dpfpdd_capture_async(): the library calls back on a thread of its own, so the
+//callback only puts the image into the buffer which came with the submission and the result into the completion ring;
+//the application reaps the completions in batches on threads it owns, at the priority it chooses, or from its event
+//loop through the event descriptor; all memory is allocated when the queue is created, nDepth bounds the captures
+//in flight together with the completions not reaped yet, so the completion ring never overflows
+//
+//the image is copied once, in the callback: the library does not say whether its buffer outlives the callback,
+//and dpfpdd_capture_async() takes no buffer of the caller
+typedef struct capture_queue {
+	pthread_mutex_t      mutex;
+	pthread_cond_t       condComplete;  //signaled when a completion is posted
+	DPFPDD_CAPTURE_PARAM cparam;
+	unsigned int         nDepth;
+	capture_request_t*   vRequest;
+	capture_request_t*   pFree;
+	unsigned int         nInFlightCnt;
+	capture_cqe_t*       vCqe;          //completion ring of nDepth entries
+	unsigned int         nCqHead;       //oldest completion
+	unsigned int         nCqCnt;
+	int                  fdEvent;       //eventfd, readable while completions are waiting
+} capture_queue_t;
+
+//all functions return 0 on success, otherwise DPFPDD error code or errno
+int  CaptureQueue_Create(const DPFPDD_CAPTURE_PARAM* pParam, unsigned int nDepth, capture_queue_t** ppQueue);
+//cancels the captures in flight and waits for them, completions not reaped are dropped; if a capture is not called
+//back within CAPTURE_QUEUE_STOP_TIMEOUT_MS the queue is left allocated, the library may still call back
+void CaptureQueue_Destroy(capture_queue_t* pQueue);
+
+//starts the captures in order until the queue is full, pnSubmitted receives how many were taken; every capture taken
+//gets exactly one completion, a capture which fails to start gets it right away with the error
+int  CaptureQueue_Submit(capture_queue_t* pQueue, const capture_sqe_t* vSqe, unsigned int nSqeCnt, unsigned int* pnSubmitted);
+
+//takes up to nMaxCnt completions, waiting until at least nMinCnt are there; nTimeoutMs of -1 waits forever, 0 does not
+//wait; when the time runs out the completions which are there are taken, ETIMEDOUT is returned if there are none
+int  CaptureQueue_Reap(capture_queue_t* pQueue, capture_cqe_t* vCqe, unsigned int nMaxCnt, unsigned int nMinCnt,
+	int nTimeoutMs, unsigned int* pnReaped);
+
+//cancels the capture in flight on the reader, it completes with DPFPDD_QUALITY_CANCELED
+int  CaptureQueue_Cancel(capture_queue_t* pQueue, DPFPDD_DEV hReader);
+
+//descriptor for poll() or epoll, readable while completions are waiting to be reaped
+int  CaptureQueue_GetEventFd(capture_queue_t* pQueue);
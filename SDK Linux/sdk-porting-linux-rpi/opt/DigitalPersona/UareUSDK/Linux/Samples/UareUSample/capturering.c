@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "capturering.h"
+#include "asynccapture.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//every buffer starts on a cache line
+#define CAPTURE_RING_ALIGN 64
+
+static size_t align_size(size_t nSize){
+	return (nSize + CAPTURE_RING_ALIGN - 1) & ~(size_t)(CAPTURE_RING_ALIGN - 1);
+}
+
+//asks the reader for the size of the image, the capture is not started
+static int query_image_size(DPFPDD_DEV hReader, const DPFPDD_CAPTURE_PARAM* pParam, unsigned int* pnImageSize){
+	DPFPDD_CAPTURE_PARAM cparam = *pParam;
+	cparam.size = sizeof(cparam);
+	DPFPDD_CAPTURE_RESULT cresult = {0};
+	cresult.size = sizeof(cresult);
+	cresult.info.size = sizeof(cresult.info);
+
+	*pnImageSize = 0;
+	int result = dpfpdd_capture(hReader, &cparam, 0, &cresult, pnImageSize, NULL);
+	return (DPFPDD_E_MORE_DATA == result) ? 0 : ((DPFPDD_SUCCESS == result) ? DPFPDD_E_FAILURE : result);
+}
+
+static size_t slot_size(unsigned int nImageSize){
+	return align_size(nImageSize) + align_size(MAX_FMD_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// capture ring
+
+int CaptureRing_GetBufferSize(DPFPDD_DEV hReader, const DPFPDD_CAPTURE_PARAM* pParam, unsigned int nSlotCnt, size_t* pnSize){
+	if(NULL == hReader || NULL == pParam || 0 == nSlotCnt || NULL == pnSize) return EINVAL;
+
+	unsigned int nImageSize = 0;
+	int result = query_image_size(hReader, pParam, &nImageSize);
+	if(0 != result) return result;
+
+	*pnSize = nSlotCnt * slot_size(nImageSize);
+	return 0;
+}
+
+int CaptureRing_Create(DPFPDD_DEV hReader, const DPFPDD_CAPTURE_PARAM* pParam, DPFJ_FMD_FORMAT nFmdType,
+	unsigned int nSlotCnt, unsigned char* pBuffer, size_t nBufferSize, capture_ring_t** ppRing){
+	if(NULL == hReader || NULL == pParam || 0 == nSlotCnt || NULL == ppRing) return EINVAL;
+	*ppRing = NULL;
+
+	unsigned int nImageSize = 0;
+	int result = query_image_size(hReader, pParam, &nImageSize);
+	if(0 != result) return result;
+	size_t nSize = nSlotCnt * slot_size(nImageSize);
+	if(NULL != pBuffer && nBufferSize < nSize) return DPFJ_E_MORE_DATA;
+
+	capture_ring_t* pRing = (capture_ring_t*)calloc(1, sizeof(capture_ring_t));
+	if(NULL != pRing) pRing->vSlot = (capture_slot_t*)calloc(nSlotCnt, sizeof(capture_slot_t));
+	if(NULL != pRing && NULL != pRing->vSlot && NULL == pBuffer){
+		//page aligned, the pages are touched below
+		void* pMemory = NULL;
+		long nPageSize = sysconf(_SC_PAGESIZE);
+		if(0 == posix_memalign(&pMemory, (0 < nPageSize) ? (size_t)nPageSize : CAPTURE_RING_ALIGN, nSize)){
+			pBuffer = (unsigned char*)pMemory;
+			pRing->bOwnBuffer = 1;
+		}
+	}
+	if(NULL == pRing || NULL == pRing->vSlot || NULL == pBuffer){
+		if(NULL != pRing && NULL != pRing->vSlot) free(pRing->vSlot);
+		if(NULL != pRing) free(pRing);
+		return ENOMEM;
+	}
+
+	pRing->hReader = hReader;
+	pRing->cparam = *pParam;
+	pRing->cparam.size = sizeof(DPFPDD_CAPTURE_PARAM);
+	pRing->nFmdType = nFmdType;
+	pRing->nImageAlloc = nImageSize;
+	pRing->nSlotCnt = nSlotCnt;
+	pRing->pBuffer = pBuffer;
+	pthread_mutex_init(&pRing->mutex, NULL);
+	pthread_cond_init(&pRing->condReleased, NULL);
+	pthread_cond_init(&pRing->condCaptured, NULL);
+
+	//the pages are faulted in now rather than during the first captures
+	memset(pBuffer, 0, nSize);
+	unsigned int i = 0;
+	for(i = 0; i < nSlotCnt; i++){
+		capture_slot_t* pSlot = &pRing->vSlot[i];
+		pSlot->pImage = pBuffer + i * slot_size(nImageSize);
+		pSlot->pFmd = pSlot->pImage + align_size(nImageSize);
+	}
+
+	*ppRing = pRing;
+	return 0;
+}
+
+void CaptureRing_Destroy(capture_ring_t* pRing){
+	if(NULL == pRing) return;
+	pthread_cond_destroy(&pRing->condCaptured);
+	pthread_cond_destroy(&pRing->condReleased);
+	pthread_mutex_destroy(&pRing->mutex);
+	if(pRing->bOwnBuffer) free(pRing->pBuffer);
+	free(pRing->vSlot);
+	free(pRing);
+}
+
+int CaptureRing_Capture(capture_ring_t* pRing, unsigned int nTimeout, capture_slot_t** ppSlot){
+	if(NULL == pRing || NULL == ppSlot) return EINVAL;
+	*ppSlot = NULL;
+
+	//slots are taken in the ring order, the next one may still be with the matcher
+	pthread_mutex_lock(&pRing->mutex);
+	capture_slot_t* pSlot = &pRing->vSlot[pRing->nNext];
+	while(pSlot->bHeld && !pRing->bCancel) pthread_cond_wait(&pRing->condReleased, &pRing->mutex);
+	int bCancel = pRing->bCancel;
+	pRing->bCancel = 0;
+	//marked under the mutex, a cancel from now on is sent to the reader until the capture returns
+	if(!bCancel) pRing->bCapturing = 1;
+	pthread_mutex_unlock(&pRing->mutex);
+	if(bCancel) return ECANCELED;
+
+	memset(&pSlot->result, 0, sizeof(pSlot->result));
+	pSlot->result.size = sizeof(pSlot->result);
+	pSlot->result.info.size = sizeof(pSlot->result.info);
+	pSlot->nImageSize = pRing->nImageAlloc;
+	int result = dpfpdd_capture(pRing->hReader, &pRing->cparam, nTimeout, &pSlot->result, &pSlot->nImageSize, pSlot->pImage);
+
+	//the cancel reached the capture; one which came after the capture returned is left for the next call
+	pthread_mutex_lock(&pRing->mutex);
+	pRing->bCapturing = 0;
+	if(DPFPDD_SUCCESS == result && (pSlot->result.quality & DPFPDD_QUALITY_CANCELED)) pRing->bCancel = 0;
+	pthread_cond_broadcast(&pRing->condCaptured);
+	pthread_mutex_unlock(&pRing->mutex);
+	if(DPFPDD_SUCCESS != result) return result;
+
+	//features are extracted straight into the slot, MAX_FMD_SIZE saves the size query
+	pSlot->nFmdSize = 0;
+	pSlot->nFmdResult = DPFJ_E_FAILURE;
+	if(pSlot->result.success){
+		unsigned int nFmdSize = MAX_FMD_SIZE;
+		//ANSI and ISO image formats of the reader have the same values as the FID formats
+		if(DPFPDD_IMG_FMT_PIXEL_BUFFER == pRing->cparam.image_fmt){
+			pSlot->nFmdResult = dpfj_create_fmd_from_raw(pSlot->pImage, pSlot->nImageSize, pSlot->result.info.width,
+				pSlot->result.info.height, pSlot->result.info.res, DPFJ_POSITION_UNKNOWN, 0, pRing->nFmdType, pSlot->pFmd, &nFmdSize);
+		}
+		else{
+			pSlot->nFmdResult = dpfj_create_fmd_from_fid(pRing->cparam.image_fmt, pSlot->pImage, pSlot->nImageSize,
+				pRing->nFmdType, pSlot->pFmd, &nFmdSize);
+		}
+		if(DPFJ_SUCCESS == pSlot->nFmdResult) pSlot->nFmdSize = nFmdSize;
+	}
+
+	pthread_mutex_lock(&pRing->mutex);
+	pSlot->bHeld = 1;
+	pSlot->nSeq = pRing->nSeq++;
+	pRing->nNext = (pRing->nNext + 1) % pRing->nSlotCnt;
+	pthread_mutex_unlock(&pRing->mutex);
+
+	*ppSlot = pSlot;
+	return 0;
+}
+
+void CaptureRing_Release(capture_ring_t* pRing, capture_slot_t* pSlot){
+	if(NULL == pRing || NULL == pSlot) return;
+	pthread_mutex_lock(&pRing->mutex);
+	pSlot->bHeld = 0;
+	pthread_cond_broadcast(&pRing->condReleased);
+	pthread_mutex_unlock(&pRing->mutex);
+}
+
+int CaptureRing_Cancel(capture_ring_t* pRing){
+	if(NULL == pRing) return EINVAL;
+	pthread_mutex_lock(&pRing->mutex);
+	pRing->bCancel = 1;
+	pthread_cond_broadcast(&pRing->condReleased);
+
+	//the reader may not have started the capture yet and drops a cancel which comes before, so it is sent again
+	//until the capture returns or takes the flag; without a capture the flag alone cancels the next one
+	int result = DPFPDD_SUCCESS;
+	while(pRing->bCapturing && pRing->bCancel && DPFPDD_SUCCESS == result){
+		pthread_mutex_unlock(&pRing->mutex);
+		result = dpfpdd_cancel(pRing->hReader);
+		pthread_mutex_lock(&pRing->mutex);
+
+		struct timespec deadline;
+		AsyncCapture_Deadline(CAPTURE_RING_CANCEL_RETRY_MS, &deadline);
+		while(pRing->bCapturing && pRing->bCancel){
+			if(ETIMEDOUT == pthread_cond_timedwait(&pRing->condCaptured, &pRing->mutex, &deadline)) break;
+		}
+	}
+	pthread_mutex_unlock(&pRing->mutex);
+	return result;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <dpfpdd.h>
+#include <dpfj.h>
+
+//a cancel is sent again after this long until the capture it was sent to returns
+#define CAPTURE_RING_CANCEL_RETRY_MS 10
+
+//captured image and its features; the buffers belong to the ring and are valid until the slot is released
+typedef struct {
+	unsigned int          nSeq;         //number of the capture, counted from 0
+	DPFPDD_CAPTURE_RESULT result;       //check result.success and result.quality, a bad capture is handed out too
+	unsigned char*        pImage;
+	unsigned int          nImageSize;
+	int                   nFmdResult;   //DPFJ error code of the extraction
+	unsigned char*        pFmd;
+	unsigned int          nFmdSize;     //0 if nothing was extracted
+	int                   bHeld;        //handed out and not released yet
+} capture_slot_t;
+
+//ring of image and FMD buffers for capture loops which run for days: the image size is asked for once, all the buffers
+//are allocated and touched up front, and every capture is made and extracted straight into the next slot of the ring;
+//slots are handed to the matcher, possibly on another thread, and released back in any order, the capture waits
+//for the next slot if the matcher falls behind
+typedef struct {
+	DPFPDD_DEV           hReader;
+	DPFPDD_CAPTURE_PARAM cparam;
+	DPFJ_FMD_FORMAT      nFmdType;
+	unsigned int         nImageAlloc;   //size of every image buffer, as the reader reports it for the capture parameters
+	capture_slot_t*      vSlot;
+	unsigned int         nSlotCnt;
+	unsigned int         nNext;         //slot of the next capture
+	unsigned int         nSeq;
+	unsigned char*       pBuffer;
+	int                  bOwnBuffer;    //buffer was allocated by the ring
+	pthread_mutex_t      mutex;
+	pthread_cond_t       condReleased;  //also signaled by CaptureRing_Cancel()
+	pthread_cond_t       condCaptured;  //signaled when dpfpdd_capture() returns
+	int                  bCancel;       //canceled, taken by the capture it reaches
+	int                  bCapturing;    //dpfpdd_capture() is called or about to be
+} capture_ring_t;
+
+//all functions return 0 on success, otherwise DPFPDD or DPFJ error code or errno
+
+//size of the buffer needed for nSlotCnt slots, for callers which provide the memory themselves
+int  CaptureRing_GetBufferSize(DPFPDD_DEV hReader, const DPFPDD_CAPTURE_PARAM* pParam, unsigned int nSlotCnt, size_t* pnSize);
+
+//pBuffer of NULL lets the ring allocate the buffers, otherwise it must be nBufferSize bytes of at least the size
+//CaptureRing_GetBufferSize() returns, and stays owned by the caller
+int  CaptureRing_Create(DPFPDD_DEV hReader, const DPFPDD_CAPTURE_PARAM* pParam, DPFJ_FMD_FORMAT nFmdType,
+	unsigned int nSlotCnt, unsigned char* pBuffer, size_t nBufferSize, capture_ring_t** ppRing);
+//all slots must be released before
+void CaptureRing_Destroy(capture_ring_t* pRing);
+
+//captures into the next slot and extracts the features, nTimeout is in milliseconds as in dpfpdd_capture();
+//only one thread captures at a time; the slot is handed out whenever dpfpdd_capture() succeeds;
+//ECANCELED is returned if the capture is canceled while it waits for the slot
+int  CaptureRing_Capture(capture_ring_t* pRing, unsigned int nTimeout, capture_slot_t** ppSlot);
+void CaptureRing_Release(capture_ring_t* pRing, capture_slot_t* pSlot);
+
+//cancels the capture in progress or waiting for a slot, from any thread but the capturing one; a capture canceled
+//by the reader is handed out with DPFPDD_QUALITY_CANCELED, a cancel which comes between two captures makes the next
+//one return ECANCELED; dpfpdd_cancel() is sent every CAPTURE_RING_CANCEL_RETRY_MS until the capture returns, so a
+//cancel which comes just before the reader starts the capture is not lost; it returns once the capture has
+int  CaptureRing_Cancel(capture_ring_t* pRing);
@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "checksum.h"
+
+unsigned int Checksum_Fnv1a(const void* pData, size_t nSize, unsigned int nHash){
+	const unsigned char* p = (const unsigned char*)pData;
+	size_t i = 0;
+	for(i = 0; i < nSize; i++) nHash = (nHash ^ p[i]) * 16777619u;
+	return nHash;
+}
+
+unsigned long long Checksum_Fnv1a64(const void* pData, size_t nSize, unsigned long long nHash){
+	const unsigned char* p = (const unsigned char*)pData;
+	size_t i = 0;
+	for(i = 0; i < nSize; i++) nHash = (nHash ^ p[i]) * 1099511628211ull;
+	return nHash;
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#define CHECKSUM_INIT   2166136261u
+#define CHECKSUM64_INIT 14695981039346656037ull
+
+//FNV-1a over the data, starting from nHash: CHECKSUM_INIT for new data, the previous value to continue;
+//for file integrity checks and hash keys, not for anything which has to resist tampering
+unsigned int       Checksum_Fnv1a(const void* pData, size_t nSize, unsigned int nHash);
+unsigned long long Checksum_Fnv1a64(const void* pData, size_t nSize, unsigned long long nHash);
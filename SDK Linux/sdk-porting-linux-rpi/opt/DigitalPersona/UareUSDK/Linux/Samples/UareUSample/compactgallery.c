@@ -0,0 +1,426 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "compactgallery.h"
+#include "record.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+//FMDs are expanded and searched in blocks of this size, a block of expanded FMDs stays in the cache
+#define COMPACT_BLOCK_SIZE  256
+#define COMPACT_MAX_HEADERS 256
+#define COMPACT_TYPE_BITS   2
+//minutiae are read 8 bytes at a time, the packed minutiae are padded so the last read stays in the buffer
+#define COMPACT_PADDING     8
+
+static unsigned int bits_for(unsigned int nValue){
+	unsigned int nBits = 0;
+	while(0 != nValue){
+		nBits++;
+		nValue >>= 1;
+	}
+	return nBits;
+}
+
+static unsigned long long low_bits(unsigned int nBits){
+	return (1ull << nBits) - 1;
+}
+
+//ANSI records which do not fit the 2-byte record length have a longer header, they are kept as they are
+static unsigned int header_size(DPFJ_FMD_FORMAT nFmdType){
+	return (DPFJ_FMD_ANSI_378_2004 == nFmdType) ? DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH : DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH;
+}
+
+//record length follows the format identifier and version, 2 bytes in ANSI and 4 bytes in ISO
+static void write_length(DPFJ_FMD_FORMAT nFmdType, unsigned char* pHeader, unsigned int nLength){
+	if(DPFJ_FMD_ANSI_378_2004 == nFmdType){
+		pHeader[8] = (unsigned char)(nLength >> 8);
+		pHeader[9] = (unsigned char)nLength;
+	}
+	else{
+		pHeader[8] = (unsigned char)(nLength >> 24);
+		pHeader[9] = (unsigned char)(nLength >> 16);
+		pHeader[10] = (unsigned char)(nLength >> 8);
+		pHeader[11] = (unsigned char)nLength;
+	}
+}
+
+static unsigned int encoded_fmd_size(unsigned int nHeaderSize, unsigned int nMinutiaCnt){
+	return nHeaderSize + DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH + nMinutiaCnt * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH + 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// encoding
+
+//single view with no extended data, right after the standard header, and no reserved bits set
+static int can_encode(const fmd_record_t* pRecord, unsigned int nHeaderSize, fmd_view_t* pView){
+	if(1 != pRecord->nViewCnt || nHeaderSize != pRecord->vViewOffset[0]) return 0;
+	if(0 != FmdRecord_GetView(pRecord, 0, pView)) return 0;
+	if(0 != pView->nExtBlockLength || encoded_fmd_size(nHeaderSize, pView->nMinutiaCnt) != pRecord->nSize) return 0;
+	unsigned int i = 0;
+	for(i = 0; i < pView->nMinutiaCnt; i++){
+		if(0 != (pView->pMinutiae[i * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH + 2] & 0xc0)) return 0;
+	}
+	return 1;
+}
+
+//finds the header with the record length zeroed, or adds it; COMPACT_MAX_HEADERS if the table is full
+static unsigned int find_header(compact_gallery_t* pGallery, const unsigned char* pData){
+	unsigned char vHeader[DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH];
+	memcpy(vHeader, pData, pGallery->nHeaderSize);
+	write_length(pGallery->nFmdType, vHeader, 0);
+
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nHeaderCnt; i++){
+		if(0 == memcmp(pGallery->vHeader + i * pGallery->nHeaderSize, vHeader, pGallery->nHeaderSize)) return i;
+	}
+	if(COMPACT_MAX_HEADERS == pGallery->nHeaderCnt) return COMPACT_MAX_HEADERS;
+	memcpy(pGallery->vHeader + i * pGallery->nHeaderSize, vHeader, pGallery->nHeaderSize);
+	pGallery->nHeaderCnt++;
+	return i;
+}
+
+//fields are packed from the lowest bit: type, x, y, angle, quality
+static void write_minutia(compact_gallery_t* pGallery, unsigned long long nBit, const fmd_minutia_t* pMinutia){
+	unsigned long long nWord = pMinutia->nQuality;
+	nWord = (nWord << pGallery->nAngleBits) | pMinutia->nAngle;
+	nWord = (nWord << pGallery->nYBits) | pMinutia->nY;
+	nWord = (nWord << pGallery->nXBits) | pMinutia->nX;
+	nWord = (nWord << COMPACT_TYPE_BITS) | pMinutia->nType;
+	nWord <<= nBit & 7;
+
+	unsigned char* p = pGallery->pMinutiae + (nBit >> 3);
+	unsigned int i = 0;
+	for(i = 0; 0 != nWord; i++, nWord >>= 8) p[i] |= (unsigned char)nWord;
+}
+
+static unsigned long long read_minutia(const compact_gallery_t* pGallery, unsigned long long nBit){
+	const unsigned char* p = pGallery->pMinutiae + (nBit >> 3);
+	unsigned long long nWord = 0;
+	int i = 0;
+	for(i = 7; 0 <= i; i--) nWord = (nWord << 8) | p[i];
+	return (nWord >> (nBit & 7)) & low_bits(pGallery->nMinutiaBits);
+}
+
+//expands the FMD to the ANSI or ISO record it was encoded from, returns its size
+static unsigned int expand_fmd(const compact_gallery_t* pGallery, unsigned int nIdx, unsigned char* pFmd){
+	if(NULL != pGallery->vRawOffset && COMPACT_NOT_RAW != pGallery->vRawOffset[nIdx]){
+		const unsigned char* pRaw = pGallery->pRaw + pGallery->vRawOffset[nIdx];
+		unsigned int nSize = 0;
+		memcpy(&nSize, pRaw, sizeof(nSize));
+		memcpy(pFmd, pRaw + sizeof(nSize), nSize);
+		return nSize;
+	}
+
+	unsigned int nFirst = pGallery->vMinutiaFirst[nIdx];
+	unsigned int nMinutiaCnt = pGallery->vMinutiaFirst[nIdx + 1] - nFirst;
+	unsigned int nSize = encoded_fmd_size(pGallery->nHeaderSize, nMinutiaCnt);
+	memcpy(pFmd, pGallery->vHeader + pGallery->vHeaderIdx[nIdx] * pGallery->nHeaderSize, pGallery->nHeaderSize);
+	write_length(pGallery->nFmdType, pFmd, nSize);
+
+	unsigned char* p = pFmd + pGallery->nHeaderSize;
+	p[0] = pGallery->vFingerPos[nIdx];
+	p[1] = pGallery->vViewImpression[nIdx];
+	p[2] = pGallery->vQuality[nIdx];
+	p[3] = (unsigned char)nMinutiaCnt;
+	p += DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH;
+
+	unsigned long long nBit = (unsigned long long)nFirst * pGallery->nMinutiaBits;
+	unsigned int i = 0;
+	for(i = 0; i < nMinutiaCnt; i++, nBit += pGallery->nMinutiaBits, p += DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH){
+		unsigned long long nWord = read_minutia(pGallery, nBit);
+		unsigned int nType = (unsigned int)(nWord & low_bits(COMPACT_TYPE_BITS));
+		nWord >>= COMPACT_TYPE_BITS;
+		unsigned int nX = (unsigned int)(nWord & low_bits(pGallery->nXBits));
+		nWord >>= pGallery->nXBits;
+		unsigned int nY = (unsigned int)(nWord & low_bits(pGallery->nYBits));
+		nWord >>= pGallery->nYBits;
+		unsigned int nAngle = (unsigned int)(nWord & low_bits(pGallery->nAngleBits));
+		nWord >>= pGallery->nAngleBits;
+		p[0] = (unsigned char)((nType << 6) | (nX >> 8));
+		p[1] = (unsigned char)nX;
+		p[2] = (unsigned char)(nY >> 8);
+		p[3] = (unsigned char)nY;
+		p[4] = (unsigned char)nAngle;
+		p[5] = (unsigned char)nWord;
+	}
+	p[0] = 0; //no extended data
+	p[1] = 0;
+	return nSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// compact gallery
+
+int CompactGallery_Create(gallery_t* pGallery, compact_gallery_t** ppGallery){
+	if(NULL == pGallery || NULL == ppGallery) return EINVAL;
+	*ppGallery = NULL;
+
+	compact_gallery_t* pCompact = (compact_gallery_t*)calloc(1, sizeof(compact_gallery_t));
+	if(NULL == pCompact) return ENOMEM;
+	pthread_mutex_init(&pCompact->mutexBlock, NULL);
+	unsigned int nFmdCnt = pGallery->nFmdCnt;
+	pCompact->nFmdType = pGallery->nFmdType;
+	pCompact->nFmdCnt = nFmdCnt;
+	pCompact->nHeaderSize = header_size(pGallery->nFmdType);
+	pCompact->vFmdId = (unsigned int*)malloc(sizeof(unsigned int) * (nFmdCnt + 1));
+	pCompact->vMinutiaFirst = (unsigned int*)malloc(sizeof(unsigned int) * (nFmdCnt + 1));
+	pCompact->vHeaderIdx = (unsigned char*)malloc(nFmdCnt + 1);
+	pCompact->vFingerPos = (unsigned char*)malloc(nFmdCnt + 1);
+	pCompact->vViewImpression = (unsigned char*)malloc(nFmdCnt + 1);
+	pCompact->vQuality = (unsigned char*)malloc(nFmdCnt + 1);
+	pCompact->vRawOffset = (unsigned int*)malloc(sizeof(unsigned int) * (nFmdCnt + 1));
+	pCompact->vHeader = (unsigned char*)malloc(COMPACT_MAX_HEADERS * pCompact->nHeaderSize);
+	if(NULL == pCompact->vFmdId || NULL == pCompact->vMinutiaFirst || NULL == pCompact->vHeaderIdx || NULL == pCompact->vFingerPos
+		|| NULL == pCompact->vViewImpression || NULL == pCompact->vQuality || NULL == pCompact->vRawOffset || NULL == pCompact->vHeader){
+		CompactGallery_Destroy(pCompact);
+		return ENOMEM;
+	}
+	if(0 != nFmdCnt) memcpy(pCompact->vFmdId, pGallery->vFmdId, sizeof(unsigned int) * nFmdCnt);
+
+	//first pass: which FMDs can be encoded, their headers, the largest values of the fields and the sizes
+	unsigned int nMaxX = 0;
+	unsigned int nMaxY = 0;
+	unsigned int nMaxAngle = 0;
+	unsigned int nMaxQuality = 0;
+	unsigned long long nMinutiaCnt = 0;
+	int bRaw = 0;
+	unsigned int nMaxViewCnt = 1;
+	fmd_record_t record;
+	fmd_view_t view;
+	fmd_minutia_t minutia;
+	unsigned int i = 0;
+	unsigned int j = 0;
+	for(i = 0; i < nFmdCnt; i++){
+		pCompact->vMinutiaFirst[i] = (unsigned int)nMinutiaCnt;
+		unsigned int nHeaderIdx = COMPACT_MAX_HEADERS;
+		if(0 == FmdRecord_Parse(&record, pGallery->nFmdType, pGallery->vFmd[i], pGallery->vFmdSize[i])
+			&& can_encode(&record, pCompact->nHeaderSize, &view)){
+			nHeaderIdx = find_header(pCompact, pGallery->vFmd[i]);
+		}
+		if(COMPACT_MAX_HEADERS == nHeaderIdx){
+			//kept as it is, with its size in front
+			pCompact->vRawOffset[i] = (unsigned int)pCompact->nRawSize;
+			pCompact->nRawSize += sizeof(unsigned int) + pGallery->vFmdSize[i];
+			if(UINT_MAX < pCompact->nRawSize){
+				CompactGallery_Destroy(pCompact);
+				return EOVERFLOW;
+			}
+			if(pCompact->nMaxFmdSize < pGallery->vFmdSize[i]) pCompact->nMaxFmdSize = pGallery->vFmdSize[i];
+			if(nMaxViewCnt < pGallery->vFmdViewCnt[i]) nMaxViewCnt = pGallery->vFmdViewCnt[i];
+			bRaw = 1;
+			continue;
+		}
+
+		pCompact->vRawOffset[i] = COMPACT_NOT_RAW;
+		pCompact->vHeaderIdx[i] = (unsigned char)nHeaderIdx;
+		pCompact->vFingerPos[i] = pGallery->vFmd[i][pCompact->nHeaderSize];
+		pCompact->vViewImpression[i] = pGallery->vFmd[i][pCompact->nHeaderSize + 1];
+		pCompact->vQuality[i] = pGallery->vFmd[i][pCompact->nHeaderSize + 2];
+		for(j = 0; j < view.nMinutiaCnt; j++){
+			FmdView_GetMinutia(&view, j, &minutia);
+			if(nMaxX < minutia.nX) nMaxX = minutia.nX;
+			if(nMaxY < minutia.nY) nMaxY = minutia.nY;
+			if(nMaxAngle < minutia.nAngle) nMaxAngle = minutia.nAngle;
+			if(nMaxQuality < minutia.nQuality) nMaxQuality = minutia.nQuality;
+		}
+		nMinutiaCnt += view.nMinutiaCnt;
+		if(UINT_MAX < nMinutiaCnt){
+			CompactGallery_Destroy(pCompact);
+			return EOVERFLOW;
+		}
+		if(pCompact->nMaxFmdSize < pGallery->vFmdSize[i]) pCompact->nMaxFmdSize = pGallery->vFmdSize[i];
+	}
+	pCompact->vMinutiaFirst[nFmdCnt] = (unsigned int)nMinutiaCnt;
+
+	pCompact->nXBits = bits_for(nMaxX);
+	pCompact->nYBits = bits_for(nMaxY);
+	pCompact->nAngleBits = bits_for(nMaxAngle);
+	pCompact->nQualityBits = bits_for(nMaxQuality);
+	pCompact->nMinutiaBits = COMPACT_TYPE_BITS + pCompact->nXBits + pCompact->nYBits + pCompact->nAngleBits + pCompact->nQualityBits;
+	pCompact->nMinutiaeSize = (size_t)((nMinutiaCnt * pCompact->nMinutiaBits + 7) >> 3) + COMPACT_PADDING;
+	pCompact->pMinutiae = (unsigned char*)calloc(1, pCompact->nMinutiaeSize);
+	if(0 != pCompact->nRawSize) pCompact->pRaw = (unsigned char*)malloc(pCompact->nRawSize);
+	//every view of the block can be a candidate of dpfj_identify()
+	pCompact->nBlockSize = (COMPACT_BLOCK_SIZE < nFmdCnt) ? COMPACT_BLOCK_SIZE : nFmdCnt;
+	pCompact->nBlockCandidateAlloc = pCompact->nBlockSize * nMaxViewCnt;
+	pCompact->pBlock = (unsigned char*)malloc((size_t)pCompact->nBlockSize * pCompact->nMaxFmdSize + 1);
+	pCompact->vBlockFmd = (unsigned char**)malloc(sizeof(unsigned char*) * (pCompact->nBlockSize + 1));
+	pCompact->vBlockFmdSize = (unsigned int*)malloc(sizeof(unsigned int) * (pCompact->nBlockSize + 1));
+	pCompact->vBlockCandidates = (DPFJ_CANDIDATE*)malloc(sizeof(DPFJ_CANDIDATE) * (pCompact->nBlockCandidateAlloc + 1));
+	if(NULL == pCompact->pMinutiae || (0 != pCompact->nRawSize && NULL == pCompact->pRaw) || NULL == pCompact->pBlock
+		|| NULL == pCompact->vBlockFmd || NULL == pCompact->vBlockFmdSize || NULL == pCompact->vBlockCandidates){
+		CompactGallery_Destroy(pCompact);
+		return ENOMEM;
+	}
+
+	//second pass: minutiae and the FMDs kept as they are
+	unsigned long long nBit = 0;
+	for(i = 0; i < nFmdCnt; i++){
+		if(COMPACT_NOT_RAW != pCompact->vRawOffset[i]){
+			unsigned char* pRaw = pCompact->pRaw + pCompact->vRawOffset[i];
+			memcpy(pRaw, &pGallery->vFmdSize[i], sizeof(unsigned int));
+			memcpy(pRaw + sizeof(unsigned int), pGallery->vFmd[i], pGallery->vFmdSize[i]);
+			continue;
+		}
+		FmdRecord_Parse(&record, pGallery->nFmdType, pGallery->vFmd[i], pGallery->vFmdSize[i]);
+		FmdRecord_GetView(&record, 0, &view);
+		for(j = 0; j < view.nMinutiaCnt; j++, nBit += pCompact->nMinutiaBits){
+			FmdView_GetMinutia(&view, j, &minutia);
+			write_minutia(pCompact, nBit, &minutia);
+		}
+	}
+
+	//the headers are few, the offsets are not needed when every FMD is encoded
+	unsigned char* vHeader = (unsigned char*)realloc(pCompact->vHeader, pCompact->nHeaderCnt * pCompact->nHeaderSize + 1);
+	if(NULL != vHeader) pCompact->vHeader = vHeader;
+	if(!bRaw){
+		free(pCompact->vRawOffset);
+		pCompact->vRawOffset = NULL;
+	}
+
+	*ppGallery = pCompact;
+	return 0;
+}
+
+void CompactGallery_Destroy(compact_gallery_t* pGallery){
+	if(NULL == pGallery) return;
+	if(NULL != pGallery->vFmdId) free(pGallery->vFmdId);
+	if(NULL != pGallery->vMinutiaFirst) free(pGallery->vMinutiaFirst);
+	if(NULL != pGallery->vHeaderIdx) free(pGallery->vHeaderIdx);
+	if(NULL != pGallery->vFingerPos) free(pGallery->vFingerPos);
+	if(NULL != pGallery->vViewImpression) free(pGallery->vViewImpression);
+	if(NULL != pGallery->vQuality) free(pGallery->vQuality);
+	if(NULL != pGallery->vRawOffset) free(pGallery->vRawOffset);
+	if(NULL != pGallery->vHeader) free(pGallery->vHeader);
+	if(NULL != pGallery->pMinutiae) free(pGallery->pMinutiae);
+	if(NULL != pGallery->pRaw) free(pGallery->pRaw);
+	if(NULL != pGallery->pBlock) free(pGallery->pBlock);
+	if(NULL != pGallery->vBlockFmd) free(pGallery->vBlockFmd);
+	if(NULL != pGallery->vBlockFmdSize) free(pGallery->vBlockFmdSize);
+	if(NULL != pGallery->vBlockCandidates) free(pGallery->vBlockCandidates);
+	pthread_mutex_destroy(&pGallery->mutexBlock);
+	free(pGallery);
+}
+
+size_t CompactGallery_GetMemorySize(compact_gallery_t* pGallery){
+	if(NULL == pGallery) return 0;
+	size_t nFmdCnt = pGallery->nFmdCnt;
+	size_t nSize = sizeof(compact_gallery_t);
+	nSize += nFmdCnt * sizeof(unsigned int);            //ids
+	nSize += (nFmdCnt + 1) * sizeof(unsigned int);      //first minutiae
+	nSize += nFmdCnt * 4;                               //header index, finger position, view and impression, quality
+	if(NULL != pGallery->vRawOffset) nSize += nFmdCnt * sizeof(unsigned int);
+	nSize += pGallery->nHeaderCnt * pGallery->nHeaderSize;
+	nSize += pGallery->nMinutiaeSize + pGallery->nRawSize;
+	nSize += (size_t)pGallery->nBlockSize * (pGallery->nMaxFmdSize + sizeof(unsigned char*) + sizeof(unsigned int));
+	nSize += pGallery->nBlockCandidateAlloc * sizeof(DPFJ_CANDIDATE);
+	return nSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// identification
+
+static int compare_candidates(const gallery_candidate_t* pc1, const gallery_candidate_t* pc2){
+	if(pc1->nScore != pc2->nScore) return (pc1->nScore < pc2->nScore) ? -1 : 1;
+	if(pc1->nId != pc2->nId) return (pc1->nId < pc2->nId) ? -1 : 1;
+	return (pc1->nViewIdx < pc2->nViewIdx) ? -1 : (pc1->nViewIdx > pc2->nViewIdx);
+}
+
+static int compare_candidates_qsort(const void* p1, const void* p2){
+	return compare_candidates((const gallery_candidate_t*)p1, (const gallery_candidate_t*)p2);
+}
+
+static void swap_candidates(gallery_candidate_t* pc1, gallery_candidate_t* pc2){
+	gallery_candidate_t tmp = *pc1;
+	*pc1 = *pc2;
+	*pc2 = tmp;
+}
+
+//the caller's array is a max-heap on the score while the blocks are searched, the worst kept candidate is on top
+static void heap_push(gallery_candidate_t* vHeap, unsigned int* pnCnt, unsigned int nCapacity, const gallery_candidate_t* pCandidate){
+	unsigned int nIdx = 0;
+	if(*pnCnt == nCapacity){
+		if(0 <= compare_candidates(pCandidate, &vHeap[0])) return;
+		vHeap[0] = *pCandidate;
+		for(;;){
+			unsigned int nWorst = nIdx;
+			unsigned int nLeft = 2 * nIdx + 1;
+			if(nLeft < *pnCnt && 0 < compare_candidates(&vHeap[nLeft], &vHeap[nWorst])) nWorst = nLeft;
+			if(nLeft + 1 < *pnCnt && 0 < compare_candidates(&vHeap[nLeft + 1], &vHeap[nWorst])) nWorst = nLeft + 1;
+			if(nWorst == nIdx) break;
+			swap_candidates(&vHeap[nIdx], &vHeap[nWorst]);
+			nIdx = nWorst;
+		}
+		return;
+	}
+	nIdx = (*pnCnt)++;
+	vHeap[nIdx] = *pCandidate;
+	while(0 < nIdx && 0 < compare_candidates(&vHeap[nIdx], &vHeap[(nIdx - 1) / 2])){
+		swap_candidates(&vHeap[nIdx], &vHeap[(nIdx - 1) / 2]);
+		nIdx = (nIdx - 1) / 2;
+	}
+}
+
+int CompactGallery_Identify(compact_gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	if(0 == nCandidateCnt || 0 == pGallery->nFmdCnt) return 0;
+
+	pthread_mutex_lock(&pGallery->mutexBlock);
+	unsigned int nBlockSize = pGallery->nBlockSize;
+	unsigned char** vFmd = pGallery->vBlockFmd;
+	unsigned int* vFmdSize = pGallery->vBlockFmdSize;
+	DPFJ_CANDIDATE* vCandidates = pGallery->vBlockCandidates;
+	int result = 0;
+
+	//every block is searched, a block with many hits does not take the place of better ones further on
+	unsigned int nFound = 0;
+	unsigned int nFirst = 0;
+	unsigned int i = 0;
+	for(nFirst = 0; 0 == result && nFirst < pGallery->nFmdCnt; nFirst += nBlockSize){
+		unsigned int nCnt = pGallery->nFmdCnt - nFirst;
+		if(nCnt > nBlockSize) nCnt = nBlockSize;
+		unsigned char* p = pGallery->pBlock;
+		for(i = 0; i < nCnt; i++){
+			vFmd[i] = p;
+			vFmdSize[i] = expand_fmd(pGallery, nFirst + i, p);
+			p += vFmdSize[i];
+		}
+
+		//the threshold is scaled by the number of FMDs searched, a block gets its proportional part
+		unsigned long long nBlockThreshold = (unsigned long long)nThreshold * nCnt / pGallery->nFmdCnt;
+		unsigned int nBlockCandidateCnt = pGallery->nBlockCandidateAlloc;
+		for(i = 0; i < nBlockCandidateCnt; i++){
+			vCandidates[i].size = sizeof(DPFJ_CANDIDATE);
+		}
+		result = dpfj_identify(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx, pGallery->nFmdType, nCnt, vFmd, vFmdSize,
+			(0 == nBlockThreshold) ? 1 : (unsigned int)nBlockThreshold, &nBlockCandidateCnt, vCandidates);
+
+		//hits of different blocks can be ranked only by their scores
+		for(i = 0; DPFJ_SUCCESS == result && i < nBlockCandidateCnt; i++){
+			gallery_candidate_t candidate;
+			candidate.nId = pGallery->vFmdId[nFirst + vCandidates[i].fmd_idx];
+			candidate.nViewIdx = vCandidates[i].view_idx;
+			result = dpfj_compare(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx, pGallery->nFmdType,
+				vFmd[vCandidates[i].fmd_idx], vFmdSize[vCandidates[i].fmd_idx], candidate.nViewIdx, &candidate.nScore);
+			if(DPFJ_SUCCESS == result) heap_push(pCandidates, &nFound, nCandidateCnt, &candidate);
+		}
+	}
+	pthread_mutex_unlock(&pGallery->mutexBlock);
+
+	if(0 == result){
+		qsort(pCandidates, nFound, sizeof(gallery_candidate_t), compare_candidates_qsort);
+		*pnCandidateCnt = nFound;
+	}
+	return result;
+}
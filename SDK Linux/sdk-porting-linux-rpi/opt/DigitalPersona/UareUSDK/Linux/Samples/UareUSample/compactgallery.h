@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include "gallery.h"
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <dpfj.h>
+
+#define COMPACT_NOT_RAW 0xffffffff
+
+//read-only copy of a gallery in a compact, lossless encoding for galleries of millions of fingers: record headers shared
+//by the FMDs are kept once, view headers are kept in arrays per field, and the minutiae are bit-packed with just as many
+//bits per field as the largest value in the gallery needs; dpfj_identify() takes only ANSI or ISO records, so the FMDs
+//are expanded back block by block when searched; FMDs which do not fit the encoding (several views, extended data,
+//more distinct headers than fit the index) are kept as they are
+typedef struct {
+	DPFJ_FMD_FORMAT nFmdType;
+	unsigned int    nFmdCnt;
+	unsigned int    nMaxFmdSize;      //largest expanded FMD
+	unsigned int*   vFmdId;           //ids of the FMDs, as in the gallery
+
+	//per FMD, one array per field
+	unsigned int*   vMinutiaFirst;    //index of the first minutia of the FMD, one more entry marks the end
+	unsigned char*  vHeaderIdx;       //index of the record header in the vHeader
+	unsigned char*  vFingerPos;
+	unsigned char*  vViewImpression;  //view number and impression type, packed as in the view header
+	unsigned char*  vQuality;
+	unsigned int*   vRawOffset;       //offset of the FMD kept as it is in the pRaw, COMPACT_NOT_RAW if encoded; NULL if none is kept
+
+	//record headers, the record length is left zero
+	unsigned int    nHeaderSize;
+	unsigned int    nHeaderCnt;
+	unsigned char*  vHeader;
+
+	//minutiae, nMinutiaBits bits each: type, x, y, angle and quality
+	unsigned int    nXBits;
+	unsigned int    nYBits;
+	unsigned int    nAngleBits;
+	unsigned int    nQualityBits;
+	unsigned int    nMinutiaBits;
+	unsigned char*  pMinutiae;
+	size_t          nMinutiaeSize;
+
+	unsigned char*  pRaw;             //FMDs kept as they are, every one after its 4-byte size
+	size_t          nRawSize;
+
+	//scratch of CompactGallery_Identify(), allocated with the gallery: one block of expanded FMDs, its arrays, and
+	//room for a candidate for every view of the block, so no hit of a block is cut off
+	pthread_mutex_t mutexBlock;       //held by CompactGallery_Identify() while it uses the scratch
+	unsigned int    nBlockSize;
+	unsigned char*  pBlock;
+	unsigned char** vBlockFmd;
+	unsigned int*   vBlockFmdSize;
+	unsigned int    nBlockCandidateAlloc;
+	DPFJ_CANDIDATE* vBlockCandidates;
+} compact_gallery_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno
+int  CompactGallery_Create(gallery_t* pGallery, compact_gallery_t** ppGallery);
+void CompactGallery_Destroy(compact_gallery_t* pGallery);
+
+//memory used by the compact gallery with its scratch, for comparison with the arena and arrays of the gallery it was created from
+size_t CompactGallery_GetMemorySize(compact_gallery_t* pGallery);
+
+//the same as Gallery_IdentifyParallel(), on one thread: the FMDs are expanded and searched block by block, each block
+//with its proportional part of the threshold as a shard; every hit of every block is scored by dpfj_compare(), and the
+//best nCandidateCnt are returned ranked by their scores, with the scores; nothing is allocated, the blocks are expanded
+//into the scratch of the gallery, so identifications on one compact gallery wait for each other
+int  CompactGallery_Identify(compact_gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
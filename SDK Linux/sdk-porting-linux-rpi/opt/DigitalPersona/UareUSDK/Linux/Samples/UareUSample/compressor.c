@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "compressor.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+//guards dpfj compression state, which is global in the library
+static pthread_mutex_t g_mutexCompression = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+	int                        bCompress;
+	int                        bRaw;
+	DPFJ_FID_FORMAT            nFidType;
+	const unsigned char*       pInput;
+	unsigned int               nInputSize;
+	unsigned int               nWidth;
+	unsigned int               nHeight;
+	unsigned int               nDpi;
+	unsigned int               nBpp;
+} operation_t;
+
+//runs one operation from start to finish, must be called with the g_mutexCompression locked
+static int run_operation(compressor_t* pCompressor, operation_t* pOp, unsigned char* pData, unsigned int* pnDataSize){
+	int result = dpfj_start_compression();
+	if(DPFJ_SUCCESS != result) return result;
+
+	if(pOp->bCompress){
+		if(0 != pCompressor->nSize) result = dpfj_set_wsq_size(pCompressor->nSize, pCompressor->nTolerance);
+		else result = dpfj_set_wsq_bitrate(pCompressor->nBitrate, pCompressor->nTolerance);
+	}
+	if(DPFJ_SUCCESS == result){
+		if(pOp->bCompress && pOp->bRaw){
+			result = dpfj_compress_raw(pOp->pInput, pOp->nInputSize, pOp->nWidth, pOp->nHeight, pOp->nDpi, pOp->nBpp, pCompressor->nAlgorithm);
+		}
+		else if(pOp->bCompress){
+			result = dpfj_compress_fid(pOp->nFidType, pOp->pInput, pOp->nInputSize, pCompressor->nAlgorithm);
+		}
+		else if(pOp->bRaw){
+			result = dpfj_expand_raw(pOp->pInput, pOp->nInputSize, pCompressor->nAlgorithm, &pOp->nWidth, &pOp->nHeight, &pOp->nDpi, &pOp->nBpp);
+		}
+		else{
+			result = dpfj_expand_fid(pOp->nFidType, pOp->pInput, pOp->nInputSize, pCompressor->nAlgorithm);
+		}
+	}
+
+	//processed data goes straight into the caller's buffer, a short buffer gets the required size back
+	if(DPFJ_SUCCESS == result){
+		unsigned int nDataSize = 0;
+		result = dpfj_get_processed_data(NULL, &nDataSize);
+		if(DPFJ_E_MORE_DATA == result){
+			if(NULL == pData || *pnDataSize < nDataSize) *pnDataSize = nDataSize;
+			else result = dpfj_get_processed_data(pData, pnDataSize);
+		}
+	}
+
+	int finish_result = dpfj_finish_compression();
+	if(DPFJ_SUCCESS == result && DPFJ_SUCCESS != finish_result) result = finish_result;
+	return result;
+}
+
+static int process(compressor_t* pCompressor, operation_t* pOp, unsigned char* pData, unsigned int* pnDataSize){
+	if(NULL == pCompressor || NULL == pOp->pInput || NULL == pnDataSize) return EINVAL;
+
+	pthread_mutex_lock(&g_mutexCompression);
+	int result = run_operation(pCompressor, pOp, pData, pnDataSize);
+	pthread_mutex_unlock(&g_mutexCompression);
+	return result;
+}
+
+int Compressor_Create(DPFJ_COMPRESSION_ALGORITHM nAlgorithm, compressor_t** ppCompressor){
+	if(NULL == ppCompressor) return EINVAL;
+	if(DPFJ_COMPRESSION_WSQ_NIST != nAlgorithm && DPFJ_COMPRESSION_WSQ_AWARE != nAlgorithm) return DPFJ_E_INVALID_PARAMETER;
+
+	*ppCompressor = (compressor_t*)calloc(1, sizeof(compressor_t));
+	if(NULL == *ppCompressor) return ENOMEM;
+
+	//0.75 bpp, the usual WSQ bitrate for 500 dpi fingerprints
+	(*ppCompressor)->nAlgorithm = nAlgorithm;
+	(*ppCompressor)->nBitrate = 75;
+	(*ppCompressor)->nTolerance = 1;
+	return 0;
+}
+
+void Compressor_Destroy(compressor_t* pCompressor){
+	if(NULL == pCompressor) return;
+	free(pCompressor);
+}
+
+int Compressor_SetBitrate(compressor_t* pCompressor, unsigned int nBitrate, unsigned int nTolerance){
+	if(NULL == pCompressor || 0 == nBitrate) return EINVAL;
+	pCompressor->nBitrate = nBitrate;
+	pCompressor->nSize = 0;
+	pCompressor->nTolerance = nTolerance;
+	return 0;
+}
+
+int Compressor_SetSize(compressor_t* pCompressor, unsigned int nSize, unsigned int nTolerance){
+	if(NULL == pCompressor || 0 == nSize) return EINVAL;
+	pCompressor->nSize = nSize;
+	pCompressor->nBitrate = 0;
+	pCompressor->nTolerance = nTolerance;
+	return 0;
+}
+
+int Compressor_CompressFid(compressor_t* pCompressor, DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize,
+	unsigned char* pData, unsigned int* pnDataSize){
+	operation_t op = {0};
+	op.bCompress = 1;
+	op.nFidType = nFidType;
+	op.pInput = pFid;
+	op.nInputSize = nFidSize;
+	return process(pCompressor, &op, pData, pnDataSize);
+}
+
+int Compressor_CompressRaw(compressor_t* pCompressor, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int nWidth, unsigned int nHeight, unsigned int nDpi, unsigned int nBpp, unsigned char* pData, unsigned int* pnDataSize){
+	operation_t op = {0};
+	op.bCompress = 1;
+	op.bRaw = 1;
+	op.pInput = pImage;
+	op.nInputSize = nImageSize;
+	op.nWidth = nWidth;
+	op.nHeight = nHeight;
+	op.nDpi = nDpi;
+	op.nBpp = nBpp;
+	return process(pCompressor, &op, pData, pnDataSize);
+}
+
+int Compressor_ExpandFid(compressor_t* pCompressor, DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize,
+	unsigned char* pData, unsigned int* pnDataSize){
+	operation_t op = {0};
+	op.nFidType = nFidType;
+	op.pInput = pFid;
+	op.nInputSize = nFidSize;
+	return process(pCompressor, &op, pData, pnDataSize);
+}
+
+int Compressor_ExpandRaw(compressor_t* pCompressor, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int* pnWidth, unsigned int* pnHeight, unsigned int* pnDpi, unsigned int* pnBpp, unsigned char* pData, unsigned int* pnDataSize){
+	if(NULL == pnWidth || NULL == pnHeight || NULL == pnDpi || NULL == pnBpp) return EINVAL;
+
+	operation_t op = {0};
+	op.bRaw = 1;
+	op.pInput = pImage;
+	op.nInputSize = nImageSize;
+	int result = process(pCompressor, &op, pData, pnDataSize);
+	if(0 == result){
+		*pnWidth = op.nWidth;
+		*pnHeight = op.nHeight;
+		*pnDpi = op.nDpi;
+		*pnBpp = op.nBpp;
+	}
+	return result;
+}
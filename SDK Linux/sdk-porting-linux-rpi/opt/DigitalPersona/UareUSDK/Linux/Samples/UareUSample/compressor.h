@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfj.h>
+#include <dpfj_compression.h>
+
+//compression context: keeps its own WSQ settings, any number of contexts can be used at the same time
+//from different threads; every call runs the whole start-process-get-finish sequence of the global
+//dpfj compression state at once, so the operations of different contexts never overlap
+//all compression in the process must go through the contexts for this to work
+typedef struct {
+	DPFJ_COMPRESSION_ALGORITHM nAlgorithm;
+	unsigned int               nBitrate;   //bitrate multiplied by 100, 0 if target size is used
+	unsigned int               nSize;      //target size, 0 if bitrate is used
+	unsigned int               nTolerance; //tolerance for the Aware WSQ
+} compressor_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno
+int  Compressor_Create(DPFJ_COMPRESSION_ALGORITHM nAlgorithm, compressor_t** ppCompressor);
+void Compressor_Destroy(compressor_t* pCompressor);
+int  Compressor_SetBitrate(compressor_t* pCompressor, unsigned int nBitrate, unsigned int nTolerance);
+int  Compressor_SetSize(compressor_t* pCompressor, unsigned int nSize, unsigned int nTolerance);
+
+//result is written to the buffer provided by the caller, nothing is allocated by the context;
+//if the buffer is too small, DPFJ_E_MORE_DATA is returned and the required size is in the pnDataSize
+int  Compressor_CompressFid(compressor_t* pCompressor, DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize,
+	unsigned char* pData, unsigned int* pnDataSize);
+int  Compressor_CompressRaw(compressor_t* pCompressor, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int nWidth, unsigned int nHeight, unsigned int nDpi, unsigned int nBpp, unsigned char* pData, unsigned int* pnDataSize);
+int  Compressor_ExpandFid(compressor_t* pCompressor, DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize,
+	unsigned char* pData, unsigned int* pnDataSize);
+int  Compressor_ExpandRaw(compressor_t* pCompressor, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int* pnWidth, unsigned int* pnHeight, unsigned int* pnDpi, unsigned int* pnBpp, unsigned char* pData, unsigned int* pnDataSize);
@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "dedup.h"
+#include "checksum.h"
+#include "record.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//tiles are this many FMDs on a side: the FMDs of a column block stay in the cache while all FMDs of the row block are
+//compared with them; only the tiles on and above the diagonal are searched, every pair is compared once
+#define DEDUP_BLOCK_SIZE 256
+
+//tiles are run in waves of this many per thread, the checkpoint is saved after every wave
+#define DEDUP_TILES_PER_THREAD 4
+
+#define DEDUP_CHECKPOINT_MAGIC   "DPDEDUP1"
+#define DEDUP_CHECKPOINT_VERSION 2
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// enrollment check
+
+//candidates of all views: by the id, the best score of an FMD first
+static int compare_found(const void* p1, const void* p2){
+	const gallery_candidate_t* pc1 = (const gallery_candidate_t*)p1;
+	const gallery_candidate_t* pc2 = (const gallery_candidate_t*)p2;
+	if(pc1->nId != pc2->nId) return (pc1->nId < pc2->nId) ? -1 : 1;
+	return (pc1->nScore < pc2->nScore) ? -1 : (pc1->nScore > pc2->nScore);
+}
+
+static int compare_ranked(const void* p1, const void* p2){
+	const gallery_candidate_t* pc1 = (const gallery_candidate_t*)p1;
+	const gallery_candidate_t* pc2 = (const gallery_candidate_t*)p2;
+	if(pc1->nScore != pc2->nScore) return (pc1->nScore < pc2->nScore) ? -1 : 1;
+	return (pc1->nId < pc2->nId) ? -1 : (pc1->nId > pc2->nId);
+}
+
+int Dedup_CheckEnrollment(gallery_t* pGallery, pool_t* pPool, unsigned char* pFmd, unsigned int nFmdSize,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+
+	fmd_record_t record;
+	int result = FmdRecord_Parse(&record, pGallery->nFmdType, pFmd, nFmdSize);
+	if(0 != result) return result;
+	unsigned int i = 0;
+	for(i = 0; i < record.nViewCnt; i++){
+		fmd_view_t view;
+		result = FmdRecord_GetView(&record, i, &view);
+		if(0 != result) return result;
+		if(DEDUP_MIN_MINUTIAE > view.nMinutiaCnt) return DPFJ_E_INVALID_FMD;
+	}
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	if(0 == nCandidateCnt) return 0;
+	if(nCandidateCnt > SIZE_MAX / sizeof(gallery_candidate_t) / record.nViewCnt) return ENOMEM;
+
+	//every view of the enrollment FMD is searched on its own with the full threshold, so a mate is missed no more
+	//than by Gallery_IdentifyParallel(); any view matching makes a duplicate, an FMD found by several is kept once
+	gallery_candidate_t* vFound = (gallery_candidate_t*)malloc(sizeof(gallery_candidate_t) * nCandidateCnt * record.nViewCnt);
+	if(NULL == vFound) return ENOMEM;
+	unsigned int nFoundCnt = 0;
+	for(i = 0; 0 == result && i < record.nViewCnt; i++){
+		unsigned int nViewFoundCnt = nCandidateCnt;
+		result = Gallery_IdentifyParallel(pGallery, pPool, pFmd, nFmdSize, i, nThreshold, &nViewFoundCnt, vFound + nFoundCnt);
+		if(0 == result) nFoundCnt += nViewFoundCnt;
+	}
+
+	if(0 == result){
+		qsort(vFound, nFoundCnt, sizeof(gallery_candidate_t), compare_found);
+		unsigned int nUniqueCnt = 0;
+		for(i = 0; i < nFoundCnt; i++){
+			if(0 == i || vFound[i].nId != vFound[i - 1].nId) vFound[nUniqueCnt++] = vFound[i];
+		}
+		qsort(vFound, nUniqueCnt, sizeof(gallery_candidate_t), compare_ranked);
+		if(nUniqueCnt > nCandidateCnt) nUniqueCnt = nCandidateCnt;
+		memcpy(pCandidates, vFound, sizeof(gallery_candidate_t) * nUniqueCnt);
+		*pnCandidateCnt = nUniqueCnt;
+	}
+
+	free(vFound);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// pairs
+
+typedef struct {
+	dedup_pair_t* vPairs;
+	unsigned int  nPairCnt;
+	unsigned int  nPairAlloc;
+} pair_list_t;
+
+static int add_pair(pair_list_t* pList, unsigned int nId1, unsigned int nId2, unsigned int nScore){
+	if(pList->nPairCnt == pList->nPairAlloc){
+		unsigned int nAlloc = (0 == pList->nPairAlloc) ? 64 : pList->nPairAlloc * 2;
+		dedup_pair_t* vPairs = (dedup_pair_t*)realloc(pList->vPairs, sizeof(dedup_pair_t) * nAlloc);
+		if(NULL == vPairs) return ENOMEM;
+		pList->vPairs = vPairs;
+		pList->nPairAlloc = nAlloc;
+	}
+	dedup_pair_t* pPair = &pList->vPairs[pList->nPairCnt++];
+	pPair->nId1 = (nId1 < nId2) ? nId1 : nId2;
+	pPair->nId2 = (nId1 < nId2) ? nId2 : nId1;
+	pPair->nScore = nScore;
+	return 0;
+}
+
+static int compare_pairs(const void* p1, const void* p2){
+	const dedup_pair_t* pp1 = (const dedup_pair_t*)p1;
+	const dedup_pair_t* pp2 = (const dedup_pair_t*)p2;
+	if(pp1->nId1 != pp2->nId1) return (pp1->nId1 < pp2->nId1) ? -1 : 1;
+	if(pp1->nId2 != pp2->nId2) return (pp1->nId2 < pp2->nId2) ? -1 : 1;
+	return (pp1->nScore < pp2->nScore) ? -1 : (pp1->nScore > pp2->nScore);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// tiles
+
+//the signature has the minutiae of the first view, the other views are looked up in the record
+static int is_comparable(gallery_t* pGallery, unsigned int nIdx){
+	if(DEDUP_MIN_MINUTIAE > pGallery->vFmdSignature[nIdx].nMinutiaCnt) return 0;
+	if(1 == pGallery->vFmdViewCnt[nIdx]) return 1;
+
+	fmd_record_t record;
+	if(0 != FmdRecord_Parse(&record, pGallery->nFmdType, pGallery->vFmd[nIdx], pGallery->vFmdSize[nIdx])) return 0;
+	unsigned int i = 0;
+	for(i = 1; i < record.nViewCnt; i++){
+		fmd_view_t view;
+		if(0 != FmdRecord_GetView(&record, i, &view) || DEDUP_MIN_MINUTIAE > view.nMinutiaCnt) return 0;
+	}
+	return 1;
+}
+
+typedef struct {
+	gallery_t*    pGallery;
+	unsigned int  nThreshold;
+	unsigned int* vFmdIdx;    //indices of the compared FMDs in the gallery, the tiles are laid over these
+	unsigned int  nFmdCnt;
+	unsigned int* vTileRow;   //row and column blocks of every tile of the wave
+	unsigned int* vTileCol;
+	pair_list_t*  vTilePairs; //pairs found in every tile of the wave
+	int*          vResult;    //result for every tile of the wave
+} dedup_wave_t;
+
+static void search_tile(void* pContext, unsigned int nTile){
+	dedup_wave_t* pWave = (dedup_wave_t*)pContext;
+	gallery_t* pGallery = pWave->pGallery;
+	pair_list_t* pPairs = &pWave->vTilePairs[nTile];
+	unsigned int nRow = pWave->vTileRow[nTile];
+	unsigned int nCol = pWave->vTileCol[nTile];
+
+	unsigned int nRowEnd = (nRow + 1) * DEDUP_BLOCK_SIZE;
+	if(nRowEnd > pWave->nFmdCnt) nRowEnd = pWave->nFmdCnt;
+	unsigned int nColEnd = (nCol + 1) * DEDUP_BLOCK_SIZE;
+	if(nColEnd > pWave->nFmdCnt) nColEnd = pWave->nFmdCnt;
+
+	//every pair is compared: dpfj_identify() over a range misses some of the pairs dpfj_compare() finds under the threshold
+	int result = DPFJ_SUCCESS;
+	unsigned int i = 0;
+	for(i = nRow * DEDUP_BLOCK_SIZE; DPFJ_SUCCESS == result && i < nRowEnd; i++){
+		unsigned int n1 = pWave->vFmdIdx[i];
+		//on the diagonal only the FMDs after this one are compared
+		unsigned int j = (nRow == nCol) ? i + 1 : nCol * DEDUP_BLOCK_SIZE;
+		for(; DPFJ_SUCCESS == result && j < nColEnd; j++){
+			unsigned int n2 = pWave->vFmdIdx[j];
+			//the best matching views decide
+			unsigned int nBest = GALLERY_NO_SCORE;
+			unsigned int nView1 = 0;
+			for(nView1 = 0; DPFJ_SUCCESS == result && nView1 < pGallery->vFmdViewCnt[n1]; nView1++){
+				unsigned int nView2 = 0;
+				for(nView2 = 0; DPFJ_SUCCESS == result && nView2 < pGallery->vFmdViewCnt[n2]; nView2++){
+					unsigned int nScore = 0;
+					result = dpfj_compare(pGallery->nFmdType, pGallery->vFmd[n1], pGallery->vFmdSize[n1], nView1,
+						pGallery->nFmdType, pGallery->vFmd[n2], pGallery->vFmdSize[n2], nView2, &nScore);
+					if(nScore < nBest) nBest = nScore;
+				}
+			}
+			if(DPFJ_SUCCESS == result && nBest < pWave->nThreshold) result = add_pair(pPairs, pGallery->vFmdId[n1], pGallery->vFmdId[n2], nBest);
+		}
+	}
+
+	pWave->vResult[nTile] = result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// checkpoint
+
+//checkpoint file: header, then the pairs found in the finished tiles; pairs are written first and the header
+//after them, so pairs of an unfinished wave are past the count in the header and are dropped on resume
+typedef struct {
+	char         szMagic[8];
+	unsigned int nVersion;
+	unsigned int nFmdCnt;
+	unsigned int nComparedCnt;
+	unsigned int nThreshold;
+	unsigned int nBlockSize;
+	unsigned int nIdChecksum; //the checkpoint belongs to the gallery with these ids only
+	unsigned int nTileDoneCnt;
+	unsigned int nPairCnt;
+} dedup_checkpoint_t;
+
+static int pwrite_all(int fd, const void* pData, size_t nSize, off_t nOffset){
+	const unsigned char* p = (const unsigned char*)pData;
+	while(0 != nSize){
+		ssize_t n = pwrite(fd, p, nSize, nOffset);
+		if(0 > n){
+			if(EINTR == errno) continue;
+			return errno;
+		}
+		p += n;
+		nSize -= n;
+		nOffset += n;
+	}
+	return 0;
+}
+
+static int pread_all(int fd, void* pData, size_t nSize, off_t nOffset){
+	unsigned char* p = (unsigned char*)pData;
+	while(0 != nSize){
+		ssize_t n = pread(fd, p, nSize, nOffset);
+		if(0 > n){
+			if(EINTR == errno) continue;
+			return errno;
+		}
+		if(0 == n) return EINVAL;
+		p += n;
+		nSize -= n;
+		nOffset += n;
+	}
+	return 0;
+}
+
+//opens the checkpoint, or creates it for a new run; pairs of the finished tiles are read into the list
+static int open_checkpoint(const char* szPath, dedup_checkpoint_t* pCheckpoint, pair_list_t* pPairs, int* pfd){
+	int fd = open(szPath, O_RDWR | O_CREAT, 0644);
+	if(-1 == fd) return errno;
+
+	int result = 0;
+	struct stat st;
+	if(0 != fstat(fd, &st)) result = errno;
+	if(0 == result && 0 == st.st_size){
+		result = pwrite_all(fd, pCheckpoint, sizeof(dedup_checkpoint_t), 0);
+		if(0 == result && 0 != fsync(fd)) result = errno;
+	}
+	else if(0 == result){
+		dedup_checkpoint_t saved;
+		result = pread_all(fd, &saved, sizeof(saved), 0);
+		//a checkpoint of another run is never resumed
+		if(0 == result && (0 != memcmp(saved.szMagic, pCheckpoint->szMagic, sizeof(saved.szMagic))
+			|| saved.nVersion != pCheckpoint->nVersion || saved.nFmdCnt != pCheckpoint->nFmdCnt
+			|| saved.nComparedCnt != pCheckpoint->nComparedCnt
+			|| saved.nThreshold != pCheckpoint->nThreshold || saved.nBlockSize != pCheckpoint->nBlockSize
+			|| saved.nIdChecksum != pCheckpoint->nIdChecksum)) result = EINVAL;
+		if(0 == result && 0 != saved.nPairCnt){
+			pPairs->vPairs = (dedup_pair_t*)malloc(sizeof(dedup_pair_t) * saved.nPairCnt);
+			if(NULL == pPairs->vPairs) result = ENOMEM;
+			else pPairs->nPairAlloc = saved.nPairCnt;
+		}
+		if(0 == result) result = pread_all(fd, pPairs->vPairs, sizeof(dedup_pair_t) * saved.nPairCnt, sizeof(saved));
+		if(0 == result){
+			pPairs->nPairCnt = saved.nPairCnt;
+			pCheckpoint->nTileDoneCnt = saved.nTileDoneCnt;
+			pCheckpoint->nPairCnt = saved.nPairCnt;
+		}
+	}
+
+	if(0 != result){
+		close(fd);
+		return result;
+	}
+	*pfd = fd;
+	return 0;
+}
+
+static int save_checkpoint(int fd, dedup_checkpoint_t* pCheckpoint, const pair_list_t* pPairs){
+	unsigned int nNewCnt = pPairs->nPairCnt - pCheckpoint->nPairCnt;
+	off_t nOffset = sizeof(dedup_checkpoint_t) + (off_t)sizeof(dedup_pair_t) * pCheckpoint->nPairCnt;
+	int result = pwrite_all(fd, pPairs->vPairs + pCheckpoint->nPairCnt, sizeof(dedup_pair_t) * nNewCnt, nOffset);
+	if(0 == result && 0 != fsync(fd)) result = errno;
+	if(0 != result) return result;
+
+	pCheckpoint->nPairCnt = pPairs->nPairCnt;
+	result = pwrite_all(fd, pCheckpoint, sizeof(dedup_checkpoint_t), 0);
+	if(0 == result && 0 != fsync(fd)) result = errno;
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// clusters
+
+//union-find on the FMD indices, the root of every set is the FMD with the lowest id
+static unsigned int find_root(unsigned int* vParent, unsigned int n){
+	while(vParent[n] != n){
+		vParent[n] = vParent[vParent[n]];
+		n = vParent[n];
+	}
+	return n;
+}
+
+typedef struct {
+	unsigned int nRootId;
+	unsigned int nId;
+} cluster_member_t;
+
+static int compare_members(const void* p1, const void* p2){
+	const cluster_member_t* pm1 = (const cluster_member_t*)p1;
+	const cluster_member_t* pm2 = (const cluster_member_t*)p2;
+	if(pm1->nRootId != pm2->nRootId) return (pm1->nRootId < pm2->nRootId) ? -1 : 1;
+	return (pm1->nId < pm2->nId) ? -1 : (pm1->nId > pm2->nId);
+}
+
+static int build_clusters(gallery_t* pGallery, dedup_result_t* pResult){
+	unsigned int nFmdCnt = pGallery->nFmdCnt;
+	unsigned int* vParent = (unsigned int*)malloc(sizeof(unsigned int) * (nFmdCnt + 1));
+	unsigned char* vMember = (unsigned char*)calloc(nFmdCnt + 1, 1);
+	cluster_member_t* vMembers = (cluster_member_t*)malloc(sizeof(cluster_member_t) * (nFmdCnt + 1));
+	int result = (NULL == vParent || NULL == vMember || NULL == vMembers) ? ENOMEM : 0;
+
+	unsigned int nMemberCnt = 0;
+	if(0 == result){
+		unsigned int i = 0;
+		for(i = 0; i < nFmdCnt; i++){
+			vParent[i] = i;
+		}
+		for(i = 0; i < pResult->nPairCnt; i++){
+			unsigned int n1 = pGallery->vIdIndex[pResult->vPairs[i].nId1];
+			unsigned int n2 = pGallery->vIdIndex[pResult->vPairs[i].nId2];
+			vMember[n1] = vMember[n2] = 1;
+			unsigned int nRoot1 = find_root(vParent, n1);
+			unsigned int nRoot2 = find_root(vParent, n2);
+			if(nRoot1 == nRoot2) continue;
+			if(pGallery->vFmdId[nRoot1] < pGallery->vFmdId[nRoot2]) vParent[nRoot2] = nRoot1;
+			else vParent[nRoot1] = nRoot2;
+		}
+		for(i = 0; i < nFmdCnt; i++){
+			if(!vMember[i]) continue;
+			vMembers[nMemberCnt].nRootId = pGallery->vFmdId[find_root(vParent, i)];
+			vMembers[nMemberCnt].nId = pGallery->vFmdId[i];
+			nMemberCnt++;
+		}
+		qsort(vMembers, nMemberCnt, sizeof(cluster_member_t), compare_members);
+
+		//every cluster has at least two members
+		pResult->vClusterFirst = (unsigned int*)malloc(sizeof(unsigned int) * (nMemberCnt / 2 + 1));
+		pResult->vClusterIds = (unsigned int*)malloc(sizeof(unsigned int) * (nMemberCnt + 1));
+		if(NULL == pResult->vClusterFirst || NULL == pResult->vClusterIds) result = ENOMEM;
+	}
+	if(0 == result){
+		unsigned int i = 0;
+		for(i = 0; i < nMemberCnt; i++){
+			if(0 == i || vMembers[i].nRootId != vMembers[i - 1].nRootId) pResult->vClusterFirst[pResult->nClusterCnt++] = i;
+			pResult->vClusterIds[i] = vMembers[i].nId;
+		}
+		pResult->vClusterFirst[pResult->nClusterCnt] = nMemberCnt;
+	}
+
+	if(NULL != vParent) free(vParent);
+	if(NULL != vMember) free(vMember);
+	if(NULL != vMembers) free(vMembers);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// all-vs-all
+
+int Dedup_Run(gallery_t* pGallery, pool_t* pPool, unsigned int nThreshold, const char* szCheckpoint, dedup_result_t** ppResult){
+	if(NULL == pGallery || NULL == ppResult) return EINVAL;
+	*ppResult = NULL;
+
+	//FMDs which cannot be compared are left out before the tiles are laid, a resumed run leaves out the same ones
+	dedup_wave_t wave = {0};
+	unsigned int* vSkippedIds = (unsigned int*)malloc(sizeof(unsigned int) * (pGallery->nFmdCnt + 1));
+	unsigned int nSkippedCnt = 0;
+	wave.vFmdIdx = (unsigned int*)malloc(sizeof(unsigned int) * (pGallery->nFmdCnt + 1));
+	if(NULL == vSkippedIds || NULL == wave.vFmdIdx){
+		if(NULL != vSkippedIds) free(vSkippedIds);
+		if(NULL != wave.vFmdIdx) free(wave.vFmdIdx);
+		return ENOMEM;
+	}
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		if(is_comparable(pGallery, i)) wave.vFmdIdx[wave.nFmdCnt++] = i;
+		else vSkippedIds[nSkippedCnt++] = pGallery->vFmdId[i];
+	}
+
+	unsigned int nBlockCnt = (wave.nFmdCnt + DEDUP_BLOCK_SIZE - 1) / DEDUP_BLOCK_SIZE;
+	unsigned int nTileCnt = nBlockCnt * (nBlockCnt + 1) / 2;
+	unsigned int nWaveSize = Pool_GetThreadCnt(pPool) * DEDUP_TILES_PER_THREAD;
+
+	dedup_checkpoint_t checkpoint;
+	memset(&checkpoint, 0, sizeof(checkpoint));
+	memcpy(checkpoint.szMagic, DEDUP_CHECKPOINT_MAGIC, sizeof(checkpoint.szMagic));
+	checkpoint.nVersion = DEDUP_CHECKPOINT_VERSION;
+	checkpoint.nFmdCnt = pGallery->nFmdCnt;
+	checkpoint.nComparedCnt = wave.nFmdCnt;
+	checkpoint.nThreshold = nThreshold;
+	checkpoint.nBlockSize = DEDUP_BLOCK_SIZE;
+	checkpoint.nIdChecksum = Checksum_Fnv1a(pGallery->vFmdId, sizeof(unsigned int) * pGallery->nFmdCnt, CHECKSUM_INIT);
+
+	pair_list_t pairs = {0};
+	int fd = -1;
+	int result = 0;
+	if(NULL != szCheckpoint) result = open_checkpoint(szCheckpoint, &checkpoint, &pairs, &fd);
+
+	wave.pGallery = pGallery;
+	wave.nThreshold = nThreshold;
+	wave.vTileRow = (unsigned int*)malloc(sizeof(unsigned int) * nWaveSize);
+	wave.vTileCol = (unsigned int*)malloc(sizeof(unsigned int) * nWaveSize);
+	wave.vTilePairs = (pair_list_t*)calloc(nWaveSize, sizeof(pair_list_t));
+	wave.vResult = (int*)malloc(sizeof(int) * nWaveSize);
+	if(0 == result && (NULL == wave.vTileRow || NULL == wave.vTileCol || NULL == wave.vTilePairs || NULL == wave.vResult)) result = ENOMEM;
+
+	//tiles are numbered row by row, from the diagonal to the right; the finished ones are skipped
+	unsigned int nRow = 0;
+	unsigned int nCol = 0;
+	unsigned int nTile = 0;
+	for(nTile = 0; nTile < checkpoint.nTileDoneCnt; nTile++){
+		if(++nCol == nBlockCnt) nCol = ++nRow;
+	}
+	while(0 == result && nTile < nTileCnt){
+		unsigned int nWaveCnt = 0;
+		for(; nWaveCnt < nWaveSize && nTile < nTileCnt; nWaveCnt++, nTile++){
+			wave.vTileRow[nWaveCnt] = nRow;
+			wave.vTileCol[nWaveCnt] = nCol;
+			wave.vTilePairs[nWaveCnt].nPairCnt = 0;
+			if(++nCol == nBlockCnt) nCol = ++nRow;
+		}
+		result = Pool_Run(pPool, nWaveCnt, search_tile, &wave);
+
+		for(i = 0; 0 == result && i < nWaveCnt; i++){
+			result = wave.vResult[i];
+		}
+		for(i = 0; 0 == result && i < nWaveCnt; i++){
+			unsigned int k = 0;
+			for(k = 0; 0 == result && k < wave.vTilePairs[i].nPairCnt; k++){
+				dedup_pair_t* pPair = &wave.vTilePairs[i].vPairs[k];
+				result = add_pair(&pairs, pPair->nId1, pPair->nId2, pPair->nScore);
+			}
+		}
+		checkpoint.nTileDoneCnt = nTile;
+		if(0 == result && -1 != fd) result = save_checkpoint(fd, &checkpoint, &pairs);
+	}
+
+	dedup_result_t* pResult = NULL;
+	if(0 == result){
+		pResult = (dedup_result_t*)calloc(1, sizeof(dedup_result_t));
+		if(NULL == pResult) result = ENOMEM;
+	}
+	if(0 == result){
+		//every pair has been compared once, in a single tile
+		qsort(pairs.vPairs, pairs.nPairCnt, sizeof(dedup_pair_t), compare_pairs);
+		pResult->nPairCnt = pairs.nPairCnt;
+		pResult->vPairs = pairs.vPairs;
+		pairs.vPairs = NULL;
+		pResult->nSkippedCnt = nSkippedCnt;
+		pResult->vSkippedIds = vSkippedIds;
+		vSkippedIds = NULL;
+		result = build_clusters(pGallery, pResult);
+	}
+	if(0 == result) *ppResult = pResult;
+	else Dedup_FreeResult(pResult);
+
+	if(NULL != wave.vTilePairs){
+		for(i = 0; i < nWaveSize; i++){
+			if(NULL != wave.vTilePairs[i].vPairs) free(wave.vTilePairs[i].vPairs);
+		}
+		free(wave.vTilePairs);
+	}
+	if(NULL != wave.vTileRow) free(wave.vTileRow);
+	if(NULL != wave.vTileCol) free(wave.vTileCol);
+	if(NULL != wave.vResult) free(wave.vResult);
+	if(NULL != wave.vFmdIdx) free(wave.vFmdIdx);
+	if(NULL != vSkippedIds) free(vSkippedIds);
+	if(NULL != pairs.vPairs) free(pairs.vPairs);
+	if(-1 != fd) close(fd);
+	//a finished run leaves nothing to resume; the result stands if the file cannot be removed, a run which resumes
+	//it later would only read the same pairs back
+	if(0 == result && NULL != szCheckpoint) unlink(szCheckpoint);
+	return result;
+}
+
+void Dedup_FreeResult(dedup_result_t* pResult){
+	if(NULL == pResult) return;
+	if(NULL != pResult->vPairs) free(pResult->vPairs);
+	if(NULL != pResult->vClusterFirst) free(pResult->vClusterFirst);
+	if(NULL != pResult->vClusterIds) free(pResult->vClusterIds);
+	if(NULL != pResult->vSkippedIds) free(pResult->vSkippedIds);
+	free(pResult);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include "gallery.h"
+#include "pool.h"
+
+#include <dpfj.h>
+
+//dpfj_compare() faults on views with fewer minutiae, FMDs with such a view are left out of Dedup_Run() and
+//refused by Dedup_CheckEnrollment()
+#define DEDUP_MIN_MINUTIAE GALLERY_MIN_MINUTIAE
+
+typedef struct {
+	unsigned int nId1;   //ids of the FMDs in the gallery, nId1 < nId2
+	unsigned int nId2;
+	unsigned int nScore; //dissimilarity score of the best matching views
+} dedup_pair_t;
+
+//duplicates found by Dedup_Run(): pairs, and clusters of FMDs connected by them
+typedef struct {
+	unsigned int  nPairCnt;
+	dedup_pair_t* vPairs;        //sorted by the ids
+	unsigned int  nClusterCnt;
+	unsigned int* vClusterFirst; //index of the first id of every cluster in the vClusterIds, one more entry marks the end
+	unsigned int* vClusterIds;   //ids of the clusters, ascending within a cluster
+	unsigned int  nSkippedCnt;
+	unsigned int* vSkippedIds;   //ids of the FMDs not compared, they have a view of too few minutiae
+} dedup_result_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno
+
+//checks an enrollment FMD against the whole gallery before it is added: every view is searched as a probe of
+//Gallery_IdentifyParallel() with the full nThreshold, a false positive identification rate as for Gallery_Identify();
+//an FMD found by several views is returned once, with its best dissimilarity score, and the candidates are ranked by
+//it; DPFJ_E_INVALID_FMD is returned if a view has fewer than DEDUP_MIN_MINUTIAE minutiae
+int  Dedup_CheckEnrollment(gallery_t* pGallery, pool_t* pPool, unsigned char* pFmd, unsigned int nFmdSize,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
+
+//all-vs-all check of the gallery: every pair is compared once, in tiles which keep their FMDs in the cache, on
+//the pool threads; nThreshold is a false match rate of a single comparison; with a checkpoint file the progress
+//is saved after every few tiles, and a run with the same file, gallery and threshold resumes where it stopped,
+//a checkpoint of another gallery or threshold is refused with EINVAL; the file is removed when the run succeeds;
+//the gallery must not be changed during the run
+int  Dedup_Run(gallery_t* pGallery, pool_t* pPool, unsigned int nThreshold, const char* szCheckpoint, dedup_result_t** ppResult);
+void Dedup_FreeResult(dedup_result_t* pResult);
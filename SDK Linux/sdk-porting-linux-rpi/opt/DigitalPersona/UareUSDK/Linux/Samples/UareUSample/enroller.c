@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "enroller.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+//guards dpfj enrollment state, which is global in the library
+static pthread_mutex_t g_mutexEnrollment = PTHREAD_MUTEX_INITIALIZER;
+
+//runs collected FMDs through the library enrollment, creates enrollment FMD if it is ready;
+//must be called with the g_mutexEnrollment locked
+static int run_enrollment(enroller_t* pEnroller){
+	int result = dpfj_start_enrollment(pEnroller->nFmdType);
+	if(DPFJ_SUCCESS != result) return result;
+
+	unsigned int i = 0;
+	for(i = 0; i < pEnroller->nFmdCnt; i++){
+		result = dpfj_add_to_enrollment(pEnroller->nFmdType, pEnroller->vFmd[i], pEnroller->vFmdSize[i], pEnroller->vViewIdx[i]);
+		if(DPFJ_E_MORE_DATA != result) break;
+	}
+
+	if(DPFJ_SUCCESS == result){
+		//MAX_FMD_SIZE is enough for the enrollment FMD, no need to query the size
+		unsigned int nFmdSize = MAX_FMD_SIZE;
+		if(NULL == pEnroller->pEnrollmentFmd){
+			pEnroller->pEnrollmentFmd = (unsigned char*)malloc(nFmdSize);
+		}
+		if(NULL == pEnroller->pEnrollmentFmd) result = ENOMEM;
+		else result = dpfj_create_enrollment_fmd(pEnroller->pEnrollmentFmd, &nFmdSize);
+		if(DPFJ_SUCCESS == result) pEnroller->nEnrollmentFmdSize = nFmdSize;
+	}
+
+	int finish_result = dpfj_finish_enrollment();
+	if((DPFJ_SUCCESS == result || DPFJ_E_MORE_DATA == result) && DPFJ_SUCCESS != finish_result) result = finish_result;
+	return result;
+}
+
+int Enroller_Create(DPFJ_FMD_FORMAT nFmdType, enroller_t** ppEnroller){
+	if(NULL == ppEnroller) return EINVAL;
+
+	*ppEnroller = (enroller_t*)calloc(1, sizeof(enroller_t));
+	if(NULL == *ppEnroller) return ENOMEM;
+
+	(*ppEnroller)->nFmdType = nFmdType;
+	return 0;
+}
+
+void Enroller_Destroy(enroller_t* pEnroller){
+	if(NULL == pEnroller) return;
+	Enroller_Reset(pEnroller);
+	if(NULL != pEnroller->vFmd) free(pEnroller->vFmd);
+	if(NULL != pEnroller->vFmdSize) free(pEnroller->vFmdSize);
+	if(NULL != pEnroller->vViewIdx) free(pEnroller->vViewIdx);
+	if(NULL != pEnroller->pEnrollmentFmd) free(pEnroller->pEnrollmentFmd);
+	free(pEnroller);
+}
+
+void Enroller_Reset(enroller_t* pEnroller){
+	if(NULL == pEnroller) return;
+	unsigned int i = 0;
+	for(i = 0; i < pEnroller->nFmdCnt; i++){
+		free(pEnroller->vFmd[i]);
+	}
+	pEnroller->nFmdCnt = 0;
+	pEnroller->nEnrollmentFmdSize = 0;
+}
+
+int Enroller_Add(enroller_t* pEnroller, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx){
+	if(NULL == pEnroller || NULL == pFmd || 0 == nFmdSize) return EINVAL;
+	if(0 != pEnroller->nEnrollmentFmdSize) return DPFJ_SUCCESS;
+
+	//keep a copy of the FMD in the context
+	if(pEnroller->nFmdCnt == pEnroller->nFmdAlloc){
+		unsigned int nAlloc = (0 == pEnroller->nFmdAlloc) ? 4 : pEnroller->nFmdAlloc * 2;
+		unsigned char** vFmd = (unsigned char**)realloc(pEnroller->vFmd, sizeof(unsigned char*) * nAlloc);
+		if(NULL == vFmd) return ENOMEM;
+		pEnroller->vFmd = vFmd;
+		unsigned int* vFmdSize = (unsigned int*)realloc(pEnroller->vFmdSize, sizeof(unsigned int) * nAlloc);
+		if(NULL == vFmdSize) return ENOMEM;
+		pEnroller->vFmdSize = vFmdSize;
+		unsigned int* vViewIdx = (unsigned int*)realloc(pEnroller->vViewIdx, sizeof(unsigned int) * nAlloc);
+		if(NULL == vViewIdx) return ENOMEM;
+		pEnroller->vViewIdx = vViewIdx;
+		pEnroller->nFmdAlloc = nAlloc;
+	}
+	unsigned char* pCopy = (unsigned char*)malloc(nFmdSize);
+	if(NULL == pCopy) return ENOMEM;
+	memcpy(pCopy, pFmd, nFmdSize);
+	pEnroller->vFmd[pEnroller->nFmdCnt] = pCopy;
+	pEnroller->vFmdSize[pEnroller->nFmdCnt] = nFmdSize;
+	pEnroller->vViewIdx[pEnroller->nFmdCnt] = nViewIdx;
+	pEnroller->nFmdCnt++;
+
+	//library state is released between the calls, so the whole set is run through it every time
+	pthread_mutex_lock(&g_mutexEnrollment);
+	int result = run_enrollment(pEnroller);
+	pthread_mutex_unlock(&g_mutexEnrollment);
+
+	//the FMD which made the set invalid is not kept
+	if(DPFJ_SUCCESS != result && DPFJ_E_MORE_DATA != result){
+		pEnroller->nFmdCnt--;
+		free(pEnroller->vFmd[pEnroller->nFmdCnt]);
+	}
+	return result;
+}
+
+int Enroller_GetFmd(enroller_t* pEnroller, unsigned char** ppFmd, unsigned int* pnFmdSize){
+	if(NULL == pEnroller || NULL == ppFmd || NULL == pnFmdSize) return EINVAL;
+	if(0 == pEnroller->nEnrollmentFmdSize) return DPFJ_E_ENROLLMENT_NOT_READY;
+
+	*ppFmd = pEnroller->pEnrollmentFmd;
+	*pnFmdSize = pEnroller->nEnrollmentFmdSize;
+	return 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfj.h>
+
+//enrollment context: collects FMDs of one enrollment, any number of contexts can be used at the same time
+//from different threads; dpfj enrollment state is global, it is taken only for the short time needed to
+//run the collected FMDs through it, never while waiting for the next capture
+//all enrollments in the process must go through the contexts for this to work
+typedef struct {
+	DPFJ_FMD_FORMAT nFmdType;
+	unsigned char** vFmd;      //collected FMDs
+	unsigned int*   vFmdSize;
+	unsigned int*   vViewIdx;
+	unsigned int    nFmdCnt;
+	unsigned int    nFmdAlloc;
+	unsigned char*  pEnrollmentFmd;
+	unsigned int    nEnrollmentFmdSize; //0 until the enrollment is ready
+} enroller_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno
+int  Enroller_Create(DPFJ_FMD_FORMAT nFmdType, enroller_t** ppEnroller);
+void Enroller_Destroy(enroller_t* pEnroller);
+
+//returns DPFJ_E_MORE_DATA if more FMDs are needed, DPFJ_SUCCESS when the enrollment FMD is ready
+int  Enroller_Add(enroller_t* pEnroller, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx);
+
+//enrollment FMD stays owned by the context
+int  Enroller_GetFmd(enroller_t* pEnroller, unsigned char** ppFmd, unsigned int* pnFmdSize);
+
+//drops collected FMDs, context can be used for the next enrollment
+void Enroller_Reset(enroller_t* pEnroller);
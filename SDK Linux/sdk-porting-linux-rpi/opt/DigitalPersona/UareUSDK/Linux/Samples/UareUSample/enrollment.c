@@ -10,10 +10,18 @@
 #include <stdlib.h>
 
 #include "helpers.h"
+#include "enroller.h"
 
 #include <dpfj.h>
 
 void Enrollment(DPFPDD_DEV hReader){
+	//enrollment context, does not block enrollments running on other threads
+	enroller_t* pEnroller = NULL;
+	int result = Enroller_Create(DPFJ_FMD_ANSI_378_2004, &pEnroller);
+	if(0 != result){
+		print_error("Enroller_Create()", result);
+		return;
+	}
 
 	int bStop = 0;
 	while(!bStop){
@@ -24,11 +32,7 @@ void Enrollment(DPFPDD_DEV hReader){
 		printf("Enrollment started\n\n");
 
 		//start the enrollment
-		int result = dpfj_start_enrollment(DPFJ_FMD_ANSI_378_2004);
-		if(DPFJ_SUCCESS != result){
-			print_error("dpfj_start_enrollment()", result);
-			return;
-		}
+		Enroller_Reset(pEnroller);
 
 		//capture fingers, create templates
 		int bDone = 0;
@@ -53,7 +57,7 @@ void Enrollment(DPFPDD_DEV hReader){
 			}
 
 			//add template to enrollment
-			result = dpfj_add_to_enrollment(DPFJ_FMD_ANSI_378_2004, pFmd, nFmdSize, 0);
+			result = Enroller_Add(pEnroller, pFmd, nFmdSize, 0);
 
 			//template is not needed anymore
 			free(pFmd);
@@ -69,47 +73,26 @@ void Enrollment(DPFPDD_DEV hReader){
 				break;
 			}
 			else{
-				print_error("dpfj_add_to_enrollment()", result);
+				print_error("Enroller_Add()", result);
 				break;
 			}
 		}
 		
-		//determine size (optional, MAX_FMR_SIZE can be used)
-		unsigned char* pEnrollmentFmd = NULL;
-		unsigned int nEnrollmentFmdSize = 0;
-
 		if(bDone){
-			result = dpfj_create_enrollment_fmd(NULL, &nEnrollmentFmdSize);
-
-			if(DPFJ_E_MORE_DATA == result){
-				pEnrollmentFmd = (unsigned char*)malloc(nEnrollmentFmdSize);
-				if(NULL == pEnrollmentFmd){
-					print_error("malloc()", result);
-				}
-				else{
-					result = dpfj_create_enrollment_fmd(pEnrollmentFmd, &nEnrollmentFmdSize);
-				}
-			}
-			if(DPFJ_SUCCESS != result){
-				print_error("dpfj_create_enrollment_fmd()", result);
-				nEnrollmentFmdSize = 0;
-			}
-
-			if(NULL != pEnrollmentFmd && 0 != nEnrollmentFmdSize){
+			//enrollment template is created by the context as soon as it is ready, no size query is needed
+			unsigned char* pEnrollmentFmd = NULL;
+			unsigned int nEnrollmentFmdSize = 0;
+			result = Enroller_GetFmd(pEnroller, &pEnrollmentFmd, &nEnrollmentFmdSize);
+			if(0 == result){
 				printf("Enrollment template created, size: %d\n\n\n", nEnrollmentFmdSize);
 
-				//now enrollment template can be stored in the database
-
-				//release memory
-				free(pEnrollmentFmd);
+				//now enrollment template can be stored in the database, Dedup_CheckEnrollment() tells if the finger is already in it
 			}
-		}
-
-		//finish the enrollment
-		result = dpfj_finish_enrollment();
-		if(DPFJ_SUCCESS != result){
-			print_error("dpfj_finish_enrollment()", result);
+			else print_error("Enroller_GetFmd()", result);
 		}
 	}
+
+	//release memory
+	Enroller_Destroy(pEnroller);
 }
 
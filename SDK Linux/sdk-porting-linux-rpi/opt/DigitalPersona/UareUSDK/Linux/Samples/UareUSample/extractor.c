@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "extractor.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void run_job(extractor_t* pExtractor, extractor_job_t* pJob){
+	//MAX_FMD_SIZE is enough for any FMD, the size query would run the extraction twice
+	unsigned int nFmdSize = MAX_FMD_SIZE;
+	unsigned char* pFmd = (unsigned char*)malloc(nFmdSize);
+	int result = (NULL == pFmd) ? ENOMEM : 0;
+	if(0 == result) result = dpfj_create_fmd_from_fid(pJob->nFidType, pJob->pFid, pJob->nFidSize, pExtractor->nFmdType, pFmd, &nFmdSize);
+	if(0 == result){
+		unsigned char* pShrunk = (unsigned char*)realloc(pFmd, nFmdSize);
+		if(NULL != pShrunk) pFmd = pShrunk;
+	}
+	else{
+		if(NULL != pFmd) free(pFmd);
+		pFmd = NULL;
+		nFmdSize = 0;
+	}
+	free(pJob->pFid);
+
+	pExtractor->pfnCallback(pExtractor->pContext, pJob->nTag, result, pFmd, nFmdSize);
+}
+
+static void* worker_thread(void* pArg){
+	extractor_t* pExtractor = (extractor_t*)pArg;
+
+	pthread_mutex_lock(&pExtractor->mutex);
+	while(1){
+		extractor_job_t* pJob = pExtractor->pHead;
+		if(NULL == pJob){
+			if(pExtractor->bStop) break;
+			pthread_cond_wait(&pExtractor->condWork, &pExtractor->mutex);
+			continue;
+		}
+		pExtractor->pHead = pJob->pNext;
+		if(NULL == pExtractor->pHead) pExtractor->pTail = NULL;
+
+		pthread_mutex_unlock(&pExtractor->mutex);
+		run_job(pExtractor, pJob);
+		free(pJob);
+		pthread_mutex_lock(&pExtractor->mutex);
+
+		pExtractor->nPendingCnt--;
+		pthread_cond_broadcast(&pExtractor->condDone);
+	}
+	pthread_mutex_unlock(&pExtractor->mutex);
+	return NULL;
+}
+
+int Extractor_Create(DPFJ_FMD_FORMAT nFmdType, unsigned int nThreadCnt, unsigned int nMaxPending,
+	extractor_callback_t pfnCallback, void* pContext, extractor_t** ppExtractor){
+	if(NULL == ppExtractor || NULL == pfnCallback || 0 == nMaxPending) return EINVAL;
+	*ppExtractor = NULL;
+
+	if(0 == nThreadCnt){
+		long nCpuCnt = sysconf(_SC_NPROCESSORS_ONLN);
+		nThreadCnt = (0 < nCpuCnt) ? (unsigned int)nCpuCnt : 1;
+	}
+
+	extractor_t* pExtractor = (extractor_t*)calloc(1, sizeof(extractor_t));
+	if(NULL == pExtractor) return ENOMEM;
+	pExtractor->vThreads = (pthread_t*)calloc(nThreadCnt, sizeof(pthread_t));
+	if(NULL == pExtractor->vThreads){
+		free(pExtractor);
+		return ENOMEM;
+	}
+	pExtractor->nFmdType = nFmdType;
+	pExtractor->pfnCallback = pfnCallback;
+	pExtractor->pContext = pContext;
+	pExtractor->nMaxPending = nMaxPending;
+	pthread_mutex_init(&pExtractor->mutex, NULL);
+	pthread_cond_init(&pExtractor->condWork, NULL);
+	pthread_cond_init(&pExtractor->condDone, NULL);
+
+	//unlike the pool, the calling thread does not take part: it is busy capturing
+	unsigned int i = 0;
+	for(i = 0; i < nThreadCnt; i++){
+		int result = pthread_create(&pExtractor->vThreads[i], NULL, worker_thread, pExtractor);
+		if(0 != result){
+			Extractor_Destroy(pExtractor);
+			return result;
+		}
+		pExtractor->nThreadCnt++;
+	}
+
+	*ppExtractor = pExtractor;
+	return 0;
+}
+
+void Extractor_Destroy(extractor_t* pExtractor){
+	if(NULL == pExtractor) return;
+
+	pthread_mutex_lock(&pExtractor->mutex);
+	pExtractor->bStop = 1;
+	pthread_cond_broadcast(&pExtractor->condWork);
+	pthread_mutex_unlock(&pExtractor->mutex);
+
+	unsigned int i = 0;
+	for(i = 0; i < pExtractor->nThreadCnt; i++) pthread_join(pExtractor->vThreads[i], NULL);
+
+	pthread_cond_destroy(&pExtractor->condDone);
+	pthread_cond_destroy(&pExtractor->condWork);
+	pthread_mutex_destroy(&pExtractor->mutex);
+	free(pExtractor->vThreads);
+	free(pExtractor);
+}
+
+int Extractor_Submit(extractor_t* pExtractor, DPFJ_FID_FORMAT nFidType, unsigned char* pFid, unsigned int nFidSize, unsigned int nTag){
+	if(NULL == pExtractor || NULL == pFid) return EINVAL;
+
+	extractor_job_t* pJob = (extractor_job_t*)malloc(sizeof(extractor_job_t));
+	if(NULL == pJob) return ENOMEM;
+	pJob->pNext = NULL;
+	pJob->nFidType = nFidType;
+	pJob->pFid = pFid;
+	pJob->nFidSize = nFidSize;
+	pJob->nTag = nTag;
+
+	pthread_mutex_lock(&pExtractor->mutex);
+	while(pExtractor->nPendingCnt >= pExtractor->nMaxPending) pthread_cond_wait(&pExtractor->condDone, &pExtractor->mutex);
+	if(NULL != pExtractor->pTail) pExtractor->pTail->pNext = pJob;
+	else pExtractor->pHead = pJob;
+	pExtractor->pTail = pJob;
+	pExtractor->nPendingCnt++;
+	pthread_cond_signal(&pExtractor->condWork);
+	pthread_mutex_unlock(&pExtractor->mutex);
+	return 0;
+}
+
+void Extractor_Wait(extractor_t* pExtractor){
+	if(NULL == pExtractor) return;
+
+	pthread_mutex_lock(&pExtractor->mutex);
+	while(0 != pExtractor->nPendingCnt) pthread_cond_wait(&pExtractor->condDone, &pExtractor->mutex);
+	pthread_mutex_unlock(&pExtractor->mutex);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include <dpfj.h>
+
+//called on a worker thread when extraction of a submitted FID is finished; FMD is allocated with malloc()
+//and belongs to the callee, it is NULL if extraction failed
+typedef void (*extractor_callback_t)(void* pContext, unsigned int nTag, int nResult, unsigned char* pFmd, unsigned int nFmdSize);
+
+typedef struct extractor_job_s {
+	struct extractor_job_s* pNext;
+	DPFJ_FID_FORMAT         nFidType;
+	unsigned char*          pFid;
+	unsigned int            nFidSize;
+	unsigned int            nTag;
+} extractor_job_t;
+
+//feature extraction stage: captured FIDs are queued and extracted on worker threads,
+//so the reader can capture the next finger while the previous one is being extracted
+typedef struct {
+	DPFJ_FMD_FORMAT      nFmdType;
+	extractor_callback_t pfnCallback;
+	void*                pContext;
+	pthread_t*           vThreads;
+	unsigned int         nThreadCnt;
+	pthread_mutex_t      mutex;
+	pthread_cond_t       condWork;
+	pthread_cond_t       condDone;   //signaled when a job is finished
+	extractor_job_t*     pHead;
+	extractor_job_t*     pTail;
+	unsigned int         nPendingCnt; //jobs queued or running
+	unsigned int         nMaxPending;
+	int                  bStop;
+} extractor_t;
+
+//nThreadCnt of 0 creates one thread per online CPU; Extractor_Submit() blocks while nMaxPending jobs are pending
+//all functions return 0 on success, otherwise DPFJ error code or errno
+int  Extractor_Create(DPFJ_FMD_FORMAT nFmdType, unsigned int nThreadCnt, unsigned int nMaxPending,
+	extractor_callback_t pfnCallback, void* pContext, extractor_t** ppExtractor);
+void Extractor_Destroy(extractor_t* pExtractor); //finishes pending jobs first
+
+//FID must be allocated with malloc(), it is taken over and freed after extraction
+int  Extractor_Submit(extractor_t* pExtractor, DPFJ_FID_FORMAT nFidType, unsigned char* pFid, unsigned int nFidSize, unsigned int nTag);
+
+//returns when all submitted jobs are finished and their callbacks returned
+void Extractor_Wait(extractor_t* pExtractor);
@@ -0,0 +1,1357 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "gallery.h"
+#include "checksum.h"
+#include "record.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//FMDs are placed in the arena on this boundary, so every FMD starts on its own cache line
+#define GALLERY_FMD_ALIGN 64
+
+//parallel identification: gallery is split into this many shards per thread, so the threads
+//which finish early can take over the remaining shards; shards are never smaller than the minimum
+#define GALLERY_SHARDS_PER_THREAD 4
+#define GALLERY_MIN_SHARD_SIZE    256
+
+//batch identification: shards are not larger than this, so a shard stays in the cache while
+//all probes of a block are searched in it; probes are searched in blocks of this size
+#define GALLERY_BATCH_SHARD_SIZE  1024
+#define GALLERY_BATCH_PROBE_BLOCK 32
+
+static unsigned int align_size(unsigned int nSize){
+	return (nSize + GALLERY_FMD_ALIGN - 1) & ~(GALLERY_FMD_ALIGN - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// validation
+
+//finger position, impression type and minutiae of the view, read from its header
+static void compute_signature(const fmd_record_t* pRecord, unsigned int nViewIdx, gallery_signature_t* pSignature){
+	memset(pSignature, 0, sizeof(gallery_signature_t));
+	fmd_view_t view;
+	if(0 != FmdRecord_GetView(pRecord, nViewIdx, &view)) return;
+	pSignature->nFingerPos = (unsigned char)view.nFingerPos;
+	pSignature->nImpressionType = (unsigned char)view.nImpressionType;
+	pSignature->nMinutiaCnt = (unsigned char)view.nMinutiaCnt;
+}
+
+//nearest neighbour distances are binned by half a millimetre, the last bin takes everything from 3.5 mm on;
+//every minutia is measured against all others, which costs more than the rest of adding the FMD
+static void compute_histogram(const fmd_record_t* pRecord, unsigned int nViewIdx, gallery_signature_t* pSignature){
+	memset(pSignature->vHistogram, 0, sizeof(pSignature->vHistogram));
+	pSignature->bHistogram = 1;
+	fmd_view_t view;
+	if(0 != FmdRecord_GetView(pRecord, nViewIdx, &view) || 2 > view.nMinutiaCnt) return;
+
+	//resolution is in pixels per centimetre, 0 in some records: 500 dpi is assumed then
+	unsigned int nResolution = (0 != pRecord->nResolution) ? pRecord->nResolution : 197;
+	unsigned int vCount[GALLERY_SIGNATURE_BINS] = {0};
+	unsigned int i = 0;
+	for(i = 0; i < view.nMinutiaCnt; i++){
+		fmd_minutia_t m1;
+		FmdView_GetMinutia(&view, i, &m1);
+		unsigned long long nNearest = ~0ULL;
+		unsigned int j = 0;
+		for(j = 0; j < view.nMinutiaCnt; j++){
+			if(i == j) continue;
+			fmd_minutia_t m2;
+			FmdView_GetMinutia(&view, j, &m2);
+			long long dx = (long long)m1.nX - m2.nX;
+			long long dy = (long long)m1.nY - m2.nY;
+			unsigned long long nDist = dx * dx + dy * dy;
+			if(nDist < nNearest) nNearest = nDist;
+		}
+		//bin of d is d / 0.5 mm = d * 20 / resolution, compared squared
+		unsigned int nBin = 0;
+		while(nBin < GALLERY_SIGNATURE_BINS - 1 && nNearest * 400 >= (unsigned long long)(nBin + 1) * (nBin + 1) * nResolution * nResolution) nBin++;
+		vCount[nBin]++;
+	}
+	for(i = 0; i < GALLERY_SIGNATURE_BINS; i++){
+		pSignature->vHistogram[i] = (unsigned char)(vCount[i] * 255 / view.nMinutiaCnt);
+	}
+}
+
+//the record is walked once, instead of once per view by the dpfj_get_fmd_*() getters
+static int validate_fmd(gallery_t* pGallery, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int* pnViewCnt,
+	gallery_signature_t* pSignature){
+	fmd_record_t record;
+	int result = FmdRecord_Parse(&record, pGallery->nFmdType, pFmd, nFmdSize);
+	if(0 != result) return result;
+
+	*pnViewCnt = record.nViewCnt;
+	compute_signature(&record, 0, pSignature);
+	if(pGallery->bPrefilter) compute_histogram(&record, 0, pSignature);
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// partitions
+
+//unknown and out of range finger positions go to the partitions of DPFJ_POSITION_UNKNOWN
+static unsigned int partition_of(const gallery_signature_t* pSignature){
+	unsigned int nFingerPos = (GALLERY_FINGER_POSITIONS > pSignature->nFingerPos) ? pSignature->nFingerPos : DPFJ_POSITION_UNKNOWN;
+	return nFingerPos * GALLERY_IMPRESSION_TYPES + (pSignature->nImpressionType & (GALLERY_IMPRESSION_TYPES - 1));
+}
+
+//makes room for one more FMD in the partition, so adding it cannot fail
+static int reserve_partition(gallery_t* pGallery, unsigned int nPartition){
+	gallery_partition_t* pPartition = &pGallery->vPartition[nPartition];
+	if(pPartition->nFmdCnt < pPartition->nFmdAlloc) return 0;
+
+	unsigned int nAlloc = (0 == pPartition->nFmdAlloc) ? 64 : pPartition->nFmdAlloc * 2;
+	unsigned char** vFmd = (unsigned char**)realloc(pPartition->vFmd, sizeof(unsigned char*) * nAlloc);
+	if(NULL == vFmd) return ENOMEM;
+	pPartition->vFmd = vFmd;
+	unsigned int* vFmdSize = (unsigned int*)realloc(pPartition->vFmdSize, sizeof(unsigned int) * nAlloc);
+	if(NULL == vFmdSize) return ENOMEM;
+	pPartition->vFmdSize = vFmdSize;
+	unsigned int* vFmdIdx = (unsigned int*)realloc(pPartition->vFmdIdx, sizeof(unsigned int) * nAlloc);
+	if(NULL == vFmdIdx) return ENOMEM;
+	pPartition->vFmdIdx = vFmdIdx;
+	pPartition->nFmdAlloc = nAlloc;
+	return 0;
+}
+
+static void add_to_partition(gallery_t* pGallery, unsigned int nIdx){
+	gallery_partition_t* pPartition = &pGallery->vPartition[partition_of(&pGallery->vFmdSignature[nIdx])];
+	unsigned int nEntry = pPartition->nFmdCnt++;
+	pPartition->vFmd[nEntry] = pGallery->vFmd[nIdx];
+	pPartition->vFmdSize[nEntry] = pGallery->vFmdSize[nIdx];
+	pPartition->vFmdIdx[nEntry] = nIdx;
+	pGallery->vFmdPartitionIdx[nIdx] = nEntry;
+}
+
+//the last entry of the partition takes the place of the removed one
+static void remove_from_partition(gallery_t* pGallery, unsigned int nIdx){
+	gallery_partition_t* pPartition = &pGallery->vPartition[partition_of(&pGallery->vFmdSignature[nIdx])];
+	unsigned int nEntry = pGallery->vFmdPartitionIdx[nIdx];
+	unsigned int nLast = --pPartition->nFmdCnt;
+	if(nEntry != nLast){
+		pPartition->vFmd[nEntry] = pPartition->vFmd[nLast];
+		pPartition->vFmdSize[nEntry] = pPartition->vFmdSize[nLast];
+		pPartition->vFmdIdx[nEntry] = pPartition->vFmdIdx[nLast];
+		pGallery->vFmdPartitionIdx[pPartition->vFmdIdx[nEntry]] = nEntry;
+	}
+}
+
+//the FMD is moved from nFrom to nTo in the arrays of the gallery
+static void move_in_partition(gallery_t* pGallery, unsigned int nFrom, unsigned int nTo){
+	gallery_partition_t* pPartition = &pGallery->vPartition[partition_of(&pGallery->vFmdSignature[nFrom])];
+	pPartition->vFmdIdx[pGallery->vFmdPartitionIdx[nFrom]] = nTo;
+	pGallery->vFmdPartitionIdx[nTo] = pGallery->vFmdPartitionIdx[nFrom];
+}
+
+static void rebase_partitions(gallery_t* pGallery){
+	unsigned int i = 0;
+	for(i = 0; i < GALLERY_FINGER_POSITIONS * GALLERY_IMPRESSION_TYPES; i++){
+		gallery_partition_t* pPartition = &pGallery->vPartition[i];
+		unsigned int j = 0;
+		for(j = 0; j < pPartition->nFmdCnt; j++) pPartition->vFmd[j] = pGallery->vFmd[pPartition->vFmdIdx[j]];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// arena
+
+static void rebase_fmds(gallery_t* pGallery){
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		pGallery->vFmd[i] = pGallery->pArena + pGallery->vFmdOffset[i];
+	}
+	rebase_partitions(pGallery);
+}
+
+typedef struct {
+	unsigned int nOffset;
+	unsigned int nIdx;
+} arena_slot_t;
+
+static int compare_slots(const void* p1, const void* p2){
+	unsigned int n1 = ((const arena_slot_t*)p1)->nOffset;
+	unsigned int n2 = ((const arena_slot_t*)p2)->nOffset;
+	return (n1 < n2) ? -1 : (n1 > n2);
+}
+
+static int compact_arena(gallery_t* pGallery){
+	//entries moved by Gallery_Remove() are out of the arena order, visit FMDs by offset
+	//so the data can be moved down in a single pass
+	arena_slot_t* vSlots = (arena_slot_t*)malloc(sizeof(arena_slot_t) * (pGallery->nFmdCnt + 1));
+	if(NULL == vSlots) return ENOMEM;
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		vSlots[i].nOffset = pGallery->vFmdOffset[i];
+		vSlots[i].nIdx = i;
+	}
+	qsort(vSlots, pGallery->nFmdCnt, sizeof(arena_slot_t), compare_slots);
+
+	unsigned int nUsed = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		unsigned int nIdx = vSlots[i].nIdx;
+		if(nUsed != pGallery->vFmdOffset[nIdx]){
+			memmove(pGallery->pArena + nUsed, pGallery->pArena + pGallery->vFmdOffset[nIdx], pGallery->vFmdSize[nIdx]);
+			pGallery->vFmdOffset[nIdx] = nUsed;
+		}
+		nUsed += align_size(pGallery->vFmdSize[nIdx]);
+	}
+	free(vSlots);
+
+	pGallery->nArenaUsed = nUsed;
+	pGallery->nArenaDead = 0;
+	rebase_fmds(pGallery);
+	return 0;
+}
+
+//the arena is addressed by unsigned int offsets, it is doubled while that fits and takes the rest of the range after
+static unsigned int grow_arena_size(unsigned int nSize){
+	return (UINT_MAX / 2 < nSize) ? UINT_MAX : nSize * 2;
+}
+
+static int reserve_arena(gallery_t* pGallery, unsigned int nSize){
+	if(UINT_MAX - pGallery->nArenaUsed < nSize) return ENOMEM;
+	if(pGallery->nArenaUsed + nSize <= pGallery->nArenaSize) return 0;
+
+	//reuse space of the removed FMDs before growing; a mapped arena is read-only, it is compacted after it is copied
+	if(0 != pGallery->nArenaDead && NULL == pGallery->pMapping){
+		int result = compact_arena(pGallery);
+		if(0 != result) return result;
+		if(pGallery->nArenaUsed + nSize <= pGallery->nArenaSize) return 0;
+	}
+
+	unsigned int nNewSize = (0 == pGallery->nArenaSize) ? 64 * MAX_FMD_SIZE : grow_arena_size(pGallery->nArenaSize);
+	while(nNewSize < pGallery->nArenaUsed + nSize) nNewSize = grow_arena_size(nNewSize);
+	void* pNewArena = NULL;
+	if(0 != posix_memalign(&pNewArena, GALLERY_FMD_ALIGN, nNewSize)) return ENOMEM;
+	if(NULL != pGallery->pArena){
+		memcpy(pNewArena, pGallery->pArena, pGallery->nArenaUsed);
+		if(NULL != pGallery->pMapping){
+			munmap(pGallery->pMapping, pGallery->nMappingSize);
+			pGallery->pMapping = NULL;
+			pGallery->nMappingSize = 0;
+		}
+		else free(pGallery->pArena);
+	}
+
+	pGallery->pArena = (unsigned char*)pNewArena;
+	pGallery->nArenaSize = nNewSize;
+	rebase_fmds(pGallery);
+	return 0;
+}
+
+static int reserve_entries(gallery_t* pGallery){
+	if(pGallery->nFmdCnt < pGallery->nFmdAlloc && pGallery->nNextId < pGallery->nIdAlloc) return 0;
+
+	if(pGallery->nFmdCnt == pGallery->nFmdAlloc){
+		unsigned int nAlloc = (0 == pGallery->nFmdAlloc) ? 64 : pGallery->nFmdAlloc * 2;
+		unsigned char** vFmd = (unsigned char**)realloc(pGallery->vFmd, sizeof(unsigned char*) * nAlloc);
+		if(NULL == vFmd) return ENOMEM;
+		pGallery->vFmd = vFmd;
+		unsigned int* vFmdSize = (unsigned int*)realloc(pGallery->vFmdSize, sizeof(unsigned int) * nAlloc);
+		if(NULL == vFmdSize) return ENOMEM;
+		pGallery->vFmdSize = vFmdSize;
+		unsigned int* vFmdOffset = (unsigned int*)realloc(pGallery->vFmdOffset, sizeof(unsigned int) * nAlloc);
+		if(NULL == vFmdOffset) return ENOMEM;
+		pGallery->vFmdOffset = vFmdOffset;
+		unsigned int* vFmdViewCnt = (unsigned int*)realloc(pGallery->vFmdViewCnt, sizeof(unsigned int) * nAlloc);
+		if(NULL == vFmdViewCnt) return ENOMEM;
+		pGallery->vFmdViewCnt = vFmdViewCnt;
+		gallery_signature_t* vFmdSignature = (gallery_signature_t*)realloc(pGallery->vFmdSignature, sizeof(gallery_signature_t) * nAlloc);
+		if(NULL == vFmdSignature) return ENOMEM;
+		pGallery->vFmdSignature = vFmdSignature;
+		unsigned int* vFmdId = (unsigned int*)realloc(pGallery->vFmdId, sizeof(unsigned int) * nAlloc);
+		if(NULL == vFmdId) return ENOMEM;
+		pGallery->vFmdId = vFmdId;
+		unsigned int* vFmdPartitionIdx = (unsigned int*)realloc(pGallery->vFmdPartitionIdx, sizeof(unsigned int) * nAlloc);
+		if(NULL == vFmdPartitionIdx) return ENOMEM;
+		pGallery->vFmdPartitionIdx = vFmdPartitionIdx;
+		pGallery->nFmdAlloc = nAlloc;
+	}
+	if(pGallery->nNextId == pGallery->nIdAlloc){
+		unsigned int nAlloc = (0 == pGallery->nIdAlloc) ? 64 : pGallery->nIdAlloc * 2;
+		unsigned int* vIdIndex = (unsigned int*)realloc(pGallery->vIdIndex, sizeof(unsigned int) * nAlloc);
+		if(NULL == vIdIndex) return ENOMEM;
+		pGallery->vIdIndex = vIdIndex;
+		pGallery->nIdAlloc = nAlloc;
+	}
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// gallery
+
+int Gallery_Create(DPFJ_FMD_FORMAT nFmdType, gallery_t** ppGallery){
+	if(NULL == ppGallery) return EINVAL;
+	if(DPFJ_FMD_ANSI_378_2004 != nFmdType && DPFJ_FMD_ISO_19794_2_2005 != nFmdType) return DPFJ_E_INVALID_PARAMETER;
+
+	*ppGallery = (gallery_t*)calloc(1, sizeof(gallery_t));
+	if(NULL == *ppGallery) return ENOMEM;
+	(*ppGallery)->vPartition = (gallery_partition_t*)calloc(GALLERY_FINGER_POSITIONS * GALLERY_IMPRESSION_TYPES, sizeof(gallery_partition_t));
+	if(NULL == (*ppGallery)->vPartition){
+		free(*ppGallery);
+		*ppGallery = NULL;
+		return ENOMEM;
+	}
+
+	(*ppGallery)->nFmdType = nFmdType;
+	return 0;
+}
+
+void Gallery_Destroy(gallery_t* pGallery){
+	if(NULL == pGallery) return;
+	if(NULL != pGallery->pMapping) munmap(pGallery->pMapping, pGallery->nMappingSize);
+	else if(NULL != pGallery->pArena) free(pGallery->pArena);
+	if(NULL != pGallery->vFmd) free(pGallery->vFmd);
+	if(NULL != pGallery->vFmdSize) free(pGallery->vFmdSize);
+	if(NULL != pGallery->vFmdOffset) free(pGallery->vFmdOffset);
+	if(NULL != pGallery->vFmdViewCnt) free(pGallery->vFmdViewCnt);
+	if(NULL != pGallery->vFmdSignature) free(pGallery->vFmdSignature);
+	if(NULL != pGallery->vFmdId) free(pGallery->vFmdId);
+	if(NULL != pGallery->vIdIndex) free(pGallery->vIdIndex);
+	if(NULL != pGallery->vFmdPartitionIdx) free(pGallery->vFmdPartitionIdx);
+	unsigned int i = 0;
+	for(i = 0; i < GALLERY_FINGER_POSITIONS * GALLERY_IMPRESSION_TYPES; i++){
+		gallery_partition_t* pPartition = &pGallery->vPartition[i];
+		if(NULL != pPartition->vFmd) free(pPartition->vFmd);
+		if(NULL != pPartition->vFmdSize) free(pPartition->vFmdSize);
+		if(NULL != pPartition->vFmdIdx) free(pPartition->vFmdIdx);
+	}
+	free(pGallery->vPartition);
+	free(pGallery);
+}
+
+//appends the FMD which is already written at the end of the arena
+static void commit_fmd(gallery_t* pGallery, unsigned int nFmdSize, unsigned int nViewCnt, const gallery_signature_t* pSignature,
+	unsigned int* pnId){
+	unsigned int nIdx = pGallery->nFmdCnt;
+	unsigned int nId = pGallery->nNextId;
+	pGallery->vFmdOffset[nIdx] = pGallery->nArenaUsed;
+	pGallery->vFmd[nIdx] = pGallery->pArena + pGallery->nArenaUsed;
+	pGallery->vFmdSize[nIdx] = nFmdSize;
+	pGallery->vFmdViewCnt[nIdx] = nViewCnt;
+	pGallery->vFmdSignature[nIdx] = *pSignature;
+	pGallery->vFmdId[nIdx] = nId;
+	pGallery->vIdIndex[nId] = nIdx;
+	add_to_partition(pGallery, nIdx);
+	pGallery->nArenaUsed += align_size(nFmdSize);
+	pGallery->nFmdCnt++;
+	pGallery->nNextId++;
+
+	*pnId = nId;
+}
+
+int Gallery_Add(gallery_t* pGallery, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int* pnId){
+	if(NULL == pGallery || NULL == pnId) return EINVAL;
+
+	//FMD is parsed and validated only once, here
+	unsigned int nViewCnt = 0;
+	gallery_signature_t signature;
+	int result = validate_fmd(pGallery, pFmd, nFmdSize, &nViewCnt, &signature);
+	if(0 != result) return result;
+
+	result = reserve_entries(pGallery);
+	if(0 == result) result = reserve_partition(pGallery, partition_of(&signature));
+	if(0 == result) result = reserve_arena(pGallery, align_size(nFmdSize));
+	if(0 != result) return result;
+
+	memcpy(pGallery->pArena + pGallery->nArenaUsed, pFmd, nFmdSize);
+	commit_fmd(pGallery, nFmdSize, nViewCnt, &signature, pnId);
+	return 0;
+}
+
+//features are extracted straight into the free end of the arena: MAX_FMD_SIZE is reserved there, so
+//the size never has to be queried (which runs the extraction twice), and only the actual size is kept
+static int add_extracted(gallery_t* pGallery, int bRaw, DPFJ_FID_FORMAT nFidType, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int nWidth, unsigned int nHeight, unsigned int nDpi, DPFJ_FINGER_POSITION nFingerPos, unsigned int* pnId){
+	if(NULL == pGallery || NULL == pImage || NULL == pnId) return EINVAL;
+
+	int result = reserve_entries(pGallery);
+	if(0 == result) result = reserve_arena(pGallery, align_size(MAX_FMD_SIZE));
+	if(0 != result) return result;
+
+	unsigned char* pFmd = pGallery->pArena + pGallery->nArenaUsed;
+	unsigned int nFmdSize = MAX_FMD_SIZE;
+	if(bRaw){
+		result = dpfj_create_fmd_from_raw(pImage, nImageSize, nWidth, nHeight, nDpi, nFingerPos, 0, pGallery->nFmdType, pFmd, &nFmdSize);
+	}
+	else{
+		result = dpfj_create_fmd_from_fid(nFidType, pImage, nImageSize, pGallery->nFmdType, pFmd, &nFmdSize);
+	}
+	if(DPFJ_SUCCESS != result) return result;
+
+	unsigned int nViewCnt = 0;
+	gallery_signature_t signature;
+	result = validate_fmd(pGallery, pFmd, nFmdSize, &nViewCnt, &signature);
+	if(0 == result) result = reserve_partition(pGallery, partition_of(&signature));
+	if(0 != result) return result;
+
+	commit_fmd(pGallery, nFmdSize, nViewCnt, &signature, pnId);
+	return 0;
+}
+
+int Gallery_AddFromFid(gallery_t* pGallery, DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize, unsigned int* pnId){
+	return add_extracted(pGallery, 0, nFidType, pFid, nFidSize, 0, 0, 0, DPFJ_POSITION_UNKNOWN, pnId);
+}
+
+int Gallery_AddFromRaw(gallery_t* pGallery, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int nWidth, unsigned int nHeight, unsigned int nDpi, DPFJ_FINGER_POSITION nFingerPos, unsigned int* pnId){
+	return add_extracted(pGallery, 1, 0, pImage, nImageSize, nWidth, nHeight, nDpi, nFingerPos, pnId);
+}
+
+int Gallery_Remove(gallery_t* pGallery, unsigned int nId){
+	if(NULL == pGallery) return EINVAL;
+	if(nId >= pGallery->nNextId || GALLERY_NO_INDEX == pGallery->vIdIndex[nId]) return ENOENT;
+
+	//move the last entry into the place of the removed one, the data stays in the arena until compacted
+	unsigned int nIdx = pGallery->vIdIndex[nId];
+	unsigned int nLast = pGallery->nFmdCnt - 1;
+	pGallery->nArenaDead += align_size(pGallery->vFmdSize[nIdx]);
+	remove_from_partition(pGallery, nIdx);
+	if(nIdx != nLast){
+		move_in_partition(pGallery, nLast, nIdx);
+		pGallery->vFmd[nIdx] = pGallery->vFmd[nLast];
+		pGallery->vFmdSize[nIdx] = pGallery->vFmdSize[nLast];
+		pGallery->vFmdOffset[nIdx] = pGallery->vFmdOffset[nLast];
+		pGallery->vFmdViewCnt[nIdx] = pGallery->vFmdViewCnt[nLast];
+		pGallery->vFmdSignature[nIdx] = pGallery->vFmdSignature[nLast];
+		pGallery->vFmdId[nIdx] = pGallery->vFmdId[nLast];
+		pGallery->vIdIndex[pGallery->vFmdId[nIdx]] = nIdx;
+	}
+	pGallery->vIdIndex[nId] = GALLERY_NO_INDEX;
+	pGallery->nFmdCnt--;
+	return 0;
+}
+
+int Gallery_GetFmd(gallery_t* pGallery, unsigned int nId, unsigned char** ppFmd, unsigned int* pnFmdSize){
+	if(NULL == pGallery || NULL == ppFmd || NULL == pnFmdSize) return EINVAL;
+	if(nId >= pGallery->nNextId || GALLERY_NO_INDEX == pGallery->vIdIndex[nId]) return ENOENT;
+
+	unsigned int nIdx = pGallery->vIdIndex[nId];
+	*ppFmd = pGallery->vFmd[nIdx];
+	*pnFmdSize = pGallery->vFmdSize[nIdx];
+	return 0;
+}
+
+int Gallery_Identify(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	if(0 == nCandidateCnt || 0 == pGallery->nFmdCnt) return 0;
+
+	DPFJ_CANDIDATE* vCandidates = (DPFJ_CANDIDATE*)malloc(sizeof(DPFJ_CANDIDATE) * nCandidateCnt);
+	if(NULL == vCandidates) return ENOMEM;
+	unsigned int i = 0;
+	for(i = 0; i < nCandidateCnt; i++){
+		vCandidates[i].size = sizeof(DPFJ_CANDIDATE);
+	}
+
+	//the arrays are passed as they are, nothing is rebuilt or copied per call
+	int result = dpfj_identify(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx,
+		pGallery->nFmdType, pGallery->nFmdCnt, pGallery->vFmd, pGallery->vFmdSize, nThreshold, &nCandidateCnt, vCandidates);
+	if(DPFJ_SUCCESS == result){
+		for(i = 0; i < nCandidateCnt; i++){
+			pCandidates[i].nId = pGallery->vFmdId[vCandidates[i].fmd_idx];
+			pCandidates[i].nViewIdx = vCandidates[i].view_idx;
+			pCandidates[i].nScore = GALLERY_NO_SCORE;
+		}
+		*pnCandidateCnt = nCandidateCnt;
+	}
+
+	free(vCandidates);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// parallel identification
+
+typedef struct {
+	unsigned int nFmdIdx;
+	unsigned int nViewIdx;
+	unsigned int nScore;
+} scored_candidate_t;
+
+typedef struct {
+	gallery_t*          pGallery;
+	unsigned int        nProbeCnt;
+	unsigned char**     vProbeFmd;
+	unsigned int*       vProbeFmdSize;
+	unsigned int        nViewIdx;
+	unsigned int*       vProbeViewIdx;   //view of every probe, NULL if all probes use the nViewIdx
+	unsigned int        nThreshold;
+	unsigned int        nShardSize;
+	unsigned int        nCandidateCnt;   //requested number of candidates, per shard and probe
+	DPFJ_CANDIDATE*     vShardCandidates;
+	scored_candidate_t* vScored;         //candidates for every shard and probe, nCandidateCnt each
+	unsigned int*       vScoredCnt;      //number of candidates found for every shard and probe
+	int*                vResult;         //result for every shard
+} identify_job_t;
+
+//dpfj_identify() threshold is a false positive identification rate, it is scaled by the number of FMDs
+//searched; a shard gets its proportional part, so the per-comparison threshold stays the same as for the whole gallery
+static unsigned int shard_threshold(unsigned int nThreshold, unsigned int nShardFmdCnt, unsigned int nFmdCnt){
+	unsigned long long nShardThreshold = (unsigned long long)nThreshold * nShardFmdCnt / nFmdCnt;
+	return (0 == nShardThreshold) ? 1 : (unsigned int)nShardThreshold;
+}
+
+//nCnt1 * nCnt2 entries of nSize bytes, the count fits an unsigned int and the size a size_t
+static int fits_array(size_t nSize, unsigned int nCnt1, unsigned int nCnt2){
+	if(0 == nCnt1 || 0 == nCnt2) return 1;
+	return nCnt2 <= UINT_MAX / nCnt1 && (size_t)nCnt1 * nCnt2 <= SIZE_MAX / nSize;
+}
+
+static int compare_scored(const void* p1, const void* p2){
+	const scored_candidate_t* pc1 = (const scored_candidate_t*)p1;
+	const scored_candidate_t* pc2 = (const scored_candidate_t*)p2;
+	if(pc1->nScore != pc2->nScore) return (pc1->nScore < pc2->nScore) ? -1 : 1;
+	return (pc1->nFmdIdx < pc2->nFmdIdx) ? -1 : (pc1->nFmdIdx > pc2->nFmdIdx);
+}
+
+static void identify_shard(void* pContext, unsigned int nShard){
+	identify_job_t* pJob = (identify_job_t*)pContext;
+	gallery_t* pGallery = pJob->pGallery;
+
+	unsigned int nFirst = nShard * pJob->nShardSize;
+	unsigned int nCnt = pGallery->nFmdCnt - nFirst;
+	if(nCnt > pJob->nShardSize) nCnt = pJob->nShardSize;
+	unsigned int nThreshold = shard_threshold(pJob->nThreshold, nCnt, pGallery->nFmdCnt);
+	DPFJ_CANDIDATE* vCandidates = pJob->vShardCandidates + nShard * pJob->nCandidateCnt;
+
+	//all probes go through the shard one after another, while its FMDs are still in the cache
+	int result = DPFJ_SUCCESS;
+	unsigned int nProbe = 0;
+	for(nProbe = 0; DPFJ_SUCCESS == result && nProbe < pJob->nProbeCnt; nProbe++){
+		unsigned char* pFmd = pJob->vProbeFmd[nProbe];
+		unsigned int nFmdSize = pJob->vProbeFmdSize[nProbe];
+		unsigned int nViewIdx = (NULL != pJob->vProbeViewIdx) ? pJob->vProbeViewIdx[nProbe] : pJob->nViewIdx;
+		unsigned int nSlot = nShard * pJob->nProbeCnt + nProbe;
+		scored_candidate_t* vScored = pJob->vScored + nSlot * pJob->nCandidateCnt;
+		unsigned int nCandidateCnt = pJob->nCandidateCnt;
+		unsigned int i = 0;
+		for(i = 0; i < nCandidateCnt; i++){
+			vCandidates[i].size = sizeof(DPFJ_CANDIDATE);
+		}
+
+		result = dpfj_identify(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx,
+			pGallery->nFmdType, nCnt, pGallery->vFmd + nFirst, pGallery->vFmdSize + nFirst, nThreshold, &nCandidateCnt, vCandidates);
+
+		//candidates from different shards can be ranked only by their scores
+		unsigned int nScoredCnt = 0;
+		for(i = 0; DPFJ_SUCCESS == result && i < nCandidateCnt; i++){
+			unsigned int nFmdIdx = nFirst + vCandidates[i].fmd_idx;
+			unsigned int nScore = 0;
+			result = dpfj_compare(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx,
+				pGallery->nFmdType, pGallery->vFmd[nFmdIdx], pGallery->vFmdSize[nFmdIdx], vCandidates[i].view_idx, &nScore);
+			if(DPFJ_SUCCESS != result) break;
+
+			vScored[nScoredCnt].nFmdIdx = nFmdIdx;
+			vScored[nScoredCnt].nViewIdx = vCandidates[i].view_idx;
+			vScored[nScoredCnt].nScore = nScore;
+			nScoredCnt++;
+		}
+		pJob->vScoredCnt[nSlot] = nScoredCnt;
+	}
+
+	pJob->vResult[nShard] = result;
+}
+
+//searches all shards for all probes of the job, then merges candidates of every probe
+static int run_identify_job(identify_job_t* pJob, pool_t* pPool, unsigned int* vCandidateCnt, gallery_candidate_t* vCandidates){
+	gallery_t* pGallery = pJob->pGallery;
+	unsigned int nShardCnt = (pGallery->nFmdCnt + pJob->nShardSize - 1) / pJob->nShardSize;
+	unsigned int nCandidateCnt = pJob->nCandidateCnt;
+	unsigned int nSlotCnt = nShardCnt * pJob->nProbeCnt;
+	if(!fits_array(sizeof(scored_candidate_t), nCandidateCnt, nSlotCnt) || !fits_array(sizeof(DPFJ_CANDIDATE), nCandidateCnt, nShardCnt)) return ENOMEM;
+
+	pJob->vShardCandidates = (DPFJ_CANDIDATE*)malloc(sizeof(DPFJ_CANDIDATE) * nCandidateCnt * nShardCnt);
+	pJob->vScored = (scored_candidate_t*)malloc(sizeof(scored_candidate_t) * nCandidateCnt * nSlotCnt);
+	pJob->vScoredCnt = (unsigned int*)malloc(sizeof(unsigned int) * nSlotCnt);
+	pJob->vResult = (int*)malloc(sizeof(int) * nShardCnt);
+
+	int result = ENOMEM;
+	if(NULL != pJob->vShardCandidates && NULL != pJob->vScored && NULL != pJob->vScoredCnt && NULL != pJob->vResult){
+		result = Pool_Run(pPool, nShardCnt, identify_shard, pJob);
+	}
+	unsigned int i = 0;
+	for(i = 0; 0 == result && i < nShardCnt; i++){
+		result = pJob->vResult[i];
+	}
+
+	//merge: pack candidates of all shards together, rank them and keep the best ones
+	scored_candidate_t* vMerged = NULL;
+	if(0 == result){
+		vMerged = (scored_candidate_t*)malloc(sizeof(scored_candidate_t) * nCandidateCnt * nShardCnt);
+		if(NULL == vMerged) result = ENOMEM;
+	}
+	unsigned int nProbe = 0;
+	for(nProbe = 0; 0 == result && nProbe < pJob->nProbeCnt; nProbe++){
+		unsigned int nMergedCnt = 0;
+		for(i = 0; i < nShardCnt; i++){
+			unsigned int nSlot = i * pJob->nProbeCnt + nProbe;
+			memcpy(vMerged + nMergedCnt, pJob->vScored + nSlot * nCandidateCnt, sizeof(scored_candidate_t) * pJob->vScoredCnt[nSlot]);
+			nMergedCnt += pJob->vScoredCnt[nSlot];
+		}
+		qsort(vMerged, nMergedCnt, sizeof(scored_candidate_t), compare_scored);
+		if(nMergedCnt > nCandidateCnt) nMergedCnt = nCandidateCnt;
+
+		gallery_candidate_t* pCandidates = vCandidates + nProbe * nCandidateCnt;
+		for(i = 0; i < nMergedCnt; i++){
+			pCandidates[i].nId = pGallery->vFmdId[vMerged[i].nFmdIdx];
+			pCandidates[i].nViewIdx = vMerged[i].nViewIdx;
+			pCandidates[i].nScore = vMerged[i].nScore;
+		}
+		vCandidateCnt[nProbe] = nMergedCnt;
+	}
+
+	if(NULL != vMerged) free(vMerged);
+	if(NULL != pJob->vShardCandidates) free(pJob->vShardCandidates);
+	if(NULL != pJob->vScored) free(pJob->vScored);
+	if(NULL != pJob->vScoredCnt) free(pJob->vScoredCnt);
+	if(NULL != pJob->vResult) free(pJob->vResult);
+	return result;
+}
+
+int Gallery_IdentifyParallel(gallery_t* pGallery, pool_t* pPool, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	if(0 == nCandidateCnt || 0 == pGallery->nFmdCnt) return 0;
+
+	//small galleries are not worth splitting, they are searched as one shard on the calling thread, so the
+	//candidates are scored the same way
+	unsigned int nShardCnt = Pool_GetThreadCnt(pPool) * GALLERY_SHARDS_PER_THREAD;
+	unsigned int nShardSize = (pGallery->nFmdCnt + nShardCnt - 1) / nShardCnt;
+	if(GALLERY_MIN_SHARD_SIZE > nShardSize) nShardSize = GALLERY_MIN_SHARD_SIZE;
+	if(NULL == pPool || pGallery->nFmdCnt <= nShardSize){
+		nShardSize = pGallery->nFmdCnt;
+		pPool = NULL;
+	}
+
+	identify_job_t job = {0};
+	job.pGallery = pGallery;
+	job.nProbeCnt = 1;
+	job.vProbeFmd = &pFmd;
+	job.vProbeFmdSize = &nFmdSize;
+	job.nViewIdx = nViewIdx;
+	job.nThreshold = nThreshold;
+	job.nShardSize = nShardSize;
+	job.nCandidateCnt = nCandidateCnt;
+	return run_identify_job(&job, pPool, pnCandidateCnt, pCandidates);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// batch identification
+
+int Gallery_IdentifyBatch(gallery_t* pGallery, pool_t* pPool, unsigned int nProbeCnt, unsigned char** vFmd, unsigned int* vFmdSize,
+	unsigned int nViewIdx, unsigned int nThreshold, unsigned int nCandidateCnt, unsigned int* vCandidateCnt, gallery_candidate_t* vCandidates){
+	if(NULL == pGallery || (0 != nProbeCnt && (NULL == vFmd || NULL == vFmdSize || NULL == vCandidateCnt || NULL == vCandidates))) return EINVAL;
+
+	unsigned int i = 0;
+	for(i = 0; i < nProbeCnt; i++){
+		vCandidateCnt[i] = 0;
+	}
+	if(0 == nCandidateCnt || 0 == pGallery->nFmdCnt) return 0;
+
+	//shards are kept small enough to stay in the cache while a block of probes goes through them,
+	//but there are still enough of them to keep all threads busy
+	unsigned int nShardCnt = Pool_GetThreadCnt(pPool) * GALLERY_SHARDS_PER_THREAD;
+	unsigned int nShardSize = (pGallery->nFmdCnt + nShardCnt - 1) / nShardCnt;
+	if(GALLERY_BATCH_SHARD_SIZE < nShardSize) nShardSize = GALLERY_BATCH_SHARD_SIZE;
+	if(GALLERY_MIN_SHARD_SIZE > nShardSize) nShardSize = GALLERY_MIN_SHARD_SIZE;
+
+	int result = 0;
+	unsigned int nFirst = 0;
+	for(nFirst = 0; 0 == result && nFirst < nProbeCnt; nFirst += GALLERY_BATCH_PROBE_BLOCK){
+		identify_job_t job = {0};
+		job.pGallery = pGallery;
+		job.nProbeCnt = nProbeCnt - nFirst;
+		if(GALLERY_BATCH_PROBE_BLOCK < job.nProbeCnt) job.nProbeCnt = GALLERY_BATCH_PROBE_BLOCK;
+		job.vProbeFmd = vFmd + nFirst;
+		job.vProbeFmdSize = vFmdSize + nFirst;
+		job.nViewIdx = nViewIdx;
+		job.nThreshold = nThreshold;
+		job.nShardSize = nShardSize;
+		job.nCandidateCnt = nCandidateCnt;
+		result = run_identify_job(&job, pPool, vCandidateCnt + nFirst, vCandidates + nFirst * nCandidateCnt);
+	}
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fused identification
+
+typedef struct {
+	unsigned int nFmdIdx;
+	unsigned int nProbe;
+	unsigned int nViewIdx;
+	unsigned int nScore;
+} view_score_t;
+
+static int compare_view_scores(const void* p1, const void* p2){
+	const view_score_t* ps1 = (const view_score_t*)p1;
+	const view_score_t* ps2 = (const view_score_t*)p2;
+	if(ps1->nFmdIdx != ps2->nFmdIdx) return (ps1->nFmdIdx < ps2->nFmdIdx) ? -1 : 1;
+	return (ps1->nProbe < ps2->nProbe) ? -1 : (ps1->nProbe > ps2->nProbe);
+}
+
+//the threshold of every probe view is loosened by this factor: dpfj_identify() does not score a mate as dpfj_compare()
+//does, and an FMD which no view returns is not fused at all; the candidates it adds are only compared and then cut by
+//the fused bound
+#define GALLERY_FUSION_VIEW_MARGIN 4
+
+//threshold every probe view is searched with: any FMD whose fused score can pass the caller's threshold has
+//to be a candidate of at least one view; for the product, one of the views is then under the P-th root of it
+static unsigned int fusion_view_threshold(unsigned int nFusion, unsigned int nThreshold, unsigned int nFmdCnt, unsigned int nProbeCnt){
+	double dThreshold = nThreshold;
+	if(GALLERY_FUSION_PRODUCT == nFusion && 1 < nProbeCnt){
+		double dScale = (double)nFmdCnt * DPFJ_PROBABILITY_ONE;
+		dThreshold = dScale * pow(dThreshold / dScale, 1.0 / nProbeCnt);
+	}
+	dThreshold *= GALLERY_FUSION_VIEW_MARGIN;
+	return (DPFJ_PROBABILITY_ONE < dThreshold) ? DPFJ_PROBABILITY_ONE : (unsigned int)dThreshold;
+}
+
+static unsigned int fuse_scores(unsigned int nFusion, const unsigned int* vScores, unsigned int nProbeCnt){
+	unsigned int nFused = vScores[0];
+	double dFused = (double)vScores[0] / DPFJ_PROBABILITY_ONE;
+	unsigned int i = 0;
+	for(i = 1; i < nProbeCnt; i++){
+		if(GALLERY_FUSION_MIN == nFusion && vScores[i] < nFused) nFused = vScores[i];
+		if(GALLERY_FUSION_MAX == nFusion && vScores[i] > nFused) nFused = vScores[i];
+		dFused *= (double)vScores[i] / DPFJ_PROBABILITY_ONE;
+	}
+	return (GALLERY_FUSION_PRODUCT == nFusion) ? (unsigned int)(dFused * DPFJ_PROBABILITY_ONE) : nFused;
+}
+
+//score of the probe view against the best matching view of the FMD in the gallery; views with fewer than
+//GALLERY_MIN_MINUTIAE minutiae are not compared, an FMD with no other view does not match
+static int score_fmd(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx, unsigned int nFmdIdx,
+	unsigned int* pnScore, unsigned int* pnFmdViewIdx){
+	*pnScore = GALLERY_NO_SCORE;
+	fmd_record_t record;
+	int result = FmdRecord_Parse(&record, pGallery->nFmdType, pGallery->vFmd[nFmdIdx], pGallery->vFmdSize[nFmdIdx]);
+	if(0 != result) return result;
+	unsigned int nFmdView = 0;
+	for(nFmdView = 0; nFmdView < record.nViewCnt; nFmdView++){
+		fmd_view_t view;
+		if(0 != FmdRecord_GetView(&record, nFmdView, &view) || GALLERY_MIN_MINUTIAE > view.nMinutiaCnt) continue;
+		unsigned int nScore = 0;
+		result = dpfj_compare(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx,
+			pGallery->nFmdType, pGallery->vFmd[nFmdIdx], pGallery->vFmdSize[nFmdIdx], nFmdView, &nScore);
+		if(DPFJ_SUCCESS != result) return result;
+		if(GALLERY_NO_SCORE != *pnScore && nScore >= *pnScore) continue;
+		*pnScore = nScore;
+		*pnFmdViewIdx = nFmdView;
+	}
+	if(GALLERY_NO_SCORE == *pnScore){
+		*pnScore = DPFJ_PROBABILITY_ONE;
+		*pnFmdViewIdx = 0;
+	}
+	return DPFJ_SUCCESS;
+}
+
+int Gallery_IdentifyFused(gallery_t* pGallery, pool_t* pPool, unsigned int nProbeCnt, unsigned char** vFmd, unsigned int* vFmdSize,
+	unsigned int* vViewIdx, unsigned int nFusion, unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == vFmd || NULL == vFmdSize || NULL == vViewIdx || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+	if(0 == nProbeCnt || GALLERY_FUSION_PRODUCT < nFusion) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	if(0 == nCandidateCnt || 0 == pGallery->nFmdCnt) return 0;
+
+	//an FMD ranked low for one view can still come out on top after the fusion, every view gets more candidates;
+	//the largest arrays have nCandidateCnt * nProbeCnt * nProbeCnt entries
+	if(!fits_array(sizeof(view_score_t), nCandidateCnt, nProbeCnt) || !fits_array(sizeof(view_score_t), nCandidateCnt * nProbeCnt, nProbeCnt)) return ENOMEM;
+	unsigned int nFetchCnt = nCandidateCnt * nProbeCnt;
+	unsigned int nViewScoreCnt = nFetchCnt * nProbeCnt;
+	unsigned int* vFetchedCnt = (unsigned int*)malloc(sizeof(unsigned int) * nProbeCnt);
+	gallery_candidate_t* vFetched = (gallery_candidate_t*)malloc(sizeof(gallery_candidate_t) * nViewScoreCnt);
+	view_score_t* vViewScores = (view_score_t*)malloc(sizeof(view_score_t) * nViewScoreCnt);
+	scored_candidate_t* vFused = (scored_candidate_t*)malloc(sizeof(scored_candidate_t) * nViewScoreCnt);
+	unsigned int* vScores = (unsigned int*)malloc(sizeof(unsigned int) * nProbeCnt);
+	int result = (NULL == vFetchedCnt || NULL == vFetched || NULL == vViewScores || NULL == vFused || NULL == vScores) ? ENOMEM : 0;
+
+	//all probe views go through a shard one after another, while its FMDs are still in the cache
+	if(0 == result){
+		unsigned int nShardCnt = Pool_GetThreadCnt(pPool) * GALLERY_SHARDS_PER_THREAD;
+		unsigned int nShardSize = (pGallery->nFmdCnt + nShardCnt - 1) / nShardCnt;
+		if(GALLERY_BATCH_SHARD_SIZE < nShardSize) nShardSize = GALLERY_BATCH_SHARD_SIZE;
+		if(GALLERY_MIN_SHARD_SIZE > nShardSize) nShardSize = GALLERY_MIN_SHARD_SIZE;
+
+		identify_job_t job = {0};
+		job.pGallery = pGallery;
+		job.nProbeCnt = nProbeCnt;
+		job.vProbeFmd = vFmd;
+		job.vProbeFmdSize = vFmdSize;
+		job.vProbeViewIdx = vViewIdx;
+		job.nThreshold = fusion_view_threshold(nFusion, nThreshold, pGallery->nFmdCnt, nProbeCnt);
+		job.nShardSize = nShardSize;
+		job.nCandidateCnt = nFetchCnt;
+		result = run_identify_job(&job, pPool, vFetchedCnt, vFetched);
+	}
+
+	//scores are grouped by the FMD, every FMD gets a score for every view, the missing ones are compared
+	unsigned int nCnt = 0;
+	unsigned int nProbe = 0;
+	unsigned int i = 0;
+	for(nProbe = 0; 0 == result && nProbe < nProbeCnt; nProbe++){
+		for(i = 0; i < vFetchedCnt[nProbe]; i++){
+			const gallery_candidate_t* pFetched = &vFetched[nProbe * nFetchCnt + i];
+			vViewScores[nCnt].nFmdIdx = pGallery->vIdIndex[pFetched->nId];
+			vViewScores[nCnt].nProbe = nProbe;
+			vViewScores[nCnt].nViewIdx = pFetched->nViewIdx;
+			vViewScores[nCnt].nScore = pFetched->nScore;
+			nCnt++;
+		}
+	}
+	if(0 == result) qsort(vViewScores, nCnt, sizeof(view_score_t), compare_view_scores);
+
+	//fused score has to pass the caller's threshold scaled to a single comparison, as for the shards
+	double dBound = (double)nThreshold / pGallery->nFmdCnt;
+	unsigned int nFusedCnt = 0;
+	unsigned int nFirst = 0;
+	while(0 == result && nFirst < nCnt){
+		unsigned int nFmdIdx = vViewScores[nFirst].nFmdIdx;
+		unsigned int nFmdViewIdx = vViewScores[nFirst].nViewIdx;
+		for(nProbe = 0; nProbe < nProbeCnt; nProbe++){
+			vScores[nProbe] = GALLERY_NO_SCORE;
+		}
+		for(; nFirst < nCnt && vViewScores[nFirst].nFmdIdx == nFmdIdx; nFirst++){
+			vScores[vViewScores[nFirst].nProbe] = vViewScores[nFirst].nScore;
+		}
+		for(nProbe = 0; 0 == result && nProbe < nProbeCnt; nProbe++){
+			unsigned int nViewIdx = 0;
+			if(GALLERY_NO_SCORE != vScores[nProbe]) continue;
+			result = score_fmd(pGallery, vFmd[nProbe], vFmdSize[nProbe], vViewIdx[nProbe], nFmdIdx, &vScores[nProbe], &nViewIdx);
+		}
+		if(0 != result) break;
+
+		unsigned int nFused = fuse_scores(nFusion, vScores, nProbeCnt);
+		if((double)nFused >= dBound) continue;
+		vFused[nFusedCnt].nFmdIdx = nFmdIdx;
+		vFused[nFusedCnt].nViewIdx = nFmdViewIdx;
+		vFused[nFusedCnt].nScore = nFused;
+		nFusedCnt++;
+	}
+
+	if(0 == result){
+		qsort(vFused, nFusedCnt, sizeof(scored_candidate_t), compare_scored);
+		if(nFusedCnt > nCandidateCnt) nFusedCnt = nCandidateCnt;
+		for(i = 0; i < nFusedCnt; i++){
+			pCandidates[i].nId = pGallery->vFmdId[vFused[i].nFmdIdx];
+			pCandidates[i].nViewIdx = vFused[i].nViewIdx;
+			pCandidates[i].nScore = vFused[i].nScore;
+		}
+		*pnCandidateCnt = nFusedCnt;
+	}
+
+	if(NULL != vFetchedCnt) free(vFetchedCnt);
+	if(NULL != vFetched) free(vFetched);
+	if(NULL != vViewScores) free(vViewScores);
+	if(NULL != vFused) free(vFused);
+	if(NULL != vScores) free(vScores);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// pre-filter
+
+typedef struct {
+	unsigned int nDistance;
+	unsigned int nIdx;
+} prefilter_slot_t;
+
+#define PREFILTER_EXCLUDED 0xffffffff
+
+//L1 distance of the histograms plus the difference in the number of minutiae; known finger positions must agree
+static unsigned int signature_distance(const gallery_signature_t* p1, const gallery_signature_t* p2){
+	if(0 != p1->nFingerPos && 0 != p2->nFingerPos && p1->nFingerPos != p2->nFingerPos) return PREFILTER_EXCLUDED;
+	unsigned int nDistance = abs((int)p1->nMinutiaCnt - (int)p2->nMinutiaCnt);
+	unsigned int i = 0;
+	for(i = 0; i < GALLERY_SIGNATURE_BINS; i++) nDistance += abs((int)p1->vHistogram[i] - (int)p2->vHistogram[i]);
+	return nDistance;
+}
+
+static int compare_slots_by_distance(const void* p1, const void* p2){
+	const prefilter_slot_t* ps1 = (const prefilter_slot_t*)p1;
+	const prefilter_slot_t* ps2 = (const prefilter_slot_t*)p2;
+	if(ps1->nDistance != ps2->nDistance) return (ps1->nDistance < ps2->nDistance) ? -1 : 1;
+	return (ps1->nIdx < ps2->nIdx) ? -1 : (ps1->nIdx > ps2->nIdx);
+}
+
+static void swap_slots(prefilter_slot_t* p1, prefilter_slot_t* p2){
+	prefilter_slot_t tmp = *p1;
+	*p1 = *p2;
+	*p2 = tmp;
+}
+
+//moves the nK slots closest by distance to the front, in no particular order: quickselect, the range holding the
+//nK-th slot is partitioned until its boundary falls on it; no two slots are equal, the index breaks the ties
+static void select_closest_slots(prefilter_slot_t* vSlots, unsigned int nCnt, unsigned int nK){
+	unsigned int nFirst = 0;
+	unsigned int nEnd = nCnt;
+	while(nFirst < nK && nK < nEnd){
+		//median of three is the pivot, kept at the end of the range
+		unsigned int nLast = nEnd - 1;
+		unsigned int nMid = nFirst + (nEnd - nFirst) / 2;
+		if(0 < compare_slots_by_distance(&vSlots[nFirst], &vSlots[nMid])) swap_slots(&vSlots[nFirst], &vSlots[nMid]);
+		if(0 < compare_slots_by_distance(&vSlots[nMid], &vSlots[nLast])) swap_slots(&vSlots[nMid], &vSlots[nLast]);
+		if(0 < compare_slots_by_distance(&vSlots[nFirst], &vSlots[nMid])) swap_slots(&vSlots[nFirst], &vSlots[nMid]);
+		swap_slots(&vSlots[nMid], &vSlots[nLast]);
+
+		unsigned int nPivot = nFirst;
+		unsigned int i = 0;
+		for(i = nFirst; i < nLast; i++){
+			if(0 > compare_slots_by_distance(&vSlots[i], &vSlots[nLast])) swap_slots(&vSlots[i], &vSlots[nPivot++]);
+		}
+		swap_slots(&vSlots[nPivot], &vSlots[nLast]);
+		if(nPivot < nK) nFirst = nPivot + 1;
+		else nEnd = nPivot;
+	}
+}
+
+int Gallery_EnablePrefilter(gallery_t* pGallery){
+	if(NULL == pGallery) return EINVAL;
+
+	//FMDs were validated when added, those with a histogram from the file are left as they are
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		if(pGallery->vFmdSignature[i].bHistogram) continue;
+		fmd_record_t record;
+		int result = FmdRecord_Parse(&record, pGallery->nFmdType, pGallery->vFmd[i], pGallery->vFmdSize[i]);
+		if(0 != result) return result;
+		compute_histogram(&record, 0, &pGallery->vFmdSignature[i]);
+	}
+	pGallery->bPrefilter = 1;
+	return 0;
+}
+
+int Gallery_IdentifyPrefiltered(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int nPenetration, unsigned int* pnSearchedCnt, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == pnSearchedCnt || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+	if(0 == nPenetration || 100 < nPenetration || !pGallery->bPrefilter) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	*pnSearchedCnt = 0;
+	if(0 == nCandidateCnt || 0 == pGallery->nFmdCnt) return 0;
+
+	fmd_record_t record;
+	int result = FmdRecord_Parse(&record, pGallery->nFmdType, pFmd, nFmdSize);
+	if(0 != result) return result;
+	if(nViewIdx >= record.nViewCnt) return DPFJ_E_INVALID_PARAMETER;
+	gallery_signature_t signature;
+	compute_signature(&record, nViewIdx, &signature);
+	compute_histogram(&record, nViewIdx, &signature);
+
+	//FMDs closest by signature are kept, up to the penetration rate of the gallery
+	unsigned int nFmdCnt = pGallery->nFmdCnt;
+	prefilter_slot_t* vSlots = (prefilter_slot_t*)malloc(sizeof(prefilter_slot_t) * nFmdCnt);
+	unsigned char** vFmd = (unsigned char**)malloc(sizeof(unsigned char*) * nFmdCnt);
+	unsigned int* vFmdSize = (unsigned int*)malloc(sizeof(unsigned int) * nFmdCnt);
+	DPFJ_CANDIDATE* vCandidates = (DPFJ_CANDIDATE*)malloc(sizeof(DPFJ_CANDIDATE) * nCandidateCnt);
+	if(NULL == vSlots || NULL == vFmd || NULL == vFmdSize || NULL == vCandidates) result = ENOMEM;
+	if(0 == result){
+		unsigned int i = 0;
+		for(i = 0; i < nFmdCnt; i++){
+			vSlots[i].nDistance = signature_distance(&signature, &pGallery->vFmdSignature[i]);
+			vSlots[i].nIdx = i;
+		}
+
+		//only the FMDs kept are sorted, the closest are searched first
+		unsigned int nSearchCnt = (unsigned int)(((unsigned long long)nFmdCnt * nPenetration + 99) / 100);
+		select_closest_slots(vSlots, nFmdCnt, nSearchCnt);
+		qsort(vSlots, nSearchCnt, sizeof(prefilter_slot_t), compare_slots_by_distance);
+		while(0 < nSearchCnt && PREFILTER_EXCLUDED == vSlots[nSearchCnt - 1].nDistance) nSearchCnt--;
+		for(i = 0; i < nSearchCnt; i++){
+			vFmd[i] = pGallery->vFmd[vSlots[i].nIdx];
+			vFmdSize[i] = pGallery->vFmdSize[vSlots[i].nIdx];
+		}
+		for(i = 0; i < nCandidateCnt; i++) vCandidates[i].size = sizeof(DPFJ_CANDIDATE);
+
+		//the threshold keeps the per-comparison rate of the whole gallery, as for the shards
+		if(0 != nSearchCnt){
+			result = dpfj_identify(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx, pGallery->nFmdType, nSearchCnt, vFmd, vFmdSize,
+				shard_threshold(nThreshold, nSearchCnt, nFmdCnt), &nCandidateCnt, vCandidates);
+		}
+		else nCandidateCnt = 0;
+		if(DPFJ_SUCCESS == result){
+			for(i = 0; i < nCandidateCnt; i++){
+				pCandidates[i].nId = pGallery->vFmdId[vSlots[vCandidates[i].fmd_idx].nIdx];
+				pCandidates[i].nViewIdx = vCandidates[i].view_idx;
+				pCandidates[i].nScore = GALLERY_NO_SCORE;
+			}
+			*pnCandidateCnt = nCandidateCnt;
+			*pnSearchedCnt = nSearchCnt;
+		}
+	}
+
+	if(NULL != vSlots) free(vSlots);
+	if(NULL != vFmd) free(vFmd);
+	if(NULL != vFmdSize) free(vFmdSize);
+	if(NULL != vCandidates) free(vCandidates);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// finger partitions
+
+//max-heap on the score, the worst kept candidate is on top
+static void heap_sift_down(scored_candidate_t* vHeap, unsigned int nCnt, unsigned int nIdx){
+	for(;;){
+		unsigned int nWorst = nIdx;
+		unsigned int nLeft = 2 * nIdx + 1;
+		unsigned int nRight = nLeft + 1;
+		if(nLeft < nCnt && 0 < compare_scored(&vHeap[nLeft], &vHeap[nWorst])) nWorst = nLeft;
+		if(nRight < nCnt && 0 < compare_scored(&vHeap[nRight], &vHeap[nWorst])) nWorst = nRight;
+		if(nWorst == nIdx) break;
+		scored_candidate_t tmp = vHeap[nIdx];
+		vHeap[nIdx] = vHeap[nWorst];
+		vHeap[nWorst] = tmp;
+		nIdx = nWorst;
+	}
+}
+
+static void heap_push(scored_candidate_t* vHeap, unsigned int* pnCnt, unsigned int nCapacity, const scored_candidate_t* pCandidate){
+	if(*pnCnt == nCapacity){
+		if(0 <= compare_scored(pCandidate, &vHeap[0])) return;
+		vHeap[0] = *pCandidate;
+		heap_sift_down(vHeap, *pnCnt, 0);
+		return;
+	}
+	unsigned int nIdx = (*pnCnt)++;
+	vHeap[nIdx] = *pCandidate;
+	while(0 < nIdx){
+		unsigned int nParent = (nIdx - 1) / 2;
+		if(0 <= compare_scored(&vHeap[nParent], &vHeap[nIdx])) break;
+		scored_candidate_t tmp = vHeap[nIdx];
+		vHeap[nIdx] = vHeap[nParent];
+		vHeap[nParent] = tmp;
+		nIdx = nParent;
+	}
+}
+
+int Gallery_IdentifyFingers(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nFingerCnt, const DPFJ_FINGER_POSITION* vFingerPos, unsigned int nImpressionMask,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || (0 != nFingerCnt && NULL == vFingerPos) || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	if(0 == nImpressionMask) nImpressionMask = (1u << GALLERY_IMPRESSION_TYPES) - 1;
+
+	//the threshold is shared by all FMDs searched; a finger listed twice is searched once
+	unsigned int nFingerMask = 0;
+	unsigned int nSearchCnt = 0;
+	unsigned int i = 0;
+	unsigned int j = 0;
+	for(i = 0; i < nFingerCnt; i++){
+		//the enum may be unsigned, the cast keeps the negative values out
+		if(0 > (int)vFingerPos[i] || GALLERY_FINGER_POSITIONS <= (int)vFingerPos[i]) return DPFJ_E_INVALID_PARAMETER;
+		if(0 != (nFingerMask & (1u << vFingerPos[i]))) continue;
+		nFingerMask |= 1u << vFingerPos[i];
+		for(j = 0; j < GALLERY_IMPRESSION_TYPES; j++){
+			if(0 != (nImpressionMask & (1u << j))) nSearchCnt += pGallery->vPartition[vFingerPos[i] * GALLERY_IMPRESSION_TYPES + j].nFmdCnt;
+		}
+	}
+	if(0 == nCandidateCnt || 0 == nSearchCnt) return 0;
+
+	DPFJ_CANDIDATE* vCandidates = (DPFJ_CANDIDATE*)malloc(sizeof(DPFJ_CANDIDATE) * nCandidateCnt);
+	scored_candidate_t* vHeap = (scored_candidate_t*)malloc(sizeof(scored_candidate_t) * nCandidateCnt);
+	int result = (NULL == vCandidates || NULL == vHeap) ? ENOMEM : DPFJ_SUCCESS;
+
+	//every partition is searched, its hits are ranked with the others' by their scores, as the shards are merged
+	unsigned int nHeapCnt = 0;
+	unsigned int nFinger = 0;
+	for(nFinger = 0; DPFJ_SUCCESS == result && nFinger < GALLERY_FINGER_POSITIONS; nFinger++){
+		if(0 == (nFingerMask & (1u << nFinger))) continue;
+		for(j = 0; DPFJ_SUCCESS == result && j < GALLERY_IMPRESSION_TYPES; j++){
+			const gallery_partition_t* pPartition = &pGallery->vPartition[nFinger * GALLERY_IMPRESSION_TYPES + j];
+			if(0 == (nImpressionMask & (1u << j)) || 0 == pPartition->nFmdCnt) continue;
+
+			unsigned int nPartitionCandidateCnt = nCandidateCnt;
+			unsigned int k = 0;
+			for(k = 0; k < nPartitionCandidateCnt; k++) vCandidates[k].size = sizeof(DPFJ_CANDIDATE);
+			result = dpfj_identify(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx, pGallery->nFmdType, pPartition->nFmdCnt,
+				pPartition->vFmd, pPartition->vFmdSize, shard_threshold(nThreshold, pPartition->nFmdCnt, nSearchCnt),
+				&nPartitionCandidateCnt, vCandidates);
+			for(k = 0; DPFJ_SUCCESS == result && k < nPartitionCandidateCnt; k++){
+				scored_candidate_t scored;
+				scored.nFmdIdx = pPartition->vFmdIdx[vCandidates[k].fmd_idx];
+				scored.nViewIdx = vCandidates[k].view_idx;
+				result = dpfj_compare(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx,
+					pGallery->nFmdType, pGallery->vFmd[scored.nFmdIdx], pGallery->vFmdSize[scored.nFmdIdx], scored.nViewIdx, &scored.nScore);
+				if(DPFJ_SUCCESS == result) heap_push(vHeap, &nHeapCnt, nCandidateCnt, &scored);
+			}
+		}
+	}
+
+	if(DPFJ_SUCCESS == result){
+		qsort(vHeap, nHeapCnt, sizeof(scored_candidate_t), compare_scored);
+		for(i = 0; i < nHeapCnt; i++){
+			pCandidates[i].nId = pGallery->vFmdId[vHeap[i].nFmdIdx];
+			pCandidates[i].nViewIdx = vHeap[i].nViewIdx;
+			pCandidates[i].nScore = vHeap[i].nScore;
+		}
+		*pnCandidateCnt = nHeapCnt;
+	}
+
+	if(NULL != vCandidates) free(vCandidates);
+	if(NULL != vHeap) free(vHeap);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// file
+
+//gallery file: header, table with one entry per FMD, then the arena starting on a page boundary;
+//numbers are in the byte order of the machine which wrote the file, the marker tells it apart
+#define GALLERY_FILE_MAGIC   "DPGALLRY"
+#define GALLERY_FILE_VERSION 3
+#define GALLERY_FILE_ENDIAN  0x01020304
+#define GALLERY_FILE_PAGE    4096
+
+//removed ids leave holes, so the next id can be far above the number of FMDs, but its index is allocated when the file
+//is opened: a file whose ids would take more than this many index entries per byte of the file is refused as damaged
+#define GALLERY_FILE_IDS_PER_BYTE 16
+
+typedef struct {
+	char         szMagic[8];
+	unsigned int nVersion;
+	unsigned int nEndian;
+	unsigned int nFmdType;
+	unsigned int nFmdCnt;
+	unsigned int nNextId;
+	unsigned int nTableOffset;
+	unsigned int nArenaOffset;
+	unsigned int nArenaSize;
+	unsigned int nTableChecksum;
+	unsigned int nArenaChecksum;
+	unsigned int nHeaderChecksum;  //of all fields above
+} gallery_file_header_t;
+
+typedef struct {
+	unsigned int nOffset;   //in the arena
+	unsigned int nSize;
+	unsigned int nViewCnt;  //FMDs are parsed when saved, not when loaded
+	unsigned int nId;
+	gallery_signature_t signature;
+} gallery_file_entry_t;
+
+static int ids_fit(unsigned int nNextId, unsigned int nFmdCnt, unsigned long long nFileSize){
+	return nFmdCnt <= nNextId && GALLERY_NO_INDEX != nNextId && nNextId <= nFileSize * GALLERY_FILE_IDS_PER_BYTE;
+}
+
+static int write_all(int fd, const void* pData, size_t nSize){
+	const unsigned char* p = (const unsigned char*)pData;
+	while(0 != nSize){
+		ssize_t n = write(fd, p, nSize);
+		if(0 > n){
+			if(EINTR == errno) continue;
+			return errno;
+		}
+		p += n;
+		nSize -= n;
+	}
+	return 0;
+}
+
+int Gallery_Save(gallery_t* pGallery, const char* szPath){
+	if(NULL == pGallery || NULL == szPath) return EINVAL;
+
+	//written to a temporary file which replaces the old one only when complete; a truncated name could be another file
+	char szTemp[PATH_MAX];
+	if(sizeof(szTemp) <= (size_t)snprintf(szTemp, sizeof(szTemp), "%s.tmp", szPath)) return ENAMETOOLONG;
+
+	//FMDs are written packed in the order of the arrays, removed FMDs are left out
+	gallery_file_entry_t* vEntries = (gallery_file_entry_t*)malloc(sizeof(gallery_file_entry_t) * (pGallery->nFmdCnt + 1));
+	if(NULL == vEntries) return ENOMEM;
+	unsigned int nArenaSize = 0;
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		memset(&vEntries[i], 0, sizeof(gallery_file_entry_t)); //padding goes into the checksum
+		vEntries[i].nOffset = nArenaSize;
+		vEntries[i].nSize = pGallery->vFmdSize[i];
+		vEntries[i].nViewCnt = pGallery->vFmdViewCnt[i];
+		vEntries[i].signature = pGallery->vFmdSignature[i];
+		vEntries[i].nId = pGallery->vFmdId[i];
+		nArenaSize += align_size(pGallery->vFmdSize[i]);
+	}
+
+	gallery_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.szMagic, GALLERY_FILE_MAGIC, sizeof(header.szMagic));
+	header.nVersion = GALLERY_FILE_VERSION;
+	header.nEndian = GALLERY_FILE_ENDIAN;
+	header.nFmdType = pGallery->nFmdType;
+	header.nFmdCnt = pGallery->nFmdCnt;
+	header.nNextId = pGallery->nNextId;
+	header.nTableOffset = sizeof(header);
+	unsigned int nTableSize = sizeof(gallery_file_entry_t) * pGallery->nFmdCnt;
+	header.nArenaOffset = (header.nTableOffset + nTableSize + GALLERY_FILE_PAGE - 1) & ~(GALLERY_FILE_PAGE - 1);
+	header.nArenaSize = nArenaSize;
+	if(!ids_fit(header.nNextId, header.nFmdCnt, (unsigned long long)header.nArenaOffset + nArenaSize)){
+		free(vEntries);
+		return EOVERFLOW;
+	}
+	header.nTableChecksum = Checksum_Fnv1a(vEntries, nTableSize, CHECKSUM_INIT);
+	static const unsigned char vZeros[GALLERY_FMD_ALIGN] = {0};
+	header.nArenaChecksum = CHECKSUM_INIT;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		header.nArenaChecksum = Checksum_Fnv1a(pGallery->vFmd[i], pGallery->vFmdSize[i], header.nArenaChecksum);
+		header.nArenaChecksum = Checksum_Fnv1a(vZeros, align_size(pGallery->vFmdSize[i]) - pGallery->vFmdSize[i], header.nArenaChecksum);
+	}
+	header.nHeaderChecksum = Checksum_Fnv1a(&header, offsetof(gallery_file_header_t, nHeaderChecksum), CHECKSUM_INIT);
+
+	int fd = open(szTemp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(0 > fd){
+		free(vEntries);
+		return errno;
+	}
+
+	int result = write_all(fd, &header, sizeof(header));
+	if(0 == result) result = write_all(fd, vEntries, nTableSize);
+	if(0 == result && 0 > lseek(fd, header.nArenaOffset, SEEK_SET)) result = errno;
+	for(i = 0; 0 == result && i < pGallery->nFmdCnt; i++){
+		result = write_all(fd, pGallery->vFmd[i], pGallery->vFmdSize[i]);
+		if(0 == result) result = write_all(fd, vZeros, align_size(pGallery->vFmdSize[i]) - pGallery->vFmdSize[i]);
+	}
+	//an empty arena is not written, the file still has to reach the arena offset
+	if(0 == result && 0 != ftruncate(fd, (off_t)header.nArenaOffset + nArenaSize)) result = errno;
+	if(0 == result && 0 != fsync(fd)) result = errno;
+	if(0 != close(fd) && 0 == result) result = errno;
+	if(0 == result && 0 != rename(szTemp, szPath)) result = errno;
+	if(0 != result) unlink(szTemp);
+
+	free(vEntries);
+	return result;
+}
+
+int Gallery_Open(const char* szPath, int bVerify, gallery_t** ppGallery){
+	if(NULL == szPath || NULL == ppGallery) return EINVAL;
+	*ppGallery = NULL;
+
+	int fd = open(szPath, O_RDONLY);
+	if(0 > fd) return errno;
+	struct stat st;
+	if(0 != fstat(fd, &st)){
+		int result = errno;
+		close(fd);
+		return result;
+	}
+	if(sizeof(gallery_file_header_t) > (size_t)st.st_size || 0xffffffffu < (unsigned long long)st.st_size){
+		close(fd);
+		return DPFJ_E_INVALID_FMD;
+	}
+
+	//the arena is never read here, its pages are faulted in by the first identifications
+	size_t nMappingSize = (size_t)st.st_size;
+	unsigned char* pMapping = (unsigned char*)mmap(NULL, nMappingSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(MAP_FAILED == pMapping) return errno;
+
+	gallery_file_header_t header;
+	memcpy(&header, pMapping, sizeof(header));
+	unsigned int nTableSize = sizeof(gallery_file_entry_t) * header.nFmdCnt;
+	int result = 0;
+	if(0 != memcmp(header.szMagic, GALLERY_FILE_MAGIC, sizeof(header.szMagic)) || GALLERY_FILE_VERSION != header.nVersion
+		|| GALLERY_FILE_ENDIAN != header.nEndian
+		|| header.nHeaderChecksum != Checksum_Fnv1a(&header, offsetof(gallery_file_header_t, nHeaderChecksum), CHECKSUM_INIT)){
+		result = DPFJ_E_INVALID_FMD;
+	}
+	else if(header.nFmdCnt > nMappingSize / sizeof(gallery_file_entry_t)
+		|| header.nTableOffset > nMappingSize || nTableSize > nMappingSize - header.nTableOffset
+		|| 0 != header.nArenaOffset % GALLERY_FILE_PAGE
+		|| header.nArenaOffset > nMappingSize || header.nArenaSize > nMappingSize - header.nArenaOffset
+		|| !ids_fit(header.nNextId, header.nFmdCnt, nMappingSize)){
+		result = DPFJ_E_INVALID_FMD;
+	}
+	else if(header.nTableChecksum != Checksum_Fnv1a(pMapping + header.nTableOffset, nTableSize, CHECKSUM_INIT)){
+		result = DPFJ_E_INVALID_FMD;
+	}
+	else if(bVerify && header.nArenaChecksum != Checksum_Fnv1a(pMapping + header.nArenaOffset, header.nArenaSize, CHECKSUM_INIT)){
+		result = DPFJ_E_INVALID_FMD;
+	}
+
+	gallery_t* pGallery = NULL;
+	if(0 == result) result = Gallery_Create(header.nFmdType, &pGallery);
+	if(0 == result){
+		pGallery->pMapping = pMapping;
+		pGallery->nMappingSize = nMappingSize;
+		pGallery->pArena = pMapping + header.nArenaOffset;
+		pGallery->nArenaSize = header.nArenaSize;
+		pGallery->nArenaUsed = header.nArenaSize;
+		pGallery->nNextId = header.nNextId;
+		pMapping = NULL;
+
+		//only the table is read: it is copied into the arrays and the id index is rebuilt
+		pGallery->nFmdAlloc = header.nFmdCnt;
+		pGallery->nIdAlloc = header.nNextId;
+		pGallery->vFmd = (unsigned char**)malloc(sizeof(unsigned char*) * (header.nFmdCnt + 1));
+		pGallery->vFmdSize = (unsigned int*)malloc(sizeof(unsigned int) * (header.nFmdCnt + 1));
+		pGallery->vFmdOffset = (unsigned int*)malloc(sizeof(unsigned int) * (header.nFmdCnt + 1));
+		pGallery->vFmdViewCnt = (unsigned int*)malloc(sizeof(unsigned int) * (header.nFmdCnt + 1));
+		pGallery->vFmdSignature = (gallery_signature_t*)malloc(sizeof(gallery_signature_t) * (header.nFmdCnt + 1));
+		pGallery->vFmdId = (unsigned int*)malloc(sizeof(unsigned int) * (header.nFmdCnt + 1));
+		pGallery->vIdIndex = (unsigned int*)malloc(sizeof(unsigned int) * ((size_t)header.nNextId + 1));
+		pGallery->vFmdPartitionIdx = (unsigned int*)malloc(sizeof(unsigned int) * (header.nFmdCnt + 1));
+		if(NULL == pGallery->vFmd || NULL == pGallery->vFmdSize || NULL == pGallery->vFmdOffset || NULL == pGallery->vFmdViewCnt
+			|| NULL == pGallery->vFmdSignature || NULL == pGallery->vFmdId || NULL == pGallery->vIdIndex || NULL == pGallery->vFmdPartitionIdx){
+			result = ENOMEM;
+		}
+	}
+	if(0 == result){
+		unsigned int i = 0;
+		for(i = 0; i < header.nNextId; i++) pGallery->vIdIndex[i] = GALLERY_NO_INDEX;
+
+		const gallery_file_entry_t* vEntries = (const gallery_file_entry_t*)(pGallery->pMapping + header.nTableOffset);
+		for(i = 0; 0 == result && i < header.nFmdCnt; i++){
+			gallery_file_entry_t entry;
+			memcpy(&entry, &vEntries[i], sizeof(entry));
+			//every view has at least its header in the FMD, the arena is not parsed to check more
+			if(entry.nOffset > header.nArenaSize || entry.nSize > header.nArenaSize - entry.nOffset
+				|| 0 == entry.nViewCnt || RECORD_MAX_VIEWS < entry.nViewCnt || entry.nSize / DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH < entry.nViewCnt
+				|| entry.nId >= header.nNextId || GALLERY_NO_INDEX != pGallery->vIdIndex[entry.nId]){
+				result = DPFJ_E_INVALID_FMD;
+				break;
+			}
+			pGallery->vFmdOffset[i] = entry.nOffset;
+			pGallery->vFmd[i] = pGallery->pArena + entry.nOffset;
+			pGallery->vFmdSize[i] = entry.nSize;
+			pGallery->vFmdViewCnt[i] = entry.nViewCnt;
+			pGallery->vFmdSignature[i] = entry.signature;
+			pGallery->vFmdId[i] = entry.nId;
+			pGallery->vIdIndex[entry.nId] = i;
+			//partitions are rebuilt from the signatures in the table, the arena is not touched
+			result = reserve_partition(pGallery, partition_of(&entry.signature));
+			if(0 != result) break;
+			add_to_partition(pGallery, i);
+			pGallery->nFmdCnt++;
+		}
+	}
+
+	if(0 != result){
+		if(NULL != pMapping) munmap(pMapping, nMappingSize);
+		Gallery_Destroy(pGallery);
+		return result;
+	}
+	*ppGallery = pGallery;
+	return 0;
+}
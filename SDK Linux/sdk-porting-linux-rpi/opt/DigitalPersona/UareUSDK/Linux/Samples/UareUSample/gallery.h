@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include "pool.h"
+
+#include <stddef.h>
+
+#include <dpfj.h>
+
+#define GALLERY_NO_INDEX 0xffffffff
+#define GALLERY_NO_SCORE 0xffffffff
+#define GALLERY_SIGNATURE_BINS 8
+
+//dpfj_compare() faults on views with fewer minutiae, such views of the gallery are not scored
+#define GALLERY_MIN_MINUTIAE 6
+
+//partitions: finger positions from DPFJ_POSITION_UNKNOWN to DPFJ_POSITION_LLITTLE, impression types of the 4-bit field in the view header
+#define GALLERY_FINGER_POSITIONS 11
+#define GALLERY_IMPRESSION_TYPES 16
+
+//fusion rules of Gallery_IdentifyFused()
+#define GALLERY_FUSION_MIN     0 //the best view decides, any finger matching is enough
+#define GALLERY_FUSION_MAX     1 //the worst view decides, all fingers have to match
+#define GALLERY_FUSION_PRODUCT 2 //false match rates of the views are multiplied, as for independent fingers
+
+//coarse signature for the pre-filter: finger position, number of minutiae and a histogram of the distances
+//from every minutia to its nearest neighbour, which does not change with rotation or translation of the finger;
+//the impression type is kept with it for the partitions; the histogram is the costly part, it is computed only for
+//galleries searched with the pre-filter
+typedef struct {
+	unsigned char nFingerPos;
+	unsigned char nMinutiaCnt;
+	unsigned char vHistogram[GALLERY_SIGNATURE_BINS]; //share of the minutiae in every bin, 255 is all
+	unsigned char nImpressionType;
+	unsigned char bHistogram;  //the histogram is computed
+} gallery_signature_t;
+
+//FMDs of one finger position and impression type, by their first views; the arrays are passed to dpfj_identify() as they are
+typedef struct {
+	unsigned int    nFmdCnt;
+	unsigned int    nFmdAlloc;
+	unsigned char** vFmd;
+	unsigned int*   vFmdSize;
+	unsigned int*   vFmdIdx;     //index of the FMD in the arrays of the gallery
+} gallery_partition_t;
+
+//persistent 1:N gallery: FMDs are validated once when added and packed back to back
+//into a single arena, the arrays passed to dpfj_identify() are kept between calls
+typedef struct {
+	DPFJ_FMD_FORMAT nFmdType;
+	unsigned char*  pArena;      //FMD data, packed back to back
+	unsigned int    nArenaSize;  //allocated size of the arena
+	unsigned int    nArenaUsed;  //used size of the arena, including removed FMDs
+	unsigned int    nArenaDead;  //size of the removed FMDs still in the arena
+	unsigned int    nFmdCnt;     //number of FMDs in the gallery
+	unsigned int    nFmdAlloc;   //allocated entries in the arrays below
+	unsigned char** vFmd;        //FMDs, as expected by dpfj_identify()
+	unsigned int*   vFmdSize;    //sizes of the FMDs, as expected by dpfj_identify()
+	unsigned int*   vFmdOffset;  //offsets of the FMDs in the arena
+	unsigned int*   vFmdViewCnt; //number of views in the FMDs
+	gallery_signature_t* vFmdSignature; //pre-filter signatures of the first views of the FMDs
+	unsigned int*   vFmdId;      //ids of the FMDs
+	unsigned int*   vFmdPartitionIdx; //index of the FMD in the arrays of its partition
+	gallery_partition_t* vPartition;  //GALLERY_FINGER_POSITIONS * GALLERY_IMPRESSION_TYPES partitions, kept with the arrays above
+	unsigned int*   vIdIndex;    //index of the FMD in the arrays above for every id, GALLERY_NO_INDEX if removed
+	unsigned int    nIdAlloc;    //allocated entries in the vIdIndex
+	unsigned int    nNextId;
+	int             bPrefilter;  //histograms of the signatures are computed for every FMD added
+	unsigned char*  pMapping;    //mapped gallery file, the arena points into it until the gallery is changed
+	size_t          nMappingSize;
+} gallery_t;
+
+typedef struct {
+	unsigned int nId;      //id of the FMD, as returned by Gallery_Add()
+	unsigned int nViewIdx; //index of the view in the FMD
+	unsigned int nScore;   //dissimilarity score, GALLERY_NO_SCORE if the candidates are not ranked by their scores
+} gallery_candidate_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno
+int  Gallery_Create(DPFJ_FMD_FORMAT nFmdType, gallery_t** ppGallery);
+void Gallery_Destroy(gallery_t* pGallery);
+int  Gallery_Add(gallery_t* pGallery, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int* pnId);
+
+//extract features and add them to the gallery in one step: the FMD is created directly in the arena, with no size query
+//and no over-allocated copy
+int  Gallery_AddFromFid(gallery_t* pGallery, DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize, unsigned int* pnId);
+int  Gallery_AddFromRaw(gallery_t* pGallery, const unsigned char* pImage, unsigned int nImageSize,
+	unsigned int nWidth, unsigned int nHeight, unsigned int nDpi, DPFJ_FINGER_POSITION nFingerPos, unsigned int* pnId);
+
+int  Gallery_Remove(gallery_t* pGallery, unsigned int nId);
+int  Gallery_GetFmd(gallery_t* pGallery, unsigned int nId, unsigned char** ppFmd, unsigned int* pnFmdSize);
+int  Gallery_Identify(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
+
+//the same as Gallery_Identify(), but the gallery is split into shards which are searched on the pool threads;
+//candidates of the shards are ranked by their dissimilarity scores and merged, the scores are returned with them;
+//a small gallery, or any gallery with no pool, is searched as one shard and its candidates are scored the same way;
+//the candidates are the best of dpfj_identify(), which does not rank exactly as dpfj_compare() scores; the matcher
+//takes no bound from the scores kept, so a search for the best K by score cannot skip any part of the gallery
+int  Gallery_IdentifyParallel(gallery_t* pGallery, pool_t* pPool, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
+
+//identifies every probe in the array against the gallery: the gallery goes through the cache once for every
+//block of probes instead of once for every probe; nCandidateCnt candidates are reserved for every probe in the
+//vCandidates, the number of candidates found for every probe is returned in the vCandidateCnt
+int  Gallery_IdentifyBatch(gallery_t* pGallery, pool_t* pPool, unsigned int nProbeCnt, unsigned char** vFmd, unsigned int* vFmdSize,
+	unsigned int nViewIdx, unsigned int nThreshold, unsigned int nCandidateCnt, unsigned int* vCandidateCnt, gallery_candidate_t* vCandidates);
+
+//identification with several probe views at once, e.g. two fingers presented together: all views are searched in one
+//pass over the gallery, every candidate gets a score for every view, and the scores are fused by the rule, one of
+//GALLERY_FUSION_*; the fused score has to pass nThreshold, candidates are ranked by it and returned with it;
+//the fusion is approximate: an FMD is a candidate only if dpfj_identify() returns it for at least one view, and the
+//identify and compare scores do not agree exactly, so a mate whose fused score passes can be missed
+int  Gallery_IdentifyFused(gallery_t* pGallery, pool_t* pPool, unsigned int nProbeCnt, unsigned char** vFmd, unsigned int* vFmdSize,
+	unsigned int* vViewIdx, unsigned int nFusion, unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
+
+//computes the signature histograms of the FMDs in the gallery, and of every FMD added from then on, for
+//Gallery_IdentifyPrefiltered(); a gallery opened from a file needs it again, the histograms saved are kept
+int  Gallery_EnablePrefilter(gallery_t* pGallery);
+
+//identification with a pre-filter: only nPenetration percent of the gallery, the FMDs with signatures closest to
+//the probe, is searched with dpfj_identify(); pnSearchedCnt receives the number of FMDs searched; the signature is
+//coarse, a mate can be left out: bench_prefilter on 2000 synthetic fingers, whose full search ranked all 100 mates
+//first, missed 45 of them at 5%, 35 at 10%, 12 at 25% and 3 at 50%; EINVAL before Gallery_EnablePrefilter()
+int  Gallery_IdentifyPrefiltered(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int nPenetration, unsigned int* pnSearchedCnt, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
+
+//identification restricted to some fingers: vFingerPos lists the DPFJ_POSITION_* to search, in any order;
+//nImpressionMask has bit (1 << impression type) set for every DPFJ_SCAN_* type to search, 0 searches all;
+//an FMD is in the partition of its first view, its other views are searched with it; every partition gets its
+//proportional part of the threshold and the candidates of all partitions are ranked by their dpfj_compare() scores,
+//as the shards of Gallery_IdentifyParallel()
+int  Gallery_IdentifyFingers(gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nFingerCnt, const DPFJ_FINGER_POSITION* vFingerPos, unsigned int nImpressionMask,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
+
+//gallery file: Gallery_Save() writes the FMDs with their ids and view counts, Gallery_Open() maps the file and
+//reads only its header and table, FMDs are paged in when first searched; bVerify checks the FMDs' checksum too,
+//which reads the whole file; a mapped gallery can be changed, its FMDs are copied to memory on the first Gallery_Add();
+//the ids of removed FMDs are kept as holes, Gallery_Save() returns EOVERFLOW when there are more holes than a file of
+//its size may hold, Gallery_Open() refuses such a file as damaged
+int  Gallery_Save(gallery_t* pGallery, const char* szPath);
+int  Gallery_Open(const char* szPath, int bVerify, gallery_t** ppGallery);
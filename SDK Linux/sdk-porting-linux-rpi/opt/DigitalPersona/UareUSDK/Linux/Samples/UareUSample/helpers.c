@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <time.h>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // error handling
@@ -56,18 +57,54 @@ void print_error(const char* szFunctionName, int nError){
 // capture
 
 DPFPDD_DEV g_hReader = NULL;
+volatile sig_atomic_t g_bCancel = 0;
 
 void signal_handler(int nSignal) {
 	if(SIGINT == nSignal){
+		g_bCancel = 1;
 		//cancel capture
 		if(NULL != g_hReader) dpfpdd_cancel(g_hReader);
 	}
 }
 
-int CaptureFinger(const char* szFingerName, DPFPDD_DEV hReader, DPFJ_FMD_FORMAT nFtType, unsigned char** ppFt, unsigned int* pFtSize){
+//the status is polled while the reader is busy, with the sleep in between doubled up to the maximum
+#define READY_POLL_MIN_MS 1
+#define READY_POLL_MAX_MS 16
+
+//waits until the reader is ready to capture; returns 0 if ready, EINTR if canceled, otherwise an error code;
+//the library notifies of no status change, so instead of spinning on dpfpdd_get_device_status() the thread sleeps
+//between the polls, and Ctrl-C cuts the sleep short
+static int wait_until_ready(DPFPDD_DEV hReader){
+	unsigned int nDelay = READY_POLL_MIN_MS;
+	while(!g_bCancel){
+		DPFPDD_DEV_STATUS ds;
+		ds.size = sizeof(DPFPDD_DEV_STATUS);
+		int result = dpfpdd_get_device_status(hReader, &ds);
+		if(DPFPDD_SUCCESS != result){
+			print_error("dpfpdd_get_device_status()", result);
+			return result;
+		}
+
+		if(DPFPDD_STATUS_FAILURE == ds.status){
+			print_error("Reader failure", DPFPDD_STATUS_FAILURE);
+			return DPFPDD_E_DEVICE_FAILURE;
+		}
+		if(DPFPDD_STATUS_READY == ds.status || DPFPDD_STATUS_NEED_CALIBRATION == ds.status) return 0;
+
+		//busy
+		struct timespec ts;
+		ts.tv_sec = 0;
+		ts.tv_nsec = (long)nDelay * 1000000;
+		nanosleep(&ts, NULL);
+		if(READY_POLL_MAX_MS > nDelay) nDelay <<= 1;
+	}
+	return EINTR;
+}
+
+int CaptureImage(const char* szFingerName, DPFPDD_DEV hReader, unsigned char** ppImage, unsigned int* pImageSize){
 	int result = 0;
-	*ppFt = NULL;
-	*pFtSize = 0;
+	*ppImage = NULL;
+	*pImageSize = 0;
 
 	//prepare capture parameters and result
 	DPFPDD_CAPTURE_PARAM cparam = {0};
@@ -106,28 +143,11 @@ int CaptureFinger(const char* szFingerName, DPFPDD_DEV hReader, DPFJ_FMD_FORMAT
 	sigaddset(&new_sigmask, SIGINT);
 	sigprocmask(SIG_UNBLOCK, &new_sigmask, &old_sigmask);
 	
+	g_bCancel = 0;
 	while(1){
 		//wait until ready
-		int is_ready = 0;
-		while(1){
-			DPFPDD_DEV_STATUS ds;
-			ds.size = sizeof(DPFPDD_DEV_STATUS);
-			result = dpfpdd_get_device_status(hReader, &ds);
-			if(DPFPDD_SUCCESS != result){
-				print_error("dpfpdd_get_device_status()", result);
-				break;
-			}
-			
-			if(DPFPDD_STATUS_FAILURE == ds.status){
-				print_error("Reader failure", DPFPDD_STATUS_FAILURE);
-				break;
-			}
-			if(DPFPDD_STATUS_READY == ds.status || DPFPDD_STATUS_NEED_CALIBRATION == ds.status){
-				is_ready = 1;
-				break;
-			}
-		}
-		if(!is_ready) break;
+		result = wait_until_ready(hReader);
+		if(0 != result) break;
 
 		//capture fingerprint
 		printf("Put %s on the reader, or press Ctrl-C to cancel...\r\n", szFingerName);
@@ -140,27 +160,10 @@ int CaptureFinger(const char* szFingerName, DPFPDD_DEV hReader, DPFJ_FMD_FORMAT
 				//captured
 				printf("    fingerprint captured,\n");
 
-				//get max size for the feature template
-				unsigned int nFeaturesSize = MAX_FMD_SIZE;
-				unsigned char* pFeatures = (unsigned char*)malloc(nFeaturesSize);
-				if(NULL == pFeatures){
-					print_error("malloc()", ENOMEM);
-					result = ENOMEM;
-				}
-				else{
-					//create template
-					result = dpfj_create_fmd_from_fid(DPFJ_FID_ISO_19794_4_2005, pImage, nImageSize, nFtType, pFeatures, &nFeaturesSize);
-
-					if(DPFJ_SUCCESS == result){
-						*ppFt = pFeatures;
-						*pFtSize = nFeaturesSize;
-						printf("    features extracted.\n\n");
-					}
-					else{
-						print_error("dpfj_create_fmd_from_fid()", result);
-						free(pFeatures);
-					}
-				}
+				//image is handed over to the caller
+				*ppImage = pImage;
+				*pImageSize = nImageSize;
+				pImage = NULL;
 			}
 			else if(DPFPDD_QUALITY_CANCELED == cresult.quality){
 				//capture canceled
@@ -209,4 +212,41 @@ int CaptureFinger(const char* szFingerName, DPFPDD_DEV hReader, DPFJ_FMD_FORMAT
 	return result;
 }
 
+int CaptureFinger(const char* szFingerName, DPFPDD_DEV hReader, DPFJ_FMD_FORMAT nFtType, unsigned char** ppFt, unsigned int* pFtSize){
+	*ppFt = NULL;
+	*pFtSize = 0;
+
+	unsigned char* pImage = NULL;
+	unsigned int nImageSize = 0;
+	int result = CaptureImage(szFingerName, hReader, &pImage, &nImageSize);
+	if(0 != result) return result;
+
+	//get max size for the feature template
+	unsigned int nFeaturesSize = MAX_FMD_SIZE;
+	unsigned char* pFeatures = (unsigned char*)malloc(nFeaturesSize);
+	if(NULL == pFeatures){
+		print_error("malloc()", ENOMEM);
+		result = ENOMEM;
+	}
+	else{
+		//create template
+		result = dpfj_create_fmd_from_fid(DPFJ_FID_ISO_19794_4_2005, pImage, nImageSize, nFtType, pFeatures, &nFeaturesSize);
+
+		if(DPFJ_SUCCESS == result){
+			//MAX_FMD_SIZE saves the size query, which would run the extraction twice; keep only the actual size
+			unsigned char* pShrunk = (unsigned char*)realloc(pFeatures, nFeaturesSize);
+			if(NULL != pShrunk) pFeatures = pShrunk;
+			*ppFt = pFeatures;
+			*pFtSize = nFeaturesSize;
+			printf("    features extracted.\n\n");
+		}
+		else{
+			print_error("dpfj_create_fmd_from_fid()", result);
+			free(pFeatures);
+		}
+	}
+
+	free(pImage);
+	return result;
+}
 
@@ -14,6 +14,9 @@
 //error handling
 void print_error(const char* szFunctionName, int nError);
 
+//returns 0 if captured, otherwise an error code; image is in ISO 19794-4-2005 format, allocated with malloc()
+int CaptureImage(const char* szFingerName, DPFPDD_DEV hReader, unsigned char** ppImage, unsigned int* pImageSize);
+
 //returns 0 if captured, otherwise an error code
 int CaptureFinger(const char* szFingerName, DPFPDD_DEV hReader, DPFJ_FMD_FORMAT nFtType, unsigned char** ppFt, unsigned int* pFtSize);
 
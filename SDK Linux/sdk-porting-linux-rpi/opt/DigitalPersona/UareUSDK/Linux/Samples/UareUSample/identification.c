@@ -11,13 +11,30 @@
 #include <unistd.h>
 
 #include "helpers.h"
+#include "gallery.h"
+#include "extractor.h"
 
 #include <dpfj.h>
 
+typedef struct {
+	unsigned char** vFmd;
+	unsigned int*   vFmdSize;
+	int*            vResult;
+} extracted_t;
+
+//called on the extractor threads, every finger has its own slot
+static void on_extracted(void* pContext, unsigned int nTag, int nResult, unsigned char* pFmd, unsigned int nFmdSize){
+	extracted_t* pExtracted = (extracted_t*)pContext;
+	pExtracted->vFmd[nTag] = pFmd;
+	pExtracted->vFmdSize[nTag] = nFmdSize;
+	pExtracted->vResult[nTag] = nResult;
+}
+
 void Identification(DPFPDD_DEV hReader){
 	const int nFingerCnt = 5;
 	unsigned char* vFmd[nFingerCnt];
 	unsigned int vFmdSize[nFingerCnt];
+	int vResult[nFingerCnt];
 	char* vFingerName[nFingerCnt];
 	
 	//initialization
@@ -25,6 +42,7 @@ void Identification(DPFPDD_DEV hReader){
 	for(i = 0; i < nFingerCnt; i++){
 		vFmd[i] = NULL;
 		vFmdSize[i] = 0;
+		vResult[i] = 0;
 	}
 	vFingerName[0] = "your thumb";
 	vFingerName[1] = "your index finger";
@@ -38,18 +56,45 @@ void Identification(DPFPDD_DEV hReader){
 		print_error("dpfpdd_led_config()", result);
 	}
 
+	//features are extracted on the extractor threads while the next finger is captured
+	extracted_t extracted = { vFmd, vFmdSize, vResult };
+	extractor_t* pExtractor = NULL;
+	result = Extractor_Create(DPFJ_FMD_ANSI_378_2004, 0, nFingerCnt, on_extracted, &extracted, &pExtractor);
+	if(0 != result){
+		print_error("Extractor_Create()", result);
+		return;
+	}
+
 	int bStop = 0;
 	while(!bStop){
 		printf("Identification started\n\n");
 
 		//capture fingers
 		for(i = 0; i < nFingerCnt; i++){
-			if(0 == CaptureFinger(vFingerName[i], hReader, DPFJ_FMD_ANSI_378_2004, &vFmd[i], &vFmdSize[i])) continue;
+			unsigned char* pImage = NULL;
+			unsigned int nImageSize = 0;
+			if(0 == CaptureImage(vFingerName[i], hReader, &pImage, &nImageSize)){
+				result = Extractor_Submit(pExtractor, DPFJ_FID_ISO_19794_4_2005, pImage, nImageSize, i);
+				if(0 == result) continue;
+
+				print_error("Extractor_Submit()", result);
+				free(pImage);
+			}
 			
 			bStop = 1;
 			break;
 		}
 
+		//wait for extraction of the fingers captured so far
+		Extractor_Wait(pExtractor);
+		for(i = 0; !bStop && i < nFingerCnt; i++){
+			if(DPFJ_SUCCESS == vResult[i]) continue;
+
+			print_error("dpfj_create_fmd_from_fid()", vResult[i]);
+			bStop = 1;
+		}
+		if(!bStop) printf("    features extracted.\n\n");
+
 		if(!bStop){
 			//run identification
 
@@ -57,16 +102,29 @@ void Identification(DPFPDD_DEV hReader){
 			//for a discussion of  how to evaluate dissimilarity scores, as well as the statistical validity of the dissimilarity score and error rates, consult the Developer Guide
 			unsigned int falsepositive_rate = DPFJ_PROBABILITY_ONE / 100000; 
 			unsigned int nCandidateCnt = nFingerCnt;
-			DPFJ_CANDIDATE vCandidates[nFingerCnt];
-			int result = dpfj_identify(DPFJ_FMD_ANSI_378_2004, vFmd[nFingerCnt - 1], vFmdSize[nFingerCnt - 1], 0,
-				DPFJ_FMD_ANSI_378_2004, nFingerCnt - 1, vFmd, vFmdSize, falsepositive_rate, &nCandidateCnt, vCandidates);
+			gallery_candidate_t vCandidates[nFingerCnt];
+			unsigned int vFingerId[nFingerCnt - 1];
+
+			//the fingers enrolled in this round go into a gallery of their own, the next round captures new ones;
+			//the gallery picks the ids, they are kept to tell the fingers of the candidates
+			gallery_t* pGallery = NULL;
+			int result = Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery);
+			for(i = 0; 0 == result && i < nFingerCnt - 1; i++){
+				result = Gallery_Add(pGallery, vFmd[i], vFmdSize[i], &vFingerId[i]);
+			}
+			if(0 == result){
+				//candidates come ranked, with their dissimilarity scores
+				result = Gallery_IdentifyParallel(pGallery, NULL, vFmd[nFingerCnt - 1], vFmdSize[nFingerCnt - 1], 0,
+					falsepositive_rate, &nCandidateCnt, vCandidates);
+			}
+			Gallery_Destroy(pGallery);
 
 			if(DPFJ_SUCCESS == result){
 				if(0 != nCandidateCnt){
-					//optional: to get false match rate run compare for the top candidate
-					unsigned int falsematch_rate = 0;
-					result = dpfj_compare(DPFJ_FMD_ANSI_378_2004, vFmd[nFingerCnt - 1], vFmdSize[nFingerCnt - 1], 0, 
-						DPFJ_FMD_ANSI_378_2004, vFmd[vCandidates[0].fmd_idx], vFmdSize[vCandidates[0].view_idx], 0, &falsematch_rate);
+					//false match rate of the top candidate is its score, no extra compare is needed
+					unsigned int falsematch_rate = vCandidates[0].nScore;
+					int nFinger = 0;
+					while(nFinger < nFingerCnt - 2 && vFingerId[nFinger] != vCandidates[0].nId) nFinger++;
 
 					//turn green LED on for 1 sec
 					dpfpdd_led_ctrl(hReader, DPFPDD_LED_ACCEPT, DPFPDD_LED_CMD_ON);
@@ -74,7 +132,7 @@ void Identification(DPFPDD_DEV hReader){
 					dpfpdd_led_ctrl(hReader, DPFPDD_LED_ACCEPT, DPFPDD_LED_CMD_OFF);
 
 					//print out the results
-					printf("Fingerprint identified, %s\n", vFingerName[vCandidates[0].fmd_idx]);
+					printf("Fingerprint identified, %s\n", vFingerName[nFinger]);
 					printf("dissimilarity score: 0x%x.\n", falsematch_rate);
 					printf("false match rate: %e.\n\n\n", (double)(falsematch_rate / DPFJ_PROBABILITY_ONE));
 				}
@@ -88,7 +146,7 @@ void Identification(DPFPDD_DEV hReader){
 					printf("Fingerprint was not identified.\n\n\n");
 				}
 			}
-			else print_error("dpfj_identify()", result);
+			else print_error("Gallery_Create(), Gallery_Add() or Gallery_IdentifyParallel()", result);
 		}
 
 		//release memory
@@ -96,7 +154,10 @@ void Identification(DPFPDD_DEV hReader){
 			if(NULL != vFmd[i]) free(vFmd[i]);
 			vFmd[i] = NULL;
 			vFmdSize[i] = 0;
+			vResult[i] = 0;
 		}
 	}
+
+	Extractor_Destroy(pExtractor);
 }
 
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "livegallery.h"
+#include "record.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIVE_MIN_ALLOC 64
+
+static live_fmd_t* fmd_from_data(unsigned char* pData){
+	return (live_fmd_t*)(pData - offsetof(live_fmd_t, vData));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// arrays
+
+static live_arrays_t* create_arrays(unsigned int nAlloc){
+	if(LIVE_MIN_ALLOC > nAlloc) nAlloc = LIVE_MIN_ALLOC;
+	live_arrays_t* pArrays = (live_arrays_t*)calloc(1, sizeof(live_arrays_t));
+	if(NULL == pArrays) return NULL;
+	pArrays->vFmd = (unsigned char**)malloc(sizeof(unsigned char*) * nAlloc);
+	pArrays->vFmdSize = (unsigned int*)malloc(sizeof(unsigned int) * nAlloc);
+	pArrays->vFmdId = (unsigned int*)malloc(sizeof(unsigned int) * nAlloc);
+	if(NULL == pArrays->vFmd || NULL == pArrays->vFmdSize || NULL == pArrays->vFmdId){
+		if(NULL != pArrays->vFmd) free(pArrays->vFmd);
+		if(NULL != pArrays->vFmdSize) free(pArrays->vFmdSize);
+		if(NULL != pArrays->vFmdId) free(pArrays->vFmdId);
+		free(pArrays);
+		return NULL;
+	}
+	pArrays->nAlloc = nAlloc;
+	return pArrays;
+}
+
+//appends the entry, the arrays take their own reference to the FMD
+static void append_entry(live_arrays_t* pArrays, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nId){
+	__sync_fetch_and_add(&fmd_from_data(pFmd)->nRef, 1);
+	pArrays->vFmd[pArrays->nUsed] = pFmd;
+	pArrays->vFmdSize[pArrays->nUsed] = nFmdSize;
+	pArrays->vFmdId[pArrays->nUsed] = nId;
+	pArrays->nUsed++;
+}
+
+//called without the mutex when the last snapshot using the arrays is gone
+static void free_arrays(live_arrays_t* pArrays){
+	unsigned int i = 0;
+	for(i = 0; i < pArrays->nUsed; i++){
+		live_fmd_t* pLiveFmd = fmd_from_data(pArrays->vFmd[i]);
+		if(0 == __sync_sub_and_fetch(&pLiveFmd->nRef, 1)) free(pLiveFmd);
+	}
+	free(pArrays->vFmd);
+	free(pArrays->vFmdSize);
+	free(pArrays->vFmdId);
+	free(pArrays);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// snapshots
+
+static live_snapshot_t* acquire_snapshot(live_gallery_t* pGallery){
+	pthread_mutex_lock(&pGallery->mutex);
+	live_snapshot_t* pSnapshot = pGallery->pSnapshot;
+	pSnapshot->nRef++;
+	pthread_mutex_unlock(&pGallery->mutex);
+	return pSnapshot;
+}
+
+static void release_snapshot(live_gallery_t* pGallery, live_snapshot_t* pSnapshot){
+	live_arrays_t* pDeadArrays = NULL;
+	pthread_mutex_lock(&pGallery->mutex);
+	pSnapshot->nRef--;
+	if(0 == pSnapshot->nRef){
+		pSnapshot->pArrays->nRef--;
+		if(0 == pSnapshot->pArrays->nRef) pDeadArrays = pSnapshot->pArrays;
+	}
+	else pSnapshot = NULL;
+	pthread_mutex_unlock(&pGallery->mutex);
+
+	//freeing happens outside the mutex, other threads keep taking snapshots meanwhile
+	if(NULL != pSnapshot){
+		if(NULL != pSnapshot->vTombstone) free(pSnapshot->vTombstone);
+		free(pSnapshot);
+	}
+	if(NULL != pDeadArrays) free_arrays(pDeadArrays);
+}
+
+//creates an unpublished snapshot, tombstones are copied with nExtra free entries at the end
+static live_snapshot_t* create_snapshot(live_arrays_t* pArrays, unsigned int nFmdCnt, const unsigned int* vTombstone,
+	unsigned int nTombstoneCnt, unsigned int nExtra){
+	live_snapshot_t* pSnapshot = (live_snapshot_t*)calloc(1, sizeof(live_snapshot_t));
+	if(NULL == pSnapshot) return NULL;
+	if(0 != nTombstoneCnt + nExtra){
+		pSnapshot->vTombstone = (unsigned int*)malloc(sizeof(unsigned int) * (nTombstoneCnt + nExtra));
+		if(NULL == pSnapshot->vTombstone){
+			free(pSnapshot);
+			return NULL;
+		}
+		if(0 != nTombstoneCnt) memcpy(pSnapshot->vTombstone, vTombstone, sizeof(unsigned int) * nTombstoneCnt);
+	}
+	pSnapshot->nRef = 1; //reference of the gallery
+	pSnapshot->pArrays = pArrays;
+	pSnapshot->nFmdCnt = nFmdCnt;
+	pSnapshot->nTombstoneCnt = nTombstoneCnt;
+	return pSnapshot;
+}
+
+//makes the snapshot current, must be called with the mutexWrite locked
+static void publish_snapshot(live_gallery_t* pGallery, live_snapshot_t* pSnapshot){
+	pthread_mutex_lock(&pGallery->mutex);
+	live_snapshot_t* pOld = pGallery->pSnapshot;
+	pSnapshot->pArrays->nRef++;
+	pGallery->pSnapshot = pSnapshot;
+	pthread_mutex_unlock(&pGallery->mutex);
+
+	if(NULL != pOld) release_snapshot(pGallery, pOld);
+}
+
+static int is_tombstone(const live_snapshot_t* pSnapshot, unsigned int nId){
+	unsigned int nLow = 0;
+	unsigned int nHigh = pSnapshot->nTombstoneCnt;
+	while(nLow < nHigh){
+		unsigned int nMid = nLow + (nHigh - nLow) / 2;
+		if(pSnapshot->vTombstone[nMid] == nId) return 1;
+		if(pSnapshot->vTombstone[nMid] < nId) nLow = nMid + 1;
+		else nHigh = nMid;
+	}
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// gallery
+
+int LiveGallery_Create(DPFJ_FMD_FORMAT nFmdType, live_gallery_t** ppGallery){
+	if(NULL == ppGallery) return EINVAL;
+	if(DPFJ_FMD_ANSI_378_2004 != nFmdType && DPFJ_FMD_ISO_19794_2_2005 != nFmdType) return DPFJ_E_INVALID_PARAMETER;
+
+	live_gallery_t* pGallery = (live_gallery_t*)calloc(1, sizeof(live_gallery_t));
+	if(NULL == pGallery) return ENOMEM;
+	pGallery->nFmdType = nFmdType;
+	pthread_mutex_init(&pGallery->mutex, NULL);
+	pthread_mutex_init(&pGallery->mutexWrite, NULL);
+
+	live_arrays_t* pArrays = create_arrays(0);
+	live_snapshot_t* pSnapshot = (NULL != pArrays) ? create_snapshot(pArrays, 0, NULL, 0, 0) : NULL;
+	if(NULL == pSnapshot){
+		if(NULL != pArrays) free_arrays(pArrays);
+		LiveGallery_Destroy(pGallery);
+		return ENOMEM;
+	}
+	publish_snapshot(pGallery, pSnapshot);
+
+	*ppGallery = pGallery;
+	return 0;
+}
+
+void LiveGallery_Destroy(live_gallery_t* pGallery){
+	if(NULL == pGallery) return;
+	if(NULL != pGallery->pSnapshot) release_snapshot(pGallery, pGallery->pSnapshot);
+	if(NULL != pGallery->vIdIndex) free(pGallery->vIdIndex);
+	pthread_mutex_destroy(&pGallery->mutexWrite);
+	pthread_mutex_destroy(&pGallery->mutex);
+	free(pGallery);
+}
+
+int LiveGallery_Add(live_gallery_t* pGallery, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int* pnId){
+	if(NULL == pGallery || NULL == pnId) return EINVAL;
+
+	fmd_record_t record;
+	int result = FmdRecord_Parse(&record, pGallery->nFmdType, pFmd, nFmdSize);
+	if(0 != result) return result;
+
+	live_fmd_t* pLiveFmd = (live_fmd_t*)malloc(offsetof(live_fmd_t, vData) + nFmdSize);
+	if(NULL == pLiveFmd) return ENOMEM;
+	pLiveFmd->nRef = 0;
+	pLiveFmd->nSize = nFmdSize;
+	memcpy(pLiveFmd->vData, pFmd, nFmdSize);
+
+	pthread_mutex_lock(&pGallery->mutexWrite);
+	live_snapshot_t* pCurrent = pGallery->pSnapshot;
+	live_arrays_t* pArrays = pCurrent->pArrays;
+	unsigned int nId = pGallery->nNextId;
+
+	if(nId == pGallery->nIdAlloc){
+		unsigned int nAlloc = (0 == pGallery->nIdAlloc) ? LIVE_MIN_ALLOC : pGallery->nIdAlloc * 2;
+		unsigned int* vIdIndex = (unsigned int*)realloc(pGallery->vIdIndex, sizeof(unsigned int) * nAlloc);
+		if(NULL == vIdIndex) result = ENOMEM;
+		else{
+			pGallery->vIdIndex = vIdIndex;
+			pGallery->nIdAlloc = nAlloc;
+		}
+	}
+
+	//full arrays are replaced by bigger ones; the old ones stay with the snapshots which still use them
+	live_arrays_t* pNewArrays = NULL;
+	if(0 == result && pArrays->nUsed == pArrays->nAlloc){
+		pNewArrays = create_arrays(pArrays->nAlloc * 2);
+		if(NULL == pNewArrays) result = ENOMEM;
+		else{
+			unsigned int i = 0;
+			for(i = 0; i < pArrays->nUsed; i++) append_entry(pNewArrays, pArrays->vFmd[i], pArrays->vFmdSize[i], pArrays->vFmdId[i]);
+			pArrays = pNewArrays;
+		}
+	}
+
+	live_snapshot_t* pSnapshot = NULL;
+	if(0 == result){
+		pSnapshot = create_snapshot(pArrays, pCurrent->nFmdCnt + 1, pCurrent->vTombstone, pCurrent->nTombstoneCnt, 0);
+		if(NULL == pSnapshot) result = ENOMEM;
+	}
+	if(0 == result){
+		//written past the end of every published snapshot, nobody reads the entry yet
+		pGallery->vIdIndex[nId] = pArrays->nUsed;
+		append_entry(pArrays, pLiveFmd->vData, nFmdSize, nId);
+		pGallery->nNextId++;
+		publish_snapshot(pGallery, pSnapshot);
+		*pnId = nId;
+	}
+	else{
+		if(NULL != pNewArrays) free_arrays(pNewArrays);
+		free(pLiveFmd);
+	}
+	pthread_mutex_unlock(&pGallery->mutexWrite);
+	return result;
+}
+
+int LiveGallery_Remove(live_gallery_t* pGallery, unsigned int nId){
+	if(NULL == pGallery) return EINVAL;
+
+	pthread_mutex_lock(&pGallery->mutexWrite);
+	int result = 0;
+	if(nId >= pGallery->nNextId || GALLERY_NO_INDEX == pGallery->vIdIndex[nId]) result = ENOENT;
+
+	live_snapshot_t* pSnapshot = NULL;
+	if(0 == result){
+		live_snapshot_t* pCurrent = pGallery->pSnapshot;
+		pSnapshot = create_snapshot(pCurrent->pArrays, pCurrent->nFmdCnt, pCurrent->vTombstone, pCurrent->nTombstoneCnt, 1);
+		if(NULL == pSnapshot) result = ENOMEM;
+	}
+	if(0 == result){
+		//insert keeping the tombstones sorted
+		unsigned int i = pSnapshot->nTombstoneCnt;
+		while(0 < i && pSnapshot->vTombstone[i - 1] > nId){
+			pSnapshot->vTombstone[i] = pSnapshot->vTombstone[i - 1];
+			i--;
+		}
+		pSnapshot->vTombstone[i] = nId;
+		pSnapshot->nTombstoneCnt++;
+		pGallery->vIdIndex[nId] = GALLERY_NO_INDEX;
+		publish_snapshot(pGallery, pSnapshot);
+	}
+	pthread_mutex_unlock(&pGallery->mutexWrite);
+	return result;
+}
+
+int LiveGallery_Compact(live_gallery_t* pGallery){
+	if(NULL == pGallery) return EINVAL;
+
+	pthread_mutex_lock(&pGallery->mutexWrite);
+	live_snapshot_t* pCurrent = pGallery->pSnapshot;
+	if(0 == pCurrent->nTombstoneCnt){
+		pthread_mutex_unlock(&pGallery->mutexWrite);
+		return 0;
+	}
+
+	//surviving FMDs are shared with the old arrays, only the pointers are copied
+	int result = 0;
+	live_arrays_t* pOld = pCurrent->pArrays;
+	live_arrays_t* pArrays = create_arrays(pCurrent->nFmdCnt - pCurrent->nTombstoneCnt + LIVE_MIN_ALLOC);
+	live_snapshot_t* pSnapshot = NULL;
+	if(NULL != pArrays){
+		unsigned int i = 0;
+		for(i = 0; i < pCurrent->nFmdCnt; i++){
+			if(is_tombstone(pCurrent, pOld->vFmdId[i])) continue;
+			append_entry(pArrays, pOld->vFmd[i], pOld->vFmdSize[i], pOld->vFmdId[i]);
+		}
+		pSnapshot = create_snapshot(pArrays, pArrays->nUsed, NULL, 0, 0);
+	}
+	if(NULL == pSnapshot){
+		if(NULL != pArrays) free_arrays(pArrays);
+		result = ENOMEM;
+	}
+	else{
+		unsigned int i = 0;
+		for(i = 0; i < pArrays->nUsed; i++) pGallery->vIdIndex[pArrays->vFmdId[i]] = i;
+		publish_snapshot(pGallery, pSnapshot);
+	}
+	pthread_mutex_unlock(&pGallery->mutexWrite);
+	return result;
+}
+
+int LiveGallery_Identify(live_gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates){
+	if(NULL == pGallery || NULL == pnCandidateCnt || NULL == pCandidates) return EINVAL;
+
+	unsigned int nCandidateCnt = *pnCandidateCnt;
+	*pnCandidateCnt = 0;
+	live_snapshot_t* pSnapshot = acquire_snapshot(pGallery);
+	unsigned int nLiveCnt = pSnapshot->nFmdCnt - pSnapshot->nTombstoneCnt;
+	if(0 == nCandidateCnt || 0 == nLiveCnt){
+		release_snapshot(pGallery, pSnapshot);
+		return 0;
+	}
+
+	//tombstones can take candidate places, as many extra candidates are asked for; the threshold is
+	//scaled by the number of searched FMDs, it is raised back to the rate of the live FMDs
+	unsigned int nFetchCnt = nCandidateCnt + pSnapshot->nTombstoneCnt;
+	if(nFetchCnt > pSnapshot->nFmdCnt) nFetchCnt = pSnapshot->nFmdCnt;
+	unsigned long long nScaled = (unsigned long long)nThreshold * pSnapshot->nFmdCnt / nLiveCnt;
+	if(DPFJ_PROBABILITY_ONE < nScaled) nScaled = DPFJ_PROBABILITY_ONE;
+
+	int result = 0;
+	DPFJ_CANDIDATE* vCandidates = (DPFJ_CANDIDATE*)malloc(sizeof(DPFJ_CANDIDATE) * nFetchCnt);
+	if(NULL == vCandidates) result = ENOMEM;
+	if(0 == result){
+		unsigned int i = 0;
+		for(i = 0; i < nFetchCnt; i++) vCandidates[i].size = sizeof(DPFJ_CANDIDATE);
+
+		live_arrays_t* pArrays = pSnapshot->pArrays;
+		result = dpfj_identify(pGallery->nFmdType, pFmd, nFmdSize, nViewIdx,
+			pGallery->nFmdType, pSnapshot->nFmdCnt, pArrays->vFmd, pArrays->vFmdSize, (unsigned int)nScaled, &nFetchCnt, vCandidates);
+		if(DPFJ_SUCCESS == result){
+			unsigned int nFound = 0;
+			for(i = 0; i < nFetchCnt && nFound < nCandidateCnt; i++){
+				unsigned int nId = pArrays->vFmdId[vCandidates[i].fmd_idx];
+				if(is_tombstone(pSnapshot, nId)) continue;
+				pCandidates[nFound].nId = nId;
+				pCandidates[nFound].nViewIdx = vCandidates[i].view_idx;
+				pCandidates[nFound].nScore = GALLERY_NO_SCORE;
+				nFound++;
+			}
+			*pnCandidateCnt = nFound;
+		}
+		free(vCandidates);
+	}
+
+	release_snapshot(pGallery, pSnapshot);
+	return result;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include "gallery.h"
+
+#include <pthread.h>
+
+#include <dpfj.h>
+
+//FMD shared by the arrays which contain it, freed with the last of them
+typedef struct {
+	unsigned int  nRef;     //changed with atomic operations
+	unsigned int  nSize;
+	unsigned char vData[1];
+} live_fmd_t;
+
+//arrays as expected by dpfj_identify(); entries are only ever appended, so a snapshot can keep
+//reading its part while new FMDs are written past its end
+typedef struct {
+	unsigned int    nRef;   //snapshots using the arrays
+	unsigned int    nUsed;  //entries written, each holds a reference to its FMD
+	unsigned int    nAlloc;
+	unsigned char** vFmd;
+	unsigned int*   vFmdSize;
+	unsigned int*   vFmdId;
+} live_arrays_t;
+
+//state of the gallery at one moment, never changed after it is published
+typedef struct {
+	unsigned int    nRef;
+	live_arrays_t*  pArrays;
+	unsigned int    nFmdCnt;        //number of the entries of the arrays which belong to the snapshot
+	unsigned int*   vTombstone;     //ids removed since the arrays were built, sorted
+	unsigned int    nTombstoneCnt;
+} live_snapshot_t;
+
+//gallery which is changed while it is searched: every change publishes a new snapshot, identification
+//searches the snapshot which was current when it started; the mutex is held only to take or drop
+//a reference, so searches never wait for additions, removals or compaction
+typedef struct {
+	DPFJ_FMD_FORMAT  nFmdType;
+	pthread_mutex_t  mutex;       //guards pSnapshot and the reference counts of snapshots and arrays
+	pthread_mutex_t  mutexWrite;  //serializes changes
+	live_snapshot_t* pSnapshot;
+	unsigned int*    vIdIndex;    //index in the current arrays for every id, GALLERY_NO_INDEX if removed
+	unsigned int     nIdAlloc;
+	unsigned int     nNextId;
+} live_gallery_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno
+int  LiveGallery_Create(DPFJ_FMD_FORMAT nFmdType, live_gallery_t** ppGallery);
+void LiveGallery_Destroy(live_gallery_t* pGallery); //no other calls may be running
+int  LiveGallery_Add(live_gallery_t* pGallery, const unsigned char* pFmd, unsigned int nFmdSize, unsigned int* pnId);
+
+//removed FMDs stay in the arrays as tombstones, they are filtered out of the candidates until compacted
+int  LiveGallery_Remove(live_gallery_t* pGallery, unsigned int nId);
+
+//rebuilds the arrays without the tombstones; meant to run periodically on a background thread,
+//searches keep going on the older snapshots meanwhile
+int  LiveGallery_Compact(live_gallery_t* pGallery);
+
+int  LiveGallery_Identify(live_gallery_t* pGallery, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx,
+	unsigned int nThreshold, unsigned int* pnCandidateCnt, gallery_candidate_t* pCandidates);
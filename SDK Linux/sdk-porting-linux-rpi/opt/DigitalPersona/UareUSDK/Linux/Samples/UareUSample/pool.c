@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "pool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//takes tasks until there is none left, must be called with the mutex locked
+static void run_tasks(pool_t* pPool){
+	while(pPool->nNextTask < pPool->nTaskCnt){
+		unsigned int nTask = pPool->nNextTask++;
+		pool_task_t pfnTask = pPool->pfnTask;
+		void* pContext = pPool->pContext;
+
+		pthread_mutex_unlock(&pPool->mutex);
+		pfnTask(pContext, nTask);
+		pthread_mutex_lock(&pPool->mutex);
+
+		pPool->nDoneCnt++;
+		if(pPool->nDoneCnt == pPool->nTaskCnt) pthread_cond_broadcast(&pPool->condDone);
+	}
+}
+
+static void* worker_thread(void* pArg){
+	pool_t* pPool = (pool_t*)pArg;
+
+	pthread_mutex_lock(&pPool->mutex);
+	while(!pPool->bStop){
+		if(pPool->nNextTask < pPool->nTaskCnt) run_tasks(pPool);
+		else pthread_cond_wait(&pPool->condWork, &pPool->mutex);
+	}
+	pthread_mutex_unlock(&pPool->mutex);
+	return NULL;
+}
+
+int Pool_Create(unsigned int nThreadCnt, pool_t** ppPool){
+	if(NULL == ppPool) return EINVAL;
+	*ppPool = NULL;
+
+	if(0 == nThreadCnt){
+		long nCpuCnt = sysconf(_SC_NPROCESSORS_ONLN);
+		nThreadCnt = (0 < nCpuCnt) ? (unsigned int)nCpuCnt : 1;
+	}
+
+	pool_t* pPool = (pool_t*)calloc(1, sizeof(pool_t));
+	if(NULL == pPool) return ENOMEM;
+	pPool->vThreads = (pthread_t*)calloc(nThreadCnt, sizeof(pthread_t));
+	if(NULL == pPool->vThreads){
+		free(pPool);
+		return ENOMEM;
+	}
+	pthread_mutex_init(&pPool->mutex, NULL);
+	pthread_mutex_init(&pPool->mutexRun, NULL);
+	pthread_cond_init(&pPool->condWork, NULL);
+	pthread_cond_init(&pPool->condDone, NULL);
+
+	//calling thread takes part in every run, one worker less is needed
+	unsigned int i = 0;
+	for(i = 0; i < nThreadCnt - 1; i++){
+		int result = pthread_create(&pPool->vThreads[i], NULL, worker_thread, pPool);
+		if(0 != result){
+			Pool_Destroy(pPool);
+			return result;
+		}
+		pPool->nThreadCnt++;
+	}
+
+	*ppPool = pPool;
+	return 0;
+}
+
+void Pool_Destroy(pool_t* pPool){
+	if(NULL == pPool) return;
+
+	pthread_mutex_lock(&pPool->mutex);
+	pPool->bStop = 1;
+	pthread_cond_broadcast(&pPool->condWork);
+	pthread_mutex_unlock(&pPool->mutex);
+
+	unsigned int i = 0;
+	for(i = 0; i < pPool->nThreadCnt; i++){
+		pthread_join(pPool->vThreads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pPool->condDone);
+	pthread_cond_destroy(&pPool->condWork);
+	pthread_mutex_destroy(&pPool->mutexRun);
+	pthread_mutex_destroy(&pPool->mutex);
+	free(pPool->vThreads);
+	free(pPool);
+}
+
+unsigned int Pool_GetThreadCnt(pool_t* pPool){
+	if(NULL == pPool) return 1;
+	return pPool->nThreadCnt + 1;
+}
+
+int Pool_Run(pool_t* pPool, unsigned int nTaskCnt, pool_task_t pfnTask, void* pContext){
+	if(NULL == pfnTask) return EINVAL;
+	if(0 == nTaskCnt) return 0;
+
+	if(NULL == pPool){
+		unsigned int i = 0;
+		for(i = 0; i < nTaskCnt; i++){
+			pfnTask(pContext, i);
+		}
+		return 0;
+	}
+
+	pthread_mutex_lock(&pPool->mutexRun);
+	pthread_mutex_lock(&pPool->mutex);
+
+	pPool->pfnTask = pfnTask;
+	pPool->pContext = pContext;
+	pPool->nTaskCnt = nTaskCnt;
+	pPool->nNextTask = 0;
+	pPool->nDoneCnt = 0;
+	pthread_cond_broadcast(&pPool->condWork);
+
+	run_tasks(pPool);
+	while(pPool->nDoneCnt < pPool->nTaskCnt){
+		pthread_cond_wait(&pPool->condDone, &pPool->mutex);
+	}
+
+	pPool->nTaskCnt = 0;
+	pPool->nNextTask = 0;
+	pPool->pfnTask = NULL;
+	pPool->pContext = NULL;
+
+	pthread_mutex_unlock(&pPool->mutex);
+	pthread_mutex_unlock(&pPool->mutexRun);
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+//task is called once for every index from 0 to task count - 1
+typedef void (*pool_task_t)(void* pContext, unsigned int nTask);
+
+//fixed set of worker threads; tasks of a run are handed out one at a time to whichever
+//thread is free, so threads which finish early keep taking the remaining tasks
+typedef struct {
+	pthread_t*      vThreads;
+	unsigned int    nThreadCnt;
+	pthread_mutex_t mutex;
+	pthread_mutex_t mutexRun;  //serializes Pool_Run() calls
+	pthread_cond_t  condWork;
+	pthread_cond_t  condDone;
+	pool_task_t     pfnTask;
+	void*           pContext;
+	unsigned int    nTaskCnt;
+	unsigned int    nNextTask;
+	unsigned int    nDoneCnt;
+	int             bStop;
+} pool_t;
+
+//nThreadCnt of 0 creates one thread per online CPU
+int  Pool_Create(unsigned int nThreadCnt, pool_t** ppPool);
+void Pool_Destroy(pool_t* pPool);
+unsigned int Pool_GetThreadCnt(pool_t* pPool);
+
+//runs all tasks and returns when they are finished, calling thread runs tasks as well;
+//without a pool all tasks are run on the calling thread
+int  Pool_Run(pool_t* pPool, unsigned int nTaskCnt, pool_task_t pfnTask, void* pContext);
@@ -0,0 +1,506 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "readermanager.h"
+#include "asynccapture.h"
+
+#include <errno.h>
+#include <linux/netlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define UEVENT_BUFFER_SIZE 8192
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// completion queue, must be called with the mutex locked
+
+static void queue_push(reader_manager_t* pManager, reader_capture_t* pCapture){
+	pCapture->pNext = NULL;
+	if(NULL != pManager->pTail) pManager->pTail->pNext = pCapture;
+	else{
+		pManager->pHead = pCapture;
+		AsyncCapture_SetEvent(pManager->fdEvent);
+	}
+	pManager->pTail = pCapture;
+	pthread_cond_signal(&pManager->condQueue);
+}
+
+static reader_capture_t* queue_pop(reader_manager_t* pManager){
+	reader_capture_t* pCapture = pManager->pHead;
+	if(NULL != pCapture){
+		pManager->pHead = pCapture->pNext;
+		if(NULL == pManager->pHead){
+			pManager->pTail = NULL;
+			AsyncCapture_ResetEvent(pManager->fdEvent);
+		}
+		pCapture->pNext = NULL;
+	}
+	return pCapture;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// captures
+
+//called by the library on its own thread; the image is copied, the library buffer is not guaranteed to outlive the call
+static void DPAPICALL capture_callback(void* pContext, unsigned int nReserved, unsigned int nDataSize, void* pData){
+	manager_reader_t* pReader = (manager_reader_t*)pContext;
+	reader_manager_t* pManager = pReader->pManager;
+	DPFPDD_CAPTURE_CALLBACK_DATA_0* pCallbackData = (DPFPDD_CAPTURE_CALLBACK_DATA_0*)pData;
+	(void)nReserved;
+
+	int nResult = DPFPDD_E_FAILURE;
+	unsigned int nImageSize = 0;
+	if(NULL != pCallbackData && sizeof(DPFPDD_CAPTURE_CALLBACK_DATA_0) <= nDataSize){
+		nResult = pCallbackData->error;
+		if(DPFPDD_SUCCESS == nResult && NULL != pCallbackData->image_data) nImageSize = pCallbackData->image_size;
+	}
+
+	reader_capture_t* pCapture = (reader_capture_t*)malloc(sizeof(reader_capture_t) + nImageSize);
+	if(NULL == pCapture && 0 != nImageSize){
+		//report the failure without the image rather than lose the reader silently
+		pCapture = (reader_capture_t*)malloc(sizeof(reader_capture_t));
+		nResult = ENOMEM;
+		nImageSize = 0;
+	}
+	if(NULL != pCapture){
+		memset(pCapture, 0, sizeof(reader_capture_t));
+		pCapture->nReaderIdx = pReader->nIdx;
+		pCapture->nResult = nResult;
+		if(DPFPDD_SUCCESS == nResult) pCapture->result = pCallbackData->capture_result;
+		pCapture->nImageSize = nImageSize;
+		if(0 != nImageSize) memcpy(pCapture->vImage, pCallbackData->image_data, nImageSize);
+	}
+
+	pthread_mutex_lock(&pManager->mutex);
+	pReader->bArmed = 0;
+	pReader->bFailed = (DPFPDD_SUCCESS != nResult && ENOMEM != nResult);
+	pManager->nPendingCnt--;
+	if(NULL != pCapture && !pManager->bStop){
+		queue_push(pManager, pCapture);
+		pCapture = NULL;
+	}
+	pthread_cond_broadcast(&pManager->condArmed);
+	pthread_mutex_unlock(&pManager->mutex);
+
+	if(NULL != pCapture) free(pCapture);
+}
+
+static int arm_reader(reader_manager_t* pManager, manager_reader_t* pReader){
+	if(NULL == pReader->hReader) return ENODEV;
+
+	//marked as armed before the capture is started, the callback can come before dpfpdd_capture_async() returns
+	pthread_mutex_lock(&pManager->mutex);
+	if(pManager->bStop || pReader->bArmed){
+		pthread_mutex_unlock(&pManager->mutex);
+		return pManager->bStop ? ECANCELED : 0;
+	}
+	pReader->bArmed = 1;
+	pManager->nPendingCnt++;
+	pthread_mutex_unlock(&pManager->mutex);
+
+	int result = dpfpdd_capture_async(pReader->hReader, &pManager->cparam, pReader, capture_callback);
+	if(DPFPDD_SUCCESS != result){
+		pthread_mutex_lock(&pManager->mutex);
+		pReader->bArmed = 0;
+		pReader->bFailed = (DPFPDD_E_DEVICE_BUSY != result);
+		pManager->nPendingCnt--;
+		pthread_cond_broadcast(&pManager->condArmed);
+		pthread_mutex_unlock(&pManager->mutex);
+	}
+	return result;
+}
+
+//cancels the capture of the reader and waits for it to be called back
+static int disarm_reader(reader_manager_t* pManager, manager_reader_t* pReader, const struct timespec* pDeadline){
+	return AsyncCapture_Cancel(&pManager->mutex, &pManager->condArmed, pReader->hReader, &pReader->bArmed, pDeadline);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// readers
+
+//enumerates the readers, vInfo is allocated with malloc()
+static int query_readers(DPFPDD_DEV_INFO** pvInfo, unsigned int* pnCnt){
+	unsigned int nCnt = 1;
+	DPFPDD_DEV_INFO* vInfo = NULL;
+	while(1){
+		DPFPDD_DEV_INFO* vNewInfo = (DPFPDD_DEV_INFO*)realloc(vInfo, sizeof(DPFPDD_DEV_INFO) * nCnt);
+		if(NULL == vNewInfo){
+			if(NULL != vInfo) free(vInfo);
+			return ENOMEM;
+		}
+		vInfo = vNewInfo;
+		unsigned int i = 0;
+		for(i = 0; i < nCnt; i++) vInfo[i].size = sizeof(DPFPDD_DEV_INFO);
+
+		unsigned int nNewCnt = nCnt;
+		int result = dpfpdd_query_devices(&nNewCnt, vInfo);
+		if(DPFPDD_E_MORE_DATA == result){
+			nCnt = nNewCnt;
+			continue;
+		}
+		if(DPFPDD_SUCCESS != result){
+			free(vInfo);
+			return result;
+		}
+		*pvInfo = vInfo;
+		*pnCnt = nNewCnt;
+		return 0;
+	}
+}
+
+static manager_reader_t* find_reader(reader_manager_t* pManager, const char* szName){
+	unsigned int i = 0;
+	for(i = 0; i < pManager->nReaderCnt; i++){
+		if(0 == strcmp(pManager->vReader[i]->szName, szName)) return pManager->vReader[i];
+	}
+	return NULL;
+}
+
+static manager_reader_t* add_reader(reader_manager_t* pManager, const char* szName){
+	if(pManager->nReaderCnt == pManager->nReaderAlloc){
+		unsigned int nAlloc = (0 != pManager->nReaderAlloc) ? 2 * pManager->nReaderAlloc : 16;
+		manager_reader_t** vReader = (manager_reader_t**)realloc(pManager->vReader, sizeof(manager_reader_t*) * nAlloc);
+		if(NULL == vReader) return NULL;
+		pManager->vReader = vReader;
+		pManager->nReaderAlloc = nAlloc;
+	}
+
+	manager_reader_t* pReader = (manager_reader_t*)calloc(1, sizeof(manager_reader_t));
+	if(NULL == pReader) return NULL;
+	pReader->pManager = pManager;
+	pReader->nIdx = pManager->nReaderCnt;
+	strncpy(pReader->szName, szName, sizeof(pReader->szName) - 1);
+	pManager->vReader[pManager->nReaderCnt++] = pReader;
+	return pReader;
+}
+
+static void close_reader(reader_manager_t* pManager, manager_reader_t* pReader){
+	if(NULL != pManager->pfnPnp) pManager->pfnPnp(pManager->pPnpContext, pReader->nIdx, pReader->szName, 0);
+
+	struct timespec deadline;
+	AsyncCapture_Deadline(READER_MANAGER_STOP_TIMEOUT_MS, &deadline);
+	disarm_reader(pManager, pReader, &deadline);
+
+	dpfpdd_close(pReader->hReader);
+	pReader->hReader = NULL;
+}
+
+static int open_reader(reader_manager_t* pManager, manager_reader_t* pReader){
+	int result = dpfpdd_open(pReader->szName, &pReader->hReader);
+	if(DPFPDD_SUCCESS != result){
+		pReader->hReader = NULL;
+		return result;
+	}
+	pReader->bFailed = 0;
+	if(NULL != pManager->pfnPnp) pManager->pfnPnp(pManager->pPnpContext, pReader->nIdx, pReader->szName, 1);
+
+	//readers plugged in while the manager runs start capturing right away
+	arm_reader(pManager, pReader);
+	return 0;
+}
+
+static int refresh_readers(reader_manager_t* pManager, unsigned int* pnOpenedCnt, unsigned int* pnClosedCnt){
+	DPFPDD_DEV_INFO* vInfo = NULL;
+	unsigned int nInfoCnt = 0;
+	int result = query_readers(&vInfo, &nInfoCnt);
+	if(0 != result) return result;
+
+	unsigned int i = 0;
+	for(i = 0; i < pManager->nReaderCnt; i++) pManager->vReader[i]->bListed = 0;
+	for(i = 0; i < nInfoCnt; i++){
+		manager_reader_t* pReader = find_reader(pManager, vInfo[i].name);
+		if(NULL == pReader) pReader = add_reader(pManager, vInfo[i].name);
+		if(NULL == pReader){
+			result = ENOMEM;
+			break;
+		}
+		pReader->bListed = 1;
+	}
+	free(vInfo);
+	//the readers after the failed one are not marked as listed, closing the unlisted ones would close them too;
+	//nothing is closed or opened, the next refresh tries again
+	if(0 != result) return result;
+
+	//readers gone, and readers whose capture failed: a reader unplugged and plugged in again keeps its name,
+	//but its old handle does not work anymore
+	for(i = 0; i < pManager->nReaderCnt; i++){
+		manager_reader_t* pReader = pManager->vReader[i];
+		if(NULL == pReader->hReader) continue;
+
+		pthread_mutex_lock(&pManager->mutex);
+		int bFailed = pReader->bFailed && !pReader->bArmed;
+		pthread_mutex_unlock(&pManager->mutex);
+		if(pReader->bListed && !bFailed) continue;
+
+		close_reader(pManager, pReader);
+		(*pnClosedCnt)++;
+	}
+
+	//readers plugged in, a reader which fails to open is tried again on the next refresh
+	for(i = 0; i < pManager->nReaderCnt; i++){
+		manager_reader_t* pReader = pManager->vReader[i];
+		if(!pReader->bListed || NULL != pReader->hReader) continue;
+		if(0 == open_reader(pManager, pReader)) (*pnOpenedCnt)++;
+	}
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// uevents
+
+//socket receiving the uevents of the kernel, not the ones udev sends again after processing them
+static int open_uevent_socket(void){
+	int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+	if(-1 == fd) return -1;
+
+	struct sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1;
+	if(0 != bind(fd, (struct sockaddr*)&addr, sizeof(addr))){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+//uevent is "action@devpath" followed by KEY=value strings; a reader is a USB device with the vendor ID of the readers,
+//returns 1 if plugged in, -1 if plugged out, 0 for everything else
+static int parse_uevent(const char* pEvent, size_t nSize){
+	int bUsbDevice = 0;
+	int bReader = 0;
+	int nAction = 0;
+	const char* szKey = pEvent + strlen(pEvent) + 1;
+	while(szKey < pEvent + nSize){
+		if(0 == strcmp(szKey, "ACTION=add")) nAction = 1;
+		else if(0 == strcmp(szKey, "ACTION=remove")) nAction = -1;
+		else if(0 == strcmp(szKey, "DEVTYPE=usb_device")) bUsbDevice = 1;
+		else if(0 == strncmp(szKey, "PRODUCT=" READER_MANAGER_USB_VENDOR, strlen("PRODUCT=" READER_MANAGER_USB_VENDOR))) bReader = 1;
+		szKey += strlen(szKey) + 1;
+	}
+	return (bUsbDevice && bReader) ? nAction : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// reader manager
+
+int ReaderManager_Create(const DPFPDD_CAPTURE_PARAM* pParam, reader_manager_t** ppManager){
+	if(NULL == pParam || NULL == ppManager) return EINVAL;
+	*ppManager = NULL;
+
+	reader_manager_t* pManager = (reader_manager_t*)calloc(1, sizeof(reader_manager_t));
+	if(NULL == pManager) return ENOMEM;
+	pManager->fdEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(-1 == pManager->fdEvent){
+		int result = errno;
+		free(pManager);
+		return result;
+	}
+	pthread_mutex_init(&pManager->mutex, NULL);
+	pthread_cond_init(&pManager->condQueue, NULL);
+	pthread_cond_init(&pManager->condArmed, NULL);
+	pManager->cparam = *pParam;
+	pManager->cparam.size = sizeof(DPFPDD_CAPTURE_PARAM);
+	pManager->bStop = 1;
+
+	//subscribed before the readers are listed, so a reader plugged in meanwhile is not missed
+	pManager->fdPnp = open_uevent_socket();
+
+	unsigned int nOpenedCnt = 0;
+	unsigned int nClosedCnt = 0;
+	int result = refresh_readers(pManager, &nOpenedCnt, &nClosedCnt);
+	if(0 != result){
+		ReaderManager_Destroy(pManager);
+		return result;
+	}
+	*ppManager = pManager;
+	return 0;
+}
+
+void ReaderManager_Destroy(reader_manager_t* pManager){
+	if(NULL == pManager) return;
+	ReaderManager_Stop(pManager);
+
+	//a capture not called back in time, also one of a reader closed meanwhile, has its reader and the manager as
+	//the context, a late callback must not find them freed: the readers still armed are not closed, and the manager
+	//is left allocated
+	int bLeak = 0;
+	unsigned int i = 0;
+	for(i = 0; i < pManager->nReaderCnt; i++){
+		manager_reader_t* pReader = pManager->vReader[i];
+		pthread_mutex_lock(&pManager->mutex);
+		int bArmed = pReader->bArmed;
+		pthread_mutex_unlock(&pManager->mutex);
+		if(bArmed) bLeak = 1;
+		else if(NULL != pReader->hReader) dpfpdd_close(pReader->hReader);
+	}
+	for(i = 0; !bLeak && i < pManager->nReaderCnt; i++) free(pManager->vReader[i]);
+
+	//bStop is set, late callbacks do not queue anything
+	pthread_mutex_lock(&pManager->mutex);
+	reader_capture_t* pCapture = NULL;
+	while(NULL != (pCapture = queue_pop(pManager))) free(pCapture);
+	pthread_mutex_unlock(&pManager->mutex);
+
+	if(-1 != pManager->fdPnp) close(pManager->fdPnp);
+	if(bLeak) return;
+	close(pManager->fdEvent);
+	pthread_cond_destroy(&pManager->condArmed);
+	pthread_cond_destroy(&pManager->condQueue);
+	pthread_mutex_destroy(&pManager->mutex);
+	if(NULL != pManager->vReader) free(pManager->vReader);
+	free(pManager);
+}
+
+int ReaderManager_Start(reader_manager_t* pManager){
+	if(NULL == pManager) return EINVAL;
+
+	pthread_mutex_lock(&pManager->mutex);
+	pManager->bStop = 0;
+	pthread_mutex_unlock(&pManager->mutex);
+
+	int result = 0;
+	unsigned int nArmedCnt = 0;
+	unsigned int i = 0;
+	for(i = 0; i < pManager->nReaderCnt; i++){
+		if(NULL == pManager->vReader[i]->hReader) continue;
+		int res = arm_reader(pManager, pManager->vReader[i]);
+		if(0 == res) nArmedCnt++;
+		else result = res;
+	}
+	return (0 != nArmedCnt) ? 0 : result;
+}
+
+int ReaderManager_Arm(reader_manager_t* pManager, unsigned int nReaderIdx){
+	if(NULL == pManager || nReaderIdx >= pManager->nReaderCnt) return EINVAL;
+	return arm_reader(pManager, pManager->vReader[nReaderIdx]);
+}
+
+int ReaderManager_Stop(reader_manager_t* pManager){
+	if(NULL == pManager) return EINVAL;
+
+	pthread_mutex_lock(&pManager->mutex);
+	pManager->bStop = 1;
+	pthread_mutex_unlock(&pManager->mutex);
+
+	//no reader is armed anymore once bStop is set, one deadline for all the readers
+	struct timespec deadline;
+	AsyncCapture_Deadline(READER_MANAGER_STOP_TIMEOUT_MS, &deadline);
+	int result = 0;
+	unsigned int i = 0;
+	for(i = 0; i < pManager->nReaderCnt; i++){
+		if(NULL == pManager->vReader[i]->hReader) continue;
+		if(0 != disarm_reader(pManager, pManager->vReader[i], &deadline)) result = ETIMEDOUT;
+	}
+	return result;
+}
+
+int ReaderManager_GetEventFd(reader_manager_t* pManager){
+	return (NULL != pManager) ? pManager->fdEvent : -1;
+}
+
+int ReaderManager_Wait(reader_manager_t* pManager, int nTimeoutMs, reader_capture_t** ppCapture){
+	if(NULL == pManager || NULL == ppCapture) return EINVAL;
+	*ppCapture = NULL;
+
+	struct timespec deadline;
+	if(0 < nTimeoutMs) AsyncCapture_Deadline(nTimeoutMs, &deadline);
+
+	int result = 0;
+	pthread_mutex_lock(&pManager->mutex);
+	while(NULL == pManager->pHead && 0 == result){
+		if(0 == nTimeoutMs) result = ETIMEDOUT;
+		else if(0 > nTimeoutMs) pthread_cond_wait(&pManager->condQueue, &pManager->mutex);
+		else result = pthread_cond_timedwait(&pManager->condQueue, &pManager->mutex, &deadline);
+	}
+	reader_capture_t* pCapture = queue_pop(pManager);
+	pthread_mutex_unlock(&pManager->mutex);
+	if(NULL == pCapture) return result;
+
+	//next capture on the reader, a failed one is left to the caller to rearm or to the next refresh to reopen
+	if(0 == pCapture->nResult) arm_reader(pManager, pManager->vReader[pCapture->nReaderIdx]);
+
+	*ppCapture = pCapture;
+	return 0;
+}
+
+void ReaderManager_FreeCapture(reader_capture_t* pCapture){
+	if(NULL != pCapture) free(pCapture);
+}
+
+void ReaderManager_SetPnpCallback(reader_manager_t* pManager, reader_pnp_callback_t pfnPnp, void* pContext){
+	if(NULL == pManager) return;
+	pManager->pfnPnp = pfnPnp;
+	pManager->pPnpContext = pContext;
+}
+
+int ReaderManager_GetPnpFd(reader_manager_t* pManager){
+	return (NULL != pManager) ? pManager->fdPnp : -1;
+}
+
+int ReaderManager_HandlePnp(reader_manager_t* pManager){
+	if(NULL == pManager) return EINVAL;
+	if(-1 == pManager->fdPnp) return ReaderManager_Refresh(pManager, NULL);
+
+	//readers plugged in and out since the last call
+	unsigned int nAddCnt = 0;
+	unsigned int nRemoveCnt = 0;
+	int bLost = 0;
+	char vEvent[UEVENT_BUFFER_SIZE];
+	while(1){
+		struct sockaddr_nl addr;
+		socklen_t nAddrSize = sizeof(addr);
+		ssize_t nSize = recvfrom(pManager->fdPnp, vEvent, sizeof(vEvent) - 1, 0, (struct sockaddr*)&addr, &nAddrSize);
+		if(0 > nSize){
+			if(EINTR == errno) continue;
+			//uevents were dropped when the socket buffer overflowed, the readers are refreshed to catch up
+			if(ENOBUFS == errno){
+				bLost = 1;
+				continue;
+			}
+			if(EAGAIN == errno || EWOULDBLOCK == errno) break;
+			return errno;
+		}
+		//only the kernel sends the uevents
+		if(0 != addr.nl_pid || 0 == nSize) continue;
+		vEvent[nSize] = '\0';
+
+		int nAction = parse_uevent(vEvent, (size_t)nSize);
+		if(0 < nAction) nAddCnt++;
+		if(0 > nAction) nRemoveCnt++;
+	}
+	if(0 == nAddCnt && 0 == nRemoveCnt && !bLost) return 0;
+
+	//the library learns of the readers through its own device manager, it may lag behind the kernel
+	unsigned int nOpenedCnt = 0;
+	unsigned int nClosedCnt = 0;
+	int result = 0;
+	unsigned int nTry = 0;
+	for(nTry = 0; nTry < READER_MANAGER_SETTLE_TRIES; nTry++){
+		result = refresh_readers(pManager, &nOpenedCnt, &nClosedCnt);
+		if(0 != result || (nOpenedCnt >= nAddCnt && nClosedCnt >= nRemoveCnt)) break;
+
+		struct timespec ts;
+		ts.tv_sec = 0;
+		ts.tv_nsec = (long)READER_MANAGER_SETTLE_MS * 1000000;
+		nanosleep(&ts, NULL);
+	}
+	return result;
+}
+
+int ReaderManager_Refresh(reader_manager_t* pManager, unsigned int* pnChangeCnt){
+	if(NULL == pManager) return EINVAL;
+
+	unsigned int nOpenedCnt = 0;
+	unsigned int nClosedCnt = 0;
+	int result = refresh_readers(pManager, &nOpenedCnt, &nClosedCnt);
+	if(NULL != pnChangeCnt) *pnChangeCnt = nOpenedCnt + nClosedCnt;
+	return result;
+}
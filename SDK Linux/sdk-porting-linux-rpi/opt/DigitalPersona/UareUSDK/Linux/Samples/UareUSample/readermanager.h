@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfpdd.h>
+
+#include <pthread.h>
+
+//how long ReaderManager_Stop() waits for the canceled captures to be called back
+#define READER_MANAGER_STOP_TIMEOUT_MS 2000
+
+//after a reader is plugged in or out the library needs a moment to update its list of readers,
+//the list is read again at this interval until it changes, at most the given number of times
+#define READER_MANAGER_SETTLE_MS    50
+#define READER_MANAGER_SETTLE_TRIES 20
+
+//USB vendor ID of the readers, as the kernel puts it into the PRODUCT key of the uevents
+#define READER_MANAGER_USB_VENDOR "5ba/"
+
+//completed capture of one of the readers, owned by the caller once it is taken from the queue
+typedef struct reader_capture {
+	struct reader_capture* pNext;
+	unsigned int          nReaderIdx;   //index of the reader in the manager
+	int                   nResult;      //0 or error code of the capture, the reader is not rearmed after an error
+	DPFPDD_CAPTURE_RESULT result;
+	unsigned int          nImageSize;   //0 if no image was captured
+	unsigned char         vImage[];
+} reader_capture_t;
+
+struct reader_manager;
+
+//a reader keeps its index when it is unplugged, and gets it back when it is plugged in again under the same name;
+//the library calls back with the reader as the context, so the readers are allocated one by one and never move
+typedef struct {
+	struct reader_manager* pManager;
+	unsigned int           nIdx;
+	DPFPDD_DEV             hReader;     //NULL while the reader is unplugged
+	char                   szName[MAX_DEVICE_NAME_LENGTH];
+	int                    bArmed;      //capture started and not called back yet
+	int                    bFailed;     //last capture failed, the reader is reopened on the next refresh
+	int                    bListed;     //found in the last list of readers
+} manager_reader_t;
+
+//called on the thread which calls ReaderManager_Refresh() or ReaderManager_HandlePnp(), after the reader is opened
+//or before it is closed
+typedef void (*reader_pnp_callback_t)(void* pContext, unsigned int nReaderIdx, const char* szName, int bArrived);
+
+//captures on all the readers attached, e.g. an access-control server with a dozen of readers on USB hubs: every reader
+//runs an asynchronous capture, the library calls back when a finger is captured and the result goes to a single
+//completion queue; no thread waits on a reader, the application takes the captures from the queue on its own thread,
+//either blocking in ReaderManager_Wait() or polling the event descriptor in its event loop; a reader is armed again
+//when its capture is taken from the queue, so a reader has at most one capture queued
+//
+//readers plugged in or out are followed through the kernel uevents: the device manager of the library keeps the
+//usbdpfpPnp node open and the driver lets only one process open it, so the manager listens to the USB uevents of
+//the readers instead and reads the list of readers of the library only when one of them comes or goes;
+//the manager is driven from one thread, only the library callbacks come from other threads
+typedef struct reader_manager {
+	pthread_mutex_t       mutex;
+	pthread_cond_t        condQueue;     //signaled when a capture is queued
+	pthread_cond_t        condArmed;     //signaled when a capture is called back
+	DPFPDD_CAPTURE_PARAM  cparam;
+	manager_reader_t**    vReader;
+	unsigned int          nReaderCnt;
+	unsigned int          nReaderAlloc;
+	unsigned int          nPendingCnt;   //readers armed
+	reader_capture_t*     pHead;
+	reader_capture_t*     pTail;
+	int                   fdEvent;       //eventfd, readable while the queue is not empty
+	int                   fdPnp;         //uevent socket, -1 if the uevents cannot be received
+	reader_pnp_callback_t pfnPnp;
+	void*                 pPnpContext;
+	int                   bStop;         //set until ReaderManager_Start() and after ReaderManager_Stop()
+} reader_manager_t;
+
+//all functions return 0 on success, otherwise DPFPDD error code or errno
+
+//opens every reader dpfpdd_query_devices() returns, readers which fail to open are tried again on the next refresh;
+//the manager is created with no readers at all as well, they are added when plugged in
+int  ReaderManager_Create(const DPFPDD_CAPTURE_PARAM* pParam, reader_manager_t** ppManager);
+//stops the captures and closes the readers, captures still queued are freed; if a capture is not called back within
+//READER_MANAGER_STOP_TIMEOUT_MS its reader is left open and the manager allocated, the library may still call back
+void ReaderManager_Destroy(reader_manager_t* pManager);
+
+//arms all the readers, fails only if there are readers and none of them could be armed
+int  ReaderManager_Start(reader_manager_t* pManager);
+//arms one reader again, e.g. after its capture failed; ENODEV is returned if the reader is unplugged
+int  ReaderManager_Arm(reader_manager_t* pManager, unsigned int nReaderIdx);
+//cancels the captures and waits for them to be called back; captures completed meanwhile are dropped;
+//ETIMEDOUT is returned if a capture is not called back within READER_MANAGER_STOP_TIMEOUT_MS
+int  ReaderManager_Stop(reader_manager_t* pManager);
+
+//descriptor for poll() or epoll, readable while captures are queued; the captures are taken by ReaderManager_Wait()
+int  ReaderManager_GetEventFd(reader_manager_t* pManager);
+
+//takes the next capture from the queue and arms its reader again; nTimeoutMs of -1 waits forever, 0 does not wait;
+//ETIMEDOUT is returned if no capture completed in time
+int  ReaderManager_Wait(reader_manager_t* pManager, int nTimeoutMs, reader_capture_t** ppCapture);
+void ReaderManager_FreeCapture(reader_capture_t* pCapture);
+
+//subscribes to the readers plugged in and out, pfnPnp of NULL unsubscribes
+void ReaderManager_SetPnpCallback(reader_manager_t* pManager, reader_pnp_callback_t pfnPnp, void* pContext);
+//descriptor for poll() or epoll, readable when the kernel reports USB devices plugged in or out;
+//-1 if the uevents cannot be received, ReaderManager_Refresh() has to be called by the application then
+int  ReaderManager_GetPnpFd(reader_manager_t* pManager);
+//reads the uevents and, if a reader came or went, refreshes the readers; blocks for up to
+//READER_MANAGER_SETTLE_TRIES * READER_MANAGER_SETTLE_MS while the library catches up
+int  ReaderManager_HandlePnp(reader_manager_t* pManager);
+//reads the list of readers, opens and arms the readers plugged in, closes the readers gone and reopens the readers
+//whose capture failed, e.g. unplugged and plugged in again in between; pnChangeCnt receives the number of readers
+//opened or closed, it can be NULL
+int  ReaderManager_Refresh(reader_manager_t* pManager, unsigned int* pnChangeCnt);
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "record.h"
+
+#include <string.h>
+
+//records are big endian
+static unsigned int read_be(const unsigned char* p, unsigned int nBytes){
+	unsigned int n = 0;
+	unsigned int i = 0;
+	for(i = 0; i < nBytes; i++) n = (n << 8) | p[i];
+	return n;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FMD
+
+int FmdRecord_Parse(fmd_record_t* pRecord, DPFJ_FMD_FORMAT nType, const unsigned char* pData, unsigned int nSize){
+	if(NULL == pRecord || NULL == pData) return DPFJ_E_INVALID_PARAMETER;
+
+	//ANSI: 2-byte record length, or 2 zero bytes and 4-byte length when it does not fit; ISO: 4-byte record length, no CBEFF product id
+	unsigned int nHeaderSize = 0;
+	unsigned int nLength = 0;
+	unsigned int nPos = 0;
+	switch(nType){
+	case DPFJ_FMD_ANSI_378_2004:
+		nHeaderSize = DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH;
+		if(nHeaderSize > nSize) return DPFJ_E_INVALID_FMD;
+		nLength = read_be(pData + 8, 2);
+		nPos = 10;
+		if(0 == nLength){
+			nHeaderSize += 4;
+			if(nHeaderSize > nSize) return DPFJ_E_INVALID_FMD;
+			nLength = read_be(pData + 10, 4);
+			nPos = 14;
+		}
+		nPos += 4; //CBEFF product id
+		break;
+	case DPFJ_FMD_ISO_19794_2_2005:
+		nHeaderSize = DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH;
+		if(nHeaderSize > nSize) return DPFJ_E_INVALID_FMD;
+		nLength = read_be(pData + 8, 4);
+		nPos = 12;
+		break;
+	default: return DPFJ_E_INVALID_PARAMETER;
+	}
+	if(0 != memcmp(pData, "FMR\0", 4) || nLength != nSize) return DPFJ_E_INVALID_FMD;
+
+	pRecord->pData = pData;
+	pRecord->nSize = nSize;
+	pRecord->nType = nType;
+	nPos += 2; //capture equipment
+	pRecord->nWidth = read_be(pData + nPos, 2);
+	pRecord->nHeight = read_be(pData + nPos + 2, 2);
+	pRecord->nResolution = read_be(pData + nPos + 4, 2);
+	pRecord->nViewCnt = pData[nPos + 8];
+	if(0 == pRecord->nViewCnt) return DPFJ_E_INVALID_FMD;
+
+	//every view with its minutiae and extended data block must be within the record
+	nPos = nHeaderSize;
+	unsigned int i = 0;
+	for(i = 0; i < pRecord->nViewCnt; i++){
+		if(nPos + DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH > nSize) return DPFJ_E_INVALID_FMD;
+		pRecord->vViewOffset[i] = nPos;
+		nPos += DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH + pData[nPos + 3] * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH;
+		if(nPos + 2 > nSize) return DPFJ_E_INVALID_FMD;
+		nPos += 2 + read_be(pData + nPos, 2);
+		if(nPos > nSize) return DPFJ_E_INVALID_FMD;
+	}
+	return 0;
+}
+
+int FmdRecord_GetView(const fmd_record_t* pRecord, unsigned int nView, fmd_view_t* pView){
+	if(NULL == pRecord || NULL == pView || nView >= pRecord->nViewCnt) return DPFJ_E_INVALID_PARAMETER;
+
+	const unsigned char* p = pRecord->pData + pRecord->vViewOffset[nView];
+	pView->nFingerPos = p[0];
+	pView->nViewNumber = p[1] >> 4;
+	pView->nImpressionType = p[1] & 0x0f;
+	pView->nQuality = p[2];
+	pView->nMinutiaCnt = p[3];
+	pView->pMinutiae = p + DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH;
+	p = pView->pMinutiae + pView->nMinutiaCnt * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH;
+	pView->nExtBlockLength = read_be(p, 2);
+	pView->pExtBlock = (0 != pView->nExtBlockLength) ? p + 2 : NULL;
+	return 0;
+}
+
+void FmdView_GetMinutia(const fmd_view_t* pView, unsigned int nMinutia, fmd_minutia_t* pMinutia){
+	const unsigned char* p = pView->pMinutiae + nMinutia * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH;
+	pMinutia->nType = p[0] >> 6;
+	pMinutia->nX = read_be(p, 2) & 0x3fff;
+	pMinutia->nY = read_be(p + 2, 2) & 0x3fff;
+	pMinutia->nAngle = p[4];
+	pMinutia->nQuality = p[5];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FID
+
+int FidRecord_Parse(fid_record_t* pRecord, DPFJ_FID_FORMAT nType, const unsigned char* pData, unsigned int nSize){
+	if(NULL == pRecord || NULL == pData) return DPFJ_E_INVALID_PARAMETER;
+
+	//ANSI has the 4-byte CBEFF product id after the record length, ISO does not
+	unsigned int nHeaderSize = 0;
+	switch(nType){
+	case DPFJ_FID_ANSI_381_2004: nHeaderSize = DPFJ_FID_ANSI_381_2004_RECORD_HEADER_LENGTH; break;
+	case DPFJ_FID_ISO_19794_4_2005: nHeaderSize = DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH; break;
+	default: return DPFJ_E_INVALID_PARAMETER;
+	}
+	if(nHeaderSize > nSize || 0 != memcmp(pData, "FIR\0", 4)) return DPFJ_E_INVALID_FID;
+
+	//record length is 6 bytes, records over 4 GB are not supported
+	if(0 != read_be(pData + 8, 2) || read_be(pData + 10, 4) != nSize) return DPFJ_E_INVALID_FID;
+
+	pRecord->pData = pData;
+	pRecord->nSize = nSize;
+	pRecord->nType = nType;
+	const unsigned char* p = pData + nHeaderSize - 18; //fields from the capture device id on are the same in both
+	pRecord->nImageRes = read_be(p + 10, 2);
+	pRecord->nBpp = p[14];
+	pRecord->nCompression = p[15];
+
+	//views are chained by their lengths up to the end of the record
+	unsigned int nPos = nHeaderSize;
+	pRecord->nViewCnt = 0;
+	while(nPos < nSize){
+		if(RECORD_MAX_VIEWS == pRecord->nViewCnt) return DPFJ_E_INVALID_FID;
+		if(nPos + DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH > nSize) return DPFJ_E_INVALID_FID;
+		unsigned int nLength = read_be(pData + nPos, 4);
+		if(DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH > nLength || nSize - nPos < nLength) return DPFJ_E_INVALID_FID;
+		pRecord->vViewOffset[pRecord->nViewCnt++] = nPos;
+		nPos += nLength;
+	}
+	if(0 == pRecord->nViewCnt) return DPFJ_E_INVALID_FID;
+	return 0;
+}
+
+int FidRecord_GetView(const fid_record_t* pRecord, unsigned int nView, fid_view_t* pView){
+	if(NULL == pRecord || NULL == pView || nView >= pRecord->nViewCnt) return DPFJ_E_INVALID_PARAMETER;
+
+	const unsigned char* p = pRecord->pData + pRecord->vViewOffset[nView];
+	pView->nFingerPos = p[4];
+	pView->nViewNumber = p[6];
+	pView->nQuality = p[7];
+	pView->nImpressionType = p[8];
+	pView->nWidth = read_be(p + 9, 2);
+	pView->nHeight = read_be(p + 11, 2);
+	pView->pImage = p + DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH;
+	pView->nImageSize = read_be(p, 4) - DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH;
+	return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfj.h>
+
+//the view count of both FMD and FID records is a single byte
+#define RECORD_MAX_VIEWS 255
+
+//parsed ANSI 378-2004 or ISO 19794-2-2005 record: headers are walked and checked once by FmdRecord_Parse(),
+//then every view and every minutia is reached directly in the buffer; nothing is copied, the buffer
+//(caller-owned or mapped) must outlive the record
+typedef struct {
+	const unsigned char* pData;
+	unsigned int         nSize;
+	DPFJ_FMD_FORMAT      nType;
+	unsigned int         nWidth;
+	unsigned int         nHeight;
+	unsigned int         nResolution;
+	unsigned int         nViewCnt;
+	unsigned int         vViewOffset[RECORD_MAX_VIEWS];
+} fmd_record_t;
+
+typedef struct {
+	DPFJ_FINGER_POSITION nFingerPos;
+	unsigned int         nViewNumber;
+	DPFJ_SCAN_TYPE       nImpressionType;
+	unsigned int         nQuality;
+	unsigned int         nMinutiaCnt;
+	const unsigned char* pMinutiae;      //nMinutiaCnt * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH bytes
+	unsigned int         nExtBlockLength;
+	const unsigned char* pExtBlock;
+} fmd_view_t;
+
+typedef struct {
+	unsigned int nType;    //0 - other, 1 - ridge ending, 2 - bifurcation
+	unsigned int nX;
+	unsigned int nY;
+	unsigned int nAngle;   //in units of 2 degrees
+	unsigned int nQuality;
+} fmd_minutia_t;
+
+//parsed ANSI 381-2004 or ISO 19794-4-2005 record, the same way
+typedef struct {
+	const unsigned char* pData;
+	unsigned int         nSize;
+	DPFJ_FID_FORMAT      nType;
+	unsigned int         nImageRes;
+	unsigned int         nBpp;
+	unsigned int         nCompression;
+	unsigned int         nViewCnt;
+	unsigned int         vViewOffset[RECORD_MAX_VIEWS];
+} fid_record_t;
+
+typedef struct {
+	DPFJ_FINGER_POSITION nFingerPos;
+	unsigned int         nViewNumber;
+	unsigned int         nQuality;
+	DPFJ_SCAN_TYPE       nImpressionType;
+	unsigned int         nWidth;
+	unsigned int         nHeight;
+	const unsigned char* pImage;
+	unsigned int         nImageSize;
+} fid_view_t;
+
+//parse functions return 0 on success, otherwise DPFJ_E_INVALID_FMD, DPFJ_E_INVALID_FID or DPFJ_E_INVALID_PARAMETER;
+//the getters do no checks beyond the index, the record has been checked when parsed
+int FmdRecord_Parse(fmd_record_t* pRecord, DPFJ_FMD_FORMAT nType, const unsigned char* pData, unsigned int nSize);
+int FmdRecord_GetView(const fmd_record_t* pRecord, unsigned int nView, fmd_view_t* pView);
+void FmdView_GetMinutia(const fmd_view_t* pView, unsigned int nMinutia, fmd_minutia_t* pMinutia);
+
+int FidRecord_Parse(fid_record_t* pRecord, DPFJ_FID_FORMAT nType, const unsigned char* pData, unsigned int nSize);
+int FidRecord_GetView(const fid_record_t* pRecord, unsigned int nView, fid_view_t* pView);
@@ -10,6 +10,7 @@
 #include "verification.h"
 #include "identification.h"
 #include "enrollment.h"
+#include "archival.h"
 
 #include <dpfpdd.h>
 
@@ -45,6 +46,7 @@ int main(int argc, char** argv){
 		if(0 == res) res = Menu_AddItem(pMenu, 102, "Run verification");
 		if(0 == res) res = Menu_AddItem(pMenu, 103, "Run identification");
 		if(0 == res) res = Menu_AddItem(pMenu, 104, "Run enrollment");
+		if(0 == res) res = Menu_AddItem(pMenu, 105, "Run WSQ archival of images");
 		if(0 == res){
 			//main menu loop
 			int bStop = 0;
@@ -95,6 +97,9 @@ int main(int argc, char** argv){
 							Enrollment(hReader);
 						}
 						break;
+					case 105: //run archival
+						Archival();
+						break;
 					case -2: //exit
 						bStop = 1;
 						break;
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "templatecache.h"
+#include "checksum.h"
+#include "record.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CACHE_MIN_BUCKET_BITS 8
+#define CACHE_MAX_BUCKET_BITS 24
+#define CACHE_ALLOC_OVERHEAD  16 //bookkeeping of malloc() for every block, accounted with the entry
+
+static unsigned int bucket_of(const template_cache_t* pCache, unsigned long long nKey){
+	//Fibonacci hashing, the ids are often sequential
+	return (unsigned int)((nKey * 11400714819323198485ull) >> (64 - pCache->nBucketBits));
+}
+
+static size_t entry_charge(unsigned int nFmdSize){
+	return (sizeof(template_entry_t) + nFmdSize + CACHE_ALLOC_OVERHEAD + 15) & ~(size_t)15;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// entries, all called with the mutex locked
+
+//content keys may collide, the data decides then
+static template_entry_t* find_entry(template_cache_t* pCache, unsigned long long nKey, unsigned int nKeyType,
+	DPFJ_FMD_FORMAT nFmdType, const unsigned char* pFmd, unsigned int nFmdSize){
+	template_entry_t* pEntry = pCache->vBucket[bucket_of(pCache, nKey)];
+	for(; NULL != pEntry; pEntry = pEntry->pHashNext){
+		if(pEntry->nKey != nKey || pEntry->nKeyType != nKeyType) continue;
+		if(TEMPLATE_CACHE_KEY_CONTENT == nKeyType && (pEntry->nFmdType != nFmdType || pEntry->nFmdSize != nFmdSize
+			|| 0 != memcmp(pEntry->vFmd, pFmd, nFmdSize))) continue;
+		return pEntry;
+	}
+	return NULL;
+}
+
+static void lru_unlink(template_cache_t* pCache, template_entry_t* pEntry){
+	if(NULL != pEntry->pLruPrev) pEntry->pLruPrev->pLruNext = pEntry->pLruNext;
+	else pCache->pLruHead = pEntry->pLruNext;
+	if(NULL != pEntry->pLruNext) pEntry->pLruNext->pLruPrev = pEntry->pLruPrev;
+	else pCache->pLruTail = pEntry->pLruPrev;
+	pEntry->pLruPrev = NULL;
+	pEntry->pLruNext = NULL;
+}
+
+static void lru_push_front(template_cache_t* pCache, template_entry_t* pEntry){
+	pEntry->pLruPrev = NULL;
+	pEntry->pLruNext = pCache->pLruHead;
+	if(NULL != pCache->pLruHead) pCache->pLruHead->pLruPrev = pEntry;
+	else pCache->pLruTail = pEntry;
+	pCache->pLruHead = pEntry;
+}
+
+static void unref_entry(template_cache_t* pCache, template_entry_t* pEntry){
+	pEntry->nRef--;
+	if(0 != pEntry->nRef) return;
+	pCache->nMemoryUsed -= pEntry->nCharge;
+	free(pEntry);
+}
+
+//takes the entry out of the table and the LRU list, it is freed once it is not pinned
+static void remove_entry(template_cache_t* pCache, template_entry_t* pEntry){
+	template_entry_t** ppLink = &pCache->vBucket[bucket_of(pCache, pEntry->nKey)];
+	while(*ppLink != pEntry) ppLink = &(*ppLink)->pHashNext;
+	*ppLink = pEntry->pHashNext;
+	pEntry->pHashNext = NULL;
+	lru_unlink(pCache, pEntry);
+	pCache->nEntryCnt--;
+	unref_entry(pCache, pEntry);
+}
+
+//evicts least recently used entries which are not pinned until nCharge more bytes fit
+static int make_room(template_cache_t* pCache, size_t nCharge){
+	template_entry_t* pEntry = pCache->pLruTail;
+	while(pCache->nMemoryUsed + nCharge > pCache->nMemoryLimit){
+		while(NULL != pEntry && 1 != pEntry->nRef) pEntry = pEntry->pLruPrev;
+		if(NULL == pEntry) return ENOMEM;
+		template_entry_t* pVictim = pEntry;
+		pEntry = pEntry->pLruPrev;
+		remove_entry(pCache, pVictim);
+		pCache->nEvictCnt++;
+	}
+	return 0;
+}
+
+//doubles the table once it holds more entries than buckets; failing to grow only makes the chains longer
+static void grow_table(template_cache_t* pCache){
+	if(pCache->nEntryCnt < (1u << pCache->nBucketBits) || CACHE_MAX_BUCKET_BITS == pCache->nBucketBits) return;
+	size_t nOldSize = sizeof(template_entry_t*) << pCache->nBucketBits;
+	if(pCache->nMemoryUsed + nOldSize > pCache->nMemoryLimit) return;
+	template_entry_t** vBucket = (template_entry_t**)calloc(2, nOldSize);
+	if(NULL == vBucket) return;
+
+	template_entry_t** vOld = pCache->vBucket;
+	unsigned int nOldCnt = 1u << pCache->nBucketBits;
+	pCache->vBucket = vBucket;
+	pCache->nBucketBits++;
+	unsigned int i = 0;
+	for(i = 0; i < nOldCnt; i++){
+		while(NULL != vOld[i]){
+			template_entry_t* pEntry = vOld[i];
+			vOld[i] = pEntry->pHashNext;
+			unsigned int nBucket = bucket_of(pCache, pEntry->nKey);
+			pEntry->pHashNext = vBucket[nBucket];
+			vBucket[nBucket] = pEntry;
+		}
+	}
+	free(vOld);
+	pCache->nMemoryUsed += nOldSize;
+}
+
+//the FMD is checked and copied before the mutex is taken
+static int create_entry(unsigned long long nKey, unsigned int nKeyType, DPFJ_FMD_FORMAT nFmdType, const unsigned char* pFmd,
+	unsigned int nFmdSize, template_entry_t** ppEntry){
+	fmd_record_t record;
+	int result = FmdRecord_Parse(&record, nFmdType, pFmd, nFmdSize);
+	if(0 != result) return result;
+	if(0 == record.nViewCnt) return DPFJ_E_INVALID_FMD;
+
+	size_t nCharge = entry_charge(nFmdSize);
+	template_entry_t* pEntry = (template_entry_t*)malloc(sizeof(template_entry_t) + nFmdSize);
+	if(NULL == pEntry) return ENOMEM;
+	memset(pEntry, 0, sizeof(template_entry_t));
+	pEntry->nKey = nKey;
+	pEntry->nKeyType = nKeyType;
+	pEntry->nRef = 1; //reference of the cache
+	pEntry->nCharge = nCharge;
+	pEntry->nFmdType = nFmdType;
+	pEntry->nFmdSize = nFmdSize;
+	pEntry->nViewCnt = record.nViewCnt;
+	memcpy(pEntry->vFmd, pFmd, nFmdSize);
+	*ppEntry = pEntry;
+	return 0;
+}
+
+//links the new entry, or returns the one already cached under the same content key; with the mutex locked
+static int insert_entry(template_cache_t* pCache, template_entry_t* pNew, template_entry_t** ppEntry){
+	template_entry_t* pOld = find_entry(pCache, pNew->nKey, pNew->nKeyType, pNew->nFmdType, pNew->vFmd, pNew->nFmdSize);
+	if(NULL != pOld && TEMPLATE_CACHE_KEY_CONTENT == pNew->nKeyType){
+		//put by another thread meanwhile
+		free(pNew);
+		lru_unlink(pCache, pOld);
+		lru_push_front(pCache, pOld);
+		pOld->nRef++;
+		*ppEntry = pOld;
+		return 0;
+	}
+	if(NULL != pOld) remove_entry(pCache, pOld);
+	else if(TEMPLATE_CACHE_KEY_CONTENT == pNew->nKeyType){
+		//colliding content is replaced, it is cheaper than keeping chains of equal keys
+		pOld = pCache->vBucket[bucket_of(pCache, pNew->nKey)];
+		while(NULL != pOld){
+			template_entry_t* pNext = pOld->pHashNext;
+			if(pOld->nKey == pNew->nKey && pOld->nKeyType == pNew->nKeyType) remove_entry(pCache, pOld);
+			pOld = pNext;
+		}
+	}
+
+	int result = make_room(pCache, pNew->nCharge);
+	if(0 != result){
+		free(pNew);
+		return result;
+	}
+	unsigned int nBucket = bucket_of(pCache, pNew->nKey);
+	pNew->pHashNext = pCache->vBucket[nBucket];
+	pCache->vBucket[nBucket] = pNew;
+	lru_push_front(pCache, pNew);
+	pCache->nEntryCnt++;
+	pCache->nMemoryUsed += pNew->nCharge;
+	pNew->nRef++; //handle of the caller
+	*ppEntry = pNew;
+	grow_table(pCache);
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// cache
+
+int TemplateCache_Create(size_t nMemoryLimit, template_cache_t** ppCache){
+	if(NULL == ppCache) return EINVAL;
+	*ppCache = NULL;
+
+	if(0 == nMemoryLimit){
+		long nPageCnt = sysconf(_SC_PHYS_PAGES);
+		long nPageSize = sysconf(_SC_PAGESIZE);
+		if(0 >= nPageCnt || 0 >= nPageSize) return EINVAL;
+		nMemoryLimit = (size_t)nPageCnt * (size_t)nPageSize / TEMPLATE_CACHE_DEFAULT_SHARE;
+	}
+
+	template_cache_t* pCache = (template_cache_t*)calloc(1, sizeof(template_cache_t));
+	if(NULL == pCache) return ENOMEM;
+	pCache->nBucketBits = CACHE_MIN_BUCKET_BITS;
+	pCache->vBucket = (template_entry_t**)calloc(1u << pCache->nBucketBits, sizeof(template_entry_t*));
+	if(NULL == pCache->vBucket){
+		free(pCache);
+		return ENOMEM;
+	}
+	pCache->nMemoryLimit = nMemoryLimit;
+	pCache->nMemoryUsed = sizeof(template_entry_t*) << pCache->nBucketBits;
+	pthread_mutex_init(&pCache->mutex, NULL);
+	*ppCache = pCache;
+	return 0;
+}
+
+void TemplateCache_Destroy(template_cache_t* pCache){
+	if(NULL == pCache) return;
+	while(NULL != pCache->pLruHead) remove_entry(pCache, pCache->pLruHead);
+	pthread_mutex_destroy(&pCache->mutex);
+	free(pCache->vBucket);
+	free(pCache);
+}
+
+int TemplateCache_Put(template_cache_t* pCache, unsigned int nId, DPFJ_FMD_FORMAT nFmdType, const unsigned char* pFmd,
+	unsigned int nFmdSize, template_entry_t** ppEntry){
+	if(NULL == pCache || NULL == pFmd || NULL == ppEntry) return EINVAL;
+	*ppEntry = NULL;
+
+	template_entry_t* pNew = NULL;
+	int result = create_entry(nId, TEMPLATE_CACHE_KEY_ID, nFmdType, pFmd, nFmdSize, &pNew);
+	if(0 != result) return result;
+
+	pthread_mutex_lock(&pCache->mutex);
+	result = insert_entry(pCache, pNew, ppEntry);
+	pthread_mutex_unlock(&pCache->mutex);
+	return result;
+}
+
+int TemplateCache_PutContent(template_cache_t* pCache, DPFJ_FMD_FORMAT nFmdType, const unsigned char* pFmd,
+	unsigned int nFmdSize, template_entry_t** ppEntry){
+	if(NULL == pCache || NULL == pFmd || NULL == ppEntry) return EINVAL;
+	*ppEntry = NULL;
+
+	//a hit costs the hash and a memcmp() of the data, the FMD is not parsed again
+	unsigned long long nKey = Checksum_Fnv1a64(pFmd, nFmdSize, CHECKSUM64_INIT);
+	pthread_mutex_lock(&pCache->mutex);
+	template_entry_t* pEntry = find_entry(pCache, nKey, TEMPLATE_CACHE_KEY_CONTENT, nFmdType, pFmd, nFmdSize);
+	if(NULL != pEntry){
+		lru_unlink(pCache, pEntry);
+		lru_push_front(pCache, pEntry);
+		pEntry->nRef++;
+		pCache->nHitCnt++;
+		*ppEntry = pEntry;
+	}
+	else pCache->nMissCnt++;
+	pthread_mutex_unlock(&pCache->mutex);
+	if(NULL != *ppEntry) return 0;
+
+	template_entry_t* pNew = NULL;
+	int result = create_entry(nKey, TEMPLATE_CACHE_KEY_CONTENT, nFmdType, pFmd, nFmdSize, &pNew);
+	if(0 != result) return result;
+
+	pthread_mutex_lock(&pCache->mutex);
+	result = insert_entry(pCache, pNew, ppEntry);
+	pthread_mutex_unlock(&pCache->mutex);
+	return result;
+}
+
+int TemplateCache_Get(template_cache_t* pCache, unsigned int nId, template_entry_t** ppEntry){
+	if(NULL == pCache || NULL == ppEntry) return EINVAL;
+	*ppEntry = NULL;
+
+	pthread_mutex_lock(&pCache->mutex);
+	template_entry_t* pEntry = find_entry(pCache, nId, TEMPLATE_CACHE_KEY_ID, 0, NULL, 0);
+	if(NULL != pEntry){
+		lru_unlink(pCache, pEntry);
+		lru_push_front(pCache, pEntry);
+		pEntry->nRef++;
+		pCache->nHitCnt++;
+		*ppEntry = pEntry;
+	}
+	else pCache->nMissCnt++;
+	pthread_mutex_unlock(&pCache->mutex);
+	return NULL != pEntry ? 0 : ENOENT;
+}
+
+void TemplateCache_Release(template_cache_t* pCache, template_entry_t* pEntry){
+	if(NULL == pCache || NULL == pEntry) return;
+	pthread_mutex_lock(&pCache->mutex);
+	unref_entry(pCache, pEntry);
+	pthread_mutex_unlock(&pCache->mutex);
+}
+
+int TemplateCache_Remove(template_cache_t* pCache, unsigned int nId){
+	if(NULL == pCache) return EINVAL;
+	pthread_mutex_lock(&pCache->mutex);
+	template_entry_t* pEntry = find_entry(pCache, nId, TEMPLATE_CACHE_KEY_ID, 0, NULL, 0);
+	if(NULL != pEntry) remove_entry(pCache, pEntry);
+	pthread_mutex_unlock(&pCache->mutex);
+	return NULL != pEntry ? 0 : ENOENT;
+}
+
+void TemplateCache_GetStats(template_cache_t* pCache, template_cache_stats_t* pStats){
+	if(NULL == pCache || NULL == pStats) return;
+	pthread_mutex_lock(&pCache->mutex);
+	pStats->nEntryCnt = pCache->nEntryCnt;
+	pStats->nMemoryLimit = pCache->nMemoryLimit;
+	pStats->nMemoryUsed = pCache->nMemoryUsed;
+	pStats->nHitCnt = pCache->nHitCnt;
+	pStats->nMissCnt = pCache->nMissCnt;
+	pStats->nEvictCnt = pCache->nEvictCnt;
+	pthread_mutex_unlock(&pCache->mutex);
+}
+
+int TemplateCache_Compare(const template_entry_t* pEntry, unsigned int nViewIdx, DPFJ_FMD_FORMAT nProbeType,
+	unsigned char* pProbe, unsigned int nProbeSize, unsigned int nProbeViewIdx, unsigned int* pnScore){
+	if(NULL == pEntry || NULL == pProbe || NULL == pnScore) return EINVAL;
+	if(nViewIdx >= pEntry->nViewCnt) return DPFJ_E_INVALID_PARAMETER;
+
+	//the entry is pinned by the handle and never changes, the data is read without the mutex
+	return dpfj_compare(nProbeType, pProbe, nProbeSize, nProbeViewIdx,
+		pEntry->nFmdType, (unsigned char*)pEntry->vFmd, pEntry->nFmdSize, nViewIdx, pnScore);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <dpfj.h>
+
+//key types of the cache entries
+#define TEMPLATE_CACHE_KEY_ID      0 //id supplied by the caller
+#define TEMPLATE_CACHE_KEY_CONTENT 1 //hash of the FMD data
+
+//with no memory limit given the cache takes this share of the physical memory, 64 MB on a 1 GB board
+#define TEMPLATE_CACHE_DEFAULT_SHARE 16
+
+//cached FMD: checked once when put, then compared any number of times; every handle returned for the entry pins it,
+//a pinned entry is not evicted, and a removed or replaced one is freed when its last handle is released
+typedef struct template_entry {
+	struct template_entry* pHashNext;
+	struct template_entry* pLruPrev;  //towards the most recently used entry
+	struct template_entry* pLruNext;  //towards the least recently used entry
+	unsigned long long nKey;          //id or hash of the FMD data
+	unsigned int    nKeyType;         //TEMPLATE_CACHE_KEY_*
+	unsigned int    nRef;             //handles, plus one while the entry is in the cache
+	size_t          nCharge;          //bytes accounted for the entry
+	DPFJ_FMD_FORMAT nFmdType;
+	unsigned int    nFmdSize;
+	unsigned int    nViewCnt;
+	unsigned char   vFmd[];           //copy of the FMD
+} template_entry_t;
+
+//LRU cache of FMDs for repeated 1:1 verification against the same enrolled templates, e.g. on an access point which
+//fetches the templates of its users from a server or a database; the memory used by the entries and the hash table
+//is accounted, and the least recently used entries which are not pinned are evicted to stay within the limit
+typedef struct {
+	pthread_mutex_t    mutex;
+	template_entry_t** vBucket;
+	unsigned int       nBucketBits;   //the table has 1 << nBucketBits buckets
+	unsigned int       nEntryCnt;
+	template_entry_t*  pLruHead;      //most recently used entry
+	template_entry_t*  pLruTail;      //least recently used entry, evicted first
+	size_t             nMemoryLimit;
+	size_t             nMemoryUsed;   //entries, including the removed ones still pinned, and the hash table
+	unsigned int       nHitCnt;
+	unsigned int       nMissCnt;
+	unsigned int       nEvictCnt;
+} template_cache_t;
+
+typedef struct {
+	unsigned int nEntryCnt;
+	size_t       nMemoryLimit;
+	size_t       nMemoryUsed;
+	unsigned int nHitCnt;
+	unsigned int nMissCnt;
+	unsigned int nEvictCnt;
+} template_cache_stats_t;
+
+//all functions return 0 on success, otherwise DPFJ error code or errno;
+//nMemoryLimit of 0 takes 1 / TEMPLATE_CACHE_DEFAULT_SHARE of the physical memory
+int  TemplateCache_Create(size_t nMemoryLimit, template_cache_t** ppCache);
+//all handles must be released before
+void TemplateCache_Destroy(template_cache_t* pCache);
+
+//puts the FMD under the id, an entry already there is replaced; ppEntry receives a handle to the new entry;
+//ENOMEM is returned if the entry does not fit even after evicting everything which is not pinned
+int  TemplateCache_Put(template_cache_t* pCache, unsigned int nId, DPFJ_FMD_FORMAT nFmdType, const unsigned char* pFmd,
+	unsigned int nFmdSize, template_entry_t** ppEntry);
+//finds the FMD by the hash of its data for callers which have no ids, and puts it if it is not cached yet
+int  TemplateCache_PutContent(template_cache_t* pCache, DPFJ_FMD_FORMAT nFmdType, const unsigned char* pFmd,
+	unsigned int nFmdSize, template_entry_t** ppEntry);
+//returns ENOENT if the id is not cached
+int  TemplateCache_Get(template_cache_t* pCache, unsigned int nId, template_entry_t** ppEntry);
+void TemplateCache_Release(template_cache_t* pCache, template_entry_t* pEntry);
+int  TemplateCache_Remove(template_cache_t* pCache, unsigned int nId);
+void TemplateCache_GetStats(template_cache_t* pCache, template_cache_stats_t* pStats);
+
+//dpfj_compare() of the probe against a view of the cached FMD, through a handle; needs no lock
+int  TemplateCache_Compare(const template_entry_t* pEntry, unsigned int nViewIdx, DPFJ_FMD_FORMAT nProbeType,
+	unsigned char* pProbe, unsigned int nProbeSize, unsigned int nProbeViewIdx, unsigned int* pnScore);
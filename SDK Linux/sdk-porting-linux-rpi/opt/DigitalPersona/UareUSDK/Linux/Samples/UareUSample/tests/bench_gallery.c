@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+//identification over galleries of synthetic FMDs: every probe has BENCH_MATE_CNT mates spread over the gallery, the
+//rest of the gallery are non-mates made from the same fingers with their minutiae scrambled; compared are
+//  - Gallery_Identify() with dpfj_identify() called on arrays built for every identification, the way an
+//    application keeping its FMDs one allocation each does it
+//  - the compact gallery with the gallery it was created from: memory per FMD and identification time
+//
+//usage: bench_gallery [gallery size ...], 10000 100000 1000000 by default
+
+#include "../compactgallery.h"
+#include "../gallery.h"
+#include "synthfmd.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_UNIQUE_CNT   64   //distinct fingers, the gallery is made from them
+#define BENCH_MIN_MINUTIAE 12
+#define BENCH_PROBE_CNT    5
+#define BENCH_MATE_CNT     3
+#define BENCH_MATE_SHIFT   1    //mates are jittered by up to 1, 2 and 3 pixels
+
+static double now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//finger of the probe
+static unsigned int probe_finger(unsigned int nProbe){
+	return (nProbe * 13) % BENCH_UNIQUE_CNT;
+}
+
+//mates of the probes are at a quarter, half and three quarters of the gallery
+static unsigned int mate_idx(unsigned int nProbe, unsigned int nMate, unsigned int nGalleryCnt){
+	return (nMate + 1) * (nGalleryCnt / (BENCH_MATE_CNT + 1)) + nProbe;
+}
+
+static unsigned int count_mates(unsigned int nProbe, unsigned int nGalleryCnt, unsigned int nCandidateCnt, const gallery_candidate_t* vCandidates){
+	unsigned int nFound = 0, i = 0, k = 0;
+	for(i = 0; i < nCandidateCnt; i++){
+		for(k = 0; k < BENCH_MATE_CNT; k++){
+			//ids are given in the order the FMDs were added
+			if(vCandidates[i].nId == mate_idx(nProbe, k, nGalleryCnt)) nFound++;
+		}
+	}
+	return nFound;
+}
+
+//allocated memory of the gallery: the arena and the arrays, as counted by CompactGallery_GetMemorySize() for the compact one
+static size_t gallery_memory_size(const gallery_t* pGallery){
+	size_t nSize = sizeof(gallery_t) + pGallery->nArenaSize;
+	nSize += (size_t)pGallery->nFmdAlloc * (sizeof(unsigned char*) + 5 * sizeof(unsigned int) + sizeof(gallery_signature_t));
+	nSize += (size_t)pGallery->nIdAlloc * sizeof(unsigned int);
+	unsigned int i = 0;
+	for(i = 0; i < GALLERY_FINGER_POSITIONS * GALLERY_IMPRESSION_TYPES; i++){
+		nSize += sizeof(gallery_partition_t) + (size_t)pGallery->vPartition[i].nFmdAlloc * (sizeof(unsigned char*) + 2 * sizeof(unsigned int));
+	}
+	return nSize;
+}
+
+static int bench(unsigned int nGalleryCnt, unsigned char** vUnique, unsigned int* vUniqueSize){
+	unsigned int nThreshold = DPFJ_PROBABILITY_ONE / 100000;
+	unsigned int i = 0, j = 0, k = 0;
+	if(mate_idx(BENCH_PROBE_CNT - 1, BENCH_MATE_CNT - 1, nGalleryCnt) >= nGalleryCnt){
+		printf("gallery of %u FMDs is too small\n", nGalleryCnt);
+		return EINVAL;
+	}
+
+	//the array-based FMDs: one allocation each, as records read from a database
+	double dStart = now_ms();
+	unsigned char** vRecord = (unsigned char**)calloc(nGalleryCnt, sizeof(unsigned char*));
+	unsigned int* vRecordSize = (unsigned int*)malloc(sizeof(unsigned int) * nGalleryCnt);
+	if(NULL == vRecord || NULL == vRecordSize) return ENOMEM;
+	int result = 0;
+	for(i = 0; i < nGalleryCnt && 0 == result; i++){
+		vRecordSize[i] = vUniqueSize[i % BENCH_UNIQUE_CNT];
+		vRecord[i] = (unsigned char*)malloc(vRecordSize[i]);
+		if(NULL == vRecord[i]) result = ENOMEM;
+		else result = SynthFmd_Scramble(vUnique[i % BENCH_UNIQUE_CNT], vRecordSize[i], i, vRecord[i]);
+	}
+	for(j = 0; j < BENCH_PROBE_CNT && 0 == result; j++){
+		for(k = 0; k < BENCH_MATE_CNT && 0 == result; k++){
+			unsigned int nIdx = mate_idx(j, k, nGalleryCnt);
+			unsigned int nFinger = probe_finger(j);
+			free(vRecord[nIdx]);
+			vRecordSize[nIdx] = vUniqueSize[nFinger];
+			vRecord[nIdx] = (unsigned char*)malloc(vRecordSize[nIdx]);
+			if(NULL == vRecord[nIdx]) result = ENOMEM;
+			else result = SynthFmd_Jitter(vUnique[nFinger], vRecordSize[nIdx], nIdx, (k + 1) * BENCH_MATE_SHIFT, vRecord[nIdx]);
+		}
+	}
+	double dArrayLoad = now_ms() - dStart;
+
+	dStart = now_ms();
+	gallery_t* pGallery = NULL;
+	if(0 == result) result = Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery);
+	for(i = 0; i < nGalleryCnt && 0 == result; i++){
+		unsigned int nId = 0;
+		result = Gallery_Add(pGallery, vRecord[i], vRecordSize[i], &nId);
+	}
+	double dGalleryLoad = now_ms() - dStart;
+
+	dStart = now_ms();
+	compact_gallery_t* pCompact = NULL;
+	if(0 == result) result = CompactGallery_Create(pGallery, &pCompact);
+	double dCompactLoad = now_ms() - dStart;
+	if(0 != result) printf("gallery of %u FMDs not built: 0x%x\n", nGalleryCnt, result);
+
+	//all search with the same probes, the time per identification depends on the probe
+	double dArrayMs = 0, dGalleryMs = 0, dCompactMs = 0;
+	unsigned int nArrayFound = 0, nGalleryFound = 0, nCompactFound = 0;
+	for(j = 0; j < BENCH_PROBE_CNT && 0 == result; j++){
+		unsigned char* pProbe = vUnique[probe_finger(j)];
+		unsigned int nProbeSize = vUniqueSize[probe_finger(j)];
+
+		//array-based: the arrays are gathered from the records for every call
+		dStart = now_ms();
+		unsigned char** vFmd = (unsigned char**)malloc(sizeof(unsigned char*) * nGalleryCnt);
+		unsigned int* vFmdSize = (unsigned int*)malloc(sizeof(unsigned int) * nGalleryCnt);
+		if(NULL == vFmd || NULL == vFmdSize) return ENOMEM;
+		for(i = 0; i < nGalleryCnt; i++){
+			vFmd[i] = vRecord[i];
+			vFmdSize[i] = vRecordSize[i];
+		}
+		DPFJ_CANDIDATE vCandidates[BENCH_MATE_CNT];
+		for(i = 0; i < BENCH_MATE_CNT; i++){
+			vCandidates[i].size = sizeof(DPFJ_CANDIDATE);
+		}
+		unsigned int nCandidateCnt = BENCH_MATE_CNT;
+		result = dpfj_identify(DPFJ_FMD_ANSI_378_2004, pProbe, nProbeSize, 0,
+			DPFJ_FMD_ANSI_378_2004, nGalleryCnt, vFmd, vFmdSize, nThreshold, &nCandidateCnt, vCandidates);
+		free(vFmdSize);
+		free(vFmd);
+		dArrayMs += now_ms() - dStart;
+		if(DPFJ_SUCCESS != result) break;
+		for(i = 0; i < nCandidateCnt; i++){
+			for(k = 0; k < BENCH_MATE_CNT; k++){
+				if(vCandidates[i].fmd_idx == mate_idx(j, k, nGalleryCnt)) nArrayFound++;
+			}
+		}
+
+		dStart = now_ms();
+		gallery_candidate_t vGalleryCandidates[BENCH_MATE_CNT];
+		nCandidateCnt = BENCH_MATE_CNT;
+		result = Gallery_Identify(pGallery, pProbe, nProbeSize, 0, nThreshold, &nCandidateCnt, vGalleryCandidates);
+		dGalleryMs += now_ms() - dStart;
+		if(DPFJ_SUCCESS != result) break;
+		nGalleryFound += count_mates(j, nGalleryCnt, nCandidateCnt, vGalleryCandidates);
+
+		dStart = now_ms();
+		nCandidateCnt = BENCH_MATE_CNT;
+		result = CompactGallery_Identify(pCompact, pProbe, nProbeSize, 0, nThreshold, &nCandidateCnt, vGalleryCandidates);
+		dCompactMs += now_ms() - dStart;
+		if(DPFJ_SUCCESS != result) break;
+		nCompactFound += count_mates(j, nGalleryCnt, nCandidateCnt, vGalleryCandidates);
+	}
+
+	if(0 == result){
+		unsigned int nMateCnt = BENCH_PROBE_CNT * BENCH_MATE_CNT;
+		printf("%8u FMDs  load: array %8.1f ms  gallery %8.1f ms   identify: array %9.1f ms  gallery %9.1f ms  (%.2fx)  mates found %u/%u, %u/%u\n",
+			nGalleryCnt, dArrayLoad, dGalleryLoad, dArrayMs / BENCH_PROBE_CNT, dGalleryMs / BENCH_PROBE_CNT,
+			dArrayMs / dGalleryMs, nArrayFound, nMateCnt, nGalleryFound, nMateCnt);
+		printf("%8u FMDs  memory per FMD: gallery %6.1f B  compact %6.1f B  (%.2fx)   compact built in %8.1f ms   identify: compact %9.1f ms  (%.2fx of gallery)  mates found %u/%u\n",
+			nGalleryCnt, (double)gallery_memory_size(pGallery) / nGalleryCnt, (double)CompactGallery_GetMemorySize(pCompact) / nGalleryCnt,
+			(double)gallery_memory_size(pGallery) / CompactGallery_GetMemorySize(pCompact), dCompactLoad,
+			dCompactMs / BENCH_PROBE_CNT, dCompactMs / dGalleryMs, nCompactFound, nMateCnt);
+	}
+	else printf("identification over %u FMDs failed: 0x%x\n", nGalleryCnt, result);
+
+	CompactGallery_Destroy(pCompact);
+	Gallery_Destroy(pGallery);
+	for(i = 0; i < nGalleryCnt; i++){
+		if(NULL != vRecord[i]) free(vRecord[i]);
+	}
+	free(vRecordSize);
+	free(vRecord);
+	return result;
+}
+
+int main(int argc, char** argv){
+	unsigned char* vUnique[BENCH_UNIQUE_CNT];
+	unsigned int vUniqueSize[BENCH_UNIQUE_CNT];
+	unsigned int nSeed = 1;
+	unsigned int i = 0;
+
+	for(i = 0; i < BENCH_UNIQUE_CNT; i++){
+		vUnique[i] = (unsigned char*)malloc(MAX_FMD_SIZE);
+		if(NULL == vUnique[i]) return 1;
+		while(nSeed < 100000 && 0 != SynthFmd_Create(nSeed, 0, 0, BENCH_MIN_MINUTIAE, vUnique[i], &vUniqueSize[i])) nSeed++;
+		if(100000 <= nSeed++){
+			printf("no features extracted from the synthetic images\n");
+			return 1;
+		}
+	}
+
+	int result = 0;
+	if(1 < argc){
+		for(i = 1; i < (unsigned int)argc && 0 == result; i++) result = bench((unsigned int)strtoul(argv[i], NULL, 10), vUnique, vUniqueSize);
+	}
+	else{
+		unsigned int vGalleryCnt[] = {10000, 100000, 1000000};
+		for(i = 0; i < sizeof(vGalleryCnt) / sizeof(vGalleryCnt[0]) && 0 == result; i++){
+			result = bench(vGalleryCnt[i], vUnique, vUniqueSize);
+		}
+	}
+
+	for(i = 0; i < BENCH_UNIQUE_CNT; i++) free(vUnique[i]);
+	return (0 == result) ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+//miss rate of Gallery_IdentifyPrefiltered() against its penetration: the gallery holds distinct synthetic fingers, the
+//probes are mates of some of them, moved and with noise added to the image before extraction; the full search is
+//Gallery_IdentifyParallel(), the candidates of the pre-filtered search are ranked by dpfj_compare() the same way, and a
+//miss is a probe whose mate comes first in the full search but not in the pre-filtered one
+//
+//usage: bench_prefilter [gallery size], 2000 by default
+
+#include "../gallery.h"
+#include "synthfmd.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MIN_MINUTIAE 12
+#define BENCH_PROBE_CNT    100
+#define BENCH_CANDIDATE_CNT 10   //candidates ranked, of both searches
+
+static const unsigned int g_vPenetration[] = {5, 10, 25, 50, 100};
+#define BENCH_PENETRATION_CNT (sizeof(g_vPenetration) / sizeof(g_vPenetration[0]))
+
+static double now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int compare_candidates(const void* p1, const void* p2){
+	const gallery_candidate_t* pc1 = (const gallery_candidate_t*)p1;
+	const gallery_candidate_t* pc2 = (const gallery_candidate_t*)p2;
+	if(pc1->nScore != pc2->nScore) return (pc1->nScore < pc2->nScore) ? -1 : 1;
+	return (pc1->nId < pc2->nId) ? -1 : (pc1->nId > pc2->nId);
+}
+
+//best candidate of the pre-filtered search by dpfj_compare(), GALLERY_NO_INDEX if none
+static int prefiltered_first(gallery_t* pGallery, unsigned char* pProbe, unsigned int nProbeSize, unsigned int nThreshold,
+	unsigned int nPenetration, unsigned int* pnSearchedCnt, unsigned int* pnFirstId){
+	gallery_candidate_t vCandidates[BENCH_CANDIDATE_CNT];
+	unsigned int nCandidateCnt = BENCH_CANDIDATE_CNT;
+	*pnFirstId = GALLERY_NO_INDEX;
+	int result = Gallery_IdentifyPrefiltered(pGallery, pProbe, nProbeSize, 0, nThreshold, nPenetration, pnSearchedCnt, &nCandidateCnt, vCandidates);
+	unsigned int i = 0;
+	for(i = 0; 0 == result && i < nCandidateCnt; i++){
+		unsigned char* pFmd = NULL;
+		unsigned int nFmdSize = 0;
+		result = Gallery_GetFmd(pGallery, vCandidates[i].nId, &pFmd, &nFmdSize);
+		if(0 == result) result = dpfj_compare(DPFJ_FMD_ANSI_378_2004, pProbe, nProbeSize, 0,
+			DPFJ_FMD_ANSI_378_2004, pFmd, nFmdSize, vCandidates[i].nViewIdx, &vCandidates[i].nScore);
+	}
+	if(0 != result) return result;
+	qsort(vCandidates, nCandidateCnt, sizeof(gallery_candidate_t), compare_candidates);
+	if(0 < nCandidateCnt) *pnFirstId = vCandidates[0].nId;
+	return 0;
+}
+
+int main(int argc, char** argv){
+	unsigned int nGalleryCnt = (1 < argc) ? (unsigned int)strtoul(argv[1], NULL, 10) : 2000;
+	unsigned int nThreshold = DPFJ_PROBABILITY_ONE / 100000;
+	if(BENCH_PROBE_CNT > nGalleryCnt){
+		printf("gallery of %u FMDs is too small\n", nGalleryCnt);
+		return 1;
+	}
+
+	//the gallery: the finger of the seed vSeed[i] has the id i
+	unsigned char* pFmd = (unsigned char*)malloc(MAX_FMD_SIZE);
+	unsigned int* vSeed = (unsigned int*)malloc(sizeof(unsigned int) * nGalleryCnt);
+	gallery_t* pGallery = NULL;
+	int result = (NULL == pFmd || NULL == vSeed) ? ENOMEM : Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery);
+	if(0 == result) result = Gallery_EnablePrefilter(pGallery);
+	unsigned int nSeed = 1;
+	unsigned int i = 0, j = 0;
+	for(i = 0; i < nGalleryCnt && 0 == result; i++){
+		unsigned int nFmdSize = 0;
+		while(nSeed < 100 * nGalleryCnt && 0 != SynthFmd_Create(nSeed, 0, 0, BENCH_MIN_MINUTIAE, pFmd, &nFmdSize)) nSeed++;
+		if(100 * nGalleryCnt <= nSeed) result = DPFJ_E_FAILURE;
+		unsigned int nId = 0;
+		if(0 == result) result = Gallery_Add(pGallery, pFmd, nFmdSize, &nId);
+		vSeed[i] = nSeed++;
+	}
+	if(0 != result) printf("gallery of %u FMDs not built: 0x%x\n", nGalleryCnt, result);
+
+	//probes are mates of fingers spread over the gallery, moved by 2 to 8 pixels, with noise of 4 to 16 grey levels
+	unsigned int nProbeCnt = 0, nFullFirst = 0;
+	unsigned int vMissCnt[BENCH_PENETRATION_CNT] = {0};
+	unsigned int vFirstCnt[BENCH_PENETRATION_CNT] = {0};
+	double vSearched[BENCH_PENETRATION_CNT] = {0};
+	double vMs[BENCH_PENETRATION_CNT] = {0};
+	double dFullMs = 0;
+	for(j = 0; j < BENCH_PROBE_CNT && 0 == result; j++){
+		unsigned int nMateId = j * (nGalleryCnt / BENCH_PROBE_CNT);
+		unsigned int nStep = 1 + j % 4;
+		unsigned int nFmdSize = 0;
+		if(0 != SynthFmd_Create(vSeed[nMateId], 2 * nStep, 4 * nStep, BENCH_MIN_MINUTIAE, pFmd, &nFmdSize)) continue;
+		nProbeCnt++;
+
+		gallery_candidate_t vCandidates[BENCH_CANDIDATE_CNT];
+		unsigned int nCandidateCnt = BENCH_CANDIDATE_CNT;
+		double dStart = now_ms();
+		result = Gallery_IdentifyParallel(pGallery, NULL, pFmd, nFmdSize, 0, nThreshold, &nCandidateCnt, vCandidates);
+		dFullMs += now_ms() - dStart;
+		if(0 != result) break;
+		int bFullFirst = (0 < nCandidateCnt && nMateId == vCandidates[0].nId);
+		if(bFullFirst) nFullFirst++;
+
+		unsigned int k = 0;
+		for(k = 0; k < BENCH_PENETRATION_CNT && 0 == result; k++){
+			unsigned int nSearchedCnt = 0, nFirstId = 0;
+			dStart = now_ms();
+			result = prefiltered_first(pGallery, pFmd, nFmdSize, nThreshold, g_vPenetration[k], &nSearchedCnt, &nFirstId);
+			vMs[k] += now_ms() - dStart;
+			vSearched[k] += nSearchedCnt;
+			if(nMateId == nFirstId) vFirstCnt[k]++;
+			else if(bFullFirst) vMissCnt[k]++;
+		}
+	}
+
+	if(0 == result && 0 < nProbeCnt){
+		printf("%u FMDs, %u probes, full search: mate first for %u, %.1f ms per probe\n",
+			nGalleryCnt, nProbeCnt, nFullFirst, dFullMs / nProbeCnt);
+		unsigned int k = 0;
+		for(k = 0; k < BENCH_PENETRATION_CNT; k++){
+			printf("  penetration %3u%%: searched %5.1f%%  mate first %3u/%u  missed %3u/%u (%5.1f%%)  %8.1f ms per probe\n",
+				g_vPenetration[k], 100.0 * vSearched[k] / nProbeCnt / nGalleryCnt, vFirstCnt[k], nProbeCnt,
+				vMissCnt[k], nFullFirst, (0 == nFullFirst) ? 0.0 : 100.0 * vMissCnt[k] / nFullFirst, vMs[k] / nProbeCnt);
+		}
+	}
+	else if(0 != result) printf("identification failed: 0x%x\n", result);
+
+	Gallery_Destroy(pGallery);
+	if(NULL != vSeed) free(vSeed);
+	if(NULL != pFmd) free(pFmd);
+	return (0 == result) ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+//checks of the tests, a failed one is printed and counted; the count is changed with atomic operations, the checks
+//may run on the threads of the test
+static int g_nFailCnt = 0;
+
+#define CHECK(x) do{ if(!(x)){ printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); __sync_fetch_and_add(&g_nFailCnt, 1); } }while(0)
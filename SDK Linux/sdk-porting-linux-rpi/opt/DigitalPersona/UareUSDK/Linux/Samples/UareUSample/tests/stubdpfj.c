@@ -0,0 +1,494 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "stubdpfj.h"
+#include "../record.h"
+
+#include <dpfj_compression.h>
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STUB_VIEW_SIZE 400
+
+static unsigned int g_nCompareCnt = 0;
+static unsigned int g_nCompareLimit = 0;
+static void (*g_pfnIdentifyHook)(void) = NULL;
+
+static unsigned int    g_bEnrolling = 0; //changed with atomic operations
+static DPFJ_FMD_FORMAT g_nEnrollmentType = 0;
+static unsigned char   g_vEnrollmentFmd[MAX_FMD_SIZE];
+static unsigned int    g_nEnrollmentFmdSize = 0;
+static unsigned int    g_nEnrollmentView = 0;
+static unsigned int    g_nEnrollmentCnt = 0;
+
+static unsigned int    g_bCompressing = 0; //changed with atomic operations
+static unsigned int    g_nWsqBitrate = 0;
+static unsigned int    g_nWsqSize = 0;
+static unsigned char*  g_pProcessed = NULL;
+static unsigned int    g_nProcessedSize = 0;
+
+//the tests run dpfj_identify() from several threads, rand() is not used
+static unsigned int next_random(unsigned int* pnState){
+	*pnState = *pnState * 1103515245 + 12345;
+	return (*pnState >> 8) & 0xffffff;
+}
+
+static void write_be(unsigned char* p, unsigned int nValue, unsigned int nBytes){
+	while(0 != nBytes--){
+		p[nBytes] = (unsigned char)nValue;
+		nValue >>= 8;
+	}
+}
+
+void Stub_MakeFmd(DPFJ_FMD_FORMAT nType, unsigned int nFinger, unsigned int nShift, unsigned int nVariant,
+	DPFJ_FINGER_POSITION nFingerPos, unsigned char* pFmd, unsigned int* pnFmdSize){
+	unsigned int nHeaderSize = (DPFJ_FMD_ANSI_378_2004 == nType) ? DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH : DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH;
+	unsigned int nSize = nHeaderSize + DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH + STUB_MINUTIA_CNT * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH + 2;
+	memset(pFmd, 0, nSize);
+
+	//record header: format and version, length, for ANSI the CBEFF product id, then equipment, size, resolution and views
+	memcpy(pFmd, "FMR\0 20\0", 8);
+	unsigned char* p = pFmd + 8;
+	if(DPFJ_FMD_ANSI_378_2004 == nType){
+		write_be(p, nSize, 2);
+		p += 6;
+	}
+	else{
+		write_be(p, nSize, 4);
+		p += 4;
+	}
+	p += 2;
+	write_be(p, STUB_VIEW_SIZE, 2);
+	write_be(p + 2, STUB_VIEW_SIZE, 2);
+	write_be(p + 4, 197, 2);
+	write_be(p + 6, 197, 2);
+	p[8] = 1;
+
+	p = pFmd + nHeaderSize;
+	p[0] = (unsigned char)nFingerPos;
+	p[1] = 0;
+	p[2] = 80;
+	p[3] = STUB_MINUTIA_CNT;
+	p += DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH;
+
+	unsigned int nFingerState = nFinger * 2654435761u + 1;
+	unsigned int nVariantState = nVariant * 2246822519u + nFinger + 7;
+	unsigned int i = 0;
+	for(i = 0; i < STUB_MINUTIA_CNT; i++, p += DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH){
+		int nX = 20 + (int)(next_random(&nFingerState) % (STUB_VIEW_SIZE - 40));
+		int nY = 20 + (int)(next_random(&nFingerState) % (STUB_VIEW_SIZE - 40));
+		int nAngle = 1 + (int)(next_random(&nFingerState) % 178);
+		if(0 != nShift){
+			nX += (int)(next_random(&nVariantState) % (2 * nShift + 1)) - (int)nShift;
+			nY += (int)(next_random(&nVariantState) % (2 * nShift + 1)) - (int)nShift;
+			nAngle += (int)(next_random(&nVariantState) % 3) - 1;
+		}
+		p[0] = (unsigned char)((1 << 6) | (nX >> 8));
+		p[1] = (unsigned char)nX;
+		p[2] = (unsigned char)(nY >> 8);
+		p[3] = (unsigned char)nY;
+		p[4] = (unsigned char)nAngle;
+		p[5] = 60;
+	}
+	*pnFmdSize = nSize;
+}
+
+void Stub_MakeFid(unsigned int nWidth, unsigned int nHeight, unsigned int nSeed, unsigned char* pFid, unsigned int* pnFidSize){
+	unsigned int nSize = STUB_FID_SIZE(nWidth, nHeight);
+	memset(pFid, 0, STUB_FID_SIZE(0, 0));
+
+	//record header: format and version, length, device, acquisition level, fingers, units, resolutions, depth, compression
+	memcpy(pFid, "FIR\0" "010\0", 8);
+	write_be(pFid + 10, nSize, 4);
+	write_be(pFid + 16, 31, 2);
+	pFid[18] = 1;
+	pFid[19] = 1;
+	write_be(pFid + 20, 500, 2);
+	write_be(pFid + 22, 500, 2);
+	write_be(pFid + 24, 500, 2);
+	write_be(pFid + 26, 500, 2);
+	pFid[28] = 8;
+
+	unsigned char* p = pFid + DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH;
+	write_be(p, DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH + nWidth * nHeight, 4);
+	p[5] = 1;
+	p[6] = 1;
+	p[7] = 80;
+	write_be(p + 9, nWidth, 2);
+	write_be(p + 11, nHeight, 2);
+	p += DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH;
+
+	unsigned int nState = nSeed * 2654435761u + 3;
+	unsigned int i = 0;
+	for(i = 0; i < nHeight; i++, p += nWidth) memset(p, (int)(next_random(&nState) & 0xff), nWidth);
+	*pnFidSize = nSize;
+}
+
+static unsigned int read_be(const unsigned char* p, unsigned int nBytes){
+	unsigned int nValue = 0;
+	while(0 != nBytes--) nValue = (nValue << 8) | *p++;
+	return nValue;
+}
+
+int Stub_GetWsqParams(const unsigned char* pData, unsigned int nDataSize, unsigned int* pnBitrate, unsigned int* pnSize){
+	if(NULL == pData || STUB_WSQ_HEADER_LENGTH > nDataSize || 0 != memcmp(pData, "SWSQ", 4)) return 0;
+	*pnBitrate = read_be(pData + 8, 4);
+	*pnSize = read_be(pData + 12, 4);
+	return 1;
+}
+
+unsigned int Stub_GetCompareCnt(void){
+	return __sync_fetch_and_add(&g_nCompareCnt, 0);
+}
+
+void Stub_SetCompareLimit(unsigned int nCnt){
+	__sync_lock_test_and_set(&g_nCompareLimit, nCnt);
+}
+
+void Stub_SetIdentifyHook(void (*pfnHook)(void)){
+	g_pfnIdentifyHook = pfnHook;
+}
+
+static unsigned int score_views(const fmd_view_t* pView1, const fmd_view_t* pView2){
+	if(0 == pView1->nMinutiaCnt || 0 == pView2->nMinutiaCnt) return DPFJ_PROBABILITY_ONE;
+	unsigned long long nScore = (unsigned long long)abs((int)pView1->nMinutiaCnt - (int)pView2->nMinutiaCnt) * STUB_COUNT_PENALTY;
+
+	//the minutia count is a byte, both views are decoded once
+	fmd_minutia_t vMinutiae1[256], vMinutiae2[256];
+	unsigned int i = 0;
+	unsigned int j = 0;
+	for(i = 0; i < pView1->nMinutiaCnt; i++) FmdView_GetMinutia(pView1, i, &vMinutiae1[i]);
+	for(j = 0; j < pView2->nMinutiaCnt; j++) FmdView_GetMinutia(pView2, j, &vMinutiae2[j]);
+	for(i = 0; i < pView1->nMinutiaCnt; i++){
+		const fmd_minutia_t* pm1 = &vMinutiae1[i];
+		unsigned long long nNearest = ~0ull;
+		for(j = 0; j < pView2->nMinutiaCnt; j++){
+			const fmd_minutia_t* pm2 = &vMinutiae2[j];
+			long long dx = (long long)pm1->nX - pm2->nX;
+			long long dy = (long long)pm1->nY - pm2->nY;
+			long long da = (long long)pm1->nAngle - pm2->nAngle;
+			unsigned long long nDist = dx * dx + dy * dy + da * da;
+			if(nDist < nNearest) nNearest = nDist;
+		}
+		nScore += nNearest;
+	}
+	return (DPFJ_PROBABILITY_ONE < nScore) ? DPFJ_PROBABILITY_ONE : (unsigned int)nScore;
+}
+
+static int score_fmds(DPFJ_FMD_FORMAT nType1, const unsigned char* pFmd1, unsigned int nSize1, unsigned int nView1,
+	DPFJ_FMD_FORMAT nType2, const unsigned char* pFmd2, unsigned int nSize2, unsigned int nView2, unsigned int* pnScore){
+	fmd_record_t record1, record2;
+	fmd_view_t view1, view2;
+	if(0 != FmdRecord_Parse(&record1, nType1, pFmd1, nSize1) || 0 != FmdRecord_GetView(&record1, nView1, &view1)) return DPFJ_E_INVALID_FMD;
+	if(0 != FmdRecord_Parse(&record2, nType2, pFmd2, nSize2) || 0 != FmdRecord_GetView(&record2, nView2, &view2)) return DPFJ_E_INVALID_FMD;
+	*pnScore = score_views(&view1, &view2);
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_compare(DPFJ_FMD_FORMAT nType1, unsigned char* pFmd1, unsigned int nSize1, unsigned int nView1,
+	DPFJ_FMD_FORMAT nType2, unsigned char* pFmd2, unsigned int nSize2, unsigned int nView2, unsigned int* pnScore){
+	if(NULL == pFmd1 || NULL == pFmd2 || NULL == pnScore) return DPFJ_E_INVALID_PARAMETER;
+	unsigned int nCnt = __sync_fetch_and_add(&g_nCompareCnt, 1);
+	if(0 != g_nCompareLimit && g_nCompareLimit <= nCnt) return DPFJ_E_FAILURE;
+	return score_fmds(nType1, pFmd1, nSize1, nView1, nType2, pFmd2, nSize2, nView2, pnScore);
+}
+
+typedef struct {
+	unsigned int nScore;
+	unsigned int nFmdIdx;
+	unsigned int nViewIdx;
+} stub_hit_t;
+
+static int compare_hits(const void* p1, const void* p2){
+	const stub_hit_t* ph1 = (const stub_hit_t*)p1;
+	const stub_hit_t* ph2 = (const stub_hit_t*)p2;
+	if(ph1->nScore != ph2->nScore) return (ph1->nScore < ph2->nScore) ? -1 : 1;
+	if(ph1->nFmdIdx != ph2->nFmdIdx) return (ph1->nFmdIdx < ph2->nFmdIdx) ? -1 : 1;
+	return (ph1->nViewIdx < ph2->nViewIdx) ? -1 : (ph1->nViewIdx > ph2->nViewIdx);
+}
+
+int DPAPICALL dpfj_identify(DPFJ_FMD_FORMAT nType1, unsigned char* pFmd1, unsigned int nSize1, unsigned int nView1,
+	DPFJ_FMD_FORMAT nTypes, unsigned int nFmdCnt, unsigned char** vFmd, unsigned int* vFmdSize, unsigned int nThreshold,
+	unsigned int* pnCandidateCnt, DPFJ_CANDIDATE* vCandidates){
+	if(NULL == pFmd1 || (0 != nFmdCnt && (NULL == vFmd || NULL == vFmdSize)) || NULL == pnCandidateCnt || NULL == vCandidates) return DPFJ_E_INVALID_PARAMETER;
+	if(NULL != g_pfnIdentifyHook) g_pfnIdentifyHook();
+
+	unsigned int nHitAlloc = 64;
+	unsigned int nHitCnt = 0;
+	stub_hit_t* vHits = (stub_hit_t*)malloc(sizeof(stub_hit_t) * nHitAlloc);
+	if(NULL == vHits) return DPFJ_E_FAILURE;
+	int result = DPFJ_SUCCESS;
+	unsigned int i = 0;
+	for(i = 0; DPFJ_SUCCESS == result && i < nFmdCnt; i++){
+		fmd_record_t record;
+		if(0 != FmdRecord_Parse(&record, nTypes, vFmd[i], vFmdSize[i])){
+			result = DPFJ_E_INVALID_FMD;
+			break;
+		}
+		unsigned int nView = 0;
+		for(nView = 0; DPFJ_SUCCESS == result && nView < record.nViewCnt; nView++){
+			unsigned int nScore = 0;
+			result = score_fmds(nType1, pFmd1, nSize1, nView1, nTypes, vFmd[i], vFmdSize[i], nView, &nScore);
+			if(DPFJ_SUCCESS != result || (unsigned long long)nScore * nFmdCnt >= nThreshold) continue;
+			if(nHitCnt == nHitAlloc){
+				stub_hit_t* vMore = (stub_hit_t*)realloc(vHits, sizeof(stub_hit_t) * nHitAlloc * 2);
+				if(NULL == vMore){
+					result = DPFJ_E_FAILURE;
+					break;
+				}
+				vHits = vMore;
+				nHitAlloc *= 2;
+			}
+			vHits[nHitCnt].nScore = nScore;
+			vHits[nHitCnt].nFmdIdx = i;
+			vHits[nHitCnt].nViewIdx = nView;
+			nHitCnt++;
+		}
+	}
+
+	if(DPFJ_SUCCESS == result){
+		qsort(vHits, nHitCnt, sizeof(stub_hit_t), compare_hits);
+		if(nHitCnt > *pnCandidateCnt) nHitCnt = *pnCandidateCnt;
+		for(i = 0; i < nHitCnt; i++){
+			vCandidates[i].fmd_idx = vHits[i].nFmdIdx;
+			vCandidates[i].view_idx = vHits[i].nViewIdx;
+		}
+		*pnCandidateCnt = nHitCnt;
+	}
+	free(vHits);
+	return result;
+}
+
+int DPAPICALL dpfj_create_fmd_from_raw(const unsigned char* pImage, unsigned int nImageSize, unsigned int nWidth,
+	unsigned int nHeight, unsigned int nDpi, DPFJ_FINGER_POSITION nFingerPos, unsigned int nCbeffId,
+	DPFJ_FMD_FORMAT nFmdType, unsigned char* pFmd, unsigned int* pnFmdSize){
+	(void)pImage;
+	(void)nImageSize;
+	(void)nWidth;
+	(void)nHeight;
+	(void)nDpi;
+	(void)nFingerPos;
+	(void)nCbeffId;
+	(void)nFmdType;
+	(void)pFmd;
+	(void)pnFmdSize;
+	return DPFJ_E_FAILURE;
+}
+
+int DPAPICALL dpfj_create_fmd_from_fid(DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize,
+	DPFJ_FMD_FORMAT nFmdType, unsigned char* pFmd, unsigned int* pnFmdSize){
+	(void)nFidType;
+	return dpfj_create_fmd_from_raw(pFid, nFidSize, 0, 0, 0, DPFJ_POSITION_UNKNOWN, 0, nFmdType, pFmd, pnFmdSize);
+}
+
+int DPAPICALL dpfj_start_enrollment(DPFJ_FMD_FORMAT nFmdType){
+	if(DPFJ_FMD_ANSI_378_2004 != nFmdType && DPFJ_FMD_ISO_19794_2_2005 != nFmdType) return DPFJ_E_INVALID_PARAMETER;
+	if(__sync_lock_test_and_set(&g_bEnrolling, 1)) return DPFJ_E_ENROLLMENT_IN_PROGRESS;
+	g_nEnrollmentType = nFmdType;
+	g_nEnrollmentCnt = 0;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_add_to_enrollment(DPFJ_FMD_FORMAT nFmdType, unsigned char* pFmd, unsigned int nFmdSize, unsigned int nViewIdx){
+	if(!__sync_fetch_and_add(&g_bEnrolling, 0)) return DPFJ_E_ENROLLMENT_NOT_STARTED;
+	if(NULL == pFmd || nFmdType != g_nEnrollmentType) return DPFJ_E_INVALID_PARAMETER;
+	if(STUB_ENROLLMENT_FMD_CNT <= g_nEnrollmentCnt) return DPFJ_SUCCESS;
+
+	//another enrollment would change the state here if the callers did not keep theirs apart
+	sched_yield();
+
+	unsigned int nScore = 0;
+	if(0 == g_nEnrollmentCnt){
+		if(sizeof(g_vEnrollmentFmd) < nFmdSize) return DPFJ_E_INVALID_PARAMETER;
+		if(DPFJ_SUCCESS != score_fmds(nFmdType, pFmd, nFmdSize, nViewIdx, nFmdType, pFmd, nFmdSize, nViewIdx, &nScore)) return DPFJ_E_INVALID_FMD;
+		memcpy(g_vEnrollmentFmd, pFmd, nFmdSize);
+		g_nEnrollmentFmdSize = nFmdSize;
+		g_nEnrollmentView = nViewIdx;
+	}
+	else{
+		if(DPFJ_SUCCESS != score_fmds(g_nEnrollmentType, g_vEnrollmentFmd, g_nEnrollmentFmdSize, g_nEnrollmentView,
+			nFmdType, pFmd, nFmdSize, nViewIdx, &nScore)) return DPFJ_E_INVALID_FMD;
+		if(STUB_ENROLLMENT_MAX_SCORE <= nScore) return DPFJ_E_ENROLLMENT_INVALID_SET;
+	}
+	g_nEnrollmentCnt++;
+	return (STUB_ENROLLMENT_FMD_CNT <= g_nEnrollmentCnt) ? DPFJ_SUCCESS : DPFJ_E_MORE_DATA;
+}
+
+int DPAPICALL dpfj_create_enrollment_fmd(unsigned char* pFmd, unsigned int* pnFmdSize){
+	if(NULL == pnFmdSize) return DPFJ_E_INVALID_PARAMETER;
+	if(!__sync_fetch_and_add(&g_bEnrolling, 0)) return DPFJ_E_ENROLLMENT_NOT_STARTED;
+	if(STUB_ENROLLMENT_FMD_CNT > g_nEnrollmentCnt) return DPFJ_E_ENROLLMENT_NOT_READY;
+	if(NULL == pFmd || *pnFmdSize < g_nEnrollmentFmdSize){
+		*pnFmdSize = g_nEnrollmentFmdSize;
+		return DPFJ_E_MORE_DATA;
+	}
+	memcpy(pFmd, g_vEnrollmentFmd, g_nEnrollmentFmdSize);
+	*pnFmdSize = g_nEnrollmentFmdSize;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_finish_enrollment(){
+	__sync_lock_release(&g_bEnrolling);
+	return DPFJ_SUCCESS;
+}
+
+//fields from the capture device id on are the same in both formats, ANSI has the CBEFF product id before them
+void DPAPICALL dpfj_get_fid_record_params(DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, DPFJ_FID_RECORD_PARAMS* pParams){
+	memset(pParams, 0, sizeof(DPFJ_FID_RECORD_PARAMS));
+	unsigned int nHeaderSize = DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH;
+	if(DPFJ_FID_ANSI_381_2004 == nFidType){
+		nHeaderSize = DPFJ_FID_ANSI_381_2004_RECORD_HEADER_LENGTH;
+		pParams->cbeff_id = read_be(pFid + 14, 4);
+	}
+	pParams->record_length = read_be(pFid + 10, 4);
+	const unsigned char* p = pFid + nHeaderSize - 18;
+	pParams->capture_device_id = read_be(p, 2);
+	pParams->acquisition_level = read_be(p + 2, 2);
+	pParams->finger_cnt = p[4];
+	pParams->scale_units = p[5];
+	pParams->scan_res = read_be(p + 6, 2);
+	pParams->image_res = read_be(p + 10, 2);
+	pParams->bpp = p[14];
+	pParams->compression = p[15];
+}
+
+int DPAPICALL dpfj_start_compression(){
+	if(__sync_lock_test_and_set(&g_bCompressing, 1)) return DPFJ_E_COMPRESSION_IN_PROGRESS;
+	g_nWsqBitrate = 0;
+	g_nWsqSize = 0;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_set_wsq_bitrate(unsigned int nBitrate, unsigned int nTolerance){
+	(void)nTolerance;
+	if(!__sync_fetch_and_add(&g_bCompressing, 0)) return DPFJ_E_COMPRESSION_NOT_STARTED;
+	if(0 == nBitrate) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+	g_nWsqBitrate = nBitrate;
+	g_nWsqSize = 0;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_set_wsq_size(unsigned int nSize, unsigned int nTolerance){
+	(void)nTolerance;
+	if(!__sync_fetch_and_add(&g_bCompressing, 0)) return DPFJ_E_COMPRESSION_NOT_STARTED;
+	if(0 == nSize) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+	g_nWsqSize = nSize;
+	g_nWsqBitrate = 0;
+	return DPFJ_SUCCESS;
+}
+
+//the header and the runs of the input become the processed data
+static int compress(const unsigned char* pInput, unsigned int nInputSize, DPFJ_COMPRESSION_ALGORITHM nAlgorithm,
+	unsigned int nWidth, unsigned int nHeight, unsigned int nDpi, unsigned int nBpp){
+	if(!__sync_fetch_and_add(&g_bCompressing, 0)) return DPFJ_E_COMPRESSION_NOT_STARTED;
+	if(NULL == pInput || 0 == nInputSize || (DPFJ_COMPRESSION_WSQ_NIST != nAlgorithm && DPFJ_COMPRESSION_WSQ_AWARE != nAlgorithm)
+		|| (0 == g_nWsqBitrate && 0 == g_nWsqSize)) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+
+	//another operation would change the state here if the callers did not keep theirs apart
+	sched_yield();
+
+	unsigned char* pData = (unsigned char*)malloc(STUB_WSQ_HEADER_LENGTH + 2 * (size_t)nInputSize);
+	if(NULL == pData) return DPFJ_E_COMPRESSION_WSQ_FAILURE;
+	memcpy(pData, "SWSQ", 4);
+	write_be(pData + 4, (unsigned int)nAlgorithm, 4);
+	write_be(pData + 8, g_nWsqBitrate, 4);
+	write_be(pData + 12, g_nWsqSize, 4);
+	write_be(pData + 16, nWidth, 4);
+	write_be(pData + 20, nHeight, 4);
+	write_be(pData + 24, nDpi, 4);
+	write_be(pData + 28, nBpp, 4);
+	unsigned int nSize = STUB_WSQ_HEADER_LENGTH;
+	unsigned int i = 0;
+	while(i < nInputSize){
+		unsigned int nRun = 1;
+		while(i + nRun < nInputSize && 255 > nRun && pInput[i + nRun] == pInput[i]) nRun++;
+		pData[nSize++] = (unsigned char)nRun;
+		pData[nSize++] = pInput[i];
+		i += nRun;
+	}
+
+	if(NULL != g_pProcessed) free(g_pProcessed);
+	g_pProcessed = pData;
+	g_nProcessedSize = nSize;
+	return DPFJ_SUCCESS;
+}
+
+//the runs expand back into the processed data, pData holds the header
+static int expand(const unsigned char* pData, unsigned int nDataSize, DPFJ_COMPRESSION_ALGORITHM nAlgorithm){
+	if(!__sync_fetch_and_add(&g_bCompressing, 0)) return DPFJ_E_COMPRESSION_NOT_STARTED;
+	if(NULL == pData || STUB_WSQ_HEADER_LENGTH > nDataSize || 0 != (nDataSize - STUB_WSQ_HEADER_LENGTH) % 2
+		|| 0 != memcmp(pData, "SWSQ", 4) || (unsigned int)nAlgorithm != read_be(pData + 4, 4)) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+
+	sched_yield();
+
+	unsigned int nSize = 0;
+	unsigned int i = 0;
+	for(i = STUB_WSQ_HEADER_LENGTH; i < nDataSize; i += 2) nSize += pData[i];
+	unsigned char* pImage = (unsigned char*)malloc(0 == nSize ? 1 : nSize);
+	if(NULL == pImage) return DPFJ_E_COMPRESSION_WSQ_FAILURE;
+	unsigned char* p = pImage;
+	for(i = STUB_WSQ_HEADER_LENGTH; i < nDataSize; i += 2){
+		memset(p, pData[i + 1], pData[i]);
+		p += pData[i];
+	}
+
+	if(NULL != g_pProcessed) free(g_pProcessed);
+	g_pProcessed = pImage;
+	g_nProcessedSize = nSize;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_compress_fid(DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize, DPFJ_COMPRESSION_ALGORITHM nAlgorithm){
+	fid_record_t record;
+	if(0 != FidRecord_Parse(&record, nFidType, pFid, nFidSize) || 0 != record.nCompression) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+	return compress(pFid, nFidSize, nAlgorithm, 0, 0, 0, 0);
+}
+
+int DPAPICALL dpfj_compress_raw(const unsigned char* pImage, unsigned int nImageSize, unsigned int nWidth, unsigned int nHeight,
+	unsigned int nDpi, unsigned int nBpp, DPFJ_COMPRESSION_ALGORITHM nAlgorithm){
+	if(0 == nWidth || 0 == nHeight || (unsigned long long)nWidth * nHeight * nBpp / 8 != nImageSize) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+	return compress(pImage, nImageSize, nAlgorithm, nWidth, nHeight, nDpi, nBpp);
+}
+
+int DPAPICALL dpfj_expand_fid(DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize, DPFJ_COMPRESSION_ALGORITHM nAlgorithm){
+	(void)nFidType;
+	return expand(pFid, nFidSize, nAlgorithm);
+}
+
+int DPAPICALL dpfj_expand_raw(const unsigned char* pImage, unsigned int nImageSize, DPFJ_COMPRESSION_ALGORITHM nAlgorithm,
+	unsigned int* pnWidth, unsigned int* pnHeight, unsigned int* pnDpi, unsigned int* pnBpp){
+	if(NULL == pnWidth || NULL == pnHeight || NULL == pnDpi || NULL == pnBpp) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+	int result = expand(pImage, nImageSize, nAlgorithm);
+	if(DPFJ_SUCCESS != result) return result;
+	*pnWidth = read_be(pImage + 16, 4);
+	*pnHeight = read_be(pImage + 20, 4);
+	*pnDpi = read_be(pImage + 24, 4);
+	*pnBpp = read_be(pImage + 28, 4);
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_get_processed_data(unsigned char* pData, unsigned int* pnDataSize){
+	if(NULL == pnDataSize) return DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER;
+	if(!__sync_fetch_and_add(&g_bCompressing, 0)) return DPFJ_E_COMPRESSION_NOT_STARTED;
+	if(NULL == g_pProcessed) return DPFJ_E_NO_DATA;
+	if(NULL == pData || *pnDataSize < g_nProcessedSize){
+		*pnDataSize = g_nProcessedSize;
+		return DPFJ_E_MORE_DATA;
+	}
+	memcpy(pData, g_pProcessed, g_nProcessedSize);
+	*pnDataSize = g_nProcessedSize;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_finish_compression(){
+	if(NULL != g_pProcessed) free(g_pProcessed);
+	g_pProcessed = NULL;
+	g_nProcessedSize = 0;
+	__sync_lock_release(&g_bCompressing);
+	return DPFJ_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfj.h>
+
+//matching in place of libdpfj for the tests of the gallery modules: dpfj_compare() of two views is the sum, over the
+//minutiae of the first one, of the squared distance to the nearest minutia of the second one in x, y and angle, plus
+//STUB_COUNT_PENALTY for every minutia the counts differ by; the same view scores 0, a view moved by a pixel or two
+//scores tens, an unrelated one tens of thousands; dpfj_identify() keeps every view which scores under the threshold
+//divided by the number of FMDs and ranks them by the score, as documented in dpfj.h; extraction always fails
+#define STUB_COUNT_PENALTY 1000
+
+//enrollment: STUB_ENROLLMENT_FMD_CNT FMDs make the enrollment FMD, which is a copy of the first one; an FMD which
+//scores STUB_ENROLLMENT_MAX_SCORE or more against the first one makes the set invalid; the state is global as in
+//libdpfj, a second dpfj_start_enrollment() before dpfj_finish_enrollment() fails with DPFJ_E_ENROLLMENT_IN_PROGRESS
+#define STUB_ENROLLMENT_FMD_CNT   4
+#define STUB_ENROLLMENT_MAX_SCORE 5000
+
+//compression: the stub WSQ data is a header of STUB_WSQ_HEADER_LENGTH bytes with the algorithm, bitrate and target
+//size it was made with and, for raw images, the image parameters, then the input in runs of equal bytes, so images
+//made of runs shrink and expand back exactly; the state is global as in libdpfj, a second dpfj_start_compression()
+//before dpfj_finish_compression() fails with DPFJ_E_COMPRESSION_IN_PROGRESS
+#define STUB_WSQ_HEADER_LENGTH 32
+
+//uncompressed ISO 19794-4-2005 FID of one nWidth x nHeight view, every row of the image is a run of a value chosen by
+//the nSeed
+#define STUB_FID_SIZE(nWidth, nHeight) (DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH + DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH + (nWidth) * (nHeight))
+
+//STUB_MINUTIA_CNT minutiae in a 400 x 400 pixel view
+#define STUB_MINUTIA_CNT 24
+#define STUB_FMD_SIZE    (DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH + DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH + STUB_MINUTIA_CNT * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH + 2)
+
+//single-view FMD of the finger: its minutiae are placed by the nFinger, then every one is moved by up to nShift
+//pixels and by up to one angle unit as chosen by the nVariant; nShift of 0 gives the finger itself
+void Stub_MakeFmd(DPFJ_FMD_FORMAT nType, unsigned int nFinger, unsigned int nShift, unsigned int nVariant,
+	DPFJ_FINGER_POSITION nFingerPos, unsigned char* pFmd, unsigned int* pnFmdSize);
+
+//pFid holds STUB_FID_SIZE(nWidth, nHeight) bytes
+void Stub_MakeFid(unsigned int nWidth, unsigned int nHeight, unsigned int nSeed, unsigned char* pFid, unsigned int* pnFidSize);
+
+//bitrate and target size the stub WSQ data was compressed with, 0 is returned if it is not stub WSQ data
+int Stub_GetWsqParams(const unsigned char* pData, unsigned int nDataSize, unsigned int* pnBitrate, unsigned int* pnSize);
+
+//number of dpfj_compare() calls, for the tests of what is compared
+unsigned int Stub_GetCompareCnt(void);
+
+//dpfj_compare() fails with DPFJ_E_FAILURE once Stub_GetCompareCnt() reaches nCnt, for the tests of interrupted
+//runs; 0 removes the limit
+void Stub_SetCompareLimit(unsigned int nCnt);
+
+//called by dpfj_identify() before it reads the FMDs, so a test can change a gallery while it is searched; set it
+//while no identification runs, NULL removes it
+void Stub_SetIdentifyHook(void (*pfnHook)(void));
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "stubdpfpdd.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+	unsigned int            nIdx;
+	int                     bPlugged;
+	int                     bBusy;
+	unsigned int            nGeneration;  //counts the unplugs, a handle of an older generation is stale
+	int                     bCapturing;
+	int                     bCancel;
+	int                     bFinger;      //put on the reader, taken by the next dpfpdd_capture()
+	void*                   pContext;
+	DPFPDD_CAPTURE_CALLBACK pfnCallback;
+	DPFPDD_CAPTURE_PARAM    cparam;
+} stub_reader_t;
+
+//the handles point here, a handle is a reader and the generation it was opened in
+typedef struct {
+	stub_reader_t* pReader;
+	unsigned int   nGeneration;
+} stub_handle_t;
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_cond = PTHREAD_COND_INITIALIZER;  //signaled on cancel and unplug
+static stub_reader_t   g_vReader[STUB_READER_CNT];
+static int             g_bInitialized = 0;
+static unsigned int    g_nLateMs = 0;
+static unsigned int    g_nInFlightCnt = 0;
+static unsigned int    g_nCaptureCnt = 0;
+static void            (*g_pfnCaptureHook)(DPFPDD_DEV hReader) = NULL;
+
+//called with the mutex locked
+static void init_readers(void){
+	if(g_bInitialized) return;
+	unsigned int i = 0;
+	for(i = 0; i < STUB_READER_CNT; i++){
+		g_vReader[i].nIdx = i;
+		g_vReader[i].bPlugged = 1;
+	}
+	g_bInitialized = 1;
+}
+
+static void deadline_after(unsigned int nMs, struct timespec* pDeadline){
+	clock_gettime(CLOCK_REALTIME, pDeadline);
+	pDeadline->tv_sec += nMs / 1000;
+	pDeadline->tv_nsec += (long)(nMs % 1000) * 1000000;
+	if(1000000000 <= pDeadline->tv_nsec){
+		pDeadline->tv_sec++;
+		pDeadline->tv_nsec -= 1000000000;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// control
+
+void Stub_Unplug(unsigned int nReader){
+	pthread_mutex_lock(&g_mutex);
+	init_readers();
+	g_vReader[nReader].bPlugged = 0;
+	g_vReader[nReader].nGeneration++;
+	pthread_cond_broadcast(&g_cond);
+	pthread_mutex_unlock(&g_mutex);
+}
+
+void Stub_Plug(unsigned int nReader){
+	pthread_mutex_lock(&g_mutex);
+	init_readers();
+	g_vReader[nReader].bPlugged = 1;
+	pthread_mutex_unlock(&g_mutex);
+}
+
+void Stub_SetBusy(unsigned int nReader, int bBusy){
+	pthread_mutex_lock(&g_mutex);
+	init_readers();
+	g_vReader[nReader].bBusy = bBusy;
+	pthread_mutex_unlock(&g_mutex);
+}
+
+void Stub_SetLateCallback(unsigned int nDelayMs){
+	pthread_mutex_lock(&g_mutex);
+	g_nLateMs = nDelayMs;
+	pthread_mutex_unlock(&g_mutex);
+}
+
+unsigned int Stub_GetInFlightCnt(void){
+	pthread_mutex_lock(&g_mutex);
+	unsigned int nCnt = g_nInFlightCnt;
+	pthread_mutex_unlock(&g_mutex);
+	return nCnt;
+}
+
+void Stub_PutFinger(unsigned int nReader){
+	pthread_mutex_lock(&g_mutex);
+	init_readers();
+	g_vReader[nReader].bFinger = 1;
+	pthread_cond_broadcast(&g_cond);
+	pthread_mutex_unlock(&g_mutex);
+}
+
+void Stub_SetCaptureHook(void (*pfnHook)(DPFPDD_DEV hReader)){
+	pthread_mutex_lock(&g_mutex);
+	g_pfnCaptureHook = pfnHook;
+	pthread_mutex_unlock(&g_mutex);
+}
+
+unsigned int Stub_GetCaptureCnt(void){
+	pthread_mutex_lock(&g_mutex);
+	unsigned int nCnt = g_nCaptureCnt;
+	pthread_mutex_unlock(&g_mutex);
+	return nCnt;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// capture
+
+//the handle may be closed before a late callback, the capture keeps what it needs of it
+typedef struct {
+	stub_reader_t* pReader;
+	unsigned int   nGeneration;
+	unsigned int   nDelayMs;
+	unsigned int   nLateMs;
+} stub_capture_t;
+
+static void* capture_thread(void* pContext){
+	stub_capture_t capture = *(stub_capture_t*)pContext;
+	free(pContext);
+	stub_reader_t* pReader = capture.pReader;
+
+	struct timespec deadline;
+	deadline_after((0 != capture.nLateMs) ? capture.nLateMs : capture.nDelayMs, &deadline);
+	pthread_mutex_lock(&g_mutex);
+	while(1){
+		int bGone = (pReader->nGeneration != capture.nGeneration);
+		if(0 == capture.nLateMs && (pReader->bCancel || bGone)) break;
+		if(ETIMEDOUT == pthread_cond_timedwait(&g_cond, &g_mutex, &deadline)) break;
+	}
+	int bCancel = pReader->bCancel && 0 == capture.nLateMs;
+	int bGone = (pReader->nGeneration != capture.nGeneration);
+	DPFPDD_CAPTURE_CALLBACK pfnCallback = pReader->pfnCallback;
+	void* pCallbackContext = pReader->pContext;
+	DPFPDD_CAPTURE_CALLBACK_DATA_0 data;
+	memset(&data, 0, sizeof(data));
+	data.size = sizeof(data);
+	data.capture_parm = pReader->cparam;
+	pReader->bCapturing = 0;
+	pthread_mutex_unlock(&g_mutex);
+
+	unsigned char vImage[STUB_IMAGE_SIZE];
+	memset(vImage, 0, sizeof(vImage));
+	vImage[0] = (unsigned char)pReader->nIdx;
+	if(0 != capture.nLateMs) data.error = DPFPDD_E_FAILURE;
+	else if(bGone) data.error = DPFPDD_E_DEVICE_FAILURE;
+	else if(bCancel){
+		data.capture_result.size = sizeof(data.capture_result);
+		data.capture_result.quality = DPFPDD_QUALITY_CANCELED;
+	}
+	else{
+		data.capture_result.size = sizeof(data.capture_result);
+		data.capture_result.success = 1;
+		data.image_size = sizeof(vImage);
+		data.image_data = vImage;
+	}
+	pfnCallback(pCallbackContext, 0, sizeof(data), &data);
+
+	pthread_mutex_lock(&g_mutex);
+	g_nInFlightCnt--;
+	pthread_mutex_unlock(&g_mutex);
+	return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// library
+
+int DPAPICALL dpfpdd_query_devices(unsigned int* pnCnt, DPFPDD_DEV_INFO* vInfo){
+	pthread_mutex_lock(&g_mutex);
+	init_readers();
+	unsigned int nCnt = 0;
+	unsigned int i = 0;
+	for(i = 0; i < STUB_READER_CNT; i++) nCnt += g_vReader[i].bPlugged;
+	int result = DPFPDD_SUCCESS;
+	if(*pnCnt < nCnt) result = DPFPDD_E_MORE_DATA;
+	else{
+		nCnt = 0;
+		for(i = 0; i < STUB_READER_CNT; i++){
+			if(!g_vReader[i].bPlugged) continue;
+			memset(&vInfo[nCnt], 0, sizeof(DPFPDD_DEV_INFO));
+			vInfo[nCnt].size = sizeof(DPFPDD_DEV_INFO);
+			snprintf(vInfo[nCnt].name, sizeof(vInfo[nCnt].name), "sim%u", i);
+			nCnt++;
+		}
+	}
+	*pnCnt = nCnt;
+	pthread_mutex_unlock(&g_mutex);
+	return result;
+}
+
+int DPAPICALL dpfpdd_open(char* szName, DPFPDD_DEV* phReader){
+	if(NULL == szName || NULL == phReader || 0 != strncmp(szName, "sim", 3)) return DPFPDD_E_INVALID_PARAMETER;
+	unsigned int nIdx = (unsigned int)atoi(szName + 3);
+	if(STUB_READER_CNT <= nIdx) return DPFPDD_E_INVALID_PARAMETER;
+
+	pthread_mutex_lock(&g_mutex);
+	init_readers();
+	stub_reader_t* pReader = &g_vReader[nIdx];
+	int result = DPFPDD_SUCCESS;
+	if(!pReader->bPlugged) result = DPFPDD_E_INVALID_PARAMETER;
+	else if(pReader->bBusy) result = DPFPDD_E_DEVICE_BUSY;
+	unsigned int nGeneration = pReader->nGeneration;
+	pthread_mutex_unlock(&g_mutex);
+	if(DPFPDD_SUCCESS != result) return result;
+
+	stub_handle_t* pHandle = (stub_handle_t*)malloc(sizeof(stub_handle_t));
+	if(NULL == pHandle) return DPFPDD_E_FAILURE;
+	pHandle->pReader = pReader;
+	pHandle->nGeneration = nGeneration;
+	*phReader = pHandle;
+	return DPFPDD_SUCCESS;
+}
+
+//captures in flight run on, they only keep the reader and the generation of the handle
+int DPAPICALL dpfpdd_close(DPFPDD_DEV hReader){
+	if(NULL == hReader) return DPFPDD_E_INVALID_PARAMETER;
+	free(hReader);
+	return DPFPDD_SUCCESS;
+}
+
+//the finger is seen 5 to 25 ms after it is put on the reader
+int DPAPICALL dpfpdd_capture(DPFPDD_DEV hReader, DPFPDD_CAPTURE_PARAM* pParam, unsigned int nTimeout,
+	DPFPDD_CAPTURE_RESULT* pResult, unsigned int* pnImageSize, unsigned char* pImage){
+	if(NULL == hReader || NULL == pParam || NULL == pResult || NULL == pnImageSize) return DPFPDD_E_INVALID_PARAMETER;
+	if(NULL == pImage || STUB_IMAGE_SIZE > *pnImageSize){
+		*pnImageSize = STUB_IMAGE_SIZE;
+		return DPFPDD_E_MORE_DATA;
+	}
+	stub_handle_t* pHandle = (stub_handle_t*)hReader;
+	stub_reader_t* pReader = pHandle->pReader;
+
+	pthread_mutex_lock(&g_mutex);
+	void (*pfnHook)(DPFPDD_DEV) = g_pfnCaptureHook;
+	pthread_mutex_unlock(&g_mutex);
+	if(NULL != pfnHook) pfnHook(hReader);
+
+	struct timespec deadline;
+	deadline_after(nTimeout, &deadline);
+	pthread_mutex_lock(&g_mutex);
+	int result = DPFPDD_SUCCESS;
+	if(pReader->nGeneration != pHandle->nGeneration) result = DPFPDD_E_DEVICE_FAILURE;
+	else if(pReader->bCapturing) result = DPFPDD_E_DEVICE_BUSY;
+	if(DPFPDD_SUCCESS != result){
+		pthread_mutex_unlock(&g_mutex);
+		return result;
+	}
+	pReader->bCapturing = 1;
+	pReader->bCancel = 0;
+	g_nCaptureCnt++;
+	int bTimedOut = 0;
+	while(!pReader->bFinger && !pReader->bCancel && pReader->nGeneration == pHandle->nGeneration && !bTimedOut){
+		if((unsigned int)(-1) == nTimeout) pthread_cond_wait(&g_cond, &g_mutex);
+		else bTimedOut = (ETIMEDOUT == pthread_cond_timedwait(&g_cond, &g_mutex, &deadline));
+	}
+	int bFinger = pReader->bFinger && !pReader->bCancel;
+	if(bFinger){
+		//the finger is there, only a cancel stops the capture now
+		deadline_after(5 + (unsigned int)rand() % 21, &deadline);
+		while(!pReader->bCancel && ETIMEDOUT != pthread_cond_timedwait(&g_cond, &g_mutex, &deadline));
+		bFinger = !pReader->bCancel;
+	}
+	if(bFinger) pReader->bFinger = 0;
+	int bCancel = pReader->bCancel;
+	int bGone = (pReader->nGeneration != pHandle->nGeneration);
+	pReader->bCapturing = 0;
+	pReader->bCancel = 0;
+	pthread_mutex_unlock(&g_mutex);
+	if(bGone) return DPFPDD_E_DEVICE_FAILURE;
+
+	pResult->success = 0;
+	pResult->quality = 0;
+	if(bCancel) pResult->quality = DPFPDD_QUALITY_CANCELED;
+	else if(bFinger){
+		pResult->success = 1;
+		memset(pImage, 0, STUB_IMAGE_SIZE);
+		pImage[0] = (unsigned char)pReader->nIdx;
+		*pnImageSize = STUB_IMAGE_SIZE;
+	}
+	else pResult->quality = DPFPDD_QUALITY_TIMED_OUT;
+	return DPFPDD_SUCCESS;
+}
+
+int DPAPICALL dpfpdd_capture_async(DPFPDD_DEV hReader, DPFPDD_CAPTURE_PARAM* pParam, void* pContext,
+	DPFPDD_CAPTURE_CALLBACK pfnCallback){
+	if(NULL == hReader || NULL == pParam || NULL == pfnCallback) return DPFPDD_E_INVALID_PARAMETER;
+	stub_handle_t* pHandle = (stub_handle_t*)hReader;
+	stub_reader_t* pReader = pHandle->pReader;
+
+	stub_capture_t* pCapture = (stub_capture_t*)malloc(sizeof(stub_capture_t));
+	if(NULL == pCapture) return DPFPDD_E_FAILURE;
+	pCapture->pReader = pReader;
+	pCapture->nGeneration = pHandle->nGeneration;
+
+	pthread_mutex_lock(&g_mutex);
+	int result = DPFPDD_SUCCESS;
+	if(pReader->nGeneration != pHandle->nGeneration) result = DPFPDD_E_DEVICE_FAILURE;
+	else if(pReader->bCapturing) result = DPFPDD_E_DEVICE_BUSY;
+	if(DPFPDD_SUCCESS == result){
+		pReader->bCapturing = 1;
+		pReader->bCancel = 0;
+		pReader->pContext = pContext;
+		pReader->pfnCallback = pfnCallback;
+		pReader->cparam = *pParam;
+		pCapture->nDelayMs = 5 + (unsigned int)rand() % 21;
+		pCapture->nLateMs = g_nLateMs;
+		g_nInFlightCnt++;
+	}
+	pthread_mutex_unlock(&g_mutex);
+	if(DPFPDD_SUCCESS != result){
+		free(pCapture);
+		return result;
+	}
+
+	//detached, the callback may start the next capture of the reader from the thread of the application right away
+	pthread_t thread;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if(0 != pthread_create(&thread, &attr, capture_thread, pCapture)){
+		pthread_mutex_lock(&g_mutex);
+		pReader->bCapturing = 0;
+		g_nInFlightCnt--;
+		pthread_mutex_unlock(&g_mutex);
+		free(pCapture);
+		result = DPFPDD_E_FAILURE;
+	}
+	pthread_attr_destroy(&attr);
+	return result;
+}
+
+int DPAPICALL dpfpdd_cancel(DPFPDD_DEV hReader){
+	if(NULL == hReader) return DPFPDD_E_INVALID_PARAMETER;
+	stub_reader_t* pReader = ((stub_handle_t*)hReader)->pReader;
+	pthread_mutex_lock(&g_mutex);
+	if(pReader->bCapturing) pReader->bCancel = 1;
+	pthread_cond_broadcast(&g_cond);
+	pthread_mutex_unlock(&g_mutex);
+	return DPFPDD_SUCCESS;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfpdd.h>
+
+//simulated readers in place of libdpfpdd for the tests of the capture modules, no hardware needed: readers "sim0"
+//to "sim11" are listed, every dpfpdd_capture_async() is called back from a thread of its own after 5 to 25 ms with
+//an image of STUB_IMAGE_SIZE bytes, the first one is the number of the reader; dpfpdd_capture() waits for a finger
+//put on the reader with Stub_PutFinger(), and times out or is canceled as the library's
+#define STUB_READER_CNT  12
+#define STUB_IMAGE_SIZE  1000
+
+//the reader disappears from the list, its capture in flight fails with DPFPDD_E_DEVICE_FAILURE; a handle opened
+//before does not work anymore after the reader is plugged in again
+void Stub_Unplug(unsigned int nReader);
+void Stub_Plug(unsigned int nReader);
+
+//dpfpdd_open() of the reader fails with DPFPDD_E_DEVICE_BUSY while set
+void Stub_SetBusy(unsigned int nReader, int bBusy);
+
+//while not 0, captures ignore the cancel and are called back with DPFPDD_E_FAILURE only after nDelayMs
+void Stub_SetLateCallback(unsigned int nDelayMs);
+
+//number of dpfpdd_capture_async() calls whose callback has not returned yet
+unsigned int Stub_GetInFlightCnt(void);
+
+//the next dpfpdd_capture() on the reader gets an image after 5 to 25 ms
+void Stub_PutFinger(unsigned int nReader);
+
+//called by dpfpdd_capture() before the capture starts, a dpfpdd_cancel() from the hook reaches no capture; NULL removes it
+void Stub_SetCaptureHook(void (*pfnHook)(DPFPDD_DEV hReader));
+
+//number of dpfpdd_capture() calls which waited for a finger
+unsigned int Stub_GetCaptureCnt(void);
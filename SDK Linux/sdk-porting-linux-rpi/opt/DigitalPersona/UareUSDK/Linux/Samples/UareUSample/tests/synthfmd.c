@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "synthfmd.h"
+#include "../record.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//minutiae are made as points around which the ridge phase turns by one full period, a ridge ends or forks there;
+//a fractional turn, as around a core, would leave a seam of ridge endings whose extraction changes with every shift
+//or noise, and the mates would not match
+#define SYNTH_MINUTIA_CNT 30
+#define SYNTH_MINUTIA_GAP 24   //pixels between minutiae, closer ones of opposite turn cancel out
+
+static void synth_image(unsigned int nSeed, unsigned char* pImage){
+	double vX[SYNTH_MINUTIA_CNT], vY[SYNTH_MINUTIA_CNT], vTurn[SYNTH_MINUTIA_CNT];
+	unsigned int i = 0, x = 0, y = 0;
+	srand(nSeed);
+
+	//ridges about 9.5 pixels apart in a direction of the seed, bent by two slow waves
+	double dDirection = (rand() % 180) * M_PI / 180;
+	double dBendX = (rand() % 200) / 100.0 * 6;
+	double dBendY = (rand() % 200) / 100.0 * 6;
+	double dPhaseX = rand() % 100;
+	double dPhaseY = rand() % 100;
+
+	//minutiae inside the finger, away from its edge and from each other
+	unsigned int nCnt = 0, nTry = 0;
+	for(nTry = 0; nCnt < SYNTH_MINUTIA_CNT && nTry < 10000; nTry++){
+		double dX = rand() % SYNTH_WIDTH;
+		double dY = rand() % SYNTH_HEIGHT;
+		double dEx = (dX - SYNTH_WIDTH / 2.0) / (SYNTH_WIDTH * 0.36);
+		double dEy = (dY - SYNTH_HEIGHT / 2.0) / (SYNTH_HEIGHT * 0.39);
+		if(dEx * dEx + dEy * dEy > 1) continue;
+		for(i = 0; i < nCnt; i++) if((vX[i] - dX) * (vX[i] - dX) + (vY[i] - dY) * (vY[i] - dY) < SYNTH_MINUTIA_GAP * SYNTH_MINUTIA_GAP) break;
+		if(i < nCnt) continue;
+		vX[nCnt] = dX;
+		vY[nCnt] = dY;
+		vTurn[nCnt] = (rand() % 2) ? 1 : -1;
+		nCnt++;
+	}
+
+	for(y = 0; y < SYNTH_HEIGHT; y++){
+		for(x = 0; x < SYNTH_WIDTH; x++){
+			double dPhase = 0.66 * (x * cos(dDirection) + y * sin(dDirection)) + dBendX * sin(y / 70.0 + dPhaseX) + dBendY * sin(x / 60.0 + dPhaseY);
+			for(i = 0; i < nCnt; i++) dPhase += vTurn[i] * atan2(y - vY[i], x - vX[i]);
+			double dX = x - SYNTH_WIDTH / 2.0;
+			double dY = y - SYNTH_HEIGHT / 2.0;
+			double dEx = dX / (SYNTH_WIDTH * 0.42);
+			double dEy = dY / (SYNTH_HEIGHT * 0.45);
+			pImage[y * SYNTH_WIDTH + x] = (dEx * dEx + dEy * dEy > 1) ? 255 : (unsigned char)(128 + 110 * sin(dPhase));
+		}
+	}
+}
+
+int SynthFmd_Create(unsigned int nSeed, unsigned int nShift, unsigned int nNoise, unsigned int nMinMinutiae,
+	unsigned char* pFmd, unsigned int* pnFmdSize){
+	static unsigned char vFinger[SYNTH_WIDTH * SYNTH_HEIGHT];
+	static unsigned char vImage[SYNTH_WIDTH * SYNTH_HEIGHT];
+	synth_image(nSeed, vFinger);
+
+	//moved down and right, the uncovered edge is background
+	srand(nSeed * 7 + nShift);
+	unsigned int x = 0, y = 0;
+	for(y = 0; y < SYNTH_HEIGHT; y++){
+		for(x = 0; x < SYNTH_WIDTH; x++){
+			int nX = (int)x - (int)nShift;
+			int nY = (int)y - (int)nShift / 2;
+			int nValue = (0 > nX || 0 > nY) ? 255 : vFinger[nY * SYNTH_WIDTH + nX];
+			if(0 != nNoise) nValue += rand() % (int)(2 * nNoise + 1) - (int)nNoise;
+			vImage[y * SYNTH_WIDTH + x] = (unsigned char)((0 > nValue) ? 0 : ((255 < nValue) ? 255 : nValue));
+		}
+	}
+
+	unsigned int nFmdSize = MAX_FMD_SIZE;
+	int result = dpfj_create_fmd_from_raw(vImage, sizeof(vImage), SYNTH_WIDTH, SYNTH_HEIGHT, SYNTH_DPI,
+		DPFJ_POSITION_UNKNOWN, 0, DPFJ_FMD_ANSI_378_2004, pFmd, &nFmdSize);
+	if(DPFJ_SUCCESS != result) return result;
+
+	fmd_record_t record;
+	fmd_view_t view;
+	result = FmdRecord_Parse(&record, DPFJ_FMD_ANSI_378_2004, pFmd, nFmdSize);
+	if(0 == result) result = FmdRecord_GetView(&record, 0, &view);
+	if(0 == result && nMinMinutiae > view.nMinutiaCnt) result = DPFJ_E_FAILURE;
+	if(0 == result) *pnFmdSize = nFmdSize;
+	return result;
+}
+
+//the minutiae of the first view are rewritten in place, type and quality are kept
+static int move_minutiae(unsigned char* pFmd, unsigned int nFmdSize, unsigned int nSeed, int bScramble, unsigned int nShift){
+	fmd_record_t record;
+	fmd_view_t view;
+	int result = FmdRecord_Parse(&record, DPFJ_FMD_ANSI_378_2004, pFmd, nFmdSize);
+	if(0 == result) result = FmdRecord_GetView(&record, 0, &view);
+	if(0 != result) return result;
+
+	srand(nSeed);
+	unsigned int i = 0;
+	for(i = 0; i < view.nMinutiaCnt; i++){
+		fmd_minutia_t minutia;
+		FmdView_GetMinutia(&view, i, &minutia);
+		int nX = (int)minutia.nX;
+		int nY = (int)minutia.nY;
+		int nAngle = (int)minutia.nAngle;
+		if(bScramble){
+			nX = rand() % (int)record.nWidth;
+			nY = rand() % (int)record.nHeight;
+			nAngle = rand() % 180;
+		}
+		else if(0 != nShift){
+			nX += rand() % (int)(2 * nShift + 1) - (int)nShift;
+			nY += rand() % (int)(2 * nShift + 1) - (int)nShift;
+			nAngle = (nAngle + 180 + rand() % 3 - 1) % 180;
+		}
+		nX = (0 > nX) ? 0 : ((int)record.nWidth <= nX ? (int)record.nWidth - 1 : nX);
+		nY = (0 > nY) ? 0 : ((int)record.nHeight <= nY ? (int)record.nHeight - 1 : nY);
+
+		unsigned char* p = pFmd + (view.pMinutiae - pFmd) + i * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH;
+		p[0] = (unsigned char)((minutia.nType << 6) | ((nX >> 8) & 0x3f));
+		p[1] = (unsigned char)nX;
+		p[2] = (unsigned char)((p[2] & 0xc0) | ((nY >> 8) & 0x3f));
+		p[3] = (unsigned char)nY;
+		p[4] = (unsigned char)nAngle;
+	}
+	return 0;
+}
+
+int SynthFmd_Jitter(const unsigned char* pFmd, unsigned int nFmdSize, unsigned int nSeed, unsigned int nShift, unsigned char* pOut){
+	memcpy(pOut, pFmd, nFmdSize);
+	return move_minutiae(pOut, nFmdSize, nSeed, 0, nShift);
+}
+
+int SynthFmd_Scramble(const unsigned char* pFmd, unsigned int nFmdSize, unsigned int nSeed, unsigned char* pOut){
+	memcpy(pOut, pFmd, nFmdSize);
+	return move_minutiae(pOut, nFmdSize, nSeed, 1, 0);
+}
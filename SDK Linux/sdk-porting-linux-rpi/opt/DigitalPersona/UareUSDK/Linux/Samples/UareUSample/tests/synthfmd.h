@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#pragma once
+
+#include <dpfj.h>
+
+//synthetic ANSI 378-2004 FMDs for the benchmarks, no reader needed: a bent ridge pattern with about 30 ridge endings and
+//forks placed by the seed is drawn into a SYNTH_WIDTH x SYNTH_HEIGHT image at SYNTH_DPI and extracted by libdpfj
+#define SYNTH_WIDTH  360
+#define SYNTH_HEIGHT 400
+#define SYNTH_DPI    500
+
+//finger of the seed; a mate of it is the same finger moved by nShift pixels with nNoise of grey level noise, 0 and 0
+//give the finger itself; DPFJ_E_FAILURE is returned if fewer than nMinMinutiae minutiae were extracted
+int SynthFmd_Create(unsigned int nSeed, unsigned int nShift, unsigned int nNoise, unsigned int nMinMinutiae,
+	unsigned char* pFmd, unsigned int* pnFmdSize);
+
+//cheap variants of an extracted FMD for large galleries, pOut receives nFmdSize bytes: Jitter moves every minutia of the
+//first view by up to nShift pixels, which keeps it a mate; Scramble places the minutiae anew, which makes a non-mate
+//with the same headers and number of minutiae
+int SynthFmd_Jitter(const unsigned char* pFmd, unsigned int nFmdSize, unsigned int nSeed, unsigned int nShift, unsigned char* pOut);
+int SynthFmd_Scramble(const unsigned char* pFmd, unsigned int nFmdSize, unsigned int nSeed, unsigned char* pOut);
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include <stdio.h>
+
+//the module is included to watch the files it opens
+static FILE* watch_fopen(const char* szPath, const char* szMode);
+#define fopen watch_fopen
+#include "../archiver.c"
+#undef fopen
+
+#include "stubdpfj.h"
+#include "check.h"
+
+#define TEST_WIDTH    64
+#define TEST_HEIGHT   48
+#define TEST_FID_SIZE STUB_FID_SIZE(TEST_WIDTH, TEST_HEIGHT)
+#define TEST_FID_CNT  12
+
+static char g_szDir[64];
+
+//files read and written by the archiver; an item read is in flight until it is written, and holds at least the size
+//of its image until then, so no more items than g_nMaxInFlight can be read ahead of the writes
+static pthread_mutex_t g_mutexFiles = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int g_nReadCnt = 0;
+static unsigned int g_nWriteCnt = 0;
+static unsigned int g_nMaxInFlight = 0;
+static unsigned int g_nWriteDelayMs = 0;
+
+//the writes are slowed down, so the reads would run ahead of them without the memory limit; the files which are
+//skipped are read too, they are not counted
+static FILE* watch_fopen(const char* szPath, const char* szMode){
+	if('r' == szMode[0]){
+		if(NULL == strstr(szPath, "/fid")) return fopen(szPath, szMode);
+		pthread_mutex_lock(&g_mutexFiles);
+		g_nReadCnt++;
+		CHECK(g_nReadCnt - g_nWriteCnt <= g_nMaxInFlight);
+		pthread_mutex_unlock(&g_mutexFiles);
+		return fopen(szPath, szMode);
+	}
+
+	//written under a hidden temporary name, the final one is not there yet
+	const char* szName = strrchr(szPath, '/') + 1;
+	size_t nLength = strlen(szName);
+	CHECK('.' == szName[0] && 5 < nLength && 0 == strcmp(szName + nLength - 4, ".tmp"));
+	char szFinal[PATH_MAX];
+	snprintf(szFinal, sizeof(szFinal), "%.*s%.*s", (int)(szName - szPath), szPath, (int)(nLength - 5), szName + 1);
+	struct stat st;
+	CHECK(0 != stat(szFinal, &st) || !S_ISREG(st.st_mode));
+
+	pthread_mutex_lock(&g_mutexFiles);
+	g_nWriteCnt++;
+	pthread_mutex_unlock(&g_mutexFiles);
+	usleep(g_nWriteDelayMs * 1000);
+	return fopen(szPath, szMode);
+}
+
+static void watch_files(unsigned int nMaxInFlight, unsigned int nWriteDelayMs){
+	pthread_mutex_lock(&g_mutexFiles);
+	g_nReadCnt = 0;
+	g_nWriteCnt = 0;
+	g_nMaxInFlight = nMaxInFlight;
+	g_nWriteDelayMs = nWriteDelayMs;
+	pthread_mutex_unlock(&g_mutexFiles);
+}
+
+static void make_path(const char* szName, char* szPath){
+	snprintf(szPath, PATH_MAX, "%s/%s", g_szDir, szName);
+}
+
+static void put_file(const char* szName, const unsigned char* pData, unsigned int nSize){
+	char szPath[PATH_MAX];
+	make_path(szName, szPath);
+	FILE* pFile = fopen(szPath, "wb");
+	CHECK(NULL != pFile);
+	if(NULL == pFile) return;
+	CHECK(nSize == fwrite(pData, 1, nSize, pFile));
+	fclose(pFile);
+}
+
+static unsigned int load_file(const char* szName, unsigned char* pData, unsigned int nSize){
+	char szPath[PATH_MAX];
+	make_path(szName, szPath);
+	FILE* pFile = fopen(szPath, "rb");
+	if(NULL == pFile) return 0;
+	unsigned int nRead = (unsigned int)fread(pData, 1, nSize, pFile);
+	fclose(pFile);
+	return nRead;
+}
+
+static void make_dir(const char* szName){
+	char szPath[PATH_MAX];
+	make_path(szName, szPath);
+	CHECK(0 == mkdir(szPath, 0700));
+}
+
+//entries of the directory, files and directories in it are removed
+static unsigned int list_dir(const char* szName, int bRemove){
+	char szPath[PATH_MAX];
+	make_path(szName, szPath);
+	DIR* pDir = opendir(szPath);
+	if(NULL == pDir) return 0;
+	unsigned int nCnt = 0;
+	struct dirent* pEntry = NULL;
+	while(NULL != (pEntry = readdir(pDir))){
+		if(0 == strcmp(pEntry->d_name, ".") || 0 == strcmp(pEntry->d_name, "..")) continue;
+		nCnt++;
+		if(bRemove){
+			char szEntry[PATH_MAX + NAME_MAX + 2];
+			snprintf(szEntry, sizeof(szEntry), "%s/%s", szPath, pEntry->d_name);
+			if(0 != unlink(szEntry)) rmdir(szEntry);
+		}
+	}
+	closedir(pDir);
+	if(bRemove) rmdir(szPath);
+	return nCnt;
+}
+
+//TEST_FID_CNT images, a text file and a compressed image which are skipped, and a directory which is not read
+static void make_input(void){
+	make_dir("in");
+	make_dir("in/sub");
+	unsigned char vFid[TEST_FID_SIZE];
+	unsigned int nFidSize = 0;
+	char szName[NAME_MAX];
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FID_CNT; i++){
+		Stub_MakeFid(TEST_WIDTH, TEST_HEIGHT, i, vFid, &nFidSize);
+		snprintf(szName, sizeof(szName), "in/fid%02u.iso", i);
+		put_file(szName, vFid, nFidSize);
+	}
+	vFid[DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH - 3] = 2;
+	put_file("in/compressed.iso", vFid, nFidSize);
+	const char* szText = "not a fingerprint image, a note left in the directory";
+	put_file("in/notes.txt", (const unsigned char*)szText, (unsigned int)strlen(szText));
+}
+
+//every image archived expands back to the one read
+static unsigned int check_output(const char* szOutDir){
+	compressor_t* pCompressor = NULL;
+	CHECK(0 == Compressor_Create(DPFJ_COMPRESSION_WSQ_NIST, &pCompressor));
+	if(NULL == pCompressor) return 0;
+	unsigned int nFoundCnt = 0;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FID_CNT; i++){
+		char szName[NAME_MAX];
+		snprintf(szName, sizeof(szName), "%s/fid%02u.iso", szOutDir, i);
+		unsigned char vData[TEST_FID_SIZE];
+		unsigned int nDataSize = load_file(szName, vData, sizeof(vData));
+		if(0 == nDataSize) continue;
+		nFoundCnt++;
+
+		unsigned char vFid[TEST_FID_SIZE];
+		unsigned int nFidSize = 0;
+		Stub_MakeFid(TEST_WIDTH, TEST_HEIGHT, i, vFid, &nFidSize);
+		unsigned char vExpanded[TEST_FID_SIZE];
+		unsigned int nExpandedSize = sizeof(vExpanded);
+		CHECK(nDataSize < nFidSize);
+		CHECK(0 == Compressor_ExpandFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vData, nDataSize, vExpanded, &nExpandedSize));
+		CHECK(nFidSize == nExpandedSize && 0 == memcmp(vFid, vExpanded, nFidSize));
+	}
+	Compressor_Destroy(pCompressor);
+	return nFoundCnt;
+}
+
+static void run(const char* szOutDir, unsigned int nWorkerCnt, unsigned int nMemoryLimit, archiver_stats_t* pStats){
+	char szInPath[PATH_MAX];
+	char szOutPath[PATH_MAX];
+	make_path("in", szInPath);
+	make_path(szOutDir, szOutPath);
+	CHECK(0 == Archiver_Run(szInPath, szOutPath, nWorkerCnt, nMemoryLimit, 75, pStats));
+}
+
+//the reads wait for the writes once the images in flight fill the limit
+static void test_memory_limit(void){
+	watch_files(3, 5);
+	make_dir("out");
+	archiver_stats_t stats;
+	run("out", 3, TEST_FID_SIZE * 7 / 2, &stats);
+	CHECK(TEST_FID_CNT == stats.nArchivedCnt && 2 == stats.nSkippedCnt && 0 == stats.nFailedCnt);
+	CHECK(TEST_FID_CNT == g_nReadCnt && TEST_FID_CNT == g_nWriteCnt);
+	CHECK(TEST_FID_CNT == check_output("out"));
+	CHECK(TEST_FID_CNT == list_dir("out", 1));
+}
+
+//an image larger than the limit is archived alone
+static void test_oversize(void){
+	watch_files(1, 2);
+	make_dir("out");
+	archiver_stats_t stats;
+	run("out", 2, TEST_FID_SIZE / 2, &stats);
+	CHECK(TEST_FID_CNT == stats.nArchivedCnt && 2 == stats.nSkippedCnt && 0 == stats.nFailedCnt);
+	CHECK(TEST_FID_CNT == check_output("out"));
+	CHECK(TEST_FID_CNT == list_dir("out", 1));
+}
+
+//the rename onto a directory of the name fails, the temporary file is removed and the directory stays
+static void test_rename_fails(void){
+	watch_files(TEST_FID_CNT + 2, 0);
+	make_dir("out");
+	make_dir("out/fid03.iso");
+	archiver_stats_t stats;
+	run("out", 2, 16 * TEST_FID_SIZE, &stats);
+	CHECK(TEST_FID_CNT - 1 == stats.nArchivedCnt && 2 == stats.nSkippedCnt && 1 == stats.nFailedCnt);
+	CHECK(TEST_FID_CNT - 1 == check_output("out"));
+	char szPath[PATH_MAX];
+	struct stat st;
+	make_path("out/fid03.iso", szPath);
+	CHECK(0 == stat(szPath, &st) && S_ISDIR(st.st_mode));
+	CHECK(0 == list_dir("out/fid03.iso", 1));
+	CHECK(TEST_FID_CNT - 1 == list_dir("out", 1));
+}
+
+//the archives would replace the images, the output must be another directory and must exist
+static void test_output_dir(void){
+	watch_files(0, 0);
+	char szInPath[PATH_MAX];
+	char szSamePath[PATH_MAX];
+	char szMissingPath[PATH_MAX];
+	make_path("in", szInPath);
+	make_path("in/.", szSamePath);
+	make_path("missing", szMissingPath);
+	archiver_stats_t stats;
+	CHECK(EINVAL == Archiver_Run(szInPath, szInPath, 1, TEST_FID_SIZE, 75, &stats));
+	CHECK(EINVAL == Archiver_Run(szInPath, szSamePath, 1, TEST_FID_SIZE, 75, &stats));
+	CHECK(ENOENT == Archiver_Run(szInPath, szMissingPath, 1, TEST_FID_SIZE, 75, &stats));
+	CHECK(EINVAL == Archiver_Run(szInPath, szMissingPath, 1, 0, 75, &stats));
+	CHECK(0 == g_nReadCnt && 0 == g_nWriteCnt);
+	CHECK(TEST_FID_CNT + 3 == list_dir("in", 0));
+}
+
+int main(void){
+	snprintf(g_szDir, sizeof(g_szDir), "/tmp/test_archiver_XXXXXX");
+	CHECK(NULL != mkdtemp(g_szDir));
+	make_input();
+
+	test_memory_limit();
+	test_oversize();
+	test_rename_fails();
+	test_output_dir();
+
+	list_dir("in", 1);
+	rmdir(g_szDir);
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
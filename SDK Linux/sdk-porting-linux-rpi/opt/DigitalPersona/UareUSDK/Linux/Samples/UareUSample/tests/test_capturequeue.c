@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../capturequeue.h"
+#include "stubdpfpdd.h"
+#include "check.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REAPER_CNT 4
+
+static DPFPDD_DEV g_vReader[STUB_READER_CNT];
+static unsigned char g_vImage[STUB_READER_CNT][STUB_IMAGE_SIZE];
+
+static int wait_stub_idle(unsigned int nTimeoutMs){
+	unsigned int i = 0;
+	for(i = 0; i < nTimeoutMs / 10 && 0 != Stub_GetInFlightCnt(); i++) usleep(10000);
+	return 0 == Stub_GetInFlightCnt();
+}
+
+static void make_sqe(unsigned int nReader, unsigned int nImageSize, capture_sqe_t* pSqe){
+	pSqe->hReader = g_vReader[nReader];
+	pSqe->pImage = g_vImage[nReader];
+	pSqe->nImageSize = nImageSize;
+	pSqe->nUserData = nReader;
+}
+
+typedef struct {
+	capture_queue_t* pQueue;
+	unsigned int     nTarget;
+	unsigned int     nTotal;    //completions reaped by all the reapers
+	unsigned int     nMaxBatch;
+	pthread_mutex_t  mutex;
+} reapers_t;
+
+//reaps in batches and submits the next capture of every reader it reaped
+static void* reaper_thread(void* pContext){
+	reapers_t* pReapers = (reapers_t*)pContext;
+	capture_cqe_t vCqe[8];
+	while(1){
+		pthread_mutex_lock(&pReapers->mutex);
+		int bDone = (pReapers->nTotal >= pReapers->nTarget);
+		pthread_mutex_unlock(&pReapers->mutex);
+		if(bDone) break;
+
+		unsigned int nReaped = 0;
+		if(0 != CaptureQueue_Reap(pReapers->pQueue, vCqe, 8, 1, 100, &nReaped)) continue;
+		unsigned int i = 0;
+		for(i = 0; i < nReaped; i++){
+			unsigned int nReader = (unsigned int)vCqe[i].nUserData;
+			CHECK(0 == vCqe[i].nResult && g_vImage[nReader] == vCqe[i].pImage);
+			CHECK(STUB_IMAGE_SIZE == vCqe[i].nImageSize && nReader == g_vImage[nReader][0]);
+			capture_sqe_t sqe;
+			make_sqe(nReader, STUB_IMAGE_SIZE, &sqe);
+			unsigned int nSubmitted = 0;
+			CHECK(0 == CaptureQueue_Submit(pReapers->pQueue, &sqe, 1, &nSubmitted) && 1 == nSubmitted);
+		}
+		pthread_mutex_lock(&pReapers->mutex);
+		pReapers->nTotal += nReaped;
+		if(nReaped > pReapers->nMaxBatch) pReapers->nMaxBatch = nReaped;
+		pthread_mutex_unlock(&pReapers->mutex);
+	}
+	return NULL;
+}
+
+//all readers capture continuously, several threads reap
+static void test_reapers(void){
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	capture_queue_t* pQueue = NULL;
+	CHECK(0 == CaptureQueue_Create(&cparam, 16, &pQueue));
+	if(NULL == pQueue) return;
+
+	capture_sqe_t vSqe[STUB_READER_CNT];
+	unsigned int i = 0;
+	for(i = 0; i < STUB_READER_CNT; i++) make_sqe(i, STUB_IMAGE_SIZE, &vSqe[i]);
+	unsigned int nSubmitted = 0;
+	CHECK(0 == CaptureQueue_Submit(pQueue, vSqe, STUB_READER_CNT, &nSubmitted));
+	CHECK(STUB_READER_CNT == nSubmitted);
+
+	reapers_t reapers;
+	memset(&reapers, 0, sizeof(reapers));
+	reapers.pQueue = pQueue;
+	reapers.nTarget = 2000;
+	pthread_mutex_init(&reapers.mutex, NULL);
+	pthread_t vThread[REAPER_CNT];
+	for(i = 0; i < REAPER_CNT; i++) pthread_create(&vThread[i], NULL, reaper_thread, &reapers);
+	for(i = 0; i < REAPER_CNT; i++) pthread_join(vThread[i], NULL);
+	pthread_mutex_destroy(&reapers.mutex);
+	CHECK(reapers.nTotal >= reapers.nTarget);
+
+	//the captures still in flight are canceled
+	CaptureQueue_Destroy(pQueue);
+	CHECK(wait_stub_idle(1000));
+}
+
+//the depth bounds the captures taken, a buffer too small completes with the size needed
+static void test_depth(void){
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	capture_queue_t* pQueue = NULL;
+	CHECK(0 == CaptureQueue_Create(&cparam, 2, &pQueue));
+	if(NULL == pQueue) return;
+
+	capture_sqe_t vSqe[3];
+	make_sqe(1, STUB_IMAGE_SIZE, &vSqe[0]);
+	make_sqe(2, 10, &vSqe[1]);
+	make_sqe(3, STUB_IMAGE_SIZE, &vSqe[2]);
+	unsigned int nSubmitted = 0;
+	CHECK(0 == CaptureQueue_Submit(pQueue, vSqe, 3, &nSubmitted));
+	CHECK(2 == nSubmitted);
+
+	capture_cqe_t vCqe[4];
+	unsigned int nReaped = 0;
+	CHECK(0 == CaptureQueue_Reap(pQueue, vCqe, 4, 2, -1, &nReaped));
+	CHECK(2 == nReaped);
+	unsigned int i = 0;
+	for(i = 0; i < nReaped; i++){
+		if(1 == vCqe[i].nUserData) CHECK(0 == vCqe[i].nResult && STUB_IMAGE_SIZE == vCqe[i].nImageSize);
+		else CHECK(2 == vCqe[i].nUserData && DPFPDD_E_MORE_DATA == vCqe[i].nResult && STUB_IMAGE_SIZE == vCqe[i].nImageSize);
+	}
+	CHECK(ETIMEDOUT == CaptureQueue_Reap(pQueue, vCqe, 4, 1, 0, &nReaped));
+	CHECK(0 == nReaped);
+
+	CaptureQueue_Destroy(pQueue);
+	CHECK(wait_stub_idle(1000));
+}
+
+//captures not called back in time keep the queue allocated, their callbacks come after Destroy() returned
+static void test_late_callbacks(void){
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	capture_queue_t* pQueue = NULL;
+	CHECK(0 == CaptureQueue_Create(&cparam, 4, &pQueue));
+	if(NULL == pQueue) return;
+
+	Stub_SetLateCallback(CAPTURE_QUEUE_STOP_TIMEOUT_MS + 500);
+	capture_sqe_t vSqe[3];
+	unsigned int i = 0;
+	for(i = 0; i < 3; i++) make_sqe(i, STUB_IMAGE_SIZE, &vSqe[i]);
+	unsigned int nSubmitted = 0;
+	CHECK(0 == CaptureQueue_Submit(pQueue, vSqe, 3, &nSubmitted) && 3 == nSubmitted);
+	CaptureQueue_Destroy(pQueue);
+	CHECK(3 == Stub_GetInFlightCnt());
+	CHECK(wait_stub_idle(2000));
+	Stub_SetLateCallback(0);
+}
+
+int main(void){
+	unsigned int i = 0;
+	for(i = 0; i < STUB_READER_CNT; i++){
+		char szName[MAX_DEVICE_NAME_LENGTH];
+		snprintf(szName, sizeof(szName), "sim%u", i);
+		CHECK(DPFPDD_SUCCESS == dpfpdd_open(szName, &g_vReader[i]));
+	}
+
+	test_reapers();
+	test_depth();
+	test_late_callbacks();
+
+	for(i = 0; i < STUB_READER_CNT; i++) dpfpdd_close(g_vReader[i]);
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
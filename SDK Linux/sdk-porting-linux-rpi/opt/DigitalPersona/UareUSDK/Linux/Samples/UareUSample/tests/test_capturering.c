@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../capturering.h"
+#include "stubdpfpdd.h"
+#include "check.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//a capture which misses its cancel blocks for good, the test is killed instead
+#define TEST_WATCHDOG_S 30
+
+static capture_ring_t* g_pRing = NULL;
+
+static unsigned int now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned int)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// extraction, in place of libdpfj: the FMD is the first bytes of the image
+
+int DPAPICALL dpfj_create_fmd_from_raw(const unsigned char* pImage, unsigned int nImageSize, unsigned int nWidth,
+	unsigned int nHeight, unsigned int nDpi, DPFJ_FINGER_POSITION nFingerPos, unsigned int nCbeffId,
+	DPFJ_FMD_FORMAT nFmdType, unsigned char* pFmd, unsigned int* pnFmdSize){
+	(void)nWidth;
+	(void)nHeight;
+	(void)nDpi;
+	(void)nFingerPos;
+	(void)nCbeffId;
+	(void)nFmdType;
+	if(16 > nImageSize || 16 > *pnFmdSize) return DPFJ_E_FAILURE;
+	memcpy(pFmd, pImage, 16);
+	*pnFmdSize = 16;
+	return DPFJ_SUCCESS;
+}
+
+int DPAPICALL dpfj_create_fmd_from_fid(DPFJ_FID_FORMAT nFidType, const unsigned char* pFid, unsigned int nFidSize,
+	DPFJ_FMD_FORMAT nFmdType, unsigned char* pFmd, unsigned int* pnFmdSize){
+	(void)nFidType;
+	return dpfj_create_fmd_from_raw(pFid, nFidSize, 0, 0, 0, DPFJ_POSITION_UNKNOWN, 0, nFmdType, pFmd, pnFmdSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// tests
+
+//a finger on the reader is captured and extracted into the slot
+static void test_capture(void){
+	Stub_PutFinger(0);
+	capture_slot_t* pSlot = NULL;
+	CHECK(0 == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	if(NULL == pSlot) return;
+	CHECK(pSlot->result.success && STUB_IMAGE_SIZE == pSlot->nImageSize);
+	CHECK(DPFJ_SUCCESS == pSlot->nFmdResult && 16 == pSlot->nFmdSize);
+	CaptureRing_Release(g_pRing, pSlot);
+}
+
+//one capture runs for the whole timeout, the timed out capture is handed out
+#define TEST_TIMEOUT_MS 250
+
+static void test_timeout(void){
+	unsigned int nStartCnt = Stub_GetCaptureCnt();
+	unsigned int nStart = now_ms();
+	capture_slot_t* pSlot = NULL;
+	CHECK(0 == CaptureRing_Capture(g_pRing, TEST_TIMEOUT_MS, &pSlot));
+	unsigned int nElapsed = now_ms() - nStart;
+	CHECK(TEST_TIMEOUT_MS <= nElapsed && 2 * TEST_TIMEOUT_MS > nElapsed);
+	CHECK(1 == Stub_GetCaptureCnt() - nStartCnt);
+	if(NULL == pSlot) return;
+	CHECK(!pSlot->result.success && (pSlot->result.quality & DPFPDD_QUALITY_TIMED_OUT));
+	CaptureRing_Release(g_pRing, pSlot);
+}
+
+static void* cancel_thread(void* pContext){
+	usleep(*(unsigned int*)pContext * 1000);
+	CHECK(0 == CaptureRing_Cancel(g_pRing));
+	return NULL;
+}
+
+//the cancel comes after the capture was marked and before dpfpdd_capture() starts, so the first dpfpdd_cancel()
+//finds no capture to cancel; one sent again reaches it
+static pthread_t g_hookThread;
+static int g_bHookCanceled = 0;
+
+static void cancel_hook(DPFPDD_DEV hReader){
+	(void)hReader;
+	if(g_bHookCanceled) return;
+	g_bHookCanceled = 1;
+	static unsigned int nDelayMs = 0;
+	pthread_create(&g_hookThread, NULL, cancel_thread, &nDelayMs);
+	//the first cancel is sent while the hook waits
+	usleep(3 * CAPTURE_RING_CANCEL_RETRY_MS * 1000);
+}
+
+static void test_cancel_before_capture(void){
+	g_bHookCanceled = 0;
+	Stub_SetCaptureHook(cancel_hook);
+	unsigned int nStart = now_ms();
+	capture_slot_t* pSlot = NULL;
+	CHECK(0 == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	CHECK(g_bHookCanceled);
+	CHECK(1000 > now_ms() - nStart);
+	Stub_SetCaptureHook(NULL);
+	if(g_bHookCanceled) pthread_join(g_hookThread, NULL);
+	if(NULL != pSlot){
+		CHECK(!pSlot->result.success && (pSlot->result.quality & DPFPDD_QUALITY_CANCELED));
+		CaptureRing_Release(g_pRing, pSlot);
+	}
+
+	//the cancel was taken, the next capture is not canceled
+	Stub_PutFinger(0);
+	CHECK(0 == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	if(NULL != pSlot){
+		CHECK(pSlot->result.success);
+		CaptureRing_Release(g_pRing, pSlot);
+	}
+}
+
+//the cancel reaches the running capture, which is handed out canceled and takes the flag
+static void test_cancel_during_capture(void){
+	unsigned int nDelayMs = 50;
+	pthread_t thread;
+	pthread_create(&thread, NULL, cancel_thread, &nDelayMs);
+	capture_slot_t* pSlot = NULL;
+	CHECK(0 == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	pthread_join(thread, NULL);
+	if(NULL != pSlot){
+		CHECK(!pSlot->result.success && (pSlot->result.quality & DPFPDD_QUALITY_CANCELED));
+		CaptureRing_Release(g_pRing, pSlot);
+	}
+
+	Stub_PutFinger(0);
+	CHECK(0 == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	if(NULL != pSlot) CaptureRing_Release(g_pRing, pSlot);
+}
+
+//a cancel with no capture running cancels the next one without waiting
+static void test_cancel_between_captures(void){
+	unsigned int nStart = now_ms();
+	CHECK(0 == CaptureRing_Cancel(g_pRing));
+	CHECK(CAPTURE_RING_CANCEL_RETRY_MS > now_ms() - nStart);
+	capture_slot_t* pSlot = NULL;
+	CHECK(ECANCELED == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	CHECK(NULL == pSlot);
+}
+
+//with every slot held the capture waits, the cancel wakes it
+static void test_cancel_waiting_for_slot(void){
+	capture_slot_t* vSlot[2] = {NULL, NULL};
+	unsigned int i = 0;
+	for(i = 0; i < 2; i++){
+		Stub_PutFinger(0);
+		CHECK(0 == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &vSlot[i]));
+	}
+	unsigned int nDelayMs = 50;
+	pthread_t thread;
+	pthread_create(&thread, NULL, cancel_thread, &nDelayMs);
+	capture_slot_t* pSlot = NULL;
+	CHECK(ECANCELED == CaptureRing_Capture(g_pRing, (unsigned int)(-1), &pSlot));
+	pthread_join(thread, NULL);
+	for(i = 0; i < 2; i++){
+		if(NULL != vSlot[i]) CaptureRing_Release(g_pRing, vSlot[i]);
+	}
+}
+
+int main(void){
+	alarm(TEST_WATCHDOG_S);
+
+	DPFPDD_DEV hReader = NULL;
+	CHECK(DPFPDD_SUCCESS == dpfpdd_open("sim0", &hReader));
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	cparam.size = sizeof(cparam);
+	cparam.image_fmt = DPFPDD_IMG_FMT_PIXEL_BUFFER;
+	CHECK(0 == CaptureRing_Create(hReader, &cparam, DPFJ_FMD_ANSI_378_2004, 2, NULL, 0, &g_pRing));
+	if(NULL != g_pRing){
+		test_capture();
+		test_timeout();
+		test_cancel_before_capture();
+		test_cancel_during_capture();
+		test_cancel_between_captures();
+		test_cancel_waiting_for_slot();
+		CaptureRing_Destroy(g_pRing);
+	}
+	dpfpdd_close(hReader);
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
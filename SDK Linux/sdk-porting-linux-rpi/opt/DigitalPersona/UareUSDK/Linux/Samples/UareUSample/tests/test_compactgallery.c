@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../compactgallery.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+//every finger is in the gallery three times, moved by 0, 1 and 2 pixels, so every probe has three mates in three blocks
+#define TEST_FINGER_CNT  200
+#define TEST_COPY_CNT    3
+#define TEST_TWO_VIEWS   1000   //finger of the second view of the FMD with two views
+#define TEST_THREAD_CNT  4
+//per comparison the threshold is 500, the mates score under it, other fingers tens of thousands
+#define TEST_THRESHOLD(n) (500 * (n))
+
+static gallery_t* g_pGallery = NULL;
+static compact_gallery_t* g_pCompact = NULL;
+static pool_t* g_pPool = NULL;
+
+//FMD with the views of two fingers, which the compact gallery keeps as it is
+static void make_two_view_fmd(unsigned int nFinger1, unsigned int nFinger2, unsigned char* pFmd, unsigned int* pnFmdSize){
+	unsigned char vView[STUB_FMD_SIZE];
+	unsigned int nViewSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger1, 0, 0, DPFJ_POSITION_RINDEX, pFmd, pnFmdSize);
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger2, 0, 0, DPFJ_POSITION_LINDEX, vView, &nViewSize);
+	unsigned int nHeaderSize = DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH;
+	memcpy(pFmd + *pnFmdSize, vView + nHeaderSize, nViewSize - nHeaderSize);
+	*pnFmdSize += nViewSize - nHeaderSize;
+	pFmd[8] = (unsigned char)(*pnFmdSize >> 8);
+	pFmd[9] = (unsigned char)*pnFmdSize;
+	pFmd[24] = 2;
+}
+
+static int same_candidates(unsigned int nCnt1, const gallery_candidate_t* v1, unsigned int nCnt2, const gallery_candidate_t* v2){
+	if(nCnt1 != nCnt2) return 0;
+	unsigned int i = 0;
+	for(i = 0; i < nCnt1; i++){
+		if(v1[i].nId != v2[i].nId || v1[i].nViewIdx != v2[i].nViewIdx || v1[i].nScore != v2[i].nScore) return 0;
+	}
+	return 1;
+}
+
+//the compact gallery finds the same candidates with the same scores in the same order as the sharded search of the arena
+static void check_probe(unsigned int nFinger, unsigned int nCandidateCnt){
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 1, 9999, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+	unsigned int nThreshold = TEST_THRESHOLD(g_pGallery->nFmdCnt);
+
+	gallery_candidate_t vArena[16], vCompact[16];
+	unsigned int nArenaCnt = nCandidateCnt;
+	unsigned int nCompactCnt = nCandidateCnt;
+	CHECK(0 == Gallery_IdentifyParallel(g_pGallery, g_pPool, vProbe, nProbeSize, 0, nThreshold, &nArenaCnt, vArena));
+	CHECK(0 == CompactGallery_Identify(g_pCompact, vProbe, nProbeSize, 0, nThreshold, &nCompactCnt, vCompact));
+	CHECK(same_candidates(nArenaCnt, vArena, nCompactCnt, vCompact));
+	unsigned int nMateCnt = (TEST_FINGER_CNT > nFinger) ? TEST_COPY_CNT : 1;
+	CHECK(((nMateCnt < nCandidateCnt) ? nMateCnt : nCandidateCnt) == nCompactCnt);
+}
+
+static void* identify_thread(void* pContext){
+	unsigned int nThread = *(unsigned int*)pContext;
+	unsigned int i = 0;
+	for(i = 0; i < 20; i++) check_probe((nThread * 37 + i * 11) % TEST_FINGER_CNT, 16);
+	return NULL;
+}
+
+int main(void){
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &g_pGallery));
+	CHECK(0 == Pool_Create(TEST_THREAD_CNT, &g_pPool));
+	if(NULL == g_pGallery || NULL == g_pPool) return 1;
+
+	unsigned char vFmd[2 * STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	unsigned int nId = 0;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT * TEST_COPY_CNT; i++){
+		Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, i % TEST_FINGER_CNT, i / TEST_FINGER_CNT, i, DPFJ_POSITION_UNKNOWN, vFmd, &nFmdSize);
+		CHECK(0 == Gallery_Add(g_pGallery, vFmd, nFmdSize, &nId));
+		//the finger position is kept per FMD with the view header
+		if(100 == i){
+			Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, TEST_FINGER_CNT + 1, 0, 0, DPFJ_POSITION_RTHUMB, vFmd, &nFmdSize);
+			CHECK(0 == Gallery_Add(g_pGallery, vFmd, nFmdSize, &nId));
+		}
+		if(300 == i){
+			make_two_view_fmd(TEST_TWO_VIEWS - 1, TEST_TWO_VIEWS, vFmd, &nFmdSize);
+			CHECK(0 == Gallery_Add(g_pGallery, vFmd, nFmdSize, &nId));
+		}
+	}
+	CHECK(0 == CompactGallery_Create(g_pGallery, &g_pCompact));
+	if(NULL == g_pCompact) return 1;
+	CHECK(NULL != g_pCompact->vRawOffset && 2 == g_pCompact->nBlockCandidateAlloc / g_pCompact->nBlockSize);
+
+	//more candidates than mates, fewer than mates, and the second view of the FMD kept as it is
+	for(i = 0; i < TEST_FINGER_CNT; i += 7){
+		check_probe(i, 16);
+		check_probe(i, 2);
+	}
+	check_probe(TEST_FINGER_CNT + 1, 16);
+	check_probe(TEST_TWO_VIEWS, 16);
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, TEST_TWO_VIEWS, 1, 1, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+	gallery_candidate_t vCandidates[4];
+	unsigned int nCandidateCnt = 4;
+	CHECK(0 == CompactGallery_Identify(g_pCompact, vProbe, nProbeSize, 0, TEST_THRESHOLD(g_pCompact->nFmdCnt), &nCandidateCnt, vCandidates));
+	CHECK(1 == nCandidateCnt && 1 == vCandidates[0].nViewIdx);
+
+	//identifications on one compact gallery from several threads do not overwrite each other's blocks
+	pthread_t vThread[TEST_THREAD_CNT];
+	unsigned int vThreadIdx[TEST_THREAD_CNT];
+	for(i = 0; i < TEST_THREAD_CNT; i++){
+		vThreadIdx[i] = i;
+		pthread_create(&vThread[i], NULL, identify_thread, &vThreadIdx[i]);
+	}
+	for(i = 0; i < TEST_THREAD_CNT; i++) pthread_join(vThread[i], NULL);
+
+	CompactGallery_Destroy(g_pCompact);
+	Gallery_Destroy(g_pGallery);
+	Pool_Destroy(g_pPool);
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
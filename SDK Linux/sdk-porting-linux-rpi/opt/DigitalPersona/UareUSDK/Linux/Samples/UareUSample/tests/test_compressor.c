@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../compressor.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_WIDTH      64
+#define TEST_HEIGHT     48
+#define TEST_FID_SIZE   STUB_FID_SIZE(TEST_WIDTH, TEST_HEIGHT)
+#define TEST_THREAD_CNT 4
+#define TEST_ROUND_CNT  200
+
+//compresses and expands the FID back, the stub WSQ data keeps the settings it was made with
+static int round_trip(compressor_t* pCompressor, unsigned int nSeed, unsigned int nBitrate, unsigned int nSize){
+	unsigned char vFid[TEST_FID_SIZE];
+	unsigned int nFidSize = 0;
+	Stub_MakeFid(TEST_WIDTH, TEST_HEIGHT, nSeed, vFid, &nFidSize);
+
+	unsigned char vData[TEST_FID_SIZE];
+	unsigned int nDataSize = sizeof(vData);
+	if(0 != Compressor_CompressFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vFid, nFidSize, vData, &nDataSize)) return 0;
+	unsigned int nDataBitrate = 0;
+	unsigned int nDataTargetSize = 0;
+	if(!Stub_GetWsqParams(vData, nDataSize, &nDataBitrate, &nDataTargetSize) || nBitrate != nDataBitrate || nSize != nDataTargetSize) return 0;
+
+	unsigned char vExpanded[TEST_FID_SIZE];
+	unsigned int nExpandedSize = sizeof(vExpanded);
+	if(0 != Compressor_ExpandFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vData, nDataSize, vExpanded, &nExpandedSize)) return 0;
+	return nFidSize == nExpandedSize && 0 == memcmp(vFid, vExpanded, nFidSize);
+}
+
+static void test_settings(void){
+	compressor_t* pCompressor = NULL;
+	CHECK(EINVAL == Compressor_Create(DPFJ_COMPRESSION_WSQ_NIST, NULL));
+	CHECK(DPFJ_E_INVALID_PARAMETER == Compressor_Create(0, &pCompressor));
+	CHECK(0 == Compressor_Create(DPFJ_COMPRESSION_WSQ_NIST, &pCompressor));
+	if(NULL == pCompressor) return;
+
+	CHECK(round_trip(pCompressor, 1, 75, 0));
+	CHECK(EINVAL == Compressor_SetSize(pCompressor, 0, 0));
+	CHECK(0 == Compressor_SetSize(pCompressor, 500, 2));
+	CHECK(round_trip(pCompressor, 1, 0, 500));
+	CHECK(EINVAL == Compressor_SetBitrate(pCompressor, 0, 0));
+	CHECK(0 == Compressor_SetBitrate(pCompressor, 150, 0));
+	CHECK(round_trip(pCompressor, 2, 150, 0));
+	Compressor_Destroy(pCompressor);
+}
+
+//a short buffer gets the size back and nothing written, a failed operation still finishes the library's
+static void test_buffer(void){
+	compressor_t* pCompressor = NULL;
+	CHECK(0 == Compressor_Create(DPFJ_COMPRESSION_WSQ_AWARE, &pCompressor));
+	if(NULL == pCompressor) return;
+	unsigned char vFid[TEST_FID_SIZE];
+	unsigned int nFidSize = 0;
+	Stub_MakeFid(TEST_WIDTH, TEST_HEIGHT, 3, vFid, &nFidSize);
+
+	unsigned int nDataSize = 0;
+	CHECK(DPFJ_E_MORE_DATA == Compressor_CompressFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vFid, nFidSize, NULL, &nDataSize));
+	CHECK(STUB_WSQ_HEADER_LENGTH < nDataSize && nDataSize < nFidSize);
+	unsigned int nRequired = nDataSize;
+	unsigned char vData[TEST_FID_SIZE];
+	memset(vData, 0xa5, sizeof(vData));
+	nDataSize = nRequired - 1;
+	CHECK(DPFJ_E_MORE_DATA == Compressor_CompressFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vFid, nFidSize, vData, &nDataSize));
+	CHECK(nRequired == nDataSize && 0xa5 == vData[0]);
+	CHECK(0 == Compressor_CompressFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vFid, nFidSize, vData, &nDataSize));
+	CHECK(nRequired == nDataSize);
+
+	unsigned char vExpanded[TEST_FID_SIZE];
+	unsigned int nExpandedSize = sizeof(vExpanded);
+	CHECK(EINVAL == Compressor_ExpandFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vData, nDataSize, vExpanded, NULL));
+	CHECK(DPFJ_E_COMPRESSION_INVALID_WSQ_PARAMETER == Compressor_ExpandFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vFid, nFidSize, vExpanded, &nExpandedSize));
+	CHECK(0 == Compressor_ExpandFid(pCompressor, DPFJ_FID_ISO_19794_4_2005, vData, nDataSize, vExpanded, &nExpandedSize));
+	CHECK(nFidSize == nExpandedSize && 0 == memcmp(vFid, vExpanded, nFidSize));
+	Compressor_Destroy(pCompressor);
+}
+
+static void test_raw(void){
+	compressor_t* pCompressor = NULL;
+	CHECK(0 == Compressor_Create(DPFJ_COMPRESSION_WSQ_NIST, &pCompressor));
+	if(NULL == pCompressor) return;
+	unsigned char vImage[TEST_WIDTH * TEST_HEIGHT];
+	unsigned int i = 0;
+	for(i = 0; i < TEST_HEIGHT; i++) memset(vImage + i * TEST_WIDTH, (int)(i * 5), TEST_WIDTH);
+
+	unsigned char vData[TEST_WIDTH * TEST_HEIGHT];
+	unsigned int nDataSize = sizeof(vData);
+	CHECK(0 == Compressor_CompressRaw(pCompressor, vImage, sizeof(vImage), TEST_WIDTH, TEST_HEIGHT, 500, 8, vData, &nDataSize));
+
+	unsigned char vExpanded[TEST_WIDTH * TEST_HEIGHT];
+	unsigned int nExpandedSize = sizeof(vExpanded);
+	unsigned int nWidth = 0, nHeight = 0, nDpi = 0, nBpp = 0;
+	CHECK(EINVAL == Compressor_ExpandRaw(pCompressor, vData, nDataSize, NULL, &nHeight, &nDpi, &nBpp, vExpanded, &nExpandedSize));
+	CHECK(0 == Compressor_ExpandRaw(pCompressor, vData, nDataSize, &nWidth, &nHeight, &nDpi, &nBpp, vExpanded, &nExpandedSize));
+	CHECK(TEST_WIDTH == nWidth && TEST_HEIGHT == nHeight && 500 == nDpi && 8 == nBpp);
+	CHECK(sizeof(vImage) == nExpandedSize && 0 == memcmp(vImage, vExpanded, sizeof(vImage)));
+	Compressor_Destroy(pCompressor);
+}
+
+//every thread compresses with a context and a bitrate of its own; the stub fails a dpfj_start_compression() which
+//overlaps another operation, and data made with another thread's settings or image does not come back
+static void* compress_thread(void* pArg){
+	unsigned int nThread = (unsigned int)(size_t)pArg;
+	compressor_t* pCompressor = NULL;
+	CHECK(0 == Compressor_Create(DPFJ_COMPRESSION_WSQ_NIST, &pCompressor));
+	if(NULL == pCompressor) return NULL;
+	CHECK(0 == Compressor_SetBitrate(pCompressor, 100 + nThread, 0));
+
+	unsigned int i = 0;
+	for(i = 0; i < TEST_ROUND_CNT; i++) CHECK(round_trip(pCompressor, nThread * TEST_ROUND_CNT + i, 100 + nThread, 0));
+	Compressor_Destroy(pCompressor);
+	return NULL;
+}
+
+static void test_concurrent(void){
+	pthread_t vThread[TEST_THREAD_CNT];
+	unsigned int i = 0;
+	for(i = 0; i < TEST_THREAD_CNT; i++) pthread_create(&vThread[i], NULL, compress_thread, (void*)(size_t)i);
+	for(i = 0; i < TEST_THREAD_CNT; i++) pthread_join(vThread[i], NULL);
+}
+
+int main(void){
+	test_settings();
+	test_buffer();
+	test_raw();
+	test_concurrent();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../dedup.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+//fingers are in the gallery three times, moved by 1 to 3 pixels; 3 blocks of FMDs make 6 tiles, 2 waves without a pool
+#define TEST_FINGER_CNT 200
+#define TEST_COPY_CNT   3
+//per comparison the copies of a finger score under it, other fingers tens of thousands
+#define TEST_THRESHOLD  500
+
+static int same_result(const dedup_result_t* p1, const dedup_result_t* p2){
+	if(p1->nPairCnt != p2->nPairCnt || p1->nClusterCnt != p2->nClusterCnt || p1->nSkippedCnt != p2->nSkippedCnt) return 0;
+	if(0 != memcmp(p1->vPairs, p2->vPairs, sizeof(dedup_pair_t) * p1->nPairCnt)) return 0;
+	if(0 != memcmp(p1->vClusterFirst, p2->vClusterFirst, sizeof(unsigned int) * (p1->nClusterCnt + 1))) return 0;
+	return 0 == memcmp(p1->vClusterIds, p2->vClusterIds, sizeof(unsigned int) * p1->vClusterFirst[p1->nClusterCnt]);
+}
+
+static gallery_t* create_gallery(void){
+	gallery_t* pGallery = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL == pGallery) return NULL;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT * TEST_COPY_CNT; i++){
+		unsigned char vFmd[STUB_FMD_SIZE];
+		unsigned int nFmdSize = 0;
+		unsigned int nId = 0;
+		Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT, i, DPFJ_POSITION_UNKNOWN, vFmd, &nFmdSize);
+		CHECK(0 == Gallery_Add(pGallery, vFmd, nFmdSize, &nId));
+	}
+	return pGallery;
+}
+
+//FMD with a view of each finger, every one moved by its shift
+static void make_two_view_fmd(unsigned int nFinger1, unsigned int nShift1, unsigned int nFinger2, unsigned int nShift2,
+	unsigned char* pFmd, unsigned int* pnFmdSize){
+	unsigned char vView[STUB_FMD_SIZE];
+	unsigned int nViewSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger1, nShift1, 1000, DPFJ_POSITION_UNKNOWN, pFmd, pnFmdSize);
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger2, nShift2, 2000, DPFJ_POSITION_UNKNOWN, vView, &nViewSize);
+	unsigned int nHeaderSize = DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH;
+	memcpy(pFmd + *pnFmdSize, vView + nHeaderSize, nViewSize - nHeaderSize);
+	*pnFmdSize += nViewSize - nHeaderSize;
+	pFmd[8] = (unsigned char)(*pnFmdSize >> 8);
+	pFmd[9] = (unsigned char)*pnFmdSize;
+	pFmd[24] = 2;
+}
+
+//every view finds the copies of its finger; copies found by both views come once, with the better score
+static void test_enrollment(gallery_t* pGallery){
+	unsigned char vFmd[2 * STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	unsigned int nThreshold = TEST_THRESHOLD * pGallery->nFmdCnt;
+	gallery_candidate_t vCandidates[2 * TEST_COPY_CNT + 1];
+	make_two_view_fmd(11, 2, 12, 2, vFmd, &nFmdSize);
+	unsigned int nCnt = 2 * TEST_COPY_CNT + 1;
+	CHECK(0 == Dedup_CheckEnrollment(pGallery, NULL, vFmd, nFmdSize, nThreshold, &nCnt, vCandidates));
+	CHECK(2 * TEST_COPY_CNT == nCnt);
+	unsigned int i = 0;
+	for(i = 0; i < nCnt; i++){
+		CHECK(11 == vCandidates[i].nId % TEST_FINGER_CNT || 12 == vCandidates[i].nId % TEST_FINGER_CNT);
+		if(0 < i) CHECK(vCandidates[i - 1].nScore <= vCandidates[i].nScore);
+	}
+
+	//the finger itself is a better match of every copy than the finger moved
+	make_two_view_fmd(13, 3, 13, 0, vFmd, &nFmdSize);
+	nCnt = 2 * TEST_COPY_CNT + 1;
+	CHECK(0 == Dedup_CheckEnrollment(pGallery, NULL, vFmd, nFmdSize, nThreshold, &nCnt, vCandidates));
+	CHECK(TEST_COPY_CNT == nCnt);
+	for(i = 0; i < nCnt; i++){
+		CHECK(13 == vCandidates[i].nId % TEST_FINGER_CNT);
+		unsigned char* pCopy = NULL;
+		unsigned int nCopySize = 0;
+		unsigned int nScore = 0;
+		CHECK(0 == Gallery_GetFmd(pGallery, vCandidates[i].nId, &pCopy, &nCopySize));
+		CHECK(DPFJ_SUCCESS == dpfj_compare(DPFJ_FMD_ANSI_378_2004, vFmd, nFmdSize, 1, DPFJ_FMD_ANSI_378_2004, pCopy, nCopySize, 0, &nScore));
+		CHECK(nScore == vCandidates[i].nScore);
+	}
+
+	//room for fewer than found keeps the best
+	gallery_candidate_t vBest[2];
+	nCnt = 2;
+	CHECK(0 == Dedup_CheckEnrollment(pGallery, NULL, vFmd, nFmdSize, nThreshold, &nCnt, vBest));
+	CHECK(2 == nCnt && 0 == memcmp(vBest, vCandidates, sizeof(vBest)));
+}
+
+//a run interrupted in its second wave resumes after the first one and finds what an uninterrupted run finds
+static void test_resume(gallery_t* pGallery, const char* szCheckpoint){
+	dedup_result_t* pFull = NULL;
+	unsigned int nStartCnt = Stub_GetCompareCnt();
+	CHECK(0 == Dedup_Run(pGallery, NULL, TEST_THRESHOLD, NULL, &pFull));
+	unsigned int nFullCnt = Stub_GetCompareCnt() - nStartCnt;
+	if(NULL == pFull) return;
+	CHECK(TEST_FINGER_CNT == pFull->nClusterCnt);
+
+	//the first wave takes the first row and the first tile of the second, 153344 comparisons
+	unsigned int nInterruptCnt = 160000;
+	dedup_result_t* pResult = NULL;
+	nStartCnt = Stub_GetCompareCnt();
+	Stub_SetCompareLimit(nStartCnt + nInterruptCnt);
+	CHECK(DPFJ_E_FAILURE == Dedup_Run(pGallery, NULL, TEST_THRESHOLD, szCheckpoint, &pResult));
+	Stub_SetCompareLimit(0);
+	CHECK(NULL == pResult);
+	CHECK(0 == access(szCheckpoint, F_OK));
+
+	//another threshold is another run, its checkpoint is not this one
+	CHECK(EINVAL == Dedup_Run(pGallery, NULL, TEST_THRESHOLD + 1, szCheckpoint, &pResult));
+	CHECK(NULL == pResult);
+
+	nStartCnt = Stub_GetCompareCnt();
+	CHECK(0 == Dedup_Run(pGallery, NULL, TEST_THRESHOLD, szCheckpoint, &pResult));
+	unsigned int nResumedCnt = Stub_GetCompareCnt() - nStartCnt;
+	CHECK(nFullCnt > nResumedCnt && nFullCnt - nInterruptCnt <= nResumedCnt);
+	if(NULL != pResult){
+		CHECK(same_result(pFull, pResult));
+		Dedup_FreeResult(pResult);
+	}
+
+	//the finished run removed its checkpoint
+	CHECK(0 != access(szCheckpoint, F_OK) && ENOENT == errno);
+	Dedup_FreeResult(pFull);
+}
+
+//a checkpoint of the gallery before an FMD was removed is refused
+static void test_changed_gallery(gallery_t* pGallery, const char* szCheckpoint){
+	dedup_result_t* pResult = NULL;
+	Stub_SetCompareLimit(Stub_GetCompareCnt() + 160000);
+	CHECK(DPFJ_E_FAILURE == Dedup_Run(pGallery, NULL, TEST_THRESHOLD, szCheckpoint, &pResult));
+	Stub_SetCompareLimit(0);
+
+	CHECK(0 == Gallery_Remove(pGallery, 7));
+	unsigned char vFmd[STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	unsigned int nId = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, 7, 1, 7, DPFJ_POSITION_UNKNOWN, vFmd, &nFmdSize);
+	CHECK(0 == Gallery_Add(pGallery, vFmd, nFmdSize, &nId));
+	CHECK(EINVAL == Dedup_Run(pGallery, NULL, TEST_THRESHOLD, szCheckpoint, &pResult));
+	CHECK(NULL == pResult);
+	unlink(szCheckpoint);
+}
+
+int main(void){
+	char szCheckpoint[64];
+	snprintf(szCheckpoint, sizeof(szCheckpoint), "/tmp/test_dedup.%d", (int)getpid());
+	unlink(szCheckpoint);
+
+	gallery_t* pGallery = create_gallery();
+	if(NULL != pGallery){
+		test_enrollment(pGallery);
+		test_resume(pGallery, szCheckpoint);
+		test_changed_gallery(pGallery, szCheckpoint);
+		Gallery_Destroy(pGallery);
+	}
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
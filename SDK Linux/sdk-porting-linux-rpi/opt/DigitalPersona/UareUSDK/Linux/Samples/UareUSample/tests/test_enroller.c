@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../enroller.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_THREAD_CNT     4
+#define TEST_ENROLLMENT_CNT 50
+
+//the FMDs of a finger are its copies moved by a pixel or two, each one of its own
+static int add_copy(enroller_t* pEnroller, unsigned int nFinger, unsigned int nCopy){
+	unsigned char vFmd[STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 2, nCopy, DPFJ_POSITION_UNKNOWN, vFmd, &nFmdSize);
+	return Enroller_Add(pEnroller, vFmd, nFmdSize, 0);
+}
+
+//the stub makes the enrollment FMD of the first FMD of the set
+static int is_enrolled(enroller_t* pEnroller, unsigned int nFinger, unsigned int nCopy){
+	unsigned char vFmd[STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 2, nCopy, DPFJ_POSITION_UNKNOWN, vFmd, &nFmdSize);
+	unsigned char* pFmd = NULL;
+	unsigned int nEnrolledSize = 0;
+	if(0 != Enroller_GetFmd(pEnroller, &pFmd, &nEnrolledSize)) return 0;
+	return nFmdSize == nEnrolledSize && 0 == memcmp(vFmd, pFmd, nFmdSize);
+}
+
+static void test_enrollment(void){
+	enroller_t* pEnroller = NULL;
+	CHECK(EINVAL == Enroller_Create(DPFJ_FMD_ANSI_378_2004, NULL));
+	CHECK(0 == Enroller_Create(DPFJ_FMD_ANSI_378_2004, &pEnroller));
+	if(NULL == pEnroller) return;
+
+	unsigned char* pFmd = NULL;
+	unsigned int nFmdSize = 0;
+	CHECK(DPFJ_E_ENROLLMENT_NOT_READY == Enroller_GetFmd(pEnroller, &pFmd, &nFmdSize));
+	CHECK(EINVAL == Enroller_Add(pEnroller, NULL, STUB_FMD_SIZE, 0));
+	unsigned int i = 0;
+	for(i = 0; i < STUB_ENROLLMENT_FMD_CNT - 1; i++) CHECK(DPFJ_E_MORE_DATA == add_copy(pEnroller, 3, i));
+	CHECK(DPFJ_E_ENROLLMENT_NOT_READY == Enroller_GetFmd(pEnroller, &pFmd, &nFmdSize));
+	CHECK(DPFJ_SUCCESS == add_copy(pEnroller, 3, i));
+	CHECK(is_enrolled(pEnroller, 3, 0));
+
+	//a ready enrollment takes no more FMDs
+	CHECK(DPFJ_SUCCESS == add_copy(pEnroller, 4, 0));
+	CHECK(STUB_ENROLLMENT_FMD_CNT == pEnroller->nFmdCnt);
+	CHECK(is_enrolled(pEnroller, 3, 0));
+
+	//the context is used again for the next finger
+	Enroller_Reset(pEnroller);
+	CHECK(0 == pEnroller->nFmdCnt);
+	CHECK(DPFJ_E_ENROLLMENT_NOT_READY == Enroller_GetFmd(pEnroller, &pFmd, &nFmdSize));
+	for(i = 0; i < STUB_ENROLLMENT_FMD_CNT - 1; i++) CHECK(DPFJ_E_MORE_DATA == add_copy(pEnroller, 5, 10 + i));
+	CHECK(DPFJ_SUCCESS == add_copy(pEnroller, 5, 10 + i));
+	CHECK(is_enrolled(pEnroller, 5, 10));
+	Enroller_Destroy(pEnroller);
+}
+
+//the FMD which makes the set invalid is dropped, the enrollment goes on with the ones before it
+static void test_invalid_set(void){
+	enroller_t* pEnroller = NULL;
+	CHECK(0 == Enroller_Create(DPFJ_FMD_ANSI_378_2004, &pEnroller));
+	if(NULL == pEnroller) return;
+
+	CHECK(DPFJ_E_MORE_DATA == add_copy(pEnroller, 8, 0));
+	CHECK(DPFJ_E_MORE_DATA == add_copy(pEnroller, 8, 1));
+	CHECK(DPFJ_E_ENROLLMENT_INVALID_SET == add_copy(pEnroller, 9, 0));
+	CHECK(2 == pEnroller->nFmdCnt);
+	CHECK(DPFJ_E_MORE_DATA == add_copy(pEnroller, 8, 2));
+	CHECK(DPFJ_SUCCESS == add_copy(pEnroller, 8, 3));
+	CHECK(is_enrolled(pEnroller, 8, 0));
+	Enroller_Destroy(pEnroller);
+}
+
+//every thread enrolls fingers of its own with a context of its own; the stub fails a dpfj_start_enrollment() which
+//overlaps another enrollment, and an enrollment FMD made of another thread's set is not the thread's finger
+static void* enroll_thread(void* pArg){
+	unsigned int nThread = (unsigned int)(size_t)pArg;
+	enroller_t* pEnroller = NULL;
+	CHECK(0 == Enroller_Create(DPFJ_FMD_ANSI_378_2004, &pEnroller));
+	if(NULL == pEnroller) return NULL;
+
+	unsigned int i = 0;
+	for(i = 0; i < TEST_ENROLLMENT_CNT; i++){
+		unsigned int nFinger = 100 + i * TEST_THREAD_CNT + nThread;
+		unsigned int j = 0;
+		for(j = 0; j < STUB_ENROLLMENT_FMD_CNT - 1; j++) CHECK(DPFJ_E_MORE_DATA == add_copy(pEnroller, nFinger, j));
+		CHECK(DPFJ_SUCCESS == add_copy(pEnroller, nFinger, j));
+		CHECK(is_enrolled(pEnroller, nFinger, 0));
+		Enroller_Reset(pEnroller);
+	}
+	Enroller_Destroy(pEnroller);
+	return NULL;
+}
+
+static void test_concurrent(void){
+	pthread_t vThread[TEST_THREAD_CNT];
+	unsigned int i = 0;
+	for(i = 0; i < TEST_THREAD_CNT; i++) pthread_create(&vThread[i], NULL, enroll_thread, (void*)(size_t)i);
+	for(i = 0; i < TEST_THREAD_CNT; i++) pthread_join(vThread[i], NULL);
+}
+
+int main(void){
+	test_enrollment();
+	test_invalid_set();
+	test_concurrent();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
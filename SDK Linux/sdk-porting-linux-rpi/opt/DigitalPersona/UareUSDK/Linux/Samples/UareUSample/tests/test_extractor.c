@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../extractor.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_JOB_CNT     12
+#define TEST_MAX_PENDING 3
+
+//the callbacks wait at the gate while it is closed, the tags are kept in the order the callbacks returned
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+	int             bGateOpen;
+	unsigned int    nDelayMs;
+	unsigned int    nEnteredCnt;
+	unsigned int    nReturnedCnt;
+	unsigned int    vTag[TEST_JOB_CNT];
+} callbacks_t;
+
+static void init_callbacks(callbacks_t* pCallbacks, int bGateOpen, unsigned int nDelayMs){
+	memset(pCallbacks, 0, sizeof(callbacks_t));
+	pthread_mutex_init(&pCallbacks->mutex, NULL);
+	pthread_cond_init(&pCallbacks->cond, NULL);
+	pCallbacks->bGateOpen = bGateOpen;
+	pCallbacks->nDelayMs = nDelayMs;
+}
+
+static void destroy_callbacks(callbacks_t* pCallbacks){
+	pthread_cond_destroy(&pCallbacks->cond);
+	pthread_mutex_destroy(&pCallbacks->mutex);
+}
+
+static unsigned int get_returned_cnt(callbacks_t* pCallbacks){
+	pthread_mutex_lock(&pCallbacks->mutex);
+	unsigned int nCnt = pCallbacks->nReturnedCnt;
+	pthread_mutex_unlock(&pCallbacks->mutex);
+	return nCnt;
+}
+
+//the stub extraction always fails, the callback gets the result and no FMD
+static void extracted(void* pContext, unsigned int nTag, int nResult, unsigned char* pFmd, unsigned int nFmdSize){
+	callbacks_t* pCallbacks = (callbacks_t*)pContext;
+	CHECK(DPFJ_E_FAILURE == nResult && NULL == pFmd && 0 == nFmdSize);
+	if(NULL != pFmd) free(pFmd);
+
+	pthread_mutex_lock(&pCallbacks->mutex);
+	pCallbacks->nEnteredCnt++;
+	pthread_cond_broadcast(&pCallbacks->cond);
+	while(!pCallbacks->bGateOpen) pthread_cond_wait(&pCallbacks->cond, &pCallbacks->mutex);
+	pthread_mutex_unlock(&pCallbacks->mutex);
+
+	usleep(pCallbacks->nDelayMs * 1000);
+
+	pthread_mutex_lock(&pCallbacks->mutex);
+	if(TEST_JOB_CNT > pCallbacks->nReturnedCnt) pCallbacks->vTag[pCallbacks->nReturnedCnt] = nTag;
+	pCallbacks->nReturnedCnt++;
+	pthread_mutex_unlock(&pCallbacks->mutex);
+}
+
+static int submit(extractor_t* pExtractor, unsigned int nTag){
+	unsigned char* pFid = (unsigned char*)malloc(STUB_FID_SIZE(4, 4));
+	if(NULL == pFid) return ENOMEM;
+	unsigned int nFidSize = 0;
+	Stub_MakeFid(4, 4, nTag, pFid, &nFidSize);
+	int result = Extractor_Submit(pExtractor, DPFJ_FID_ISO_19794_4_2005, pFid, nFidSize, nTag);
+	if(0 != result) free(pFid);
+	return result;
+}
+
+static void test_wait(void){
+	callbacks_t callbacks;
+	init_callbacks(&callbacks, 1, 2);
+	extractor_t* pExtractor = NULL;
+	CHECK(EINVAL == Extractor_Create(DPFJ_FMD_ANSI_378_2004, 1, 0, extracted, &callbacks, &pExtractor));
+	CHECK(EINVAL == Extractor_Create(DPFJ_FMD_ANSI_378_2004, 1, 4, NULL, &callbacks, &pExtractor));
+	CHECK(0 == Extractor_Create(DPFJ_FMD_ANSI_378_2004, 1, TEST_JOB_CNT, extracted, &callbacks, &pExtractor));
+	if(NULL == pExtractor) return;
+	CHECK(EINVAL == Extractor_Submit(pExtractor, DPFJ_FID_ISO_19794_4_2005, NULL, 0, 0));
+
+	//a single worker runs the jobs in the order they were submitted, every callback has returned when the wait does
+	unsigned int i = 0;
+	for(i = 0; i < TEST_JOB_CNT / 2; i++) CHECK(0 == submit(pExtractor, i));
+	Extractor_Wait(pExtractor);
+	CHECK(TEST_JOB_CNT / 2 == get_returned_cnt(&callbacks));
+	for(i = 0; i < TEST_JOB_CNT / 2; i++) CHECK(i == callbacks.vTag[i]);
+
+	//the extractor is used again after the wait
+	for(; i < TEST_JOB_CNT; i++) CHECK(0 == submit(pExtractor, i));
+	Extractor_Wait(pExtractor);
+	CHECK(TEST_JOB_CNT == get_returned_cnt(&callbacks));
+	for(i = 0; i < TEST_JOB_CNT; i++) CHECK(i == callbacks.vTag[i]);
+	Extractor_Destroy(pExtractor);
+	destroy_callbacks(&callbacks);
+}
+
+typedef struct {
+	extractor_t*  pExtractor;
+	callbacks_t*  pCallbacks;
+	unsigned int  nSubmittedCnt; //changed with atomic operations
+} submitter_t;
+
+//every job submitted is pending until its callback returns, no more than TEST_MAX_PENDING of them at a time
+static void* submit_thread(void* pArg){
+	submitter_t* pSubmitter = (submitter_t*)pArg;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_JOB_CNT; i++){
+		CHECK(0 == submit(pSubmitter->pExtractor, i));
+		unsigned int nSubmittedCnt = __sync_add_and_fetch(&pSubmitter->nSubmittedCnt, 1);
+		CHECK(nSubmittedCnt - get_returned_cnt(pSubmitter->pCallbacks) <= TEST_MAX_PENDING);
+	}
+	return NULL;
+}
+
+static void test_max_pending(void){
+	callbacks_t callbacks;
+	init_callbacks(&callbacks, 0, 1);
+	submitter_t submitter;
+	memset(&submitter, 0, sizeof(submitter));
+	submitter.pCallbacks = &callbacks;
+	CHECK(0 == Extractor_Create(DPFJ_FMD_ANSI_378_2004, 2, TEST_MAX_PENDING, extracted, &callbacks, &submitter.pExtractor));
+	if(NULL == submitter.pExtractor) return;
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, submit_thread, &submitter);
+
+	//both workers are held at the gate with a job each, one more job is queued and the next submit waits
+	unsigned int i = 0;
+	pthread_mutex_lock(&callbacks.mutex);
+	for(i = 0; i < 2000 && 2 > callbacks.nEnteredCnt; i++){
+		pthread_mutex_unlock(&callbacks.mutex);
+		usleep(1000);
+		pthread_mutex_lock(&callbacks.mutex);
+	}
+	CHECK(2 == callbacks.nEnteredCnt);
+	pthread_mutex_unlock(&callbacks.mutex);
+	usleep(100000);
+	CHECK(TEST_MAX_PENDING == __sync_fetch_and_add(&submitter.nSubmittedCnt, 0));
+
+	pthread_mutex_lock(&callbacks.mutex);
+	CHECK(2 == callbacks.nEnteredCnt && 0 == callbacks.nReturnedCnt);
+	callbacks.bGateOpen = 1;
+	pthread_cond_broadcast(&callbacks.cond);
+	pthread_mutex_unlock(&callbacks.mutex);
+	pthread_join(thread, NULL);
+	Extractor_Wait(submitter.pExtractor);
+	CHECK(TEST_JOB_CNT == get_returned_cnt(&callbacks));
+	Extractor_Destroy(submitter.pExtractor);
+	destroy_callbacks(&callbacks);
+}
+
+//pending jobs are finished, not dropped
+static void test_destroy(void){
+	callbacks_t callbacks;
+	init_callbacks(&callbacks, 1, 2);
+	extractor_t* pExtractor = NULL;
+	CHECK(0 == Extractor_Create(DPFJ_FMD_ANSI_378_2004, 2, TEST_JOB_CNT, extracted, &callbacks, &pExtractor));
+	if(NULL == pExtractor) return;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_JOB_CNT; i++) CHECK(0 == submit(pExtractor, i));
+	Extractor_Destroy(pExtractor);
+	CHECK(TEST_JOB_CNT == get_returned_cnt(&callbacks));
+	destroy_callbacks(&callbacks);
+}
+
+int main(void){
+	test_wait();
+	test_max_pending();
+	test_destroy();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
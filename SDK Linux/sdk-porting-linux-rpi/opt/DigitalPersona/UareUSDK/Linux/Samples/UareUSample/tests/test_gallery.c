@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../gallery.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//fingers are in the gallery several times, moved by 1 to 3 pixels, one of them many times
+#define TEST_FINGER_CNT 300
+#define TEST_COPY_CNT   3
+#define TEST_CROWD_CNT  12    //copies of finger 0, added first
+#define TEST_MAX_CANDIDATES 64
+//per comparison the threshold is 500, the mates score under it, other fingers tens of thousands
+#define TEST_THRESHOLD(n) (500 * (n))
+
+static int compare_candidates(const void* p1, const void* p2){
+	const gallery_candidate_t* pc1 = (const gallery_candidate_t*)p1;
+	const gallery_candidate_t* pc2 = (const gallery_candidate_t*)p2;
+	if(pc1->nScore != pc2->nScore) return (pc1->nScore < pc2->nScore) ? -1 : 1;
+	if(pc1->nId != pc2->nId) return (pc1->nId < pc2->nId) ? -1 : 1;
+	return (pc1->nViewIdx < pc2->nViewIdx) ? -1 : (pc1->nViewIdx > pc2->nViewIdx);
+}
+
+//candidates with equal scores may come in any order, both lists are sorted by the ids within a score
+static int same_candidates(unsigned int nCnt1, gallery_candidate_t* v1, unsigned int nCnt2, gallery_candidate_t* v2){
+	if(nCnt1 != nCnt2) return 0;
+	qsort(v1, nCnt1, sizeof(gallery_candidate_t), compare_candidates);
+	qsort(v2, nCnt2, sizeof(gallery_candidate_t), compare_candidates);
+	unsigned int i = 0;
+	for(i = 0; i < nCnt1; i++){
+		if(v1[i].nId != v2[i].nId || v1[i].nViewIdx != v2[i].nViewIdx || v1[i].nScore != v2[i].nScore) return 0;
+	}
+	return 1;
+}
+
+static unsigned int add_finger_at(gallery_t* pGallery, unsigned int nFinger, unsigned int nShift, unsigned int nVariant,
+	DPFJ_FINGER_POSITION nFingerPos){
+	unsigned char vFmd[STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	unsigned int nId = GALLERY_NO_INDEX;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, nShift, nVariant, nFingerPos, vFmd, &nFmdSize);
+	CHECK(0 == Gallery_Add(pGallery, vFmd, nFmdSize, &nId));
+	return nId;
+}
+
+static unsigned int add_finger(gallery_t* pGallery, unsigned int nFinger, unsigned int nShift, unsigned int nVariant){
+	return add_finger_at(pGallery, nFinger, nShift, nVariant, DPFJ_POSITION_UNKNOWN);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// scored candidates
+
+//the plain way: every hit of Gallery_Identify() is scored by dpfj_compare(), sorted, and the best K kept
+static void plain_scored(gallery_t* pGallery, unsigned char* pProbe, unsigned int nProbeSize, unsigned int nK,
+	unsigned int* pnCnt, gallery_candidate_t* vCandidates){
+	*pnCnt = TEST_MAX_CANDIDATES;
+	CHECK(0 == Gallery_Identify(pGallery, pProbe, nProbeSize, 0, TEST_THRESHOLD(pGallery->nFmdCnt), pnCnt, vCandidates));
+	unsigned int i = 0;
+	for(i = 0; i < *pnCnt; i++){
+		unsigned char* pFmd = NULL;
+		unsigned int nFmdSize = 0;
+		CHECK(0 == Gallery_GetFmd(pGallery, vCandidates[i].nId, &pFmd, &nFmdSize));
+		CHECK(DPFJ_SUCCESS == dpfj_compare(DPFJ_FMD_ANSI_378_2004, pProbe, nProbeSize, 0,
+			DPFJ_FMD_ANSI_378_2004, pFmd, nFmdSize, vCandidates[i].nViewIdx, &vCandidates[i].nScore));
+	}
+	qsort(vCandidates, *pnCnt, sizeof(gallery_candidate_t), compare_candidates);
+	if(*pnCnt > nK) *pnCnt = nK;
+}
+
+//the stub ranks by the same score in dpfj_identify() and dpfj_compare(), so the best K of the search are the plain ones
+static void check_scored(gallery_t* pGallery, unsigned int nFinger, unsigned int nK){
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 2, 7777, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+
+	gallery_candidate_t vPlain[TEST_MAX_CANDIDATES], vScored[TEST_MAX_CANDIDATES];
+	unsigned int nPlainCnt = 0;
+	plain_scored(pGallery, vProbe, nProbeSize, nK, &nPlainCnt, vPlain);
+	//no pool: the gallery is searched as one shard
+	unsigned int nScoredCnt = nK;
+	CHECK(0 == Gallery_IdentifyParallel(pGallery, NULL, vProbe, nProbeSize, 0, TEST_THRESHOLD(pGallery->nFmdCnt), &nScoredCnt, vScored));
+	CHECK(0 != nScoredCnt);
+	unsigned int i = 0;
+	for(i = 1; i < nScoredCnt; i++) CHECK(vScored[i - 1].nScore <= vScored[i].nScore);
+	CHECK(same_candidates(nPlainCnt, vPlain, nScoredCnt, vScored));
+}
+
+static void test_scored(void){
+	gallery_t* pGallery = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL == pGallery) return;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_CROWD_CNT; i++) add_finger(pGallery, 0, 1 + i % 3, 100 + i);
+	for(i = 0; i < TEST_FINGER_CNT * TEST_COPY_CNT; i++) add_finger(pGallery, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT, i);
+	//removals move FMDs out of the order of their ids
+	for(i = 5; i < TEST_FINGER_CNT * TEST_COPY_CNT; i += 97) CHECK(0 == Gallery_Remove(pGallery, i));
+
+	//fewer candidates than hits, as many as the mates, and more than all hits
+	for(i = 0; i < TEST_FINGER_CNT; i += 13){
+		check_scored(pGallery, i, 1);
+		check_scored(pGallery, i, 2);
+		check_scored(pGallery, i, TEST_COPY_CNT);
+		check_scored(pGallery, i, 16);
+	}
+	check_scored(pGallery, 0, 5);
+	check_scored(pGallery, 0, TEST_CROWD_CNT + TEST_COPY_CNT);
+	Gallery_Destroy(pGallery);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// fused identification
+
+static unsigned int fuse(unsigned int nFusion, unsigned int nScore1, unsigned int nScore2){
+	if(GALLERY_FUSION_MIN == nFusion) return (nScore1 < nScore2) ? nScore1 : nScore2;
+	if(GALLERY_FUSION_MAX == nFusion) return (nScore1 > nScore2) ? nScore1 : nScore2;
+	return (unsigned int)((double)nScore1 / DPFJ_PROBABILITY_ONE * ((double)nScore2 / DPFJ_PROBABILITY_ONE) * DPFJ_PROBABILITY_ONE);
+}
+
+//every FMD of the gallery compared with both views and fused, those under the bound sorted
+static void all_fused(gallery_t* pGallery, unsigned char** vProbe, unsigned int* vProbeSize, unsigned int nFusion, unsigned int nThreshold,
+	unsigned int nK, unsigned int* pnCnt, gallery_candidate_t* vCandidates){
+	double dBound = (double)nThreshold / pGallery->nFmdCnt;
+	unsigned int nCnt = 0;
+	unsigned int i = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		unsigned int vScore[2] = {0, 0};
+		unsigned int nProbe = 0;
+		for(nProbe = 0; nProbe < 2; nProbe++){
+			CHECK(DPFJ_SUCCESS == dpfj_compare(DPFJ_FMD_ANSI_378_2004, vProbe[nProbe], vProbeSize[nProbe], 0,
+				DPFJ_FMD_ANSI_378_2004, pGallery->vFmd[i], pGallery->vFmdSize[i], 0, &vScore[nProbe]));
+		}
+		unsigned int nFused = fuse(nFusion, vScore[0], vScore[1]);
+		if((double)nFused >= dBound) continue;
+		CHECK(TEST_MAX_CANDIDATES > nCnt);
+		if(TEST_MAX_CANDIDATES == nCnt) break;
+		vCandidates[nCnt].nId = pGallery->vFmdId[i];
+		vCandidates[nCnt].nViewIdx = 0;
+		vCandidates[nCnt].nScore = nFused;
+		nCnt++;
+	}
+	qsort(vCandidates, nCnt, sizeof(gallery_candidate_t), compare_candidates);
+	*pnCnt = (nCnt > nK) ? nK : nCnt;
+}
+
+static void test_fused(void){
+	gallery_t* pGallery = NULL;
+	pool_t* pPool = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	CHECK(0 == Pool_Create(4, &pPool));
+	if(NULL == pGallery || NULL == pPool) return;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT * TEST_COPY_CNT; i++) add_finger(pGallery, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT, i);
+
+	//two views of the same finger, and two of different fingers, which only the rule of the best view accepts
+	unsigned char vFmd[2][STUB_FMD_SIZE];
+	unsigned char* vProbe[2] = {vFmd[0], vFmd[1]};
+	unsigned int vProbeSize[2] = {0, 0};
+	unsigned int vViewIdx[2] = {0, 0};
+	unsigned int nThreshold = TEST_THRESHOLD(pGallery->nFmdCnt);
+	unsigned int nFusion = 0;
+	for(nFusion = GALLERY_FUSION_MIN; nFusion <= GALLERY_FUSION_PRODUCT; nFusion++){
+		for(i = 0; i < TEST_FINGER_CNT; i += 29){
+			unsigned int nAllCnt = 0;
+			Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, i, 2, 5555, DPFJ_POSITION_UNKNOWN, vFmd[0], &vProbeSize[0]);
+			Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, (0 == i % 2) ? i : i + 1, 1, 6666, DPFJ_POSITION_UNKNOWN, vFmd[1], &vProbeSize[1]);
+			gallery_candidate_t vAll[TEST_MAX_CANDIDATES], vFused[TEST_MAX_CANDIDATES];
+			if(GALLERY_FUSION_PRODUCT != nFusion) all_fused(pGallery, vProbe, vProbeSize, nFusion, nThreshold, 8, &nAllCnt, vAll);
+			unsigned int nFusedCnt = 8;
+			CHECK(0 == Gallery_IdentifyFused(pGallery, pPool, 2, vProbe, vProbeSize, vViewIdx, nFusion, nThreshold, &nFusedCnt, vFused));
+			//the stub's scores are not false match rates, their product passes for any FMD, so only the mates of two views of one finger are checked
+			if(GALLERY_FUSION_PRODUCT != nFusion) CHECK(same_candidates(nAllCnt, vAll, nFusedCnt, vFused));
+			else if(0 == i % 2){
+				unsigned int k = 0;
+				for(k = 0; k < nFusedCnt && k < TEST_COPY_CNT; k++) CHECK(i == vFused[k].nId % TEST_FINGER_CNT);
+			}
+		}
+	}
+
+	//the arrays of the views' candidates would not fit, nothing is searched
+	unsigned int nHugeCnt = 0x40000000;
+	gallery_candidate_t candidate;
+	CHECK(ENOMEM == Gallery_IdentifyFused(pGallery, pPool, 2, vProbe, vProbeSize, vViewIdx, GALLERY_FUSION_MIN, nThreshold, &nHugeCnt, &candidate));
+	Gallery_Destroy(pGallery);
+	Pool_Destroy(pPool);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// finger partitions
+
+//fingers go round the positions, the copies of a finger are all at its position
+#define TEST_FINGER_POS(nFinger) ((DPFJ_FINGER_POSITION)((nFinger) % GALLERY_FINGER_POSITIONS))
+
+//every FMD at the positions compared with the probe, those under the per-comparison threshold sorted
+static void all_at(gallery_t* pGallery, unsigned char* pProbe, unsigned int nProbeSize, unsigned int nFingerCnt,
+	const DPFJ_FINGER_POSITION* vFingerPos, unsigned int nK, unsigned int* pnSearchCnt, unsigned int* pnCnt, gallery_candidate_t* vCandidates){
+	unsigned int nCnt = 0;
+	unsigned int i = 0;
+	*pnSearchCnt = 0;
+	for(i = 0; i < pGallery->nFmdCnt; i++){
+		unsigned int nId = pGallery->vFmdId[i];
+		unsigned int j = 0;
+		while(j < nFingerCnt && TEST_FINGER_POS(nId % TEST_FINGER_CNT) != vFingerPos[j]) j++;
+		if(j == nFingerCnt) continue;
+		(*pnSearchCnt)++;
+
+		unsigned int nScore = 0;
+		CHECK(DPFJ_SUCCESS == dpfj_compare(DPFJ_FMD_ANSI_378_2004, pProbe, nProbeSize, 0,
+			DPFJ_FMD_ANSI_378_2004, pGallery->vFmd[i], pGallery->vFmdSize[i], 0, &nScore));
+		if(TEST_THRESHOLD(1) <= nScore) continue;
+		CHECK(TEST_MAX_CANDIDATES > nCnt);
+		if(TEST_MAX_CANDIDATES == nCnt) break;
+		vCandidates[nCnt].nId = nId;
+		vCandidates[nCnt].nViewIdx = 0;
+		vCandidates[nCnt].nScore = nScore;
+		nCnt++;
+	}
+	qsort(vCandidates, nCnt, sizeof(gallery_candidate_t), compare_candidates);
+	*pnCnt = (nCnt > nK) ? nK : nCnt;
+}
+
+static void check_fingers(gallery_t* pGallery, unsigned int nFinger, unsigned int nFingerCnt, const DPFJ_FINGER_POSITION* vFingerPos,
+	unsigned int nK){
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 2, 8888, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+
+	gallery_candidate_t vAll[TEST_MAX_CANDIDATES], vFingers[TEST_MAX_CANDIDATES];
+	unsigned int nAllCnt = 0;
+	unsigned int nSearchCnt = 0;
+	all_at(pGallery, vProbe, nProbeSize, nFingerCnt, vFingerPos, nK, &nSearchCnt, &nAllCnt, vAll);
+	unsigned int nFingersCnt = nK;
+	CHECK(0 == Gallery_IdentifyFingers(pGallery, vProbe, nProbeSize, 0, nFingerCnt, vFingerPos, 0,
+		TEST_THRESHOLD(nSearchCnt), &nFingersCnt, vFingers));
+	unsigned int i = 0;
+	for(i = 1; i < nFingersCnt; i++) CHECK(vFingers[i - 1].nScore <= vFingers[i].nScore);
+	CHECK(same_candidates(nAllCnt, vAll, nFingersCnt, vFingers));
+}
+
+static void test_fingers(void){
+	gallery_t* pGallery = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL == pGallery) return;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT * TEST_COPY_CNT; i++){
+		add_finger_at(pGallery, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT, i, TEST_FINGER_POS(i % TEST_FINGER_CNT));
+	}
+
+	for(i = 0; i < TEST_FINGER_CNT; i += 17){
+		//the probe's own finger listed last, after one which has no mate; the partitions are merged by the scores
+		DPFJ_FINGER_POSITION vFingerPos[3] = {TEST_FINGER_POS(i + 1), TEST_FINGER_POS(i + 2), TEST_FINGER_POS(i)};
+		check_fingers(pGallery, i, 3, vFingerPos, 1);
+		check_fingers(pGallery, i, 3, vFingerPos, TEST_COPY_CNT);
+		check_fingers(pGallery, i, 3, vFingerPos, 16);
+		check_fingers(pGallery, i, 1, vFingerPos, TEST_COPY_CNT);
+		//a finger listed twice is searched once
+		vFingerPos[1] = vFingerPos[2];
+		check_fingers(pGallery, i, 3, vFingerPos, 16);
+	}
+
+	//positions out of the range, below it too when the enum is signed
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, 0, 2, 8888, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+	DPFJ_FINGER_POSITION vBad[2] = {(DPFJ_FINGER_POSITION)GALLERY_FINGER_POSITIONS, (DPFJ_FINGER_POSITION)-1};
+	for(i = 0; i < 2; i++){
+		gallery_candidate_t candidate;
+		unsigned int nCnt = 1;
+		CHECK(DPFJ_E_INVALID_PARAMETER == Gallery_IdentifyFingers(pGallery, vProbe, nProbeSize, 0, 1, &vBad[i], 0,
+			TEST_THRESHOLD(pGallery->nFmdCnt), &nCnt, &candidate));
+	}
+	Gallery_Destroy(pGallery);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// pre-filter
+
+//histograms computed for the FMDs already in the gallery are those of the FMDs added after the pre-filter was enabled
+static void test_prefilter(void){
+	gallery_t* pLate = NULL;
+	gallery_t* pEarly = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pLate));
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pEarly));
+	if(NULL == pLate || NULL == pEarly) return;
+	CHECK(0 == Gallery_EnablePrefilter(pEarly));
+
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, 7, 2, 8888, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+	gallery_candidate_t vCandidates[TEST_MAX_CANDIDATES];
+	unsigned int nSearchedCnt = 0;
+	unsigned int nCnt = TEST_MAX_CANDIDATES;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT * TEST_COPY_CNT; i++){
+		if(TEST_FINGER_CNT == i){
+			CHECK(EINVAL == Gallery_IdentifyPrefiltered(pLate, vProbe, nProbeSize, 0, TEST_THRESHOLD(pLate->nFmdCnt), 100,
+				&nSearchedCnt, &nCnt, vCandidates));
+			CHECK(0 == pLate->vFmdSignature[0].bHistogram);
+			CHECK(0 == Gallery_EnablePrefilter(pLate));
+		}
+		add_finger(pLate, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT, i);
+		add_finger(pEarly, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT, i);
+	}
+	CHECK(pLate->nFmdCnt == pEarly->nFmdCnt);
+	for(i = 0; i < pLate->nFmdCnt; i++){
+		CHECK(pLate->vFmdSignature[i].bHistogram);
+		CHECK(0 == memcmp(&pLate->vFmdSignature[i], &pEarly->vFmdSignature[i], sizeof(gallery_signature_t)));
+	}
+
+	//the whole gallery searched finds the copies
+	nCnt = TEST_MAX_CANDIDATES;
+	CHECK(0 == Gallery_IdentifyPrefiltered(pLate, vProbe, nProbeSize, 0, TEST_THRESHOLD(pLate->nFmdCnt), 100,
+		&nSearchedCnt, &nCnt, vCandidates));
+	CHECK(pLate->nFmdCnt == nSearchedCnt && TEST_COPY_CNT == nCnt);
+	for(i = 0; i < nCnt; i++) CHECK(7 == vCandidates[i].nId % TEST_FINGER_CNT);
+	Gallery_Destroy(pLate);
+	Gallery_Destroy(pEarly);
+}
+
+int main(void){
+	test_scored();
+	test_fused();
+	test_fingers();
+	test_prefilter();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
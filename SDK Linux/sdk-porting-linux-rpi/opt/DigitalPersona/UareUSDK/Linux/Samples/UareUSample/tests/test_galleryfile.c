@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../gallery.h"
+#include "../checksum.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_FINGER_CNT 400
+#define TEST_MAX_CANDIDATES 16
+//per comparison the threshold is 500, the mates score under it, other fingers tens of thousands
+#define TEST_THRESHOLD(n) (500 * (n))
+
+//header fields the test breaks, as laid out in the file: magic, version, byte order, FMD type, FMD count, next id,
+//table offset, arena offset, arena size, then the checksums of the table, the arena and the header before it
+#define TEST_FMD_CNT_POS         20
+#define TEST_NEXT_ID_POS         24
+#define TEST_TABLE_OFFSET_POS    28
+#define TEST_ARENA_OFFSET_POS    32
+#define TEST_ARENA_SIZE_POS      36
+#define TEST_TABLE_CHECKSUM_POS  40
+#define TEST_HEADER_CHECKSUM_POS 48
+
+//table entries: offset, size, view count, id, then the signature
+#define TEST_ENTRY_SIZE        ((4 * sizeof(unsigned int) + sizeof(gallery_signature_t) + 3) & ~(size_t)3)
+#define TEST_ENTRY_VIEW_CNT_POS 8
+
+static char g_szPath[64];
+static char g_szBrokenPath[64];
+
+static unsigned int add_finger(gallery_t* pGallery, unsigned int nFinger, unsigned int nShift){
+	unsigned char vFmd[STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	unsigned int nId = GALLERY_NO_INDEX;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, nShift, nFinger, (DPFJ_FINGER_POSITION)(nFinger % GALLERY_FINGER_POSITIONS), vFmd, &nFmdSize);
+	CHECK(0 == Gallery_Add(pGallery, vFmd, nFmdSize, &nId));
+	return nId;
+}
+
+static unsigned char* read_file(const char* szPath, size_t* pnSize){
+	FILE* pFile = fopen(szPath, "rb");
+	if(NULL == pFile) return NULL;
+	fseek(pFile, 0, SEEK_END);
+	long nSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	unsigned char* pData = (0 < nSize) ? (unsigned char*)malloc((size_t)nSize) : NULL;
+	if(NULL != pData && (size_t)nSize != fread(pData, 1, (size_t)nSize, pFile)){
+		free(pData);
+		pData = NULL;
+	}
+	fclose(pFile);
+	*pnSize = (size_t)nSize;
+	return pData;
+}
+
+static void write_file(const char* szPath, const unsigned char* pData, size_t nSize){
+	FILE* pFile = fopen(szPath, "wb");
+	CHECK(NULL != pFile);
+	if(NULL == pFile) return;
+	CHECK(nSize == fwrite(pData, 1, nSize, pFile));
+	fclose(pFile);
+}
+
+static unsigned int read_field(const unsigned char* pFile, unsigned int nPos){
+	unsigned int n = 0;
+	memcpy(&n, pFile + nPos, sizeof(n));
+	return n;
+}
+
+//opens the first nSize bytes of the saved file, with the byte at nPos changed if it is one of them
+static int open_broken(const unsigned char* pFile, size_t nSize, size_t nPos, int bVerify){
+	unsigned char* pCopy = (unsigned char*)malloc(nSize + 1);
+	if(NULL == pCopy) return ENOMEM;
+	memcpy(pCopy, pFile, nSize);
+	if(nPos < nSize) pCopy[nPos] ^= 0x40;
+	write_file(g_szBrokenPath, pCopy, nSize);
+	free(pCopy);
+
+	gallery_t* pGallery = NULL;
+	int result = Gallery_Open(g_szBrokenPath, bVerify, &pGallery);
+	CHECK((0 == result) == (NULL != pGallery));
+	if(NULL != pGallery) Gallery_Destroy(pGallery);
+	return result;
+}
+
+static void write_field(unsigned char* pFile, unsigned int nPos, unsigned int nValue){
+	memcpy(pFile + nPos, &nValue, sizeof(nValue));
+}
+
+//opens the saved file with a header or table field set to nValue and both checksums made right again, as a crafted
+//file would have them
+static int open_patched(const unsigned char* pFile, size_t nSize, unsigned int nPos, unsigned int nValue){
+	unsigned char* pCopy = (unsigned char*)malloc(nSize + 1);
+	if(NULL == pCopy) return ENOMEM;
+	memcpy(pCopy, pFile, nSize);
+	write_field(pCopy, nPos, nValue);
+	unsigned int nTableOffset = read_field(pCopy, TEST_TABLE_OFFSET_POS);
+	size_t nTableSize = TEST_ENTRY_SIZE * read_field(pCopy, TEST_FMD_CNT_POS);
+	write_field(pCopy, TEST_TABLE_CHECKSUM_POS, Checksum_Fnv1a(pCopy + nTableOffset, nTableSize, CHECKSUM_INIT));
+	write_field(pCopy, TEST_HEADER_CHECKSUM_POS, Checksum_Fnv1a(pCopy, TEST_HEADER_CHECKSUM_POS, CHECKSUM_INIT));
+	write_file(g_szBrokenPath, pCopy, nSize);
+	free(pCopy);
+
+	gallery_t* pGallery = NULL;
+	int result = Gallery_Open(g_szBrokenPath, 0, &pGallery);
+	CHECK((0 == result) == (NULL != pGallery));
+	if(NULL != pGallery) Gallery_Destroy(pGallery);
+	return result;
+}
+
+//both galleries hold the same FMDs under the same ids and find the same candidates
+static void check_same(gallery_t* pGallery1, gallery_t* pGallery2){
+	CHECK(pGallery1->nFmdCnt == pGallery2->nFmdCnt && pGallery1->nNextId == pGallery2->nNextId);
+	unsigned int nId = 0;
+	for(nId = 0; nId < pGallery1->nNextId; nId++){
+		unsigned char* pFmd1 = NULL;
+		unsigned char* pFmd2 = NULL;
+		unsigned int nSize1 = 0;
+		unsigned int nSize2 = 0;
+		int result = Gallery_GetFmd(pGallery1, nId, &pFmd1, &nSize1);
+		CHECK(result == Gallery_GetFmd(pGallery2, nId, &pFmd2, &nSize2));
+		if(0 != result) continue;
+		CHECK(nSize1 == nSize2 && 0 == memcmp(pFmd1, pFmd2, nSize1));
+	}
+
+	unsigned int nFinger = 0;
+	for(nFinger = 0; nFinger < TEST_FINGER_CNT; nFinger += 37){
+		unsigned char vProbe[STUB_FMD_SIZE];
+		unsigned int nProbeSize = 0;
+		Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 2, 9999, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+		gallery_candidate_t vCandidates1[TEST_MAX_CANDIDATES], vCandidates2[TEST_MAX_CANDIDATES];
+		unsigned int nCnt1 = TEST_MAX_CANDIDATES;
+		unsigned int nCnt2 = TEST_MAX_CANDIDATES;
+		CHECK(0 == Gallery_IdentifyParallel(pGallery1, NULL, vProbe, nProbeSize, 0, TEST_THRESHOLD(pGallery1->nFmdCnt), &nCnt1, vCandidates1));
+		CHECK(0 == Gallery_IdentifyParallel(pGallery2, NULL, vProbe, nProbeSize, 0, TEST_THRESHOLD(pGallery2->nFmdCnt), &nCnt2, vCandidates2));
+		CHECK(0 != nCnt1 && nCnt1 == nCnt2 && 0 == memcmp(vCandidates1, vCandidates2, sizeof(gallery_candidate_t) * nCnt1));
+
+		//the partitions are rebuilt from the table
+		DPFJ_FINGER_POSITION nFingerPos = (DPFJ_FINGER_POSITION)(nFinger % GALLERY_FINGER_POSITIONS);
+		nCnt1 = TEST_MAX_CANDIDATES;
+		nCnt2 = TEST_MAX_CANDIDATES;
+		CHECK(0 == Gallery_IdentifyFingers(pGallery1, vProbe, nProbeSize, 0, 1, &nFingerPos, 0, TEST_THRESHOLD(pGallery1->nFmdCnt), &nCnt1, vCandidates1));
+		CHECK(0 == Gallery_IdentifyFingers(pGallery2, vProbe, nProbeSize, 0, 1, &nFingerPos, 0, TEST_THRESHOLD(pGallery2->nFmdCnt), &nCnt2, vCandidates2));
+		CHECK(0 != nCnt1 && nCnt1 == nCnt2 && 0 == memcmp(vCandidates1, vCandidates2, sizeof(gallery_candidate_t) * nCnt1));
+	}
+}
+
+static void test_round_trip(gallery_t* pGallery){
+	CHECK(0 == Gallery_Save(pGallery, g_szPath));
+	int bVerify = 0;
+	for(bVerify = 0; bVerify < 2; bVerify++){
+		gallery_t* pOpened = NULL;
+		CHECK(0 == Gallery_Open(g_szPath, bVerify, &pOpened));
+		if(NULL == pOpened) continue;
+		check_same(pGallery, pOpened);
+
+		//the mapped gallery can be changed, new ids go on from the saved ones
+		unsigned int nId = add_finger(pOpened, 5, 3);
+		CHECK(pGallery->nNextId == nId);
+		CHECK(0 == Gallery_Remove(pOpened, 0));
+		CHECK(pGallery->nFmdCnt == pOpened->nFmdCnt);
+		Gallery_Destroy(pOpened);
+	}
+
+	//an empty gallery is saved and opened too
+	gallery_t* pEmpty = NULL;
+	gallery_t* pOpened = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ISO_19794_2_2005, &pEmpty));
+	if(NULL == pEmpty) return;
+	CHECK(0 == Gallery_Save(pEmpty, g_szPath));
+	CHECK(0 == Gallery_Open(g_szPath, 1, &pOpened));
+	if(NULL != pOpened){
+		CHECK(0 == pOpened->nFmdCnt && DPFJ_FMD_ISO_19794_2_2005 == pOpened->nFmdType);
+		Gallery_Destroy(pOpened);
+	}
+	Gallery_Destroy(pEmpty);
+}
+
+static void test_broken_files(gallery_t* pGallery){
+	CHECK(0 == Gallery_Save(pGallery, g_szPath));
+	size_t nSize = 0;
+	unsigned char* pFile = read_file(g_szPath, &nSize);
+	CHECK(NULL != pFile);
+	if(NULL == pFile) return;
+	unsigned int nTableOffset = read_field(pFile, TEST_TABLE_OFFSET_POS);
+	unsigned int nArenaOffset = read_field(pFile, TEST_ARENA_OFFSET_POS);
+	unsigned int nArenaSize = read_field(pFile, TEST_ARENA_SIZE_POS);
+	CHECK(0 == nArenaOffset % 4096 && nArenaOffset + nArenaSize == nSize);
+
+	//the unchanged copy opens, the header and the table are checked on every open
+	CHECK(0 == open_broken(pFile, nSize, nSize, 1));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, 0, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, TEST_NEXT_ID_POS, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, TEST_ARENA_SIZE_POS + 1, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, nTableOffset, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, nTableOffset + 1000, 0));
+
+	//the arena only when asked to
+	CHECK(0 == open_broken(pFile, nSize, nArenaOffset + 7, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, nArenaOffset + 7, 1));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize, nSize - 1, 1));
+
+	//cut files: in the arena, in the table, in the header, nothing left
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nSize - 1, nSize, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nArenaOffset, nSize, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, nTableOffset + 10, nSize, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, 10, nSize, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_broken(pFile, 0, nSize, 0));
+
+	//fields with valid checksums but out of their range: the id index is allocated from the next id, the candidate
+	//arrays from the view counts
+	unsigned int nFmdCnt = read_field(pFile, TEST_FMD_CNT_POS);
+	unsigned int nNextId = read_field(pFile, TEST_NEXT_ID_POS);
+	CHECK(0 == open_patched(pFile, nSize, TEST_NEXT_ID_POS, nNextId));
+	CHECK(0 == open_patched(pFile, nSize, TEST_NEXT_ID_POS, nNextId + 1000));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, TEST_NEXT_ID_POS, 0xffffffff));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, TEST_NEXT_ID_POS, 0xfffffffe));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, TEST_NEXT_ID_POS, (unsigned int)nSize * 16 + 1));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, TEST_NEXT_ID_POS, nFmdCnt - 1));
+	unsigned int nViewCntPos = nTableOffset + TEST_ENTRY_VIEW_CNT_POS;
+	CHECK(0 == open_patched(pFile, nSize, nViewCntPos, 2));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, nViewCntPos, 0));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, nViewCntPos, 256));
+	CHECK(DPFJ_E_INVALID_FMD == open_patched(pFile, nSize, nViewCntPos, 0xffffffff));
+	free(pFile);
+
+	//the temporary file was renamed, a file that cannot be written or a name that does not fit fails
+	char szTemp[sizeof(g_szPath) + 4];
+	snprintf(szTemp, sizeof(szTemp), "%s.tmp", g_szPath);
+	CHECK(0 != access(szTemp, F_OK));
+	gallery_t* pOpened = NULL;
+	CHECK(ENOENT == Gallery_Save(pGallery, "/nonexistent/dir/gallery"));
+	CHECK(ENOENT == Gallery_Open("/nonexistent/dir/gallery", 0, &pOpened));
+	CHECK(NULL == pOpened);
+	char szLong[PATH_MAX + 16];
+	memset(szLong, 'a', sizeof(szLong) - 1);
+	szLong[sizeof(szLong) - 1] = '\0';
+	CHECK(ENAMETOOLONG == Gallery_Save(pGallery, szLong));
+}
+
+//a gallery which removed so many FMDs that its file could not be opened again is not saved
+static void test_id_holes(void){
+	gallery_t* pGallery = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL == pGallery) return;
+	unsigned int i = 0;
+	for(i = 0; i < 70000; i++){
+		unsigned int nId = add_finger(pGallery, 1, 0);
+		if(0 != nId % 10000) CHECK(0 == Gallery_Remove(pGallery, nId));
+	}
+	CHECK(0 == Gallery_Save(pGallery, g_szPath));
+	for(i = 0; i < 70000; i += 10000) CHECK(0 == Gallery_Remove(pGallery, i));
+	CHECK(EOVERFLOW == Gallery_Save(pGallery, g_szPath));
+	Gallery_Destroy(pGallery);
+}
+
+int main(void){
+	snprintf(g_szPath, sizeof(g_szPath), "/tmp/test_galleryfile.%d", (int)getpid());
+	snprintf(g_szBrokenPath, sizeof(g_szBrokenPath), "/tmp/test_galleryfile.%d.broken", (int)getpid());
+
+	//removed FMDs leave holes in the ids, which the file keeps
+	gallery_t* pGallery = NULL;
+	CHECK(0 == Gallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL != pGallery){
+		unsigned int i = 0;
+		for(i = 0; i < 2 * TEST_FINGER_CNT; i++) add_finger(pGallery, i % TEST_FINGER_CNT, 1 + i / TEST_FINGER_CNT);
+		for(i = 3; i < 2 * TEST_FINGER_CNT; i += 41) CHECK(0 == Gallery_Remove(pGallery, i));
+		test_round_trip(pGallery);
+		test_broken_files(pGallery);
+		Gallery_Destroy(pGallery);
+	}
+	test_id_holes();
+	unlink(g_szPath);
+	unlink(g_szBrokenPath);
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../livegallery.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+//id n holds finger n % TEST_FINGER_CNT, the first TEST_FINGER_CNT ids are never removed by the concurrent test
+#define TEST_FINGER_CNT     50
+#define TEST_MAX_CANDIDATES 16
+#define TEST_READER_CNT     4
+#define TEST_WRITE_CNT      600
+
+static live_gallery_t* g_pHookGallery = NULL;
+static unsigned int g_nHookFirstId = 0;
+
+static unsigned int add_finger(live_gallery_t* pGallery, unsigned int nFinger, unsigned int nShift){
+	unsigned char vFmd[STUB_FMD_SIZE];
+	unsigned int nFmdSize = 0;
+	unsigned int nId = GALLERY_NO_INDEX;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, nShift, nFinger + nShift, DPFJ_POSITION_UNKNOWN, vFmd, &nFmdSize);
+	CHECK(0 == LiveGallery_Add(pGallery, vFmd, nFmdSize, &nId));
+	return nId;
+}
+
+//candidates of the finger; per comparison the threshold is 500, copies score under it, other fingers tens of thousands
+static unsigned int find_finger(live_gallery_t* pGallery, unsigned int nFinger, unsigned int nLiveCnt, unsigned int nMaxCnt,
+	gallery_candidate_t* vCandidates){
+	unsigned char vProbe[STUB_FMD_SIZE];
+	unsigned int nProbeSize = 0;
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 2, 9999, DPFJ_POSITION_UNKNOWN, vProbe, &nProbeSize);
+	unsigned int nCnt = nMaxCnt;
+	CHECK(0 == LiveGallery_Identify(pGallery, vProbe, nProbeSize, 0, 500 * nLiveCnt, &nCnt, vCandidates));
+	return nCnt;
+}
+
+static int has_id(const gallery_candidate_t* vCandidates, unsigned int nCnt, unsigned int nId){
+	unsigned int i = 0;
+	for(i = 0; i < nCnt; i++) if(vCandidates[i].nId == nId) return 1;
+	return 0;
+}
+
+//removed FMDs are filtered out and do not take candidate places, compaction keeps the ids
+static void test_tombstones(void){
+	live_gallery_t* pGallery = NULL;
+	CHECK(0 == LiveGallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL == pGallery) return;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT; i++) CHECK(i == add_finger(pGallery, i, 0));
+	unsigned int vCopy[5];
+	for(i = 0; i < 5; i++) vCopy[i] = add_finger(pGallery, 3, 1 + i % 2);
+
+	gallery_candidate_t vCandidates[TEST_MAX_CANDIDATES];
+	CHECK(6 == find_finger(pGallery, 3, TEST_FINGER_CNT + 5, TEST_MAX_CANDIDATES, vCandidates));
+	CHECK(0 == LiveGallery_Remove(pGallery, 3));
+	CHECK(0 == LiveGallery_Remove(pGallery, vCopy[0]));
+	CHECK(0 == LiveGallery_Remove(pGallery, vCopy[1]));
+	CHECK(ENOENT == LiveGallery_Remove(pGallery, vCopy[1]));
+	CHECK(ENOENT == LiveGallery_Remove(pGallery, vCopy[4] + 1));
+
+	//the removed copies may score best, the two places still go to live ones
+	unsigned int nCnt = find_finger(pGallery, 3, TEST_FINGER_CNT + 2, 2, vCandidates);
+	CHECK(2 == nCnt);
+	for(i = 0; i < nCnt; i++) CHECK(vCandidates[i].nId == vCopy[2] || vCandidates[i].nId == vCopy[3] || vCandidates[i].nId == vCopy[4]);
+	CHECK(3 == find_finger(pGallery, 3, TEST_FINGER_CNT + 2, TEST_MAX_CANDIDATES, vCandidates));
+
+	CHECK(0 == LiveGallery_Compact(pGallery));
+	nCnt = find_finger(pGallery, 3, TEST_FINGER_CNT + 2, TEST_MAX_CANDIDATES, vCandidates);
+	CHECK(3 == nCnt && has_id(vCandidates, nCnt, vCopy[2]) && has_id(vCandidates, nCnt, vCopy[3]) && has_id(vCandidates, nCnt, vCopy[4]));
+	CHECK(1 == find_finger(pGallery, 4, TEST_FINGER_CNT + 2, TEST_MAX_CANDIDATES, vCandidates) && 4 == vCandidates[0].nId);
+	CHECK(ENOENT == LiveGallery_Remove(pGallery, vCopy[0]));
+	CHECK(0 == LiveGallery_Remove(pGallery, vCopy[2]));
+	CHECK(vCopy[4] + 1 == add_finger(pGallery, 3, 0));
+	LiveGallery_Destroy(pGallery);
+}
+
+//runs inside dpfj_identify(), after the snapshot was taken: the searched FMD is removed, a new copy added, the arrays
+//are outgrown and compacted, the snapshot keeps its arrays and FMDs
+static void change_gallery(void){
+	Stub_SetIdentifyHook(NULL);
+	CHECK(0 == LiveGallery_Remove(g_pHookGallery, 10));
+	g_nHookFirstId = add_finger(g_pHookGallery, 10, 1);
+	unsigned int i = 0;
+	for(i = 0; i < 200; i++) add_finger(g_pHookGallery, 1000 + i, 0);
+	CHECK(0 == LiveGallery_Compact(g_pHookGallery));
+}
+
+static void test_snapshot(void){
+	live_gallery_t* pGallery = NULL;
+	CHECK(0 == LiveGallery_Create(DPFJ_FMD_ANSI_378_2004, &pGallery));
+	if(NULL == pGallery) return;
+	unsigned int i = 0;
+	for(i = 0; i < TEST_FINGER_CNT; i++) add_finger(pGallery, i, 0);
+
+	gallery_candidate_t vCandidates[TEST_MAX_CANDIDATES];
+	g_pHookGallery = pGallery;
+	Stub_SetIdentifyHook(change_gallery);
+	unsigned int nCnt = find_finger(pGallery, 10, TEST_FINGER_CNT, TEST_MAX_CANDIDATES, vCandidates);
+	CHECK(1 == nCnt && 10 == vCandidates[0].nId);
+
+	//the next search sees the changes
+	nCnt = find_finger(pGallery, 10, TEST_FINGER_CNT + 200, TEST_MAX_CANDIDATES, vCandidates);
+	CHECK(1 == nCnt && g_nHookFirstId == vCandidates[0].nId);
+	CHECK(1 == find_finger(pGallery, 1100, TEST_FINGER_CNT + 200, TEST_MAX_CANDIDATES, vCandidates) && g_nHookFirstId + 101 == vCandidates[0].nId);
+	LiveGallery_Destroy(pGallery);
+}
+
+typedef struct {
+	live_gallery_t* pGallery;
+	unsigned int    bDone;     //changed with atomic operations
+	unsigned int    nSearchCnt;
+} concurrent_t;
+
+//the first copy of every finger is always there, other ids found are copies of the probed finger
+static void* reader_thread(void* pArg){
+	concurrent_t* pConcurrent = (concurrent_t*)pArg;
+	while(!__sync_fetch_and_add(&pConcurrent->bDone, 0)){
+		unsigned int nFinger = __sync_fetch_and_add(&pConcurrent->nSearchCnt, 1) * 7 % TEST_FINGER_CNT;
+		gallery_candidate_t vCandidates[TEST_MAX_CANDIDATES];
+		//the number of live FMDs changes under the search, the most there can be keeps copies under the threshold
+		unsigned int nCnt = find_finger(pConcurrent->pGallery, nFinger, TEST_FINGER_CNT + TEST_WRITE_CNT, TEST_MAX_CANDIDATES, vCandidates);
+		CHECK(has_id(vCandidates, nCnt, nFinger));
+		unsigned int i = 0;
+		for(i = 0; i < nCnt; i++) CHECK(nFinger == vCandidates[i].nId % TEST_FINGER_CNT);
+	}
+	return NULL;
+}
+
+static void test_concurrent(void){
+	concurrent_t concurrent;
+	memset(&concurrent, 0, sizeof(concurrent));
+	CHECK(0 == LiveGallery_Create(DPFJ_FMD_ANSI_378_2004, &concurrent.pGallery));
+	if(NULL == concurrent.pGallery) return;
+	unsigned int nId = 0;
+	for(nId = 0; nId < TEST_FINGER_CNT; nId++) add_finger(concurrent.pGallery, nId, 0);
+
+	pthread_t vThread[TEST_READER_CNT];
+	unsigned int i = 0;
+	for(i = 0; i < TEST_READER_CNT; i++) pthread_create(&vThread[i], NULL, reader_thread, &concurrent);
+
+	//copies are added, the older ones removed and the arrays compacted while the readers search, a search per change
+	unsigned int nRemoveId = TEST_FINGER_CNT;
+	for(i = 0; i < TEST_WRITE_CNT; i++, nId++){
+		while(__sync_fetch_and_add(&concurrent.nSearchCnt, 0) <= i) sched_yield();
+		CHECK(nId == add_finger(concurrent.pGallery, nId % TEST_FINGER_CNT, 1));
+		if(0 == i % 3) CHECK(0 == LiveGallery_Remove(concurrent.pGallery, nRemoveId++));
+		if(0 == i % 50) CHECK(0 == LiveGallery_Compact(concurrent.pGallery));
+	}
+	__sync_fetch_and_add(&concurrent.bDone, 1);
+	for(i = 0; i < TEST_READER_CNT; i++) pthread_join(vThread[i], NULL);
+	CHECK(TEST_WRITE_CNT <= concurrent.nSearchCnt);
+	LiveGallery_Destroy(concurrent.pGallery);
+}
+
+int main(void){
+	test_tombstones();
+	test_snapshot();
+	test_concurrent();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+//the module is included to reach the uevent parser
+#include "../readermanager.c"
+#include "stubdpfpdd.h"
+#include "check.h"
+
+#include <stdio.h>
+#include <sys/epoll.h>
+
+//the stub counts a capture until its callback has returned, a moment after the callback let the manager go on
+static int wait_stub_idle(unsigned int nTimeoutMs){
+	unsigned int i = 0;
+	for(i = 0; i < nTimeoutMs / 10 && 0 != Stub_GetInFlightCnt(); i++) usleep(10000);
+	return 0 == Stub_GetInFlightCnt();
+}
+
+static unsigned int g_vArrivedCnt[STUB_READER_CNT];
+static unsigned int g_vRemovedCnt[STUB_READER_CNT];
+
+static void on_pnp(void* pContext, unsigned int nReaderIdx, const char* szName, int bArrived){
+	(void)pContext;
+	(void)szName;
+	if(bArrived) g_vArrivedCnt[nReaderIdx]++;
+	else g_vRemovedCnt[nReaderIdx]++;
+}
+
+//takes nCnt captures, counts the good ones by reader; returns the number of failed ones
+static unsigned int take_captures(reader_manager_t* pManager, unsigned int nCnt, unsigned int* vGoodCnt){
+	unsigned int nFailedCnt = 0;
+	unsigned int i = 0;
+	for(i = 0; i < nCnt; i++){
+		reader_capture_t* pCapture = NULL;
+		if(0 != ReaderManager_Wait(pManager, 1000, &pCapture)) break;
+		if(0 != pCapture->nResult) nFailedCnt++;
+		else{
+			CHECK(STUB_IMAGE_SIZE == pCapture->nImageSize && pCapture->vImage[0] == pCapture->nReaderIdx);
+			vGoodCnt[pCapture->nReaderIdx]++;
+		}
+		ReaderManager_FreeCapture(pCapture);
+	}
+	CHECK(i == nCnt);
+	return nFailedCnt;
+}
+
+//takes captures until the reader has failed and none of its captures is left in the queue; returns the number of
+//failed ones: a capture which came before the unplug rearms its reader when taken, that fails right away and leaves
+//no failed capture
+static unsigned int take_until_failed(reader_manager_t* pManager, unsigned int nReaderIdx, unsigned int* vGoodCnt){
+	unsigned int nFailedCnt = 0;
+	while(1){
+		pthread_mutex_lock(&pManager->mutex);
+		manager_reader_t* pReader = pManager->vReader[nReaderIdx];
+		int bFailed = pReader->bFailed && !pReader->bArmed;
+		reader_capture_t* pCapture = NULL;
+		for(pCapture = pManager->pHead; bFailed && NULL != pCapture; pCapture = pCapture->pNext){
+			if(nReaderIdx == pCapture->nReaderIdx) bFailed = 0;
+		}
+		pthread_mutex_unlock(&pManager->mutex);
+		if(bFailed) return nFailedCnt;
+		nFailedCnt += take_captures(pManager, 1, vGoodCnt);
+	}
+}
+
+static void test_uevents(void){
+	const char szAdd[] = "add@/devices/usb1/1-1\0ACTION=add\0DEVPATH=/devices/usb1/1-1\0SUBSYSTEM=usb\0DEVTYPE=usb_device\0PRODUCT=5ba/a/101\0";
+	const char szInterface[] = "remove@/devices/usb1/1-1/1-1:1.0\0ACTION=remove\0SUBSYSTEM=usb\0DEVTYPE=usb_interface\0PRODUCT=5ba/a/101\0";
+	const char szRemove[] = "remove@/devices/usb1/1-1\0ACTION=remove\0SUBSYSTEM=usb\0DEVTYPE=usb_device\0PRODUCT=5ba/a/101\0";
+	const char szOther[] = "add@/devices/usb1/1-2\0ACTION=add\0SUBSYSTEM=usb\0DEVTYPE=usb_device\0PRODUCT=46d/c52b/1211\0";
+	CHECK(1 == parse_uevent(szAdd, sizeof(szAdd) - 1));
+	CHECK(0 == parse_uevent(szInterface, sizeof(szInterface) - 1));
+	CHECK(-1 == parse_uevent(szRemove, sizeof(szRemove) - 1));
+	CHECK(0 == parse_uevent(szOther, sizeof(szOther) - 1));
+}
+
+//all the readers capture into the single queue, taken in an epoll loop
+static void test_captures(void){
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	Stub_SetBusy(5, 1);
+	reader_manager_t* pManager = NULL;
+	CHECK(0 == ReaderManager_Create(&cparam, &pManager));
+	if(NULL == pManager) return;
+	CHECK(STUB_READER_CNT == pManager->nReaderCnt);
+	CHECK(NULL == pManager->vReader[5]->hReader);
+	CHECK(0 == ReaderManager_Start(pManager));
+
+	int fdEpoll = epoll_create1(0);
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	CHECK(0 == epoll_ctl(fdEpoll, EPOLL_CTL_ADD, ReaderManager_GetEventFd(pManager), &event));
+	unsigned int vGoodCnt[STUB_READER_CNT] = {0};
+	unsigned int nTotal = 0;
+	while(nTotal < 1000 && 1 == epoll_wait(fdEpoll, &event, 1, 1000)){
+		reader_capture_t* pCapture = NULL;
+		while(0 == ReaderManager_Wait(pManager, 0, &pCapture)){
+			CHECK(0 == pCapture->nResult && pCapture->vImage[0] == pCapture->nReaderIdx);
+			vGoodCnt[pCapture->nReaderIdx]++;
+			nTotal++;
+			ReaderManager_FreeCapture(pCapture);
+		}
+	}
+	close(fdEpoll);
+	CHECK(1000 <= nTotal);
+	unsigned int i = 0;
+	for(i = 0; i < STUB_READER_CNT; i++) CHECK((5 == i) == (0 == vGoodCnt[i]));
+
+	//stopped, nothing is pending; started again, captures come
+	CHECK(0 == ReaderManager_Stop(pManager));
+	CHECK(0 == pManager->nPendingCnt);
+	CHECK(0 == ReaderManager_Start(pManager));
+	reader_capture_t* pCapture = NULL;
+	CHECK(0 == ReaderManager_Wait(pManager, 1000, &pCapture));
+	ReaderManager_FreeCapture(pCapture);
+
+	ReaderManager_Destroy(pManager);
+	CHECK(wait_stub_idle(1000));
+	Stub_SetBusy(5, 0);
+}
+
+//readers unplugged and plugged in again, found by refreshing
+static void test_refresh(void){
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	Stub_SetBusy(5, 1);
+	reader_manager_t* pManager = NULL;
+	CHECK(0 == ReaderManager_Create(&cparam, &pManager));
+	if(NULL == pManager) return;
+	memset(g_vArrivedCnt, 0, sizeof(g_vArrivedCnt));
+	memset(g_vRemovedCnt, 0, sizeof(g_vRemovedCnt));
+	ReaderManager_SetPnpCallback(pManager, on_pnp, NULL);
+	CHECK(0 == ReaderManager_Start(pManager));
+
+	unsigned int vGoodCnt[STUB_READER_CNT] = {0};
+	CHECK(0 == take_captures(pManager, 200, vGoodCnt));
+
+	//the captures of the readers unplugged fail, the readers are closed on the refresh
+	Stub_Unplug(3);
+	Stub_Unplug(7);
+	unsigned int nFailedCnt = take_until_failed(pManager, 3, vGoodCnt);
+	nFailedCnt += take_until_failed(pManager, 7, vGoodCnt);
+	CHECK(2 >= nFailedCnt);
+	unsigned int nChangeCnt = 0;
+	CHECK(0 == ReaderManager_Refresh(pManager, &nChangeCnt));
+	CHECK(2 == nChangeCnt);
+	CHECK(1 == g_vRemovedCnt[3] && 1 == g_vRemovedCnt[7]);
+
+	//readers plugged in, and a reader not busy anymore, are opened and armed
+	Stub_SetBusy(5, 0);
+	Stub_Plug(3);
+	CHECK(0 == ReaderManager_Refresh(pManager, &nChangeCnt));
+	CHECK(2 == nChangeCnt);
+	CHECK(1 == g_vArrivedCnt[3] && 1 == g_vArrivedCnt[5]);
+	memset(vGoodCnt, 0, sizeof(vGoodCnt));
+	CHECK(0 == take_captures(pManager, 300, vGoodCnt));
+	unsigned int i = 0;
+	for(i = 0; i < STUB_READER_CNT; i++) CHECK((7 == i) == (0 == vGoodCnt[i]));
+
+	//a reader unplugged and plugged in again in between keeps its name, its capture fails and it is reopened
+	Stub_Unplug(2);
+	Stub_Plug(2);
+	Stub_Plug(7);
+	CHECK(1 >= take_until_failed(pManager, 2, vGoodCnt));
+	CHECK(0 == ReaderManager_Refresh(pManager, &nChangeCnt));
+	CHECK(3 == nChangeCnt);
+	CHECK(1 == g_vRemovedCnt[2] && 1 == g_vArrivedCnt[2] && 1 == g_vArrivedCnt[7]);
+	memset(vGoodCnt, 0, sizeof(vGoodCnt));
+	CHECK(0 == take_captures(pManager, 300, vGoodCnt));
+	for(i = 0; i < STUB_READER_CNT; i++) CHECK(0 != vGoodCnt[i]);
+
+	ReaderManager_Destroy(pManager);
+	CHECK(wait_stub_idle(1000));
+}
+
+//captures not called back in time keep the manager allocated, their callbacks come after Destroy() returned
+static void test_late_callbacks(void){
+	DPFPDD_CAPTURE_PARAM cparam = {0};
+	reader_manager_t* pManager = NULL;
+	CHECK(0 == ReaderManager_Create(&cparam, &pManager));
+	if(NULL == pManager) return;
+	Stub_SetLateCallback(READER_MANAGER_STOP_TIMEOUT_MS + 500);
+	CHECK(0 == ReaderManager_Start(pManager));
+	ReaderManager_Destroy(pManager);
+	CHECK(STUB_READER_CNT == Stub_GetInFlightCnt());
+	CHECK(wait_stub_idle(2000));
+	Stub_SetLateCallback(0);
+}
+
+int main(void){
+	test_uevents();
+	test_captures();
+	test_refresh();
+	test_late_callbacks();
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../record.h"
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//records are built field by field from the standards, every field has a value of its own so a wrong offset shows
+#define TEST_MAX_RECORD 256
+
+static void write_be(unsigned char* p, unsigned int nValue, unsigned int nBytes){
+	while(0 != nBytes--){
+		p[nBytes] = (unsigned char)nValue;
+		nValue >>= 8;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FMD
+
+//views of the test FMDs: 3 minutiae and a 5-byte extended data block, then 1 minutia and no block
+static unsigned int write_fmd_views(unsigned char* p){
+	unsigned char* pStart = p;
+	p[0] = DPFJ_POSITION_RINDEX;
+	p[1] = (0 << 4) | DPFJ_SCAN_LIVE_ROLLED;
+	p[2] = 61;
+	p[3] = 3;
+	p += DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH;
+	unsigned int i = 0;
+	for(i = 0; i < 3; i++, p += DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH){
+		write_be(p, ((i % 3) << 14) | (100 + i), 2);
+		write_be(p + 2, 200 + i, 2);
+		p[4] = (unsigned char)(40 + i);
+		p[5] = (unsigned char)(70 + i);
+	}
+	write_be(p, 5, 2);
+	memcpy(p + 2, "\x11\x22\x33\x44\x55", 5);
+	p += 7;
+
+	p[0] = DPFJ_POSITION_LMIDDLE;
+	p[1] = (1 << 4) | DPFJ_SCAN_LIVE_PLAIN;
+	p[2] = 62;
+	p[3] = 1;
+	p += DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH;
+	write_be(p, (2 << 14) | 333, 2);
+	write_be(p + 2, 444, 2);
+	p[4] = 179;
+	p[5] = 100;
+	p += DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH;
+	write_be(p, 0, 2);
+	p += 2;
+	return (unsigned int)(p - pStart);
+}
+
+//ANSI 378-2004: magic and version, record length, CBEFF product id, capture equipment, size, resolution, view count,
+//reserved; bLongLength writes 0 in the 2-byte length and the length in the 4 bytes after it
+static unsigned int make_ansi_fmd(int bLongLength, unsigned char* pFmd){
+	memset(pFmd, 0, TEST_MAX_RECORD);
+	memcpy(pFmd, "FMR\0 20\0", 8);
+	unsigned int nHeaderSize = DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH + (bLongLength ? 4 : 0);
+	unsigned char* p = pFmd + (bLongLength ? 14 : 10);
+	write_be(p, 0x33445566, 4);
+	write_be(p + 4, 0x0123, 2);
+	write_be(p + 6, 321, 2);
+	write_be(p + 8, 432, 2);
+	write_be(p + 10, 197, 2);
+	write_be(p + 12, 198, 2);
+	p[14] = 2;
+	unsigned int nSize = nHeaderSize + write_fmd_views(pFmd + nHeaderSize);
+	if(bLongLength) write_be(pFmd + 10, nSize, 4);
+	else write_be(pFmd + 8, nSize, 2);
+	return nSize;
+}
+
+//ISO 19794-2-2005: magic and version, 4-byte record length, capture equipment, size, resolution, view count, reserved
+static unsigned int make_iso_fmd(unsigned char* pFmd){
+	memset(pFmd, 0, TEST_MAX_RECORD);
+	memcpy(pFmd, "FMR\0 20\0", 8);
+	unsigned char* p = pFmd + 12;
+	write_be(p, 0x0123, 2);
+	write_be(p + 2, 321, 2);
+	write_be(p + 4, 432, 2);
+	write_be(p + 6, 197, 2);
+	write_be(p + 8, 198, 2);
+	p[10] = 2;
+	unsigned int nSize = DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH + write_fmd_views(pFmd + DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH);
+	write_be(pFmd + 8, nSize, 4);
+	return nSize;
+}
+
+static void check_fmd(DPFJ_FMD_FORMAT nType, const unsigned char* pFmd, unsigned int nSize, unsigned int nHeaderSize){
+	fmd_record_t record;
+	CHECK(0 == FmdRecord_Parse(&record, nType, pFmd, nSize));
+	CHECK(321 == record.nWidth && 432 == record.nHeight && 197 == record.nResolution);
+	CHECK(2 == record.nViewCnt && nHeaderSize == record.vViewOffset[0]);
+
+	fmd_view_t view;
+	CHECK(0 == FmdRecord_GetView(&record, 0, &view));
+	CHECK(DPFJ_POSITION_RINDEX == view.nFingerPos && 0 == view.nViewNumber && DPFJ_SCAN_LIVE_ROLLED == view.nImpressionType);
+	CHECK(61 == view.nQuality && 3 == view.nMinutiaCnt);
+	CHECK(5 == view.nExtBlockLength && NULL != view.pExtBlock && 0 == memcmp(view.pExtBlock, "\x11\x22\x33\x44\x55", 5));
+	unsigned int i = 0;
+	for(i = 0; i < 3; i++){
+		fmd_minutia_t minutia;
+		FmdView_GetMinutia(&view, i, &minutia);
+		CHECK(i % 3 == minutia.nType && 100 + i == minutia.nX && 200 + i == minutia.nY);
+		CHECK(40 + i == minutia.nAngle && 70 + i == minutia.nQuality);
+	}
+
+	CHECK(0 == FmdRecord_GetView(&record, 1, &view));
+	CHECK(DPFJ_POSITION_LMIDDLE == view.nFingerPos && 1 == view.nViewNumber && DPFJ_SCAN_LIVE_PLAIN == view.nImpressionType);
+	CHECK(62 == view.nQuality && 1 == view.nMinutiaCnt && 0 == view.nExtBlockLength && NULL == view.pExtBlock);
+	fmd_minutia_t minutia;
+	FmdView_GetMinutia(&view, 0, &minutia);
+	CHECK(2 == minutia.nType && 333 == minutia.nX && 444 == minutia.nY && 179 == minutia.nAngle && 100 == minutia.nQuality);
+	CHECK(DPFJ_E_INVALID_PARAMETER == FmdRecord_GetView(&record, 2, &view));
+}
+
+//every way the record can be cut or overrun is refused
+static void check_broken_fmd(DPFJ_FMD_FORMAT nType, unsigned char* pFmd, unsigned int nSize, unsigned int nHeaderSize,
+	unsigned int nViewCntPos){
+	fmd_record_t record;
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, pFmd, nSize - 1));
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, pFmd, nHeaderSize - 1));
+
+	unsigned char vBroken[TEST_MAX_RECORD];
+	memcpy(vBroken, pFmd, nSize);
+	vBroken[0] = 'X';
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, vBroken, nSize));
+
+	memcpy(vBroken, pFmd, nSize);
+	vBroken[nViewCntPos] = 0;
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, vBroken, nSize));
+	vBroken[nViewCntPos] = 3;
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, vBroken, nSize));
+
+	//the minutiae or the extended data block of the first view run past the end
+	memcpy(vBroken, pFmd, nSize);
+	vBroken[nHeaderSize + 3] = 40;
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, vBroken, nSize));
+	memcpy(vBroken, pFmd, nSize);
+	write_be(vBroken + nHeaderSize + DPFJ_FMD_ANSI_ISO_VIEW_HEADER_LENGTH + 3 * DPFJ_FMD_ANSI_ISO_MINITIA_LENGTH, 200, 2);
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, nType, vBroken, nSize));
+
+	CHECK(DPFJ_E_INVALID_PARAMETER == FmdRecord_Parse(&record, DPFJ_FMD_DP_PRE_REG_FEATURES, pFmd, nSize));
+	CHECK(DPFJ_E_INVALID_PARAMETER == FmdRecord_Parse(NULL, nType, pFmd, nSize));
+}
+
+static void test_fmd(void){
+	unsigned char vFmd[TEST_MAX_RECORD];
+	unsigned int nSize = make_ansi_fmd(0, vFmd);
+	check_fmd(DPFJ_FMD_ANSI_378_2004, vFmd, nSize, DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH);
+	check_broken_fmd(DPFJ_FMD_ANSI_378_2004, vFmd, nSize, DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH, 24);
+	//read as ISO, the 2-byte length and the product id after it make a 4-byte length which does not match
+	fmd_record_t record;
+	CHECK(DPFJ_E_INVALID_FMD == FmdRecord_Parse(&record, DPFJ_FMD_ISO_19794_2_2005, vFmd, nSize));
+
+	//the extended length moves everything after it by 4 bytes
+	nSize = make_ansi_fmd(1, vFmd);
+	check_fmd(DPFJ_FMD_ANSI_378_2004, vFmd, nSize, DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH + 4);
+	check_broken_fmd(DPFJ_FMD_ANSI_378_2004, vFmd, nSize, DPFJ_FMD_ANSI_378_2004_RECORD_HEADER_LENGTH + 4, 28);
+
+	nSize = make_iso_fmd(vFmd);
+	check_fmd(DPFJ_FMD_ISO_19794_2_2005, vFmd, nSize, DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH);
+	check_broken_fmd(DPFJ_FMD_ISO_19794_2_2005, vFmd, nSize, DPFJ_FMD_ISO_19794_2_2005_RECORD_HEADER_LENGTH, 22);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FID
+
+//views of the test FIDs: a 4 x 3 image and a 2 x 2 one
+static unsigned int write_fid_view(unsigned char* p, DPFJ_FINGER_POSITION nFingerPos, unsigned int nViewNumber,
+	unsigned int nWidth, unsigned int nHeight){
+	unsigned int nLength = DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH + nWidth * nHeight;
+	write_be(p, nLength, 4);
+	p[4] = (unsigned char)nFingerPos;
+	p[5] = 2;
+	p[6] = (unsigned char)nViewNumber;
+	p[7] = (unsigned char)(50 + nViewNumber);
+	p[8] = DPFJ_SCAN_LIVE_PLAIN;
+	write_be(p + 9, nWidth, 2);
+	write_be(p + 11, nHeight, 2);
+	memset(p + DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH, (int)(0xa0 + nViewNumber), nWidth * nHeight);
+	return nLength;
+}
+
+//ANSI 381-2004: magic and version, 6-byte record length, CBEFF product id, then the fields ISO has after the length:
+//capture device id, acquisition level, finger count, scale units, scan and image resolution, bit depth, compression
+static unsigned int make_fid(DPFJ_FID_FORMAT nType, unsigned char* pFid){
+	memset(pFid, 0, TEST_MAX_RECORD);
+	memcpy(pFid, "FIR\0 10\0", 8);
+	unsigned int nHeaderSize = DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH;
+	unsigned char* p = pFid + 14;
+	if(DPFJ_FID_ANSI_381_2004 == nType){
+		nHeaderSize = DPFJ_FID_ANSI_381_2004_RECORD_HEADER_LENGTH;
+		write_be(p, 0x33445566, 4);
+		p += 4;
+	}
+	write_be(p, 0x0123, 2);
+	write_be(p + 2, 31, 2);
+	p[4] = 2;
+	p[5] = 1;
+	write_be(p + 6, 501, 2);
+	write_be(p + 8, 502, 2);
+	write_be(p + 10, 503, 2);
+	write_be(p + 12, 504, 2);
+	p[14] = 8;
+	p[15] = 0;
+
+	unsigned int nSize = nHeaderSize;
+	nSize += write_fid_view(pFid + nSize, DPFJ_POSITION_RTHUMB, 0, 4, 3);
+	nSize += write_fid_view(pFid + nSize, DPFJ_POSITION_LTHUMB, 1, 2, 2);
+	write_be(pFid + 10, nSize, 4);
+	return nSize;
+}
+
+static void check_fid(DPFJ_FID_FORMAT nType, unsigned char* pFid, unsigned int nSize, unsigned int nHeaderSize){
+	fid_record_t record;
+	CHECK(0 == FidRecord_Parse(&record, nType, pFid, nSize));
+	CHECK(503 == record.nImageRes && 8 == record.nBpp && 0 == record.nCompression);
+	CHECK(2 == record.nViewCnt && nHeaderSize == record.vViewOffset[0]);
+
+	fid_view_t view;
+	CHECK(0 == FidRecord_GetView(&record, 0, &view));
+	CHECK(DPFJ_POSITION_RTHUMB == view.nFingerPos && 0 == view.nViewNumber && 50 == view.nQuality);
+	CHECK(DPFJ_SCAN_LIVE_PLAIN == view.nImpressionType && 4 == view.nWidth && 3 == view.nHeight);
+	CHECK(12 == view.nImageSize && pFid + nHeaderSize + DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH == view.pImage && 0xa0 == view.pImage[11]);
+	CHECK(0 == FidRecord_GetView(&record, 1, &view));
+	CHECK(DPFJ_POSITION_LTHUMB == view.nFingerPos && 1 == view.nViewNumber && 51 == view.nQuality);
+	CHECK(2 == view.nWidth && 2 == view.nHeight && 4 == view.nImageSize && 0xa1 == view.pImage[0]);
+	CHECK(DPFJ_E_INVALID_PARAMETER == FidRecord_GetView(&record, 2, &view));
+
+	//cut records, a view shorter than its header or past the end, lengths over 4 GB
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, pFid, nSize - 1));
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, pFid, nHeaderSize - 1));
+	unsigned char vBroken[TEST_MAX_RECORD];
+	memcpy(vBroken, pFid, nSize);
+	write_be(vBroken + nHeaderSize, DPFJ_FID_ANSI_ISO_VIEW_HEADER_LENGTH - 1, 4);
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, vBroken, nSize));
+	memcpy(vBroken, pFid, nSize);
+	write_be(vBroken + nHeaderSize, nSize, 4);
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, vBroken, nSize));
+	memcpy(vBroken, pFid, nSize);
+	vBroken[9] = 1;
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, vBroken, nSize));
+	memcpy(vBroken, pFid, nSize);
+	vBroken[2] = 'X';
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, vBroken, nSize));
+	//no views at all
+	memcpy(vBroken, pFid, nHeaderSize);
+	write_be(vBroken + 10, nHeaderSize, 4);
+	CHECK(DPFJ_E_INVALID_FID == FidRecord_Parse(&record, nType, vBroken, nHeaderSize));
+}
+
+static void test_fid(void){
+	unsigned char vFid[TEST_MAX_RECORD];
+	unsigned int nSize = make_fid(DPFJ_FID_ANSI_381_2004, vFid);
+	check_fid(DPFJ_FID_ANSI_381_2004, vFid, nSize, DPFJ_FID_ANSI_381_2004_RECORD_HEADER_LENGTH);
+	nSize = make_fid(DPFJ_FID_ISO_19794_4_2005, vFid);
+	check_fid(DPFJ_FID_ISO_19794_4_2005, vFid, nSize, DPFJ_FID_ISO_19794_4_2005_RECORD_HEADER_LENGTH);
+
+	fid_record_t record;
+	CHECK(DPFJ_E_INVALID_PARAMETER == FidRecord_Parse(&record, DPFJ_FID_ISO_19794_4_2005 + 1000, vFid, nSize));
+	CHECK(DPFJ_E_INVALID_PARAMETER == FidRecord_Parse(&record, DPFJ_FID_ISO_19794_4_2005, NULL, nSize));
+}
+
+int main(void){
+	test_fmd();
+	test_fid();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
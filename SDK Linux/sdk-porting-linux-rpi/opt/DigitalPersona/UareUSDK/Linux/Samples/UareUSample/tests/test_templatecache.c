@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2011, Digital Persona, Inc.
+ *
+ * This file is a part of sample code for the UareU SDK 2.x.
+ */
+
+#include "../templatecache.h"
+#include "stubdpfj.h"
+#include "check.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+//the table starts with 256 buckets and doubles once it holds 256 entries
+#define TEST_TABLE_SIZE (sizeof(template_entry_t*) << 8)
+
+static unsigned char g_vFmd[STUB_FMD_SIZE];
+static unsigned int g_nFmdSize = 0;
+
+//FMD of the finger, in the static buffer
+static void make_fmd(unsigned int nFinger){
+	Stub_MakeFmd(DPFJ_FMD_ANSI_378_2004, nFinger, 0, 0, DPFJ_POSITION_UNKNOWN, g_vFmd, &g_nFmdSize);
+}
+
+static int put(template_cache_t* pCache, unsigned int nId){
+	template_entry_t* pEntry = NULL;
+	make_fmd(nId);
+	int result = TemplateCache_Put(pCache, nId, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry);
+	if(NULL != pEntry) TemplateCache_Release(pCache, pEntry);
+	return result;
+}
+
+static int is_cached(template_cache_t* pCache, unsigned int nId){
+	template_entry_t* pEntry = NULL;
+	if(0 != TemplateCache_Get(pCache, nId, &pEntry)) return 0;
+	TemplateCache_Release(pCache, pEntry);
+	return 1;
+}
+
+static template_cache_stats_t get_stats(template_cache_t* pCache){
+	template_cache_stats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	TemplateCache_GetStats(pCache, &stats);
+	return stats;
+}
+
+//bytes accounted for an entry of the stub FMD, learned from a cache without pressure
+static size_t entry_charge(void){
+	template_cache_t* pCache = NULL;
+	CHECK(0 == TemplateCache_Create(1 << 20, &pCache));
+	if(NULL == pCache) return 0;
+	template_entry_t* pEntry = NULL;
+	make_fmd(1);
+	CHECK(0 == TemplateCache_Put(pCache, 1, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry));
+	size_t nCharge = (NULL != pEntry) ? pEntry->nCharge : 0;
+	CHECK(sizeof(template_entry_t) + g_nFmdSize <= nCharge);
+	if(NULL != pEntry) TemplateCache_Release(pCache, pEntry);
+	TemplateCache_Destroy(pCache);
+	return nCharge;
+}
+
+//the table and every entry are accounted, the table doubles once it holds as many entries as buckets
+static void test_memory(size_t nCharge){
+	template_cache_t* pCache = NULL;
+	CHECK(0 == TemplateCache_Create(1 << 20, &pCache));
+	if(NULL == pCache) return;
+	CHECK(TEST_TABLE_SIZE == get_stats(pCache).nMemoryUsed);
+
+	unsigned int i = 0;
+	for(i = 0; i < 255; i++) CHECK(0 == put(pCache, i));
+	CHECK(TEST_TABLE_SIZE + 255 * nCharge == get_stats(pCache).nMemoryUsed);
+	CHECK(0 == put(pCache, 255));
+	CHECK(2 * TEST_TABLE_SIZE + 256 * nCharge == get_stats(pCache).nMemoryUsed);
+
+	//a replaced entry gives its memory back
+	CHECK(0 == put(pCache, 5));
+	CHECK(256 == get_stats(pCache).nEntryCnt);
+	CHECK(2 * TEST_TABLE_SIZE + 256 * nCharge == get_stats(pCache).nMemoryUsed);
+	CHECK(0 == TemplateCache_Remove(pCache, 5));
+	CHECK(ENOENT == TemplateCache_Remove(pCache, 5));
+	CHECK(2 * TEST_TABLE_SIZE + 255 * nCharge == get_stats(pCache).nMemoryUsed);
+	TemplateCache_Destroy(pCache);
+}
+
+//the least recently used entry goes first, a get makes an entry the most recently used
+static void test_lru(size_t nCharge){
+	template_cache_t* pCache = NULL;
+	CHECK(0 == TemplateCache_Create(TEST_TABLE_SIZE + 3 * nCharge, &pCache));
+	if(NULL == pCache) return;
+	CHECK(0 == put(pCache, 1));
+	CHECK(0 == put(pCache, 2));
+	CHECK(0 == put(pCache, 3));
+	CHECK(is_cached(pCache, 1));
+
+	CHECK(0 == put(pCache, 4));
+	CHECK(1 == get_stats(pCache).nEvictCnt);
+	CHECK(!is_cached(pCache, 2));
+	CHECK(is_cached(pCache, 1) && is_cached(pCache, 3) && is_cached(pCache, 4));
+	CHECK(3 == get_stats(pCache).nEntryCnt);
+	CHECK(TEST_TABLE_SIZE + 3 * nCharge == get_stats(pCache).nMemoryUsed);
+
+	//1, 3 and 4 were got in this order, 1 is the least recently used now
+	CHECK(0 == put(pCache, 5));
+	CHECK(!is_cached(pCache, 1));
+	template_cache_stats_t stats = get_stats(pCache);
+	CHECK(2 == stats.nEvictCnt && 4 == stats.nHitCnt && 2 == stats.nMissCnt);
+	TemplateCache_Destroy(pCache);
+}
+
+//pinned entries are not evicted, removed and replaced ones stay readable and accounted until they are released
+static void test_pins(size_t nCharge){
+	template_cache_t* pCache = NULL;
+	CHECK(0 == TemplateCache_Create(TEST_TABLE_SIZE + 2 * nCharge, &pCache));
+	if(NULL == pCache) return;
+	template_entry_t* pEntry1 = NULL;
+	template_entry_t* pEntry2 = NULL;
+	make_fmd(1);
+	CHECK(0 == TemplateCache_Put(pCache, 1, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry1));
+	make_fmd(2);
+	CHECK(0 == TemplateCache_Put(pCache, 2, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry2));
+
+	//everything is pinned, nothing fits
+	template_entry_t* pEntry = NULL;
+	make_fmd(3);
+	CHECK(ENOMEM == TemplateCache_Put(pCache, 3, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry));
+	CHECK(NULL == pEntry && 0 == get_stats(pCache).nEvictCnt);
+	CHECK(TEST_TABLE_SIZE + 2 * nCharge == get_stats(pCache).nMemoryUsed);
+
+	//1 is the least recently used but pinned, 2 goes
+	TemplateCache_Release(pCache, pEntry2);
+	CHECK(0 == put(pCache, 3));
+	CHECK(is_cached(pCache, 1) && !is_cached(pCache, 2) && is_cached(pCache, 3));
+
+	//a removed entry is still compared through its handle, and still takes its memory
+	CHECK(0 == TemplateCache_Remove(pCache, 1));
+	CHECK(!is_cached(pCache, 1));
+	CHECK(1 == get_stats(pCache).nEntryCnt);
+	CHECK(TEST_TABLE_SIZE + 2 * nCharge == get_stats(pCache).nMemoryUsed);
+	unsigned int nScore = ~0u;
+	make_fmd(1);
+	CHECK(0 == TemplateCache_Compare(pEntry1, 0, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, 0, &nScore));
+	CHECK(0 == nScore);
+	CHECK(DPFJ_E_INVALID_PARAMETER == TemplateCache_Compare(pEntry1, 1, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, 0, &nScore));
+	TemplateCache_Release(pCache, pEntry1);
+	CHECK(TEST_TABLE_SIZE + nCharge == get_stats(pCache).nMemoryUsed);
+
+	//a replaced entry keeps its data for the handle, the id gets the new one
+	CHECK(0 == TemplateCache_Get(pCache, 3, &pEntry));
+	if(NULL != pEntry){
+		template_entry_t* pNew = NULL;
+		unsigned char vOld[STUB_FMD_SIZE];
+		make_fmd(3);
+		memcpy(vOld, g_vFmd, g_nFmdSize);
+		make_fmd(30);
+		CHECK(0 == TemplateCache_Put(pCache, 3, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pNew));
+		CHECK(NULL != pNew && pNew != pEntry);
+		CHECK(0 == memcmp(pEntry->vFmd, vOld, g_nFmdSize));
+		CHECK(TEST_TABLE_SIZE + 2 * nCharge == get_stats(pCache).nMemoryUsed);
+		TemplateCache_Release(pCache, pEntry);
+		if(NULL != pNew) TemplateCache_Release(pCache, pNew);
+		CHECK(TEST_TABLE_SIZE + nCharge == get_stats(pCache).nMemoryUsed);
+	}
+	TemplateCache_Destroy(pCache);
+}
+
+//the same data is found by its content, whatever buffer it comes in
+static void test_content(void){
+	template_cache_t* pCache = NULL;
+	CHECK(0 == TemplateCache_Create(1 << 20, &pCache));
+	if(NULL == pCache) return;
+	template_entry_t* pEntry1 = NULL;
+	template_entry_t* pEntry2 = NULL;
+	make_fmd(7);
+	CHECK(0 == TemplateCache_PutContent(pCache, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry1));
+	unsigned char vCopy[STUB_FMD_SIZE];
+	memcpy(vCopy, g_vFmd, g_nFmdSize);
+	CHECK(0 == TemplateCache_PutContent(pCache, DPFJ_FMD_ANSI_378_2004, vCopy, g_nFmdSize, &pEntry2));
+	CHECK(NULL != pEntry1 && pEntry1 == pEntry2);
+	template_cache_stats_t stats = get_stats(pCache);
+	CHECK(1 == stats.nEntryCnt && 1 == stats.nHitCnt && 1 == stats.nMissCnt);
+	if(NULL != pEntry1) TemplateCache_Release(pCache, pEntry1);
+	if(NULL != pEntry2) TemplateCache_Release(pCache, pEntry2);
+
+	//a broken FMD is not cached
+	template_entry_t* pEntry = NULL;
+	vCopy[0] = 'X';
+	CHECK(0 != TemplateCache_PutContent(pCache, DPFJ_FMD_ANSI_378_2004, vCopy, g_nFmdSize, &pEntry));
+	CHECK(NULL == pEntry && 1 == get_stats(pCache).nEntryCnt);
+	TemplateCache_Destroy(pCache);
+}
+
+static void test_arguments(void){
+	template_entry_t* pEntry = NULL;
+	unsigned int nScore = 0;
+	CHECK(EINVAL == TemplateCache_Create(1 << 20, NULL));
+	make_fmd(1);
+	CHECK(EINVAL == TemplateCache_Put(NULL, 1, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry));
+	CHECK(EINVAL == TemplateCache_PutContent(NULL, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, &pEntry));
+	CHECK(EINVAL == TemplateCache_Get(NULL, 1, &pEntry));
+	CHECK(EINVAL == TemplateCache_Remove(NULL, 1));
+	CHECK(EINVAL == TemplateCache_Compare(NULL, 0, DPFJ_FMD_ANSI_378_2004, g_vFmd, g_nFmdSize, 0, &nScore));
+}
+
+int main(void){
+	size_t nCharge = entry_charge();
+	if(0 != nCharge){
+		test_memory(nCharge);
+		test_lru(nCharge);
+		test_pins(nCharge);
+	}
+	test_content();
+	test_arguments();
+
+	printf("%s: %s\n", __FILE__, (0 == g_nFailCnt) ? "passed" : "FAILED");
+	return (0 == g_nFailCnt) ? 0 : 1;
+}
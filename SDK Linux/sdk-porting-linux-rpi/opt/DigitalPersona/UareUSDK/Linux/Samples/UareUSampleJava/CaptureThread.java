@@ -8,6 +8,10 @@ public class CaptureThread extends Thread
 {
 	public static final String ACT_CAPTURE = "capture_thread_captured";
 	
+	//the status is polled while the reader is busy, with the wait in between doubled up to the maximum
+	private static final int READY_POLL_MIN_MS = 5;
+	private static final int READY_POLL_MAX_MS = 100;
+	
 	public class CaptureEvent extends ActionEvent{
 		private static final long serialVersionUID = 101;
 
@@ -24,7 +28,8 @@ public class CaptureThread extends Thread
 	}
 	
 	private ActionListener m_listener;
-	private boolean m_bCancel;
+	private volatile boolean m_bCancel;
+	private final Object m_ready_lock = new Object();
 	private Reader  m_reader;
 	private boolean m_bStream;
 	private Fid.Format             m_format;
@@ -60,12 +65,14 @@ public class CaptureThread extends Thread
 			try{
 				//wait for reader to become ready
 				boolean bReady = false;
+				int nDelay = READY_POLL_MIN_MS;
 				while(!bReady && !m_bCancel){
 					Reader.Status rs = m_reader.GetStatus();
 					if(Reader.ReaderStatus.BUSY == rs.status){
-						//if busy, wait a bit
+						//if busy, wait a bit, cancel() wakes the thread up
 						try{
-							Thread.sleep(100);
+							WaitReady(nDelay);
+							nDelay = Math.min(2 * nDelay, READY_POLL_MAX_MS);
 						} 
 						catch(InterruptedException e) {
 							e.printStackTrace();
@@ -106,12 +113,14 @@ public class CaptureThread extends Thread
 		try{
 			//wait for reader to become ready
 			boolean bReady = false;
+			int nDelay = READY_POLL_MIN_MS;
 			while(!bReady && !m_bCancel){
 				Reader.Status rs = m_reader.GetStatus();
 				if(Reader.ReaderStatus.BUSY == rs.status){
-					//if busy, wait a bit
+					//if busy, wait a bit, cancel() wakes the thread up
 					try{
-						Thread.sleep(100);
+						WaitReady(nDelay);
+						nDelay = Math.min(2 * nDelay, READY_POLL_MAX_MS);
 					} 
 					catch(InterruptedException e) {
 						e.printStackTrace();
@@ -171,8 +180,18 @@ public class CaptureThread extends Thread
 		});
 	}
 	
+	private void WaitReady(int milliseconds) throws InterruptedException{
+		//the reader notifies of no status change, the wait is cut short only by cancel()
+		synchronized(m_ready_lock){
+			if(!m_bCancel) m_ready_lock.wait(milliseconds);
+		}
+	}
+	
 	public void cancel(){
 		m_bCancel = true;
+		synchronized(m_ready_lock){
+			m_ready_lock.notifyAll();
+		}
 		try{
 			if(!m_bStream) m_reader.CancelCapture();
 		}